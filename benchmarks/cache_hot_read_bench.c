@@ -0,0 +1,123 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "../include/cache.h"
+#include "../include/macros.h"
+#include "../include/thread.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Read scaling on a handful of hot keys shared by every thread.
+ *
+ * cache_get() takes a reference on each hit and cache_release() drops it,
+ * so all threads bounce the hot entries' ref_count lines between cores.
+ * cache_get_pinned() inside a cache_read_begin()/cache_read_end() section
+ * takes no reference; with the thread's epoch slot already pinned, a hit
+ * writes no shared memory at all.  Throughput is summed over threads.
+ */
+#define HOT_KEYS         16
+#define READS_PER_THREAD 2000000
+#define READS_PER_PIN    64 /* lookups per pinned section */
+#define MAX_THREADS      64
+
+typedef enum { MODE_LOCKED, MODE_OPTIMISTIC, MODE_PINNED } read_mode_t;
+
+typedef struct {
+    cache_t* cache;
+    read_mode_t mode;
+    size_t hits;
+} worker_t;
+
+static char keys[HOT_KEYS][16];
+static size_t key_lens[HOT_KEYS];
+
+static void* reader(void* arg) {
+    worker_t* w = arg;
+    size_t hits = 0;
+
+    if (w->mode == MODE_PINNED) {
+        for (size_t i = 0; i < READS_PER_THREAD; i += READS_PER_PIN) {
+            if (!cache_read_begin(w->cache)) continue;
+            for (size_t j = 0; j < READS_PER_PIN; j++) {
+                size_t k = (i + j) & (HOT_KEYS - 1);
+                if (cache_get_pinned(w->cache, keys[k], key_lens[k], NULL)) hits++;
+            }
+            cache_read_end(w->cache);
+        }
+    } else {
+        for (size_t i = 0; i < READS_PER_THREAD; i++) {
+            size_t k = i & (HOT_KEYS - 1);
+            const void* v = cache_get(w->cache, keys[k], key_lens[k], NULL);
+            if (v) {
+                hits++;
+                cache_release(v);
+            }
+        }
+    }
+    w->hits = hits;
+    return NULL;
+}
+
+/** Returns total lookups per second across `threads` readers. */
+static double run(read_mode_t mode, size_t threads) {
+    cache_config_t cfg = {
+        .capacity = 1024,
+        .read_mode = mode == MODE_LOCKED ? CACHE_READ_LOCKED : CACHE_READ_OPTIMISTIC,
+        .default_ttl = 3600,
+    };
+    cache_t* cache = cache_create_ex(&cfg);
+    if (!cache) return 0;
+    for (size_t k = 0; k < HOT_KEYS; k++) cache_set(cache, keys[k], key_lens[k], "hot value", 9, 0);
+
+    worker_t workers[MAX_THREADS];
+    Thread tids[MAX_THREADS];
+    uint64_t start = get_time_ns();
+    for (size_t t = 0; t < threads; t++) {
+        workers[t] = (worker_t){.cache = cache, .mode = mode};
+        thread_create(&tids[t], reader, &workers[t]);
+    }
+    size_t hits = 0;
+    for (size_t t = 0; t < threads; t++) {
+        thread_join(tids[t], NULL);
+        hits += workers[t].hits;
+    }
+    uint64_t elapsed = get_time_ns() - start;
+    cache_destroy(cache);
+
+    size_t reads = threads * READS_PER_THREAD;
+    if (hits != reads) fprintf(stderr, "Unexpected misses: %zu\n", reads - hits);
+    return elapsed ? (double)reads * 1e9 / (double)elapsed : 0;
+}
+
+int main(void) {
+    for (size_t k = 0; k < HOT_KEYS; k++) {
+        key_lens[k] = (size_t)snprintf(keys[k], sizeof(keys[k]), "hot:%zu", k);
+    }
+
+    long ncpus = get_ncpus();
+    size_t max_threads = ncpus > 0 && ncpus < MAX_THREADS ? (size_t)ncpus : MAX_THREADS;
+
+    printf("Cache Hot-Key Read Scaling\n");
+    printf("==========================\n");
+    printf("Hot keys: %d, Reads per thread: %d, Reads per pinned section: %d\n\n", HOT_KEYS, READS_PER_THREAD,
+           READS_PER_PIN);
+
+    printf("┌─────────┬─────────────────┬─────────────────┬─────────────────┐\n");
+    printf("│ Threads │  get (locked)   │ get (optimistic)│   get_pinned    │\n");
+    printf("│         │   (Mops/sec)    │   (Mops/sec)    │   (Mops/sec)    │\n");
+    printf("├─────────┼─────────────────┼─────────────────┼─────────────────┤\n");
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        double locked = run(MODE_LOCKED, threads);
+        double optimistic = run(MODE_OPTIMISTIC, threads);
+        double pinned = run(MODE_PINNED, threads);
+        printf("│ %7zu │   %10.2f    │   %10.2f    │   %10.2f    │\n", threads, locked / 1e6, optimistic / 1e6,
+               pinned / 1e6);
+    }
+    printf("└─────────┴─────────────────┴─────────────────┴─────────────────┘\n");
+    return 0;
+}
@@ -0,0 +1,251 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "../include/cache.h"
+#include "../include/macros.h"
+#include "../include/thread.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Trace-replay comparison of the CLOCK and TinyLFU policies.
+ *
+ * Each trace is a sequence of key ids replayed read-through: cache_get(),
+ * then cache_set() on a miss.  Hit ratio is the fraction of gets that hit;
+ * throughput counts replayed accesses per second on one thread.
+ *
+ * A second table measures read-only gets of the Zipf trace from several
+ * threads at once against a warmed cache, which is where the cost of
+ * recording reads in the TinyLFU sketch shows up.
+ */
+#define TRACE_LENGTH    2000000
+#define KEY_SPACE       1000000
+#define CACHE_CAPACITY  10000
+#define ZIPF_SKEW       0.99
+#define SCAN_EVERY      50000 /* scan trace: accesses between scans */
+#define SCAN_LENGTH     20000 /* scan trace: one-off keys per scan */
+#define GETS_PER_THREAD 2000000
+#define MAX_THREADS     64
+
+/** xorshift64* — deterministic, so both policies replay the same trace. */
+static inline uint64_t rng_next(uint64_t* s) {
+    uint64_t x = *s;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *s = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+static inline double rng_unit(uint64_t* s) {
+    return (double)(rng_next(s) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/** Cumulative Zipf distribution over KEY_SPACE ranks. */
+static double* zipf_cdf_create(size_t n, double skew) {
+    double* cdf = malloc(n * sizeof(double));
+    if (!cdf) return NULL;
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += 1.0 / pow((double)(i + 1), skew);
+        cdf[i] = sum;
+    }
+    for (size_t i = 0; i < n; i++) cdf[i] /= sum;
+    return cdf;
+}
+
+static uint32_t zipf_sample(const double* cdf, size_t n, uint64_t* rng) {
+    double u = rng_unit(rng);
+    size_t lo = 0, hi = n - 1;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cdf[mid] < u) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return (uint32_t)lo;
+}
+
+/** Pure Zipfian popularity. */
+static void trace_zipf(uint32_t* trace, size_t n, const double* cdf) {
+    uint64_t rng = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < n; i++) trace[i] = zipf_sample(cdf, KEY_SPACE, &rng);
+}
+
+/** Zipfian popularity interrupted by sequential scans of never-repeated keys. */
+static void trace_scan(uint32_t* trace, size_t n, const double* cdf) {
+    uint64_t rng = 0xD1B54A32D192ED03ull;
+    uint32_t scan_key = KEY_SPACE;
+    size_t i = 0;
+    while (i < n) {
+        for (size_t j = 0; j < SCAN_EVERY && i < n; j++) trace[i++] = zipf_sample(cdf, KEY_SPACE, &rng);
+        for (size_t j = 0; j < SCAN_LENGTH && i < n; j++) trace[i++] = scan_key++;
+    }
+}
+
+typedef struct {
+    double hit_ratio;
+    double ops_per_sec;
+} replay_result;
+
+static bool replay(cache_policy_t policy, const uint32_t* trace, size_t n, replay_result* out) {
+    cache_config_t cfg = {.capacity = CACHE_CAPACITY, .policy = policy, .default_ttl = 3600};
+    cache_t* cache = cache_create_ex(&cfg);
+    if (!cache) return false;
+
+    size_t hits = 0;
+    char key[16];
+    char value[64];
+    memset(value, 'v', sizeof(value));
+
+    uint64_t start = get_time_ns();
+    for (size_t i = 0; i < n; i++) {
+        int len = snprintf(key, sizeof(key), "k%u", trace[i]);
+        const void* v = cache_get(cache, key, (size_t)len, NULL);
+        if (v) {
+            hits++;
+            cache_release(v);
+        } else {
+            cache_set(cache, key, (size_t)len, value, sizeof(value), 0);
+        }
+    }
+    uint64_t elapsed = get_time_ns() - start;
+
+    cache_destroy(cache);
+    out->hit_ratio = (double)hits / (double)n;
+    out->ops_per_sec = elapsed ? (double)n * 1e9 / (double)elapsed : 0;
+    return true;
+}
+
+typedef struct {
+    cache_t* cache;
+    const uint32_t* trace;
+    size_t offset;
+    size_t hits;
+} get_worker_t;
+
+static void* get_worker(void* arg) {
+    get_worker_t* w = arg;
+    size_t hits = 0;
+    char key[16];
+    for (size_t i = 0; i < GETS_PER_THREAD; i++) {
+        int len = snprintf(key, sizeof(key), "k%u", w->trace[(w->offset + i) % TRACE_LENGTH]);
+        const void* v = cache_get(w->cache, key, (size_t)len, NULL);
+        if (v) {
+            hits++;
+            cache_release(v);
+        }
+    }
+    w->hits = hits;
+    return NULL;
+}
+
+/** Returns total gets per second across `threads` readers of a cache warmed by one replay. */
+static double concurrent_gets(cache_policy_t policy, const uint32_t* trace, size_t threads) {
+    cache_config_t cfg = {
+        .capacity = CACHE_CAPACITY,
+        .policy = policy,
+        .read_mode = CACHE_READ_OPTIMISTIC,
+        .default_ttl = 3600,
+    };
+    cache_t* cache = cache_create_ex(&cfg);
+    if (!cache) return 0;
+
+    char key[16];
+    char value[64];
+    memset(value, 'v', sizeof(value));
+    for (size_t i = 0; i < TRACE_LENGTH; i++) {
+        int len = snprintf(key, sizeof(key), "k%u", trace[i]);
+        const void* v = cache_get(cache, key, (size_t)len, NULL);
+        if (v) {
+            cache_release(v);
+        } else {
+            cache_set(cache, key, (size_t)len, value, sizeof(value), 0);
+        }
+    }
+
+    get_worker_t workers[MAX_THREADS];
+    Thread tids[MAX_THREADS];
+    uint64_t start = get_time_ns();
+    for (size_t t = 0; t < threads; t++) {
+        workers[t] = (get_worker_t){.cache = cache, .trace = trace, .offset = t * (TRACE_LENGTH / threads)};
+        thread_create(&tids[t], get_worker, &workers[t]);
+    }
+    for (size_t t = 0; t < threads; t++) thread_join(tids[t], NULL);
+    uint64_t elapsed = get_time_ns() - start;
+
+    cache_destroy(cache);
+    size_t gets = threads * GETS_PER_THREAD;
+    return elapsed ? (double)gets * 1e9 / (double)elapsed : 0;
+}
+
+int main(void) {
+    double* cdf = zipf_cdf_create(KEY_SPACE, ZIPF_SKEW);
+    uint32_t* trace = malloc(TRACE_LENGTH * sizeof(uint32_t));
+    if (!cdf || !trace) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    printf("Cache Policy Trace Replay\n");
+    printf("=========================\n");
+    printf("Accesses: %d, Key space: %d, Capacity: %d, Zipf skew: %.2f\n", TRACE_LENGTH, KEY_SPACE, CACHE_CAPACITY,
+           ZIPF_SKEW);
+    printf("Scan trace: %d one-off keys after every %d Zipfian accesses\n\n", SCAN_LENGTH, SCAN_EVERY);
+
+    printf("┌──────────────┬──────────┬─────────────┬─────────────────┐\n");
+    printf("│    Trace     │  Policy  │  Hit ratio  │  Throughput     │\n");
+    printf("│              │          │     (%%)     │    (Mops/sec)   │\n");
+    printf("├──────────────┼──────────┼─────────────┼─────────────────┤\n");
+
+    static const struct {
+        const char* name;
+        void (*build)(uint32_t*, size_t, const double*);
+    } traces[] = {{"zipf", trace_zipf}, {"zipf + scans", trace_scan}};
+    static const struct {
+        const char* name;
+        cache_policy_t policy;
+    } policies[] = {{"CLOCK", CACHE_POLICY_CLOCK}, {"TinyLFU", CACHE_POLICY_TINYLFU}};
+
+    for (size_t t = 0; t < ARRAY_SIZE(traces); t++) {
+        traces[t].build(trace, TRACE_LENGTH, cdf);
+        for (size_t p = 0; p < ARRAY_SIZE(policies); p++) {
+            replay_result r;
+            if (!replay(policies[p].policy, trace, TRACE_LENGTH, &r)) {
+                fprintf(stderr, "Failed to create cache\n");
+                return 1;
+            }
+            printf("│ %-12s │ %-8s │   %7.2f   │   %10.2f    │\n", traces[t].name, policies[p].name,
+                   r.hit_ratio * 100.0, r.ops_per_sec / 1e6);
+        }
+    }
+    printf("└──────────────┴──────────┴─────────────┴─────────────────┘\n");
+
+    long ncpus = get_ncpus();
+    size_t max_threads = ncpus > 0 && ncpus < MAX_THREADS ? (size_t)ncpus : MAX_THREADS;
+    trace_zipf(trace, TRACE_LENGTH, cdf);
+
+    printf("\nConcurrent gets, zipf trace, optimistic reads (%d gets per thread)\n\n", GETS_PER_THREAD);
+    printf("┌─────────┬─────────────────┬─────────────────┐\n");
+    printf("│ Threads │   CLOCK gets    │  TinyLFU gets   │\n");
+    printf("│         │   (Mops/sec)    │   (Mops/sec)    │\n");
+    printf("├─────────┼─────────────────┼─────────────────┤\n");
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        double clock = concurrent_gets(CACHE_POLICY_CLOCK, trace, threads);
+        double lfu = concurrent_gets(CACHE_POLICY_TINYLFU, trace, threads);
+        printf("│ %7zu │   %10.2f    │   %10.2f    │\n", threads, clock / 1e6, lfu / 1e6);
+    }
+    printf("└─────────┴─────────────────┴─────────────────┘\n");
+
+    free(trace);
+    free(cdf);
+    return 0;
+}
@@ -0,0 +1,160 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "../include/macros.h"
+#include "../include/thread.h"
+#include "../include/threadpool.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * threadpool_parallel_for() against hand-rolled static chunking.
+ *
+ * The static version is what callers wrote before: cut [0, N) into
+ * STATIC_CHUNKS_PER_THREAD equal chunks per worker, submit them with
+ * threadpool_submit_batch() and threadpool_wait().  parallel_for() uses
+ * grain 0 (automatic) and lazy binary splitting.
+ *
+ * Per-index cost is a number of hash rounds given by the workload:
+ *   uniform    — every index costs the same.
+ *   triangular — cost grows linearly with the index.
+ *   hotspot    — the last 2% of indices cost 50x the rest.
+ * On uniform work both should match; on skewed work static chunks leave
+ * most workers idle while the chunks covering the expensive region finish.
+ */
+#define N_ITEMS                  200000
+#define BASE_ROUNDS              64
+#define STATIC_CHUNKS_PER_THREAD 4
+#define NUM_RUNS                 3
+#define MAX_THREADS              64
+
+typedef enum { WL_UNIFORM, WL_TRIANGULAR, WL_HOTSPOT, WL_COUNT } workload_t;
+
+static const char* const workload_names[WL_COUNT] = {"uniform", "triangular", "hotspot"};
+
+static inline uint64_t fast_hash(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccd;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline size_t rounds_for(workload_t wl, size_t i) {
+    switch (wl) {
+        case WL_TRIANGULAR:
+            return 1 + (2 * BASE_ROUNDS * i) / N_ITEMS;
+        case WL_HOTSPOT:
+            return i >= N_ITEMS - N_ITEMS / 50 ? BASE_ROUNDS * 50 : BASE_ROUNDS;
+        default:
+            return BASE_ROUNDS;
+    }
+}
+
+static void process_range(workload_t wl, size_t begin, size_t end) {
+    uint64_t h = begin;
+    for (size_t i = begin; i < end; i++) {
+        size_t rounds = rounds_for(wl, i);
+        for (size_t r = 0; r < rounds; r++) h = fast_hash(h + r);
+    }
+
+    // Optimizer defeat, as in threadpool_bench.c
+#if defined(__GNUC__) || defined(__clang__)
+    __asm__ volatile("" : : "r"(h) : "memory");
+#else
+    volatile uint64_t compiler_sink = h;
+    (void)compiler_sink;
+#endif
+}
+
+/* ── parallel_for ───────────────────────────────────────────────────────── */
+
+static void pf_body(size_t begin, size_t end, void* ctx) {
+    process_range(*(const workload_t*)ctx, begin, end);
+}
+
+/* ── static chunking ────────────────────────────────────────────────────── */
+
+typedef struct {
+    workload_t wl;
+    size_t begin;
+    size_t end;
+} chunk_t;
+
+static void chunk_task(void* arg) {
+    const chunk_t* c = (const chunk_t*)arg;
+    process_range(c->wl, c->begin, c->end);
+}
+
+static void run_static(Threadpool* pool, size_t threads, workload_t wl) {
+    size_t nchunks = threads * STATIC_CHUNKS_PER_THREAD;
+    chunk_t* chunks = (chunk_t*)malloc(nchunks * sizeof(chunk_t));
+    void (**fns)(void*) = (void (**)(void*))malloc(nchunks * sizeof(*fns));
+    void** args = (void**)malloc(nchunks * sizeof(void*));
+    if (!chunks || !fns || !args) {
+        fprintf(stderr, "Allocation failed\n");
+        exit(1);
+    }
+    for (size_t c = 0; c < nchunks; c++) {
+        chunks[c] = (chunk_t){wl, N_ITEMS * c / nchunks, N_ITEMS * (c + 1) / nchunks};
+        fns[c] = chunk_task;
+        args[c] = &chunks[c];
+    }
+    threadpool_submit_batch(pool, fns, args, nchunks);
+    threadpool_wait(pool);
+    free(chunks);
+    free(fns);
+    free(args);
+}
+
+/** Returns the best of NUM_RUNS wall-clock times in milliseconds. */
+static double measure(size_t threads, workload_t wl, bool adaptive) {
+    Threadpool* pool = threadpool_create(threads);
+    if (!pool) {
+        fprintf(stderr, "Failed to create thread pool with %zu threads\n", threads);
+        exit(1);
+    }
+
+    double best = 0;
+    for (int run = 0; run < NUM_RUNS; run++) {
+        uint64_t start = get_time_ns();
+        if (adaptive) {
+            threadpool_parallel_for(pool, 0, N_ITEMS, 0, pf_body, &wl);
+        } else {
+            run_static(pool, threads, wl);
+        }
+        double ms = (double)(get_time_ns() - start) / 1e6;
+        if (run == 0 || ms < best) best = ms;
+    }
+
+    threadpool_destroy(pool, -1);
+    return best;
+}
+
+int main(void) {
+    long ncpus = get_ncpus();
+    size_t max_threads = ncpus > 0 && ncpus < MAX_THREADS ? (size_t)ncpus : MAX_THREADS;
+
+    printf("parallel_for vs Static Chunking\n");
+    printf("===============================\n");
+    printf("Items: %d, Base rounds/item: %d, Static chunks/thread: %d, Best of %d runs\n\n", N_ITEMS,
+           BASE_ROUNDS, STATIC_CHUNKS_PER_THREAD, NUM_RUNS);
+
+    for (int wl = 0; wl < WL_COUNT; wl++) {
+        printf("Workload: %s\n", workload_names[wl]);
+        printf("┌─────────┬─────────────────┬─────────────────┬─────────────────┐\n");
+        printf("│ Threads │  static (ms)    │ parallel_for(ms)│    speedup      │\n");
+        printf("├─────────┼─────────────────┼─────────────────┼─────────────────┤\n");
+        for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+            double st = measure(threads, (workload_t)wl, false);
+            double pf = measure(threads, (workload_t)wl, true);
+            printf("│ %7zu │   %10.2f    │   %10.2f    │   %10.2fx   │\n", threads, st, pf, pf > 0 ? st / pf : 0);
+        }
+        printf("└─────────┴─────────────────┴─────────────────┴─────────────────┘\n\n");
+    }
+    return 0;
+}
@@ -6,7 +6,7 @@
  * in size on each expansion up to ARENA_MAX_BLOCK_SIZE, then grow linearly.
  * Reset is O(1) and keeps committed pages alive for reuse.
  *
- * Two creation modes:
+ * Three creation modes:
  *
  *   // Heap-allocated arena struct (uses per-thread TLS buffer as first block):
  *   Arena* a = arena_create(0);
@@ -18,6 +18,11 @@
  *   arena_init(&a, buf, sizeof(buf));
  *   arena_destroy(&a);  // frees overflow blocks; buf is caller-owned
  *
+ *   // One contiguous virtual range, committed page by page on demand:
+ *   Arena* a = arena_create_reserved(0);
+ *   arena_decommit(a);  // hand pages above the cursor back to the OS
+ *   arena_destroy(a);
+ *
  * OOM behaviour
  * -------------
  * By default all allocation functions return NULL on failure, leaving error
@@ -37,6 +42,27 @@
  * Note: arena_realloc() is intentionally NOT annotated returns_nonnull even
  * when ARENA_ABORT_ON_OOM is set, because new_size==0 is a valid shrink-to-
  * nothing call that returns NULL by contract, not an allocation failure.
+ *
+ * Diagnostics
+ * -----------
+ * Two compile-time modes instrument the allocator.  Both change the layout
+ * of Arena, so they must be defined for the library and every translation
+ * unit that includes this header (the ARENA_STATS / ARENA_DEBUG CMake
+ * options do this).  With neither defined the hooks compile to nothing.
+ *
+ *   ARENA_STATS  Counts allocations, bytes requested versus padding, bytes
+ *                stranded by copying arena_realloc() calls and block tails
+ *                skipped by the slow path, plus per-block fill and the
+ *                high-water mark.  Read them with arena_stats() or print
+ *                them with arena_stats_dump() to size arena_create().
+ *
+ *   ARENA_DEBUG  Follows every allocation with ARENA_GUARD_SIZE guard bytes
+ *                and fills memory reclaimed by arena_reset()/arena_restore()
+ *                with ARENA_POISON_BYTE.  Guards are verified on reset,
+ *                restore and destroy, or on demand with arena_debug_check().
+ *                Under AddressSanitizer, guards and reclaimed memory are
+ *                also poisoned, so overflows and use-after-reset trap on
+ *                the offending access.
  */
 
 #ifndef ARENA_H
@@ -47,6 +73,10 @@
 #include <stdint.h>
 #include <string.h>
 
+#ifdef ARENA_STATS
+#include <stdio.h> /* FILE */
+#endif
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -131,6 +161,28 @@ extern "C" {
  */
 #define ARENA_MAX_BLOCK_SIZE (8 * 1024 * 1024) /* 8 MB */
 
+/** Virtual address range reserved by arena_create_reserved(0). */
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#define ARENA_DEFAULT_RESERVE_SIZE ((size_t)64 * 1024 * 1024 * 1024) /* 64 GB */
+#else
+#define ARENA_DEFAULT_RESERVE_SIZE ((size_t)256 * 1024 * 1024) /* 256 MB */
+#endif
+
+/**
+ * Minimum step by which a reserved arena commits pages.  Larger steps mean
+ * fewer commit system calls; smaller ones keep the resident set tighter.
+ */
+#define ARENA_COMMIT_GRANULE (64 * 1024) /* 64 KB */
+
+#ifdef ARENA_DEBUG
+/** Guard bytes placed after every allocation in ARENA_DEBUG builds. */
+#define ARENA_GUARD_SIZE 32
+/** Fill byte for memory reclaimed by arena_reset() / arena_restore(). */
+#define ARENA_POISON_BYTE 0xDD
+#else
+#define ARENA_GUARD_SIZE 0
+#endif
+
 /* -------------------------------------------------------------------------
  * Core types
  * ---------------------------------------------------------------------- */
@@ -152,6 +204,9 @@ typedef struct ArenaBlock {
     char* base;              /**< Start of usable region (after header + padding).       */
     char* end;               /**< One past the last byte of this block's allocation.     */
     bool is_static;          /**< True when the backing buffer is caller-owned.          */
+#ifdef ARENA_STATS
+    char* high_water; /**< Furthest cursor recorded in this block (updated when the cursor leaves it). */
+#endif
 } ArenaBlock;
 
 /**
@@ -166,10 +221,34 @@ typedef struct ArenaBlock {
  */
 typedef struct ArenaCheckpoint {
     char* saved_curr;        /**< Allocation cursor at the time of the save.  */
-    char* saved_end;         /**< Block end pointer at the time of the save.  */
     ArenaBlock* saved_block; /**< Active block at the time of the save.       */
+#ifdef ARENA_DEBUG
+    void* saved_guard; /**< Newest guard at the time of the save. */
+#endif
 } ArenaCheckpoint;
 
+#ifdef ARENA_STATS
+/**
+ * Allocation statistics (ARENA_STATS builds).  Counters accumulate from
+ * creation and survive arena_reset(); the last four fields are computed
+ * when arena_stats() is called.
+ */
+typedef struct ArenaStats {
+    size_t alloc_count;      /**< Successful allocations.                                    */
+    size_t bytes_requested;  /**< Bytes asked for, adjusted by in-place arena_realloc().     */
+    size_t bytes_padding;    /**< Alignment padding inserted before allocations.             */
+    size_t bytes_stranded;   /**< Old regions abandoned by copying arena_realloc() calls.    */
+    size_t bytes_tail_waste; /**< Block tails skipped because an allocation did not fit.     */
+    size_t realloc_in_place; /**< arena_realloc() calls served by moving the cursor.         */
+    size_t realloc_copied;   /**< arena_realloc() calls that allocated and copied.           */
+    size_t reclaim_count;    /**< arena_reset() and arena_restore() calls.                   */
+    size_t peak_used;        /**< High-water mark of arena_used_size().                      */
+    size_t bytes_used;       /**< arena_used_size() now.                                     */
+    size_t bytes_committed;  /**< arena_committed_size() now.                                */
+    size_t block_count;      /**< Blocks in the chain.                                       */
+} ArenaStats;
+#endif
+
 /**
  * Arena control structure.
  *
@@ -186,11 +265,42 @@ typedef struct Arena {
     ArenaBlock* head;          /**< Head of the block chain (always the first block).       */
     size_t page_size;          /**< OS page size used to round block sizes (usually 4096).  */
     size_t total_committed;    /**< Total bytes across all committed blocks.              */
+    char* reserve_end;         /**< End of the reserved range (arena_create_reserved()), else NULL. */
     bool heap_allocated;       /**< True when this struct was allocated by arena_create(). */
     bool* tls_in_use_origin;   /* == &static_buffer_in_use on creating thread */
     ArenaBlock first_block;    /**< Embedded descriptor for the initial backing buffer.     */
+#ifdef ARENA_STATS
+    ArenaStats stats; /**< Running counters; read through arena_stats(). */
+#endif
+#ifdef ARENA_DEBUG
+    void* last_guard; /**< Newest guard; guards link back to their predecessors. */
+#endif
 } Arena;
 
+/* -------------------------------------------------------------------------
+ * Diagnostic hooks (ARENA_STATS / ARENA_DEBUG) — not for direct use
+ * ---------------------------------------------------------------------- */
+
+#if defined(ARENA_STATS) || defined(ARENA_DEBUG)
+/** @private Records a new allocation of @p size bytes after @p padding bytes of alignment. */
+void _arena_on_alloc(Arena* arena, void* ptr, size_t size, size_t padding);
+/** @private Records an in-place resize of the last allocation. */
+void _arena_on_resize(Arena* arena, void* ptr, size_t old_size, size_t new_size);
+/** @private Records a copying arena_realloc() that abandoned @p old_size bytes. */
+void _arena_on_realloc_copy(Arena* arena, size_t old_size);
+/** @private Runs before the cursor moves back to @p cp (NULL: arena_reset()). */
+void _arena_on_reclaim(Arena* arena, const ArenaCheckpoint* cp);
+#define ARENA_ON_ALLOC(a, p, s, pad)   _arena_on_alloc((a), (p), (s), (pad))
+#define ARENA_ON_RESIZE(a, p, os, ns)  _arena_on_resize((a), (p), (os), (ns))
+#define ARENA_ON_REALLOC_COPY(a, os)   _arena_on_realloc_copy((a), (os))
+#define ARENA_ON_RECLAIM(a, cp)        _arena_on_reclaim((a), (cp))
+#else
+#define ARENA_ON_ALLOC(a, p, s, pad)  ((void)0)
+#define ARENA_ON_RESIZE(a, p, os, ns) ((void)0)
+#define ARENA_ON_REALLOC_COPY(a, os)  ((void)0)
+#define ARENA_ON_RECLAIM(a, cp)       ((void)0)
+#endif
+
 /* -------------------------------------------------------------------------
  * Lifecycle
  * ---------------------------------------------------------------------- */
@@ -221,6 +331,23 @@ void arena_init(Arena* a, void* buf, size_t size);
  */
 Arena* arena_create(size_t reserve_size);
 
+/**
+ * Allocates an Arena backed by a single reserved virtual address range.
+ *
+ * The range is reserved without being backed by memory (mmap(PROT_NONE) /
+ * VirtualAlloc(MEM_RESERVE)) and pages are committed in
+ * ARENA_COMMIT_GRANULE steps as the cursor advances.  The arena therefore
+ * never chains blocks: no bytes are stranded at block ends, and
+ * arena_realloc() of the last allocation always grows in place.  Once the
+ * reservation is used up, allocations fail instead of chaining a new block.
+ *
+ * @param reserve_size Bytes of address space to reserve, rounded up to a
+ *                     page.  Pass 0 for ARENA_DEFAULT_RESERVE_SIZE.
+ * @return Pointer to a ready-to-use Arena, or NULL if the reservation or
+ *         the first commit fails.
+ */
+Arena* arena_create_reserved(size_t reserve_size);
+
 /**
  * Resets the arena, making all committed memory available for reuse.
  *
@@ -231,6 +358,7 @@ Arena* arena_create(size_t reserve_size);
  */
 static ARENA_INLINE void arena_reset(Arena* a) {
     if (!a || !a->head) return;
+    ARENA_ON_RECLAIM(a, NULL);
     a->current_block = a->head;
     a->curr = a->head->base;
     a->end = a->head->end;
@@ -248,6 +376,22 @@ static ARENA_INLINE void arena_reset(Arena* a) {
  */
 void arena_destroy(Arena* a);
 
+/**
+ * Returns memory the arena holds but does not currently use to the OS.
+ *
+ * Call it after arena_reset() or arena_restore() to shed the footprint of a
+ * spike.  A reserved arena keeps ARENA_COMMIT_GRANULE of committed headroom
+ * above its cursor, so the next allocations do not commit the pages straight
+ * back, and decommits the pages beyond that (the address range stays
+ * reserved and is recommitted on demand); a block-chain arena frees the
+ * overflow blocks after the current one.  Live allocations are untouched,
+ * but checkpoints taken beyond the current cursor become invalid.
+ *
+ * @param a Arena to trim.  NULL is safely ignored.
+ * @return Bytes released.
+ */
+size_t arena_decommit(Arena* a);
+
 /* -------------------------------------------------------------------------
  * Checkpoint (save / restore)
  * ---------------------------------------------------------------------- */
@@ -270,8 +414,10 @@ void arena_destroy(Arena* a);
 static ARENA_INLINE ArenaCheckpoint arena_save(const Arena* a) {
     return (ArenaCheckpoint){
         .saved_curr = a->curr,
-        .saved_end = a->end,
         .saved_block = a->current_block,
+#ifdef ARENA_DEBUG
+        .saved_guard = a->last_guard,
+#endif
     };
 }
 
@@ -286,8 +432,11 @@ static ARENA_INLINE ArenaCheckpoint arena_save(const Arena* a) {
  * @param cp  Checkpoint returned by arena_save() on the same arena.
  */
 static ARENA_INLINE void arena_restore(Arena* a, ArenaCheckpoint cp) {
+    ARENA_ON_RECLAIM(a, &cp);
     a->curr = cp.saved_curr;
-    a->end = cp.saved_end;
+    /* A reserved arena's block grows and shrinks with commits, so take the
+     * block's live end rather than the one current at the save. */
+    a->end = cp.saved_block->end;
     a->current_block = cp.saved_block;
 }
 
@@ -342,6 +491,18 @@ static ARENA_INLINE size_t arena_used_size(const Arena* a) {
  */
 void* _arena_alloc_slow(Arena* arena, size_t size, size_t alignment);
 
+/**
+ * @private
+ * Commits pages of a reserved arena (reserve_end != NULL) so the current block reaches at least
+ * @p new_end.  Used by arena_realloc() to grow the last allocation in place.
+ *
+ * @param arena   The arena to extend.
+ * @param new_end Required end of the committed region.
+ * @return true on success, false when the reservation is exhausted or the
+ *         commit fails.
+ */
+bool _arena_extend(Arena* arena, char* new_end);
+
 /* -------------------------------------------------------------------------
  * Core allocation functions
  * ---------------------------------------------------------------------- */
@@ -374,17 +535,18 @@ ARENA_ATTR_ALLOC_SIZE(2) void* arena_alloc_align(Arena* arena, size_t size, size
 
     uintptr_t curr = (uintptr_t)arena->curr;
     uintptr_t aligned = (curr + alignment - 1) & ~(uintptr_t)(alignment - 1);
-    uintptr_t next = aligned + size;
+    uintptr_t next = aligned + size + ARENA_GUARD_SIZE;
 
     if (ARENA_LIKELY(next <= (uintptr_t)arena->end)) {
         arena->curr = (char*)next;
         /* Prefetch the allocated region; hides DRAM latency when the caller
          * immediately writes the object (the common case). */
         ARENA_PREFETCH((void*)aligned);
+        ARENA_ON_ALLOC(arena, (void*)aligned, size, aligned - curr);
         return (void*)aligned;
     }
 
-    void* ptr = _arena_alloc_slow(arena, size, alignment);
+    void* ptr = _arena_alloc_slow(arena, size + ARENA_GUARD_SIZE, alignment);
     if (ARENA_UNLIKELY(!ptr)) {
 #ifdef ARENA_ABORT_ON_OOM
         ARENA_OOM_HANDLER(size);
@@ -393,6 +555,7 @@ ARENA_ATTR_ALLOC_SIZE(2) void* arena_alloc_align(Arena* arena, size_t size, size
         return NULL;
 #endif
     }
+    ARENA_ON_ALLOC(arena, ptr, size, 0); /* the slow path records its own padding */
     return ptr;
 }
 
@@ -431,15 +594,16 @@ static ARENA_NONNULL_ ARENA_INLINE ARENA_ATTR_MALLOC ARENA_ATTR_ALLOC_SIZE(2) vo
 #endif
 
     char* ptr = arena->curr;
-    char* next = ptr + size;
+    char* next = ptr + size + ARENA_GUARD_SIZE;
 
     if (ARENA_LIKELY(next <= arena->end)) {
         arena->curr = next;
         ARENA_PREFETCH(ptr);
+        ARENA_ON_ALLOC(arena, ptr, size, 0);
         return ptr;
     }
 
-    void* p = _arena_alloc_slow(arena, size, 1);
+    void* p = _arena_alloc_slow(arena, size + ARENA_GUARD_SIZE, 1);
     if (ARENA_UNLIKELY(!p)) {
 #ifdef ARENA_ABORT_ON_OOM
         ARENA_OOM_HANDLER(size);
@@ -448,6 +612,7 @@ static ARENA_NONNULL_ ARENA_INLINE ARENA_ATTR_MALLOC ARENA_ATTR_ALLOC_SIZE(2) vo
         return NULL;
 #endif
     }
+    ARENA_ON_ALLOC(arena, p, size, 0);
     return p;
 }
 
@@ -462,7 +627,8 @@ static ARENA_NONNULL_ ARENA_INLINE ARENA_ATTR_MALLOC ARENA_ATTR_ALLOC_SIZE(2) vo
  * new size fits in the current block, the bump cursor is adjusted in place —
  * zero copies, zero allocations.  Shrinking is always O(1) regardless of
  * position.  Falls back to arena_alloc_align() + memcpy() only when the
- * in-place extend would cross a block boundary.
+ * in-place extend would cross a block boundary; a reserved arena commits
+ * more pages instead, so its last allocation never moves.
  *
  * Special cases:
  *  - @p old_ptr == NULL or @p old_size == 0: behaves like arena_alloc_align().
@@ -482,18 +648,26 @@ static ARENA_INLINE void* arena_realloc(Arena* arena, void* old_ptr, size_t old_
                                         size_t alignment) {
     if (!old_ptr || old_size == 0) { return arena_alloc_align(arena, new_size, alignment); }
 
+    /* The last allocation ends at the cursor (after its guard in ARENA_DEBUG builds). */
+    bool is_last = (char*)old_ptr + old_size + ARENA_GUARD_SIZE == arena->curr;
+
     if (new_size == 0) {
         /* Shrink to nothing: reclaim bytes only if this was the last alloc. */
-        if ((char*)old_ptr + old_size == arena->curr) { arena->curr = (char*)old_ptr; }
+        if (is_last) {
+            ARENA_ON_RESIZE(arena, old_ptr, old_size, 0);
+            arena->curr = (char*)old_ptr;
+        }
         /* NULL here is a defined contract value, not an OOM — do not invoke
          * ARENA_OOM_HANDLER. */
         return NULL;
     }
 
     /* Fast path: old_ptr was the last allocation in the current block. */
-    if ((char*)old_ptr + old_size == arena->curr) {
-        char* new_end = (char*)old_ptr + new_size;
-        if (new_size <= old_size || new_end <= arena->end) {
+    if (is_last) {
+        char* new_end = (char*)old_ptr + new_size + ARENA_GUARD_SIZE;
+        if (new_size <= old_size || new_end <= arena->end ||
+            (arena->reserve_end && _arena_extend(arena, new_end))) {
+            ARENA_ON_RESIZE(arena, old_ptr, old_size, new_size);
             arena->curr = new_end;
             return old_ptr;
         }
@@ -507,6 +681,7 @@ static ARENA_INLINE void* arena_realloc(Arena* arena, void* old_ptr, size_t old_
         return NULL;
     }
     memcpy(new_ptr, old_ptr, old_size < new_size ? old_size : new_size);
+    ARENA_ON_REALLOC_COPY(arena, old_size);
     return new_ptr;
 }
 
@@ -664,6 +839,154 @@ static ARENA_INLINE char* arena_strdupn(Arena* arena, const char* str, size_t le
     return dup;
 }
 
+/* -------------------------------------------------------------------------
+ * Diagnostics
+ * ---------------------------------------------------------------------- */
+
+#ifdef ARENA_STATS
+/**
+ * Snapshots the arena's statistics (ARENA_STATS builds).
+ *
+ * @param a   Arena to query.
+ * @param out Receives the counters plus the current used, committed and
+ *            block figures.  Zeroed if @p a is NULL.
+ */
+void arena_stats(const Arena* a, ArenaStats* out);
+
+/**
+ * Prints the statistics and the fill of every block to @p out
+ * (ARENA_STATS builds).
+ *
+ * @param a     Arena to report on.  NULL prints nothing.
+ * @param label Name printed in the header line; may be NULL.
+ * @param out   Destination stream, e.g. stderr.
+ */
+void arena_stats_dump(const Arena* a, const char* label, FILE* out);
+#endif
+
+#ifdef ARENA_DEBUG
+/**
+ * Verifies the guard bytes of every live allocation (ARENA_DEBUG builds).
+ *
+ * Guards are walked newest first; the walk stops at the first overwritten
+ * guard, which is reported on stderr with the address and size of the
+ * allocation that overflowed into it.
+ *
+ * @param a Arena to check.  NULL counts as intact.
+ * @return true if every guard is intact.
+ */
+bool arena_debug_check(const Arena* a);
+#endif
+
+/* -------------------------------------------------------------------------
+ * Concurrent arena
+ *
+ * A thread-safe arena for batches shared by many threads (parallel parsers,
+ * threadpool tasks).  Each thread bump-allocates from a private chunk of
+ * ARENA_CHUNK_SIZE bytes with no atomics and no locks; a fresh chunk is
+ * carved from the shared current block with a single atomic fetch-add, and
+ * only replacing an exhausted block takes a lock.  Memory is released all
+ * at once by carena_reset() or carena_destroy().
+ *
+ *   ConcurrentArena* ca = carena_create(0);
+ *   // any number of threads:
+ *   Node* n = carena_alloc(ca, sizeof(Node));
+ *   // once every thread is done with the batch:
+ *   carena_reset(ca);
+ * ---------------------------------------------------------------------- */
+
+/** Bytes each thread claims from the shared block per carve. */
+#define ARENA_CHUNK_SIZE (16 * 1024) /* 16 KB */
+
+/** Default shared block size for carena_create(0). */
+#define ARENA_CONCURRENT_BLOCK_SIZE (1024 * 1024) /* 1 MB */
+
+/** Opaque thread-safe arena. */
+typedef struct ConcurrentArena ConcurrentArena;
+
+/**
+ * Creates a concurrent arena.
+ *
+ * @param block_size Size of each shared block in bytes (0 = 1 MB).  Values
+ *                   below 4 * ARENA_CHUNK_SIZE are raised to it.
+ * @return New arena, or NULL on allocation failure.
+ */
+ConcurrentArena* carena_create(size_t block_size);
+
+/**
+ * Allocates @p size bytes aligned to @p alignment.  Thread-safe.
+ *
+ * Requests up to ARENA_CHUNK_SIZE / 4 come from the calling thread's chunk;
+ * larger ones are carved from the shared block directly (or get a block of
+ * their own when larger than half a block).
+ *
+ * @param arena     The owning arena.
+ * @param size      Bytes to allocate.  0 returns NULL.
+ * @param alignment Power-of-two alignment, at most 64 bytes.
+ * @return Aligned pointer valid until carena_reset() or carena_destroy(),
+ *         or NULL on failure.
+ */
+ARENA_ATTR_MALLOC ARENA_ATTR_ALLOC_SIZE(2) void* carena_alloc_align(ConcurrentArena* arena, size_t size,
+                                                                    size_t alignment);
+
+/**
+ * Allocates @p size bytes with ARENA_DEFAULT_ALIGN alignment.  Thread-safe.
+ *
+ * @param arena The owning arena.
+ * @param size  Bytes to allocate.
+ * @return 16-byte-aligned pointer, or NULL on failure.
+ */
+static ARENA_INLINE ARENA_ATTR_MALLOC ARENA_ATTR_ALLOC_SIZE(2) void* carena_alloc(ConcurrentArena* arena,
+                                                                                  size_t size) {
+    return carena_alloc_align(arena, size, ARENA_DEFAULT_ALIGN);
+}
+
+/**
+ * Duplicates a null-terminated string into the arena.  Thread-safe.
+ *
+ * @param arena The owning arena.
+ * @param str   Null-terminated source string.
+ * @return Arena-owned copy, or NULL if an argument is NULL or allocation fails.
+ */
+static ARENA_INLINE char* carena_strdup(ConcurrentArena* arena, const char* str) {
+    if (ARENA_UNLIKELY(!arena || !str)) return NULL;
+    size_t len = strlen(str);
+    char* dup = (char*)carena_alloc_align(arena, len + 1, 1);
+    if (ARENA_UNLIKELY(!dup)) return NULL;
+    memcpy(dup, str, len + 1);
+    return dup;
+}
+
+/**
+ * Makes all memory available for reuse, invalidating every pointer the
+ * arena has returned.  Shared blocks stay committed; oversized dedicated
+ * blocks are freed.  Chunks that threads still hold are abandoned, not
+ * reused.
+ *
+ * Not thread-safe: no other thread may allocate from the arena during the
+ * call.
+ *
+ * @param arena Arena to reset.  NULL is safely ignored.
+ */
+void carena_reset(ConcurrentArena* arena);
+
+/**
+ * Frees every block and the arena itself.  No other thread may use the
+ * arena during or after the call.
+ *
+ * @param arena Arena to destroy.  NULL is safely ignored.
+ */
+void carena_destroy(ConcurrentArena* arena);
+
+/**
+ * Returns the bytes committed across all blocks.  Thread-safe; the value
+ * is a snapshot while other threads allocate.
+ *
+ * @param arena Arena to query.
+ * @return Committed bytes, or 0 for NULL.
+ */
+size_t carena_committed_size(ConcurrentArena* arena);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -14,8 +14,9 @@ extern "C" {
 #include <stddef.h>
 #include <stdint.h>
 
-#define CACHE_SHARD_COUNT 32
+#define CACHE_SHARD_COUNT 32 /* default shard count; see cache_config_t.shard_count */
 #define CACHE_DEFAULT_TTL 300
+#define CACHE_HOT_KEY_MAX 64 /* bytes kept per hot key, including the NUL */
 
 /**
  * Opaque handle to the cache.
@@ -24,6 +25,234 @@ extern "C" {
  */
 typedef struct cache_s cache_t;
 
+/**
+ * How cache_get() synchronises with concurrent writers.
+ */
+typedef enum {
+    /** Readers take the shard read lock (default). */
+    CACHE_READ_LOCKED = 0,
+    /**
+     * Readers probe the shard under a per-shard sequence counter without
+     * writing to the lock word, retrying or falling back to the read lock
+     * only when a writer raced.  Unlinked entries are reclaimed after an
+     * epoch-based grace period, which slightly delays memory release.
+     */
+    CACHE_READ_OPTIMISTIC = 1,
+} cache_read_mode_t;
+
+/**
+ * Which entries a full shard keeps when a new key arrives.
+ */
+typedef enum {
+    /** Always admit the new key and evict the CLOCK victim (default). */
+    CACHE_POLICY_CLOCK = 0,
+    /**
+     * TinyLFU: a per-shard count-min sketch estimates recent access
+     * frequency, and a new key is admitted only if it is estimated hotter
+     * than the CLOCK victim it would replace.  Resists scans and one-hit
+     * wonders at the cost of 16 one-byte counters per entry of capacity,
+     * rounded up to a power of two per shard (16 to 32 bytes per entry);
+     * cache_set() returns false when the key is not admitted.
+     */
+    CACHE_POLICY_TINYLFU = 1,
+} cache_policy_t;
+
+/**
+ * Key hash used to place entries in shards and slots.
+ * Must be deterministic for a given (key, len, seed) and should mix every
+ * input bit into the result; only the seed makes placement unpredictable.
+ */
+typedef uint64_t (*cache_hash_fn)(const void* key, size_t len, uint64_t seed);
+
+/**
+ * Creation options for cache_create_ex().
+ * Zero-initialise and set only the fields you need; zero means "default".
+ */
+typedef struct {
+    size_t capacity;             /**< Total maximum number of entries (0 = 1000). */
+    uint32_t default_ttl;        /**< Default time-to-live in seconds (0 = CACHE_DEFAULT_TTL). */
+    uint64_t default_ttl_ms;     /**< Default time-to-live in ms; overrides default_ttl when non-zero. */
+    size_t shard_count;          /**< Power of two, at most 4096 (0 = CACHE_SHARD_COUNT). */
+    cache_read_mode_t read_mode; /**< Read synchronisation mode (default CACHE_READ_LOCKED). */
+    cache_policy_t policy;       /**< Admission/eviction policy (default CACHE_POLICY_CLOCK). */
+
+    /**
+     * Fraction of each shard's slots in use at capacity, in (0, 0.95]
+     * (0 = 0.5).  Tags are probed a SIMD group at a time, so higher values
+     * trade a little probe time for a much smaller slot array.
+     */
+    float max_load_factor;
+
+    /**
+     * Key hash (NULL = XXH3-64).  The seed defaults to a random value drawn
+     * once per process, so keys cannot be crafted offline to collide into
+     * one shard; pass a fixed seed only when placement must be reproducible,
+     * such as for contention-free cache_load_ex() after a restart.
+     */
+    cache_hash_fn hash_fn;
+    uint64_t hash_seed; /**< Hash seed (0 = random per-process seed). */
+
+    /**
+     * Spread shards' slot arrays round-robin over the online NUMA nodes
+     * (shard i on node i % node_count).  Linux only; ignored elsewhere or
+     * on single-node hosts.
+     */
+    bool numa_interleave;
+
+    /**
+     * Optional explicit NUMA node per shard (shard_count elements, -1 for no
+     * preference).  Takes precedence over numa_interleave.  Only read during
+     * cache_create_ex().
+     */
+    const int* shard_numa_nodes;
+
+    /**
+     * Period of an optional background sweeper thread that calls
+     * cache_tick() (0 = no thread; call cache_tick() yourself if needed).
+     */
+    uint32_t sweep_interval_ms;
+    size_t sweep_budget; /**< Slots examined per sweeper tick (0 = 4096). */
+
+    /**
+     * Hard memory budget in bytes for entry storage, split evenly across
+     * shards (0 = unlimited).  Inserts evict until the shard is back under
+     * its share; an entry larger than a shard's share is rejected.  The
+     * entry-count capacity still applies as well.
+     */
+    size_t max_bytes;
+
+    /**
+     * Allocate entries from per-shard, size-classed slabs instead of one
+     * malloc() per entry.  Freed blocks are reused by later inserts of the
+     * same class; entries above 32 KiB still use malloc().
+     */
+    bool slab_alloc;
+
+    /**
+     * Number of candidates in the sampled hot-key tracker read by
+     * cache_hot_keys() (0 = disabled).  Keep it a few times larger than the
+     * number of hot keys you want reported.
+     */
+    size_t hot_keys;
+
+    /**
+     * Feed one get in this many per thread to the hot-key tracker
+     * (0 = 64).  Sampled gets try-lock the tracker and skip the sample
+     * when it is busy, so they never wait.
+     */
+    uint32_t hot_key_sample;
+
+    /**
+     * Probabilistic early refresh for entries stored by cache_get_or_load()
+     * (0 = off; 1 is a good start, larger refreshes earlier).  A hit may
+     * reload the value before it expires.  The chance rises as expiry
+     * nears and scales with how long the last load took, so a hot key is
+     * usually refreshed by one caller before it expires for everyone.
+     */
+    float refresh_beta;
+} cache_config_t;
+
+/**
+ * Cache-wide counters returned by cache_stats().
+ * Counters are cumulative since creation.
+ */
+typedef struct {
+    uint64_t hits;        /**< Gets that returned a value. */
+    uint64_t misses;      /**< Gets that found nothing or an expired entry. */
+    uint64_t sets;        /**< Entries stored by set calls and loads. */
+    uint64_t rejections;  /**< Sets refused by the admission policy or byte budget. */
+    uint64_t evictions;   /**< Entries evicted to honour capacity or the byte budget. */
+    uint64_t expirations; /**< Expired entries removed by gets, sweeps or cache_tick(). */
+    uint64_t compactions; /**< Shard rebuilds started to clear tombstones. */
+    uint64_t lock_spins;  /**< Failed shard-lock attempts, readers and writers combined. */
+    size_t entries;       /**< Live entries. */
+    size_t capacity;      /**< Total capacity. */
+    size_t bytes;         /**< Bytes charged to live entries. */
+    size_t shard_count;   /**< Number of shards, for cache_shard_stats(). */
+} cache_stats_t;
+
+/**
+ * One shard's occupancy and write-side counters, from cache_shard_stats().
+ * Uneven entries or write_spins across shards point at hot keys or too few
+ * shards.
+ */
+typedef struct {
+    size_t entries;       /**< Live entries. */
+    size_t capacity;      /**< Maximum live entries. */
+    size_t buckets;       /**< Slots in the current table. */
+    size_t tombstones;    /**< Deleted slots in the current table. */
+    size_t bytes;         /**< Bytes charged to live entries. */
+    bool rehashing;       /**< A resize or compaction is migrating entries. */
+    uint64_t sets;        /**< Entries stored. */
+    uint64_t rejections;  /**< Sets refused by admission or the byte budget. */
+    uint64_t evictions;   /**< Entries evicted. */
+    uint64_t expirations; /**< Expired entries removed. */
+    uint64_t compactions; /**< Rebuilds started to clear tombstones. */
+    uint64_t write_spins; /**< Failed write-lock attempts. */
+} cache_shard_stats_t;
+
+/** One entry of cache_hot_keys(). */
+typedef struct {
+    char key[CACHE_HOT_KEY_MAX]; /**< Key, truncated to CACHE_HOT_KEY_MAX - 1 bytes and NUL-terminated. */
+    size_t key_len;              /**< Full key length. */
+    uint64_t hits;               /**< Estimated gets: sampled count times the sample rate (an upper bound). */
+} cache_hot_key_t;
+
+/**
+ * Reserves an entry for key and returns its writable value region, so a
+ * large value can be serialized straight into the entry instead of into a
+ * separate buffer that cache_set() would copy.
+ *
+ * The entry is invisible to readers until cache_commit().  Every
+ * successful reservation must end in exactly one cache_commit() or
+ * cache_abort().
+ *
+ * @param cache The cache handle.
+ * @param key The key.
+ * @param key_len The length of the key.
+ * @param value_len Exact size of the value to be written.
+ * @return Writable pointer to value_len bytes, or NULL on failure.
+ */
+void* cache_reserve(cache_t* cache, const char* key, size_t key_len, size_t value_len);
+
+/**
+ * Publishes a value filled in after cache_reserve(), replacing any entry
+ * with the same key.  The TTL starts at the commit.
+ * @param cache The cache that reserved value.
+ * @param value The pointer returned by cache_reserve().
+ * @param ttl_ms Optional TTL in milliseconds (0 uses default).
+ * @return true on success.  On false (admission or byte budget refused
+ *         the entry) the reservation has been released.  Either way,
+ *         value must not be used afterwards.
+ */
+bool cache_commit(cache_t* cache, void* value, uint64_t ttl_ms);
+
+/**
+ * Releases a reservation without publishing it.
+ * @param value The pointer returned by cache_reserve(), or NULL.
+ */
+void cache_abort(void* value);
+
+/**
+ * Value produced by a cache_loader_fn.
+ * The cache copies value before the loader's caller returns, then calls
+ * free_value(value) when it is set.
+ */
+typedef struct {
+    const void* value;               /**< Loaded bytes. */
+    size_t value_len;                /**< Length of value; 0 counts as a failed load. */
+    uint64_t ttl_ms;                 /**< TTL in milliseconds (0 uses the default). */
+    void (*free_value)(void* value); /**< Optional destructor for value. */
+} cache_loaded_t;
+
+/**
+ * Computes the value for a key missing from the cache.
+ * Runs without any cache lock held; it must not load the same key again
+ * through cache_get_or_load(), which would wait on itself.
+ * @return true with *out filled in, or false if the value is unavailable.
+ */
+typedef bool (*cache_loader_fn)(const char* key, size_t key_len, void* ctx, cache_loaded_t* out);
+
 /**
  * Creates a new cache.
  * @param capacity Total maximum number of entries (distributed across shards).
@@ -32,6 +261,20 @@ typedef struct cache_s cache_t;
  */
 cache_t* cache_create(size_t capacity, uint32_t default_ttl);
 
+/**
+ * Creates a new cache with explicit options.
+ *
+ * A larger shard count reduces write-lock contention on many-core hosts at
+ * the cost of a coarser per-shard capacity split.  NUMA placement applies to
+ * each shard's slot arrays, including arrays rebuilt later by compaction or
+ * cache_resize().
+ *
+ * @param config Creation options; must not be NULL.
+ * @return Pointer to new cache, or NULL on failure or invalid options
+ *         (e.g. a shard count that is not a power of two).
+ */
+cache_t* cache_create_ex(const cache_config_t* config);
+
 /**
  * Destroys the cache and frees resources.
  * Note: Zero-copy references held by users remain valid until cache_release() is called,
@@ -39,6 +282,15 @@ cache_t* cache_create(size_t capacity, uint32_t default_ttl);
  */
 void cache_destroy(cache_t* cache);
 
+/**
+ * Selects the read synchronisation mode.
+ * Call before the cache is shared between threads.
+ * @param cache The cache handle.
+ * @param mode One of cache_read_mode_t.
+ * @return true on success, false on invalid arguments.
+ */
+bool cache_set_read_mode(cache_t* cache, cache_read_mode_t mode);
+
 /**
  * Zero-Copy Retrieval.
  * @param cache The cache handle.
@@ -56,6 +308,45 @@ const void* cache_get(cache_t* cache, const char* key, size_t key_len, size_t* o
  */
 void cache_release(const void* ptr);
 
+/**
+ * Opens a pinned read section on the calling thread for cache_get_pinned().
+ *
+ * Only caches in CACHE_READ_OPTIMISTIC mode support pinning.  Sections
+ * nest; each successful call needs a matching cache_read_end().  Memory
+ * unlinked by writers anywhere is not reclaimed while any thread is
+ * pinned, so keep sections short (one request, not a thread's lifetime).
+ *
+ * @param cache The cache handle.
+ * @return true if the thread is pinned.  false for a locked-mode cache or
+ *         when every reader slot is busy; use cache_get() instead.
+ */
+bool cache_read_begin(cache_t* cache);
+
+/**
+ * Closes a section opened by cache_read_begin().  Values returned by
+ * cache_get_pinned() must not be used after the outermost call.
+ * @param cache The cache handle.
+ */
+void cache_read_end(cache_t* cache);
+
+/**
+ * Zero-copy retrieval inside a pinned read section.
+ *
+ * Unlike cache_get(), no reference is taken: a hit writes no shared
+ * memory, so many threads reading the same hot entries do not contend on
+ * its reference count.  The value stays valid until cache_read_end(), even
+ * if the entry is replaced or evicted meanwhile.  Do not call
+ * cache_release() on it.
+ *
+ * @param cache Any CACHE_READ_OPTIMISTIC cache; one pin covers them all.
+ * @param key The lookup key.
+ * @param key_len The length of the key.
+ * @param out_len Pointer to store the size of the retrieved value.
+ * @return Pointer to the value data, or NULL if not found or the thread
+ *         is not inside a pinned section.
+ */
+const void* cache_get_pinned(cache_t* cache, const char* key, size_t key_len, size_t* out_len);
+
 /**
  * Stores a value in the cache.
  * @param cache The cache handle.
@@ -63,11 +354,127 @@ void cache_release(const void* ptr);
  * @param value The data to store.
  * @param value_len The length of the data.
  * @param ttl_override Optional TTL in seconds (0 uses default).
- * @return true on success, false on failure.
+ * @return true on success, false on failure or when the admission policy
+ *         rejects a new key.
  */
 bool cache_set(cache_t* cache, const char* key, size_t key_len, const void* value, size_t value_len,
                uint32_t ttl_override);
 
+/**
+ * Stores a value in the cache with a millisecond TTL.
+ *
+ * Expiry is checked against a coarse monotonic clock refreshed about every
+ * 5 ms, so an entry expires within roughly one tick of its deadline.
+ *
+ * @param cache The cache handle.
+ * @param key The key.
+ * @param key_len The length of the key.
+ * @param value The data to store.
+ * @param value_len The length of the data.
+ * @param ttl_ms Optional TTL in milliseconds (0 uses default).
+ * @return true on success, false on failure.
+ */
+bool cache_set_ms(cache_t* cache, const char* key, size_t key_len, const void* value, size_t value_len,
+                  uint64_t ttl_ms);
+
+/**
+ * Zero-copy get-or-compute with request coalescing (single-flight).
+ *
+ * On a miss the first caller marks the key as loading, runs the loader
+ * and stores its value.  Concurrent callers for the same key do not run
+ * the loader.  If an expired value is still cached they get it
+ * immediately; otherwise they wait for the first caller's result.  When
+ * the loader fails, its caller gets the expired value if there is one.
+ *
+ * The loaded value is returned even if the admission policy or the byte
+ * budget keeps it out of the cache.
+ *
+ * @param cache The cache handle.
+ * @param key The lookup key.
+ * @param key_len The length of the key.
+ * @param loader Called on a miss (or an early refresh; see refresh_beta).
+ * @param ctx Passed through to loader.
+ * @param out_len Pointer to store the size of the retrieved value.
+ * @return Pointer to the value data, or NULL if the key is missing and
+ *         could not be loaded.
+ * @note YOU MUST CALL cache_release() on the returned pointer when done.
+ */
+const void* cache_get_or_load(cache_t* cache, const char* key, size_t key_len, cache_loader_fn loader, void* ctx,
+                              size_t* out_len);
+
+/**
+ * Batched zero-copy retrieval.
+ *
+ * Keys are grouped by shard and each shard's read lock is taken once per
+ * group instead of once per key; the home tag slots of a group are
+ * prefetched before probing.  Prefer this over a loop of cache_get() when a
+ * request fans out to many lookups.
+ *
+ * @param cache The cache handle.
+ * @param n Number of keys.
+ * @param keys Array of n key pointers.
+ * @param key_lens Array of n key lengths.
+ * @param out_values Output array of n value pointers; NULL for a miss.
+ * @param out_lens Optional output array of n value lengths (0 for a miss).
+ * @return Number of hits.
+ * @note YOU MUST CALL cache_release() on every non-NULL out_values[i].
+ */
+size_t cache_get_many(cache_t* cache, size_t n, const char* const* keys, const size_t* key_lens,
+                      const void** out_values, size_t* out_lens);
+
+/**
+ * Batched insert/update.
+ *
+ * Entries are allocated outside the locks, then linked with one write lock
+ * per shard group.  Duplicate keys are applied in array order, so the last
+ * occurrence wins.
+ *
+ * @param cache The cache handle.
+ * @param n Number of key/value pairs.
+ * @param keys Array of n key pointers.
+ * @param key_lens Array of n key lengths.
+ * @param values Array of n value pointers.
+ * @param value_lens Array of n value lengths.
+ * @param ttl_override Optional TTL in seconds applied to every pair (0 uses default).
+ * @return Number of pairs stored.
+ */
+size_t cache_set_many(cache_t* cache, size_t n, const char* const* keys, const size_t* key_lens,
+                      const void* const* values, const size_t* value_lens, uint32_t ttl_override);
+
+/**
+ * Proactively removes expired entries.
+ *
+ * Walks the shards round-robin in slices of at most 256 slots, continuing
+ * where the previous call stopped.  A slice is first checked under the read
+ * lock; the write lock is taken only when it holds expired entries, so
+ * write-lock hold time is bounded by one slice.  A shard is compacted when
+ * the resulting tombstones outnumber its live entries, and a shard with a
+ * resize or compaction in flight migrates one slice's worth of slots.  Safe
+ * to call concurrently from several threads.
+ *
+ * @param cache The cache handle.
+ * @param budget Maximum number of slots to examine in this call.
+ * @return Number of expired entries removed.
+ */
+size_t cache_tick(cache_t* cache, size_t budget);
+
+/**
+ * Changes the total capacity at runtime.
+ *
+ * Each shard moves to a table sized for the new capacity incrementally: a
+ * new table is allocated and the old one is drained a few slots per
+ * cache_set() or cache_tick() slice, so no call rehashes a whole shard at
+ * once.  Lookups stay correct throughout.  A smaller capacity takes effect
+ * immediately and is reached by evicting a bounded number of entries per
+ * write; a larger one takes effect once the larger table is allocated.  The
+ * TinyLFU sketch keeps the size it was created with.
+ *
+ * @param cache The cache handle.
+ * @param capacity New total maximum number of entries (distributed across shards).
+ * @return true on success, false on invalid arguments.
+ */
+bool cache_resize(cache_t* cache, size_t capacity);
+
 /**
  * Invalidates (removes) an entry from the cache index.
  */
@@ -86,33 +493,83 @@ void cache_clear(cache_t* cache);
  */
 size_t get_total_cache_size(cache_t* cache);
 
+/**
+ * Returns the number of bytes charged to live entries across all shards.
+ * With slab_alloc this is the size of the slab blocks in use, which tracks
+ * resident memory far more closely than the entry count.
+ * @param cache The cache instance.
+ * @return Bytes in use, or 0 if cache is NULL.
+ */
+size_t get_total_memory_usage(cache_t* cache);
+
 /**
  * Returns the total capacity of the cache across all shards.
  * Thread-safe: acquires read locks on all shards.
- * Note: Capacity is set at creation and never changes, but we lock for consistency.
+ * Reflects cache_resize() once each shard has applied the new capacity.
  * @param cache The cache instance.
  * @return Total capacity, or 0 if cache is NULL.
  */
 size_t get_total_capacity(cache_t* cache);
 
 /**
- * Serializes the current cache state to a binary file.
+ * Reads the cache-wide counters.
  *
- * The operation locks shards one by one, allowing concurrent reads/writes
- * to other shards while saving. The snapshot is not atomic across shards.
+ * Hits, misses and read-lock spins are counted in per-thread slots, one
+ * cache line each, so cache_get() never writes a line shared with other
+ * threads; this call sums the slots.  Write-side counters are kept per
+ * shard under the shard write lock.  Counts are cheap rather than exact:
+ * when more than 64 threads use one cache, threads share slots and an
+ * occasional increment may be lost.
+ *
+ * @param cache The cache handle.
+ * @param out Receives the counters.
+ * @return true on success, false on invalid arguments.
+ */
+bool cache_stats(cache_t* cache, cache_stats_t* out);
+
+/**
+ * Reads one shard's occupancy and write-side counters.
+ * @param cache The cache handle.
+ * @param shard Shard index, below cache_stats_t.shard_count.
+ * @param out Receives the counters.
+ * @return true on success, false on invalid arguments.
+ */
+bool cache_shard_stats(cache_t* cache, size_t shard, cache_shard_stats_t* out);
+
+/**
+ * Reports the hottest keys seen by the sampled tracker (see
+ * cache_config_t.hot_keys), hottest first.  Misses are counted as well as
+ * hits, so a hot key that keeps missing shows up too.
+ * @param cache The cache handle.
+ * @param out Array of at least k elements.
+ * @param k Maximum number of keys to report.
+ * @return Number of keys written; 0 when tracking is disabled.
+ */
+size_t cache_hot_keys(cache_t* cache, cache_hot_key_t* out, size_t k);
+
+/**
+ * Writes a snapshot of the cache to a file.
+ *
+ * The snapshot is one point in time across all shards: every shard's read
+ * lock is held together just long enough to take a reference to each
+ * unexpired entry, then the locks are dropped and the entries are streamed
+ * out.  Writers are never blocked for the I/O.
+ *
+ * The file holds one checksummed section per shard followed by an index
+ * and footer.  It is written as "<filename>.tmp", synced and renamed over
+ * filename, so a crash mid-save leaves any previous snapshot intact.
  *
  * @param cache_ptr The cache to save.
  * @param filename The output file path.
- * @return true on success, false on I/O error.
+ * @return true on success, false on I/O or allocation failure.
  */
 bool cache_save(cache_t* cache_ptr, const char* filename);
 
 /**
- * Loads cache entries from a binary file.
+ * Loads cache entries from a file written by cache_save().
  *
- * Entries that are already expired in the file are skipped.
- * Entries loaded will be subject to the current cache's eviction policy
- * (if the file contains more items than the cache capacity).
+ * Equivalent to cache_load_ex(cache_ptr, filename, 1).  Files written by
+ * the previous (version 1) format are still accepted.
  *
  * @param cache_ptr The cache to load into.
  * @param filename The input file path.
@@ -120,6 +577,31 @@ bool cache_save(cache_t* cache_ptr, const char* filename);
  */
 bool cache_load(cache_t* cache_ptr, const char* filename);
 
+/**
+ * Loads cache entries from a snapshot on several threads.
+ *
+ * The file is mapped read-only and its sections are checked and inserted
+ * in parallel, copying keys and values straight from the mapping.  Loading
+ * into a cache with the same shard count, hash function and hash seed as
+ * the saved one lets each thread fill its own shard without lock
+ * contention.  The snapshot does not record the seed, and the default
+ * (hash_seed = 0) draws a new one in every process, so after a restart
+ * this only applies when cache_config_t.hash_seed is set explicitly;
+ * otherwise the load is still correct, but threads contend for shards.
+ *
+ * Entries that are already expired are skipped, as are entries the cache
+ * declines (admission policy, byte budget); the capacity and eviction
+ * policy apply as for cache_set().  Every section's checksum is verified
+ * before anything is inserted, so a corrupt section or a truncated file
+ * makes the call return false without loading anything.
+ *
+ * @param cache_ptr The cache to load into.
+ * @param filename The input file path.
+ * @param threads Threads to use, including the caller (0 = one per online CPU).
+ * @return true on success, false on I/O error, invalid format or a corrupt section.
+ */
+bool cache_load_ex(cache_t* cache_ptr, const char* filename, size_t threads);
+
 /** Prints the global probe-length histogram to stderr. */
 void cache_probe_stats_dump(void);
 
@@ -21,14 +21,21 @@
  *     On 64-bit: ptr(8) + len(4) + cap(4) + buf(16) = 32 bytes.
  *     SSO holds strings up to 15 chars (+ NUL).
  *
- *  5. No memmem — replaced with a fast Rabin-Karp or Sunday's algorithm
+ *  5. Optional arena storage
+ *     cstr_new_arena() places the struct and its bytes in an Arena.  Such a
+ *     string is never in SSO mode, so `buf` is free to hold the Arena pointer
+ *     and the struct stays 32 bytes.  Growth goes through arena_realloc()
+ *     (in place while the string is the arena's latest allocation) and
+ *     cstr_free() releases nothing: arena_reset() reclaims it all at once.
+ *
+ *  6. No memmem — replaced with a fast Rabin-Karp or Sunday's algorithm
  *     variant that avoids glibc's dynamic dispatch overhead for short needles.
  *
  *  Struct layout (64-bit, little-endian):
  *    offset  0 : char*    data      (8 bytes) — always valid pointer
  *    offset  8 : uint32_t length    (4 bytes)
- *    offset 12 : uint32_t capacity  (4 bytes) — MSB = heap flag
- *    offset 16 : char     buf[16]   (16 bytes) — inline storage
+ *    offset 12 : uint32_t capacity  (4 bytes) — MSB = heap flag, bit 30 = arena flag
+ *    offset 16 : char     buf[16]   (16 bytes) — inline storage, or the Arena*
  *  Total: 32 bytes
  *
  * @warning Do NOT access struct fields directly — use the API.
@@ -41,6 +48,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
+#include "arena.h"
 #include "macros.h"
 
 #ifdef __cplusplus
@@ -73,8 +81,8 @@ extern "C" {
  * Constants
  * ---------------------------------------------------------------------- */
 
-/** Maximum string length / capacity (4 GB - 1, MSB reserved for heap flag). */
-#define CSTR_MAX_LEN ((uint32_t)0x7FFFFFFFu)
+/** Maximum string length / capacity (1 GB - 1, top two bits reserved for storage flags). */
+#define CSTR_MAX_LEN ((uint32_t)0x3FFFFFFFu)
 
 /** Size of the inline (SSO) buffer. Strings shorter than this need no heap. */
 #define CSTR_SSO_CAP 16u /* 15 usable chars + NUL */
@@ -82,6 +90,9 @@ extern "C" {
 /** Bit flag stored in `capacity` to indicate heap allocation. */
 #define CSTR_HEAP_FLAG ((uint32_t)0x80000000u)
 
+/** Bit flag stored in `capacity` (alongside the heap flag) when the bytes live in an Arena. */
+#define CSTR_ARENA_FLAG ((uint32_t)0x40000000u)
+
 /** Sentinel returned by find functions when no match is found. */
 #define CSTR_NPOS (-1)
 
@@ -97,7 +108,8 @@ extern "C" {
  *
  * `data` is ALWAYS a valid, NUL-terminated pointer:
  *   - When heap flag is clear: data == &buf[0]  (SSO path)
- *   - When heap flag is set:   data points to malloc'd memory
+ *   - When heap flag is set:   data points to malloc'd memory, or to arena
+ *                              memory if the arena flag is set too
  *
  * This eliminates the branch in every read — callers just dereference `data`.
  */
@@ -140,10 +152,16 @@ CSTR_INLINE bool cstr_is_heap(const cstr* s) {
     return (s->capacity & CSTR_HEAP_FLAG) != 0;
 }
 
-/** Extract actual heap capacity (strip flag bit). */
+/** True when string data lives in an Arena (implies cstr_is_heap()). */
+CSTR_INLINE bool cstr_is_arena(const cstr* s) CSTR_PURE;
+CSTR_INLINE bool cstr_is_arena(const cstr* s) {
+    return (s->capacity & CSTR_ARENA_FLAG) != 0;
+}
+
+/** Extract actual heap capacity (strip flag bits). */
 CSTR_INLINE uint32_t cstr_heap_cap(const cstr* s) CSTR_PURE;
 CSTR_INLINE uint32_t cstr_heap_cap(const cstr* s) {
-    return s->capacity & ~CSTR_HEAP_FLAG;
+    return s->capacity & ~(CSTR_HEAP_FLAG | CSTR_ARENA_FLAG);
 }
 
 /* -------------------------------------------------------------------------
@@ -267,9 +285,33 @@ cstr* cstr_new(const char* input) CSTR_WARN_UNUSED;
  */
 cstr* cstr_new_len(const char* data, size_t length) CSTR_WARN_UNUSED;
 
+/**
+ * @brief Create a new cstr in an arena from a C string.
+ *
+ * The struct and the bytes come from @p arena; appends grow the bytes with
+ * arena_realloc().  Functions that return a new cstr (cstr_substr,
+ * cstr_replace, cstr_split, ...) still return heap strings.
+ *
+ * @param arena  Arena to allocate from. Must outlive the string.
+ * @param input  NUL-terminated source. Must not be NULL.
+ * @return New cstr, or NULL on OOM or NULL arguments.
+ * @note cstr_free() is a no-op for it; arena_reset() releases the memory.
+ */
+cstr* cstr_new_arena(Arena* arena, const char* input) CSTR_WARN_UNUSED;
+
+/**
+ * @brief Create a new cstr in an arena from a buffer of known length.
+ *        See cstr_new_arena().
+ * @param arena   Arena to allocate from.
+ * @param data    Pointer to characters (need not be NUL-terminated).
+ * @param length  Number of bytes to copy.
+ * @return New cstr, or NULL on OOM.
+ */
+cstr* cstr_new_len_arena(Arena* arena, const char* data, size_t length) CSTR_WARN_UNUSED;
+
 /**
  * @brief Free a heap-allocated cstr and its storage.
- *        Safe to call with NULL.
+ *        Safe to call with NULL.  Arena strings are left to their arena.
  */
 void cstr_free(cstr* s);
 
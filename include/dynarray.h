@@ -14,6 +14,8 @@ extern "C" {
 #include <stddef.h>   // for size_t
 #include <stdint.h>   // for SIZE_MAX
 
+#include "arena.h"
+
 /** Growth factor for capacity expansion (1.5x). Balances memory vs reallocation frequency. */
 #define DYNARRAY_GROWTH_NUMERATOR   3
 #define DYNARRAY_GROWTH_DENOMINATOR 2
@@ -38,6 +40,8 @@ typedef struct {
     size_t capacity;
     /** Size of each element in bytes. */
     size_t element_size;
+    /** Arena the buffer is allocated from, or NULL for malloc/realloc/free. */
+    Arena* arena;
 } dynarray_t;
 
 /**
@@ -50,6 +54,25 @@ typedef struct {
  */
 bool dynarray_init(dynarray_t* arr, size_t element_size, size_t initial_capacity);
 
+/**
+ * Initializes a dynamic array whose buffer lives in an arena.
+ * Growth uses arena_realloc(), which can extend the buffer in place only while
+ * it is the arena's most recent allocation, whatever kind of arena it is. Once
+ * anything else has been allocated from the arena, each growth copies the buffer
+ * and the old one is stranded in the arena until it is reset. While the buffer
+ * is the latest allocation, an arena_create_reserved() arena grows it in place
+ * up to the reservation; a block-chain arena does so only while the current
+ * block has room. The array never shrinks its buffer.
+ * @param arr Pointer to the array structure to initialize.
+ * @param arena Arena to allocate from. Must outlive the array.
+ * @param element_size Size of each element in bytes.
+ * @param initial_capacity Initial capacity (0 uses default).
+ * @return true on success, false on allocation failure or if arena is NULL.
+ * @note dynarray_free() is optional; the memory is released by arena_reset() or
+ *       arena_destroy().
+ */
+bool dynarray_init_arena(dynarray_t* arr, Arena* arena, size_t element_size, size_t initial_capacity);
+
 /**
  * Frees all resources associated with the dynamic array.
  * @param arr Pointer to the array to free. Safe to pass NULL.
@@ -4,7 +4,8 @@
  *
  * Provides a unified interface for synchronization primitives across
  * Windows (Critical Sections/Condition Variables) and POSIX systems
- * (pthread mutexes/condition variables).
+ * (pthread mutexes/condition variables), plus futex-style wait/wake on a
+ * single word for lock-free code that needs to block.
  *
  * All functions return integer error codes instead of terminating the program,
  * allowing for proper error handling and recovery.
@@ -16,6 +17,8 @@
 #ifndef LOCK_H
 #define LOCK_H
 
+#include <stdatomic.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -142,6 +145,44 @@ int cond_wait_timeout(Condition* condition, Lock* lock, int timeout_ms);
  */
 int cond_free(Condition* condition);
 
+/* Futex-style Wait/Wake Functions */
+
+/*
+ * Sleep on a 32-bit word instead of a lock/condition pair: a waiter blocks only
+ * while the word still holds the value it expects, and a waker changes the word
+ * before waking.  No mutex is shared between them, so wait slots can be spread
+ * across cache lines (one per thread) and woken individually.
+ *
+ * Linux uses futex(2), Windows WaitOnAddress(); other platforms fall back to a
+ * small table of hashed lock/condition pairs.
+ */
+
+/**
+ * Blocks while *addr == expected, until woken through the same address or the timeout expires.
+ * @param addr Pointer to the wait word. Must not be NULL.
+ * @param expected Value *addr is expected to hold; if it differs, returns at once.
+ * @param timeout_ms Timeout in milliseconds. Negative values mean wait indefinitely.
+ * @return 0 when woken (or *addr != expected), -1 on timeout or error.
+ * @note Thread-safe. May return spuriously; callers must re-check *addr in a loop.
+ */
+int futex_wait(atomic_uint* addr, unsigned int expected, int timeout_ms);
+
+/**
+ * Wakes at most one thread blocked in futex_wait() on @p addr.
+ * @param addr Pointer to the wait word. Must not be NULL.
+ * @return 0 on success, -1 on failure.
+ * @note Thread-safe. Change *addr before waking, or the waiter may go back to sleep.
+ */
+int futex_wake_one(atomic_uint* addr);
+
+/**
+ * Wakes every thread blocked in futex_wait() on @p addr.
+ * @param addr Pointer to the wait word. Must not be NULL.
+ * @return 0 on success, -1 on failure.
+ * @note Thread-safe. Change *addr before waking, or the waiters may go back to sleep.
+ */
+int futex_wake_all(atomic_uint* addr);
+
 /* Utility Functions */
 
 #ifdef __cplusplus
@@ -6,6 +6,7 @@
 #ifndef SOLIDC_MAP_H
 #define A02E572A_DDD85_4D77_AC81_41037EDE290A
 
+#include "./arena.h"
 #include "./cmp.h"
 
 #include <float.h>
@@ -67,6 +68,9 @@ typedef struct {
                                    // free from libc.
     float max_load_factor;         // Optional: When to resize (default 0.75)
     HashFunction hash_func;        // Optional: Custom hash function
+    Arena* arena;                  // Optional: Allocate the map and its tables from this
+                                   // arena instead of the heap. Outgrown tables are left
+                                   // to the arena, and map_destroy() frees no memory.
 } MapConfig;
 
 #define MapConfigInt    (&(MapConfig){.key_compare = key_compare_int})
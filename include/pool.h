@@ -0,0 +1,118 @@
+/**
+ * pool.h - Size-classed object pool on top of an Arena
+ *
+ * An Arena only releases memory wholesale (arena_reset(), checkpoints).  A
+ * pool adds individual frees: objects up to POOL_MAX_SIZE are rounded up to
+ * one of POOL_CLASS_COUNT size classes, and pool_free() puts an object back
+ * on its class's freelist for the next pool_alloc() of that class.  The
+ * arena is only asked for memory when a freelist runs dry, so a long-lived
+ * service with a steady allocation pattern stops growing once warm and
+ * never calls malloc() per object.
+ *
+ *   Arena* a = arena_create(0);
+ *   ArenaPool* pool = pool_create(a);
+ *   Node* n = pool_alloc(pool, sizeof(Node));
+ *   ...
+ *   pool_free(pool, n, sizeof(Node));
+ *   arena_destroy(a);  // releases the pool and every object with it
+ *
+ * Freelists are kept as magazines (fixed-size stacks of free objects).
+ * Each thread works on its own loaded and previous magazine per class, so
+ * alloc/free pairs on one thread touch no shared state.  Only when both run
+ * full or empty does the thread trade a whole magazine with the class's
+ * shared depot, and only when the depot has no full magazine is the arena
+ * itself locked for a batch of fresh objects.  Objects may be freed on a
+ * different thread from the one that allocated them.
+ *
+ * The pool lives inside its arena: arena_reset() and arena_destroy()
+ * invalidate it.  While a pool is in use from several threads, the arena
+ * must not be allocated from directly, because the pool serialises its own
+ * arena calls but cannot see anyone else's.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include "arena.h"
+
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/** Largest request served from the size-class freelists. */
+#define POOL_MAX_SIZE 4096
+
+/** Size classes: 16-byte steps up to 128, then four per power of two up to POOL_MAX_SIZE. */
+#define POOL_CLASS_COUNT 28
+
+/** Free objects per magazine. */
+#define POOL_MAGAZINE_SIZE 32
+
+/** Opaque pool handle. */
+typedef struct ArenaPool ArenaPool;
+
+/**
+ * Creates a pool whose memory comes from @p arena.
+ *
+ * The pool's own bookkeeping is allocated from the arena as well, so no
+ * matching destroy call exists: the pool goes away with the arena.
+ *
+ * @param arena Backing arena.  Must outlive the pool and not be reset
+ *              while the pool is in use.
+ * @return New pool, or NULL if @p arena is NULL or out of memory.
+ */
+ArenaPool* pool_create(Arena* arena);
+
+/**
+ * Allocates an object of at least @p size bytes, aligned to 16 bytes.
+ *
+ * Requests up to POOL_MAX_SIZE reuse freed objects of the same size class
+ * first.  Larger requests are bump-allocated from the arena and are not
+ * recycled by pool_free().  Thread-safe.
+ *
+ * @param pool The pool.
+ * @param size Bytes requested.
+ * @return Pointer to the object, or NULL if @p size is 0 or memory is
+ *         exhausted.
+ */
+void* pool_alloc(ArenaPool* pool, size_t size);
+
+/**
+ * Allocates a zero-filled object; see pool_alloc().
+ *
+ * @param pool The pool.
+ * @param size Bytes requested.
+ * @return Zero-filled pointer, or NULL on failure.
+ */
+void* pool_alloc_zero(ArenaPool* pool, size_t size);
+
+/**
+ * Returns an object to the pool for reuse.
+ *
+ * @p size must be the size passed to pool_alloc() (any size in the same
+ * class works).  Objects larger than POOL_MAX_SIZE are not recycled; their
+ * memory is reclaimed with the arena.  Thread-safe, including frees of
+ * objects allocated on another thread.
+ *
+ * @param pool The pool that allocated @p ptr.
+ * @param ptr  Object to release.  NULL is ignored.
+ * @param size Size the object was allocated with.
+ */
+void pool_free(ArenaPool* pool, void* ptr, size_t size);
+
+/**
+ * Returns the usable size of objects allocated with @p size, i.e. the size
+ * of its class, or @p size itself above POOL_MAX_SIZE.
+ *
+ * @param size Requested size.
+ * @return Bytes actually reserved per object.
+ */
+size_t pool_size_class(size_t size);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* POOL_H */
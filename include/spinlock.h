@@ -32,6 +32,7 @@
 extern "C" {
 #else
 #include <stdatomic.h>
+#include <stdbool.h>
 #endif
 
 #if defined(__x86_64__) || defined(__i386__)
@@ -184,6 +185,48 @@ static inline void fast_rwlock_unlock_rd(fast_rwlock_t* l) {
 #endif
 }
 
+/**
+ * @brief Try once to acquire the lock for reading.
+ *
+ * Never spins: fails if a writer holds the lock or another thread changed
+ * the state concurrently.  Callers that must not wait, or that want to
+ * observe contention, can build their own wait loop on top of this.
+ *
+ * @param l Pointer to the spinlock. Must not be NULL.
+ * @return true if the read lock was acquired; release it with
+ *         fast_rwlock_unlock_rd().
+ */
+static inline bool fast_rwlock_tryrdlock(fast_rwlock_t* l) {
+#ifdef __cplusplus
+    int state = l->state.load(std::memory_order_relaxed);
+    return state >= 0 &&
+           l->state.compare_exchange_strong(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed);
+#else
+    int state = atomic_load_explicit(&l->state, memory_order_relaxed);
+    return state >= 0 && atomic_compare_exchange_strong_explicit(&l->state, &state, state + 1, memory_order_acquire,
+                                                                 memory_order_relaxed);
+#endif
+}
+
+/**
+ * @brief Try once to acquire the lock for writing.
+ *
+ * Never spins: fails if any reader or writer holds the lock.
+ *
+ * @param l Pointer to the spinlock. Must not be NULL.
+ * @return true if the write lock was acquired; release it with
+ *         fast_rwlock_unlock_wr().
+ */
+static inline bool fast_rwlock_trywrlock(fast_rwlock_t* l) {
+    int expected = 0;
+#ifdef __cplusplus
+    return l->state.compare_exchange_strong(expected, -1, std::memory_order_acquire, std::memory_order_relaxed);
+#else
+    return atomic_compare_exchange_strong_explicit(&l->state, &expected, -1, memory_order_acquire,
+                                                   memory_order_relaxed);
+#endif
+}
+
 /**
  * @brief Acquire the lock for writing (exclusive access).
  *
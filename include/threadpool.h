@@ -15,9 +15,16 @@
  *   using a single seq_cst CAS.
  *
  * External submitters (threads that are not pool workers) push tasks into a
- * shared @c GlobalQueue protected by a mutex.  Workers drain this queue in
- * batches of @c BATCH_SIZE tasks per mutex acquisition, then distribute the
- * extras into their own private deques for subsequent lock-free consumption.
+ * shared @c GlobalQueue, a bounded lock-free MPMC ring with a sequence number
+ * per slot.  Workers drain it in batches of up to @c BATCH_SIZE tasks per
+ * CAS, then distribute the extras into their own private deques.  Producers
+ * that find the ring full sleep on an event count (a futex on Linux) until a
+ * worker frees slots.
+ *
+ * An idle worker parks on its own futex word (see futex_wait() in lock.h).
+ * A submitter wakes exactly one parked worker by claiming its word with a
+ * CAS, without any lock shared between workers; with no worker parked the
+ * wakeup check is a fence and one load.
  *
  * ```
  *   External submitter
@@ -34,9 +41,10 @@
  * |---------------------------|---------------------------------------------|
  * | Worker push/pop (own deque) | One release store — zero contention      |
  * | Thief steal               | One seq_cst CAS — contended only between thieves |
- * | External submit (single)  | One mutex round-trip per task              |
- * | External submit (batch)   | One mutex round-trip per @c GLOBAL_Q_SIZE tasks |
- * | Worker drain from global  | One mutex round-trip per @c BATCH_SIZE tasks |
+ * | External submit (single)  | One CAS on the shared ring per task        |
+ * | External submit (batch)   | One CAS per run of free slots (usually one per batch) |
+ * | Worker drain from global  | One CAS per @c BATCH_SIZE tasks            |
+ * | Wakeup check after a push | One fence and one load; a CAS and a futex wake only if a worker is parked |
  *
  * ## Compile-time knobs
  *
@@ -47,8 +55,8 @@
  * |------------------|--------|--------------------------------------------|
  * | @c DEQUE_SIZE    | 4096   | Slots per private Chase-Lev deque          |
  * | @c GLOBAL_Q_SIZE | 16384  | Slots in the shared external submission queue |
- * | @c BATCH_SIZE    | 64     | Tasks pulled from the global queue per mutex acquisition |
- * | @c YIELD_THRESHOLD | 8    | Spin rounds before a worker parks on a condvar |
+ * | @c BATCH_SIZE    | 64     | Tasks pulled from the global queue per claim |
+ * | @c YIELD_THRESHOLD | 8    | Spin rounds before a worker parks on its futex |
  *
  * ## Lifecycle
  *
@@ -70,6 +78,67 @@
  * threadpool_destroy(pool, -1);
  * ```
  *
+ * ## Fork-join task groups
+ *
+ * A @c TaskGroup tracks a set of tasks so that exactly those can be waited
+ * for, rather than the whole pool.  Spawning from inside a running task
+ * pushes onto the worker's own deque, and @c tg_wait() executes queued
+ * tasks while the group is unfinished instead of blocking, so recursive
+ * divide-and-conquer keeps every worker busy without exhausting threads:
+ *
+ * ```c
+ * static void sort_range(void* arg) {
+ *     Range* r = arg;
+ *     if (r->len <= CUTOFF) { insertion_sort(r); return; }
+ *     Range lo, hi;
+ *     partition(r, &lo, &hi);
+ *     TaskGroup tg;
+ *     tg_init(&tg, r->pool);
+ *     tg_spawn(&tg, sort_range, &lo);
+ *     sort_range(&hi);             // keep one half on this thread
+ *     tg_wait(&tg);
+ * }
+ * ```
+ *
+ * ## Data-parallel loops
+ *
+ * @c threadpool_parallel_for() and @c threadpool_parallel_reduce() run a
+ * function over an index range using lazy binary splitting: a thread
+ * working on a range only splits off the upper half when its own queue is
+ * empty — i.e. when the previous half it offered has been stolen — and
+ * otherwise processes @c grain indices and checks again.  Idle workers
+ * therefore steal half of whatever remains instead of pre-cut chunks, so
+ * skewed per-index costs balance themselves, while an evenly loaded pool
+ * splits only O(workers × log n) times.
+ *
+ * ```c
+ * static void scale(size_t begin, size_t end, void* ctx) {
+ *     float* v = ctx;
+ *     for (size_t i = begin; i < end; i++) v[i] *= 2.0f;
+ * }
+ * threadpool_parallel_for(pool, 0, n, 0, scale, v);
+ * ```
+ *
+ * ## Futures
+ *
+ * @c threadpool_submit_future() returns a @c Future handle for the task's
+ * @c void* result.  Futures are recycled through an @c ArenaPool owned by
+ * the pool and created by its first future, so a future costs no @c malloc
+ * and no condvar, and a pool that never uses futures pays nothing for them.
+ * A waiter sleeps on the future's own futex word.  @c future_then() chains
+ * a continuation, which the worker completing the parent pushes onto its
+ * own deque and usually runs next, while the parent's result is still in
+ * cache.
+ * @c future_when_all() completes once every future it was given has.
+ *
+ * ```c
+ * Future* parsed = threadpool_submit_future(pool, parse, request);
+ * Future* reply  = future_then(parsed, render, template);
+ * send(future_wait(reply));
+ * future_release(parsed);
+ * future_release(reply);
+ * ```
+ *
  * ## Thread safety
  *
  * All public functions are safe to call from any thread concurrently, including
@@ -82,6 +151,7 @@
 #ifndef __THREADPOOL_H__
 #define __THREADPOOL_H__
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -98,6 +168,8 @@ extern "C" {
  */
 typedef struct Threadpool Threadpool;
 
+struct TaskGroup;
+
 /**
  * @brief A unit of work submitted to the pool.
  *
@@ -108,8 +180,33 @@ typedef struct Threadpool Threadpool;
 typedef struct Task {
     void (*function)(void* arg); /**< Function to execute.  Must not be NULL. */
     void* arg;                   /**< Opaque argument forwarded to @c function unchanged. */
+    struct TaskGroup* group;     /**< Group notified on completion, or NULL. */
 } Task;
 
+/**
+ * @brief A set of tasks that can be waited for as a unit.
+ *
+ * Groups are meant to live on the stack of the code that forks the work.
+ * Initialise with @c tg_init(), add tasks with @c tg_spawn(), and call
+ * @c tg_wait() before the group goes out of scope.  After @c tg_wait()
+ * returns the group may be reused without re-initialising.  No destroy call
+ * is needed.  The fields are private.
+ */
+typedef struct TaskGroup {
+    Threadpool* pool;      /**< Pool the group's tasks run on. */
+    atomic_size_t pending; /**< Spawned tasks that have not finished. */
+} TaskGroup;
+
+/**
+ * @brief Handle to the eventual result of a task.
+ *
+ * Opaque and reference counted: every function that returns a @c Future
+ * hands the caller one reference, which must be dropped with
+ * @c future_release().  Futures belong to the pool that created them and
+ * must all be released before @c threadpool_destroy().
+ */
+typedef struct Future Future;
+
 /**
  * @brief Create a new thread pool.
  *
@@ -145,11 +242,12 @@ Threadpool* threadpool_create(size_t num_threads);
  *   4096 slots; this path is not reached under normal load).
  *
  * - **External thread** (any other thread): pushes the task into the shared
- *   @c GlobalQueue under a mutex.  Costs one @c pthread_mutex_lock +
- *   @c pthread_mutex_unlock round-trip.  Blocks if the global queue is full
- *   (capacity 16384 slots) until a worker drains a slot.
+ *   @c GlobalQueue with one CAS; concurrent producers never block each
+ *   other.  Sleeps if the global queue is full (capacity 16384 slots) until
+ *   a worker drains a slot.
  *
- * After pushing, wakes one parked worker if any are sleeping.
+ * After pushing, wakes one parked worker if any are sleeping.  No lock
+ * is taken when no worker is parked.
  *
  * @param pool     Pool to submit to.  Must not be @c NULL.
  * @param function Task function.  Must not be @c NULL.
@@ -159,7 +257,7 @@ Threadpool* threadpool_create(size_t num_threads);
  *         @p function is @c NULL or if the pool is shutting down.
  *
  * @note For bulk external submission prefer @c threadpool_submit_batch, which
- *       amortises the mutex cost across many tasks.
+ *       claims many slots with a single CAS.
  *
  * @par Complexity
  * O(1) amortised.
@@ -169,10 +267,9 @@ bool threadpool_submit(Threadpool* pool, void (*function)(void*), void* arg);
 /**
  * @brief Submit multiple tasks to the pool in a single call.
  *
- * Reduces mutex acquisition overhead from O(@p count) to
- * O(@p count / @c GLOBAL_Q_SIZE) compared to calling @c threadpool_submit
- * in a loop.  For a batch of 10 000 tasks with @c GLOBAL_Q_SIZE = 16384,
- * this is a single mutex acquisition instead of 10 000.
+ * Claims global-queue slots for the whole batch at once instead of once per
+ * task.  For a batch of 10 000 tasks with @c GLOBAL_Q_SIZE = 16384 and a
+ * drained queue, this is a single CAS instead of 10 000.
  *
  * ### Submission paths
  *
@@ -183,10 +280,10 @@ bool threadpool_submit(Threadpool* pool, void (*function)(void*), void* arg);
  *
  * **External thread**: builds a flat @c Task array on the stack (if
  * @p count ≤ @c BATCH_SIZE) or heap, then hands it to @c gq_push_batch which
- * holds @c gq_mutex for the duration of each chunk write.  If the global queue
- * fills up mid-batch, @c gq_push_batch waits on @c not_full and resumes from
- * where it left off — the caller blocks until all @p count tasks are enqueued
- * or the pool shuts down.
+ * claims each run of free slots with one CAS.  If the global queue fills up
+ * mid-batch, @c gq_push_batch sleeps until workers free slots and resumes
+ * from where it left off — the caller blocks until all @p count tasks are
+ * enqueued or the pool shuts down.
  *
  * @param pool      Pool to submit to.  Must not be @c NULL.
  * @param functions Array of @p count function pointers.  @c NULL entries are
@@ -214,7 +311,8 @@ bool threadpool_submit(Threadpool* pool, void (*function)(void*), void* arg);
  * @endcode
  *
  * @par Complexity
- * O(@p count / @c GLOBAL_Q_SIZE) mutex acquisitions for external threads;
+ * O(@p count) slot writes and O(@p count / @c GLOBAL_Q_SIZE) CASes for
+ * external threads when uncontended;
  * O(@p count) deque stores (lock-free) for worker threads.
  */
 size_t threadpool_submit_batch(Threadpool* pool, void (**functions)(void*), void** args,
@@ -223,14 +321,12 @@ size_t threadpool_submit_batch(Threadpool* pool, void (**functions)(void*), void
 /**
  * @brief Block until all currently submitted tasks have completed.
  *
- * Returns only when both conditions hold simultaneously:
- * 1. Every worker's private deque is empty.
- * 2. The global submission queue is empty.
- * 3. No worker is currently executing a task (@c num_active == 0).
- *
- * Condition 3 ensures correctness when a task itself calls
- * @c threadpool_submit or @c threadpool_submit_batch — the pool is not
- * considered idle until those follow-on tasks have also completed.
+ * Returns once every task submitted to the pool (including tasks spawned
+ * into a @c TaskGroup) has finished executing.  The pool counts a task as
+ * pending from the moment it is submitted until its function returns, so
+ * follow-on tasks submitted by a running task are always counted before
+ * their parent completes — the pool is not considered idle until those
+ * have also completed.
  *
  * The pool remains fully operational after @c threadpool_wait returns.
  * New tasks may be submitted immediately.
@@ -238,7 +334,7 @@ size_t threadpool_submit_batch(Threadpool* pool, void (**functions)(void*), void
  * @param pool Pool to wait on.  If @c NULL the function returns immediately.
  *
  * @note Do **not** call @c threadpool_wait from within a running task.
- *       The task holds a slot in @c num_active, so the wait condition can
+ *       The task itself is still pending, so the wait condition can
  *       never be satisfied while that task is still on the call stack —
  *       this will deadlock.
  *
@@ -262,14 +358,13 @@ void threadpool_wait(Threadpool* pool);
  * @brief Drain all pending tasks, stop all workers, and free the pool.
  *
  * Shutdown sequence:
- * 1. Acquires @c idle_lock and waits until all queues are empty and
- *    @c num_active reaches zero (subject to @p timeout_ms).
- * 2. Sets the @c shutdown flag atomically while still holding @c idle_lock,
- *    preventing workers from re-entering their park condvar between the flag
- *    store and the subsequent broadcast.
- * 3. Broadcasts on @c work_available to wake every parked worker.
- * 4. Spin-waits for @c num_threads_alive to reach zero.
- * 5. Joins every worker thread, frees per-worker memory, destroys all
+ * 1. Acquires @c idle_lock and waits until no submitted task is pending
+ *    (subject to @p timeout_ms).
+ * 2. Sets the @c shutdown flag atomically while still holding @c idle_lock.
+ *    A worker about to park re-checks the flag after publishing that it is
+ *    parking, so it either sees the flag or is seen by step 3.
+ * 3. Marks every worker's parking word notified and wakes those asleep.
+ * 4. Joins every worker thread, frees per-worker memory, destroys all
  *    synchronisation objects, and frees the pool struct.
  *
  * The @p pool pointer is invalid after this function returns.
@@ -287,13 +382,226 @@ void threadpool_wait(Threadpool* pool);
  *          been freed.
  *
  * @warning Do **not** call @c threadpool_destroy from within a running task.
- *          The @c num_active counter will never reach zero while the calling
+ *          The pending-task count will never reach zero while the calling
  *          task is still executing, causing an infinite wait (with
  *          @p timeout_ms == -1) or a forceful shutdown that frees memory
  *          still on the call stack.
  */
 void threadpool_destroy(Threadpool* pool, int timeout_ms);
 
+/**
+ * @brief Initialise an empty task group bound to @p pool.
+ *
+ * @param tg   Group to initialise.  Must not be @c NULL.
+ * @param pool Pool that will run the group's tasks.  Must outlive every
+ *             @c tg_wait() on the group.
+ */
+void tg_init(TaskGroup* tg, Threadpool* pool);
+
+/**
+ * @brief Add a task to the group and submit it to the group's pool.
+ *
+ * Called from a task running on one of the pool's workers, the task is
+ * pushed onto that worker's own deque with a single release store, where
+ * the worker's @c tg_wait() will pop it back (most recent first) unless
+ * an idle worker steals it first.  From any other thread it goes through
+ * the global queue, exactly like @c threadpool_submit().
+ *
+ * Spawned tasks may themselves spawn into the same or a nested group.
+ *
+ * @param tg       Group to add to.  Must not be @c NULL.
+ * @param function Task function.  Must not be @c NULL.
+ * @param arg      Argument passed verbatim to @p function.
+ *
+ * @return @c true if the task was enqueued, @c false on invalid arguments
+ *         or if the pool is shutting down (the group is left unchanged).
+ */
+bool tg_spawn(TaskGroup* tg, void (*function)(void*), void* arg);
+
+/**
+ * @brief Wait until every task spawned into @p tg has finished.
+ *
+ * Rather than blocking straight away, the calling thread executes queued
+ * tasks while the group is unfinished: a worker pops its own deque and
+ * then steals like an idle worker, and an external thread steals from the
+ * workers' deques and the global queue.  The tasks it runs need not belong
+ * to @p tg.  Only when no work can be found does the caller sleep until
+ * the group completes.
+ *
+ * Unlike @c threadpool_wait(), this is safe to call from within a running
+ * task, which is what makes recursive fork-join possible.
+ *
+ * @param tg Group to wait for.  If @c NULL the function returns immediately.
+ */
+void tg_wait(TaskGroup* tg);
+
+/** Loop body for @c threadpool_parallel_for(): processes indices [@p begin, @p end). */
+typedef void (*parallel_for_fn)(size_t begin, size_t end, void* ctx);
+
+/** Loop body for @c threadpool_parallel_reduce(): folds [@p begin, @p end) into @p acc. */
+typedef void (*parallel_reduce_fn)(size_t begin, size_t end, void* acc, void* ctx);
+
+/** Merges the partial result @p other into @p acc. */
+typedef void (*parallel_combine_fn)(void* acc, const void* other, void* ctx);
+
+/**
+ * @brief Run @p fn over [@p begin, @p end) in parallel and wait for it.
+ *
+ * The range is split lazily (see "Data-parallel loops" above); @p fn is
+ * called with disjoint sub-ranges that together cover the whole range
+ * exactly once, each at most @p grain long unless the range was never
+ * split.  The calling thread takes part in the work and returns once every
+ * index has been processed.  May be called from inside a running task.
+ *
+ * @param pool  Pool to run on.  Must not be @c NULL.
+ * @param begin First index.
+ * @param end   One past the last index.  An empty range returns at once.
+ * @param grain Indices processed between split decisions, and the smallest
+ *              range that is split.  0 picks one from the range size and
+ *              worker count.  Use a larger value when per-index work is
+ *              tiny, so that calls to @p fn amortise their overhead.
+ * @param fn    Loop body.  Must not be @c NULL.
+ * @param ctx   Passed verbatim to every call of @p fn.
+ *
+ * @return @c true once the loop has completed, @c false if @p pool or
+ *         @p fn is @c NULL (nothing is run).
+ */
+bool threadpool_parallel_for(Threadpool* pool, size_t begin, size_t end, size_t grain,
+                             parallel_for_fn fn, void* ctx);
+
+/**
+ * @brief Parallel fold of [@p begin, @p end) into @p result.
+ *
+ * Works like @c threadpool_parallel_for(), except that every split-off
+ * range accumulates into its own partial result of @p result_size bytes,
+ * initialised from @p identity.  The range kept by the caller folds
+ * directly into @p result.  When all ranges are done the partials are
+ * merged into @p result with @p combine, in no particular order, so
+ * @p combine must be associative and commutative.
+ *
+ * @param pool        Pool to run on.  Must not be @c NULL.
+ * @param begin       First index.
+ * @param end         One past the last index.
+ * @param grain       As for @c threadpool_parallel_for().
+ * @param fn          Folds a sub-range into an accumulator.  Must not be @c NULL.
+ * @param combine     Merges two accumulators.  Must not be @c NULL.
+ * @param identity    @p result_size bytes holding the neutral value (0 for
+ *                    a sum).  Must not be @c NULL.
+ * @param result      Receives the reduction; initialised from @p identity
+ *                    first.  Must not be @c NULL.
+ * @param result_size Size of one accumulator in bytes.
+ * @param ctx         Passed verbatim to @p fn and @p combine.
+ *
+ * @return @c true once the reduction has completed, @c false on invalid
+ *         arguments (@p result is left untouched).
+ *
+ * @par Example
+ * @code
+ * static void sum_fn(size_t b, size_t e, void* acc, void* ctx) {
+ *     const double* v = ctx;
+ *     for (size_t i = b; i < e; i++) *(double*)acc += v[i];
+ * }
+ * static void add_fn(void* acc, const void* other, void* ctx) {
+ *     (void)ctx;
+ *     *(double*)acc += *(const double*)other;
+ * }
+ * double zero = 0, total;
+ * threadpool_parallel_reduce(pool, 0, n, 0, sum_fn, add_fn, &zero, &total, sizeof total, v);
+ * @endcode
+ */
+bool threadpool_parallel_reduce(Threadpool* pool, size_t begin, size_t end, size_t grain,
+                                parallel_reduce_fn fn, parallel_combine_fn combine,
+                                const void* identity, void* result, size_t result_size, void* ctx);
+
+/**
+ * @brief Submit a task whose return value is delivered through a future.
+ *
+ * Takes the same path as @c threadpool_submit().  The future is allocated
+ * from the pool's own object pool, so steady-state submission does not
+ * call @c malloc.
+ *
+ * @param pool     Pool to submit to.  Must not be @c NULL.
+ * @param function Task function; its return value becomes the result.
+ *                 Must not be @c NULL.
+ * @param arg      Argument passed verbatim to @p function.
+ *
+ * @return A new future, or @c NULL on invalid arguments, allocation
+ *         failure or if the pool is shutting down.
+ */
+Future* threadpool_submit_future(Threadpool* pool, void* (*function)(void*), void* arg);
+
+/**
+ * @brief Wait for @p future to complete and return its result.
+ *
+ * On one of the pool's workers the caller runs queued tasks while it
+ * waits, like @c tg_wait(), so waiting from inside a task cannot starve
+ * the pool.  Any other thread spins briefly and then sleeps on the
+ * future until it completes.
+ *
+ * @param future Future to wait for.  If @c NULL, returns @c NULL at once.
+ * @return The result produced for @p future.
+ */
+void* future_wait(Future* future);
+
+/**
+ * @brief Fetch the result of @p future if it has completed, without blocking.
+ *
+ * @param future Future to poll.
+ * @param result Receives the result on success.  May be @c NULL.
+ * @return @c true if @p future has completed, @c false if it has not or
+ *         @p future is @c NULL.
+ */
+bool future_try_get(Future* future, void** result);
+
+/**
+ * @brief Chain a continuation that runs on the result of @p future.
+ *
+ * When @p future completes, @p function is submitted from the completing
+ * thread: a worker pushes it onto its own deque, where it normally runs
+ * next.  If @p future has already completed, the continuation is
+ * submitted straight away from the calling thread.
+ *
+ * @p future itself may be released as soon as this returns.
+ *
+ * @param future   Future whose result feeds the continuation.  Must not be @c NULL.
+ * @param function Continuation; called as @p function(@p arg, result of
+ *                 @p future), and its return value becomes the result of
+ *                 the returned future.  Must not be @c NULL.
+ * @param arg      First argument passed to @p function.
+ *
+ * @return A future for the continuation's result, or @c NULL on invalid
+ *         arguments or allocation failure.
+ */
+Future* future_then(Future* future, void* (*function)(void* arg, void* result), void* arg);
+
+/**
+ * @brief Return a future that completes once all of @p futures have.
+ *
+ * Its result is @c NULL; read the individual results with
+ * @c future_try_get() once it has completed.  With @p count 0 the returned
+ * future is already complete.  The input futures may be released as soon
+ * as this returns.
+ *
+ * @param pool    Pool to allocate the combined future from.  Must not be @c NULL.
+ * @param futures Array of @p count futures.  Must not contain @c NULL.
+ * @param count   Number of entries in @p futures.
+ *
+ * @return The combined future, or @c NULL on invalid arguments or
+ *         allocation failure.
+ */
+Future* future_when_all(Threadpool* pool, Future* const* futures, size_t count);
+
+/**
+ * @brief Drop the caller's reference to @p future.
+ *
+ * The future is recycled once it has completed and nothing refers to it
+ * any more; releasing before completion is allowed and does not cancel
+ * the task.
+ *
+ * @param future Future to release.  @c NULL is ignored.
+ */
+void future_release(Future* future);
+
 #ifdef __cplusplus
 }
 #endif
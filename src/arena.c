@@ -1,17 +1,37 @@
 #include "arena.h"
 #include "aligned_alloc.h"
+#include "lock.h"
 #include "macros.h"
 
+#include <stdatomic.h>
+#include <stdio.h>  /* fprintf (ARENA_STATS / ARENA_DEBUG reports) */
 #include <stdlib.h> /* abort    */
 #include <string.h> /* memset   */
 
 #if defined(_WIN32)
 #include <windows.h>
 #else
-#include <sys/mman.h> /* (reserved for future mmap path) */
+#include <sys/mman.h> /* mmap, mprotect, madvise */
 #include <unistd.h>   /* sysconf */
 #endif
 
+#if defined(__SANITIZE_ADDRESS__)
+#define ARENA_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define ARENA_ASAN 1
+#endif
+#endif
+
+#if defined(ARENA_DEBUG) && defined(ARENA_ASAN)
+#include <sanitizer/asan_interface.h>
+#define ARENA_POISON(p, n)   ASAN_POISON_MEMORY_REGION((p), (n))
+#define ARENA_UNPOISON(p, n) ASAN_UNPOISON_MEMORY_REGION((p), (n))
+#else
+#define ARENA_POISON(p, n)   ((void)(p), (void)(n))
+#define ARENA_UNPOISON(p, n) ((void)(p), (void)(n))
+#endif
+
 /* -------------------------------------------------------------------------
  * Thread-local static backing buffer
  *
@@ -39,6 +59,249 @@ static ARENA_INLINE size_t get_page_size(void) {
 #endif
 }
 
+/* Reserves address space with no memory behind it. */
+static char* vm_reserve(size_t size) {
+#if defined(_WIN32)
+    return (char*)VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+    void* p = mmap(NULL, size, PROT_NONE, flags, -1, 0);
+    return p == MAP_FAILED ? NULL : (char*)p;
+#endif
+}
+
+static bool vm_commit(char* addr, size_t size) {
+#if defined(_WIN32)
+    return VirtualAlloc(addr, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+    return mprotect(addr, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+/* Drops the pages' contents and makes them inaccessible again. */
+static void vm_decommit(char* addr, size_t size) {
+#if defined(_WIN32)
+    VirtualFree(addr, size, MEM_DECOMMIT);
+#else
+    madvise(addr, size, MADV_DONTNEED);
+    mprotect(addr, size, PROT_NONE);
+#endif
+}
+
+static void vm_release(char* addr, size_t size) {
+#if defined(_WIN32)
+    (void)size;
+    VirtualFree(addr, 0, MEM_RELEASE);
+#else
+    munmap(addr, size);
+#endif
+}
+
+/* -------------------------------------------------------------------------
+ * Diagnostics (ARENA_STATS / ARENA_DEBUG)
+ *
+ * The inline allocation paths call the _arena_on_* hooks below; the slow
+ * path records padding and block-tail waste itself.  Guards form a list
+ * through the arena, newest first, so they can be verified without any
+ * per-allocation bookkeeping outside the arena's own memory.  A guard may
+ * sit at any address, so it is only ever accessed with memcpy.
+ * ---------------------------------------------------------------------- */
+
+#ifdef ARENA_STATS
+#define STAT_ADD(a, field, n) ((a)->stats.field += (n))
+
+/* Records how far the cursor got in the block it is about to leave. */
+static void stats_leave_block(Arena* a) {
+    if (a->curr > a->current_block->high_water) a->current_block->high_water = a->curr;
+}
+#else
+#define STAT_ADD(a, field, n) ((void)0)
+#define stats_leave_block(a)  ((void)0)
+#endif
+
+#ifdef ARENA_DEBUG
+#define GUARD_CANARY UINT64_C(0xA5E1A5E1DEADC0DE)
+#define GUARD_FILL   0xFD
+
+typedef struct {
+    uint64_t canary;
+    size_t size; /* bytes of the allocation the guard follows */
+    char* prev;  /* next older guard, or NULL */
+} ArenaGuard;
+
+_Static_assert(sizeof(ArenaGuard) <= ARENA_GUARD_SIZE, "ARENA_GUARD_SIZE too small for the guard header");
+
+static void guard_write(char* at, size_t size, char* prev) {
+    ArenaGuard g = {.canary = GUARD_CANARY, .size = size, .prev = prev};
+    ARENA_UNPOISON(at, ARENA_GUARD_SIZE);
+    memset(at, GUARD_FILL, ARENA_GUARD_SIZE);
+    memcpy(at, &g, sizeof(g));
+    ARENA_POISON(at, ARENA_GUARD_SIZE);
+}
+
+/* Reads the guard at `at`; false if any of its bytes were overwritten. */
+static bool guard_read(const char* at, ArenaGuard* out) {
+    ARENA_UNPOISON(at, ARENA_GUARD_SIZE);
+    memcpy(out, at, sizeof(*out));
+    bool ok = out->canary == GUARD_CANARY;
+    for (size_t i = sizeof(*out); ok && i < ARENA_GUARD_SIZE; i++) ok = (unsigned char)at[i] == GUARD_FILL;
+    ARENA_POISON(at, ARENA_GUARD_SIZE);
+    return ok;
+}
+
+static void guard_report(const Arena* a, const char* at, const ArenaGuard* g) {
+    if (g->canary == GUARD_CANARY) {
+        fprintf(stderr, "arena %p: write past the end of %zu-byte allocation at %p\n", (const void*)a, g->size,
+                (const void*)(at - g->size));
+    } else {
+        fprintf(stderr, "arena %p: write past the end of the allocation ending at %p\n", (const void*)a,
+                (const void*)at);
+    }
+}
+
+/* Fills and poisons [from, end) so stale pointers read garbage (or trap under ASan). */
+static void debug_poison(char* from, char* end) {
+    if (from >= end) return;
+    ARENA_UNPOISON(from, (size_t)(end - from));
+    memset(from, ARENA_POISON_BYTE, (size_t)(end - from));
+    ARENA_POISON(from, (size_t)(end - from));
+}
+
+bool arena_debug_check(const Arena* a) {
+    if (!a) return true;
+    for (const char* at = (const char*)a->last_guard; at;) {
+        ArenaGuard g;
+        if (!guard_read(at, &g)) {
+            guard_report(a, at, &g);
+            return false; /* older links are untrustworthy past a damaged guard */
+        }
+        at = g.prev;
+    }
+    return true;
+}
+#endif /* ARENA_DEBUG */
+
+#if defined(ARENA_STATS) || defined(ARENA_DEBUG)
+void _arena_on_alloc(Arena* a, void* ptr, size_t size, size_t padding) {
+    STAT_ADD(a, alloc_count, 1);
+    STAT_ADD(a, bytes_requested, size);
+    STAT_ADD(a, bytes_padding, padding);
+    (void)padding;
+#ifdef ARENA_DEBUG
+    ARENA_UNPOISON(ptr, size);
+    guard_write((char*)ptr + size, size, (char*)a->last_guard);
+    a->last_guard = (char*)ptr + size;
+#else
+    (void)ptr;
+#endif
+}
+
+void _arena_on_resize(Arena* a, void* ptr, size_t old_size, size_t new_size) {
+#ifdef ARENA_STATS
+    a->stats.bytes_requested = a->stats.bytes_requested - old_size + new_size;
+    if (new_size) a->stats.realloc_in_place++;
+#endif
+#ifdef ARENA_DEBUG
+    char* old_guard = (char*)ptr + old_size;
+    ArenaGuard g;
+    if (!guard_read(old_guard, &g)) {
+        guard_report(a, old_guard, &g);
+        g.prev = NULL;
+    }
+    debug_poison((char*)ptr + new_size, old_guard + ARENA_GUARD_SIZE);
+    if (new_size == 0) {
+        a->last_guard = g.prev;
+        return;
+    }
+    ARENA_UNPOISON(ptr, new_size);
+    guard_write((char*)ptr + new_size, new_size, g.prev);
+    a->last_guard = (char*)ptr + new_size;
+#else
+    (void)ptr;
+#endif
+}
+
+void _arena_on_realloc_copy(Arena* a, size_t old_size) {
+    STAT_ADD(a, bytes_stranded, old_size);
+    STAT_ADD(a, realloc_copied, 1);
+    (void)a;
+    (void)old_size;
+}
+
+void _arena_on_reclaim(Arena* a, const ArenaCheckpoint* cp) {
+#ifdef ARENA_STATS
+    stats_leave_block(a);
+    size_t used = arena_used_size(a);
+    if (used > a->stats.peak_used) a->stats.peak_used = used;
+    a->stats.reclaim_count++;
+#endif
+#ifdef ARENA_DEBUG
+    arena_debug_check(a); /* report overflows before the evidence is overwritten */
+    ArenaBlock* block = cp ? cp->saved_block : a->head;
+    char* from = cp ? cp->saved_curr : block->base;
+    for (; block; block = block->next) {
+        debug_poison(from, block->end);
+        if (block->next) from = block->next->base;
+    }
+    a->last_guard = cp ? cp->saved_guard : NULL;
+#else
+    (void)cp;
+#endif
+}
+#endif /* ARENA_STATS || ARENA_DEBUG */
+
+#ifdef ARENA_STATS
+void arena_stats(const Arena* a, ArenaStats* out) {
+    if (!out) return;
+    if (!a) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    *out = a->stats;
+    out->bytes_used = arena_used_size(a);
+    if (out->bytes_used > out->peak_used) out->peak_used = out->bytes_used;
+    out->bytes_committed = a->total_committed;
+    out->block_count = 0;
+    for (const ArenaBlock* b = a->head; b; b = b->next) out->block_count++;
+}
+
+void arena_stats_dump(const Arena* a, const char* label, FILE* out) {
+    if (!a || !out) return;
+
+    ArenaStats st;
+    arena_stats(a, &st);
+    size_t overhead = st.bytes_padding + st.bytes_stranded + st.bytes_tail_waste;
+
+    fprintf(out, "=== arena %s (%p) ===\n", label ? label : "", (const void*)a);
+    fprintf(out, "  allocations      : %zu\n", st.alloc_count);
+    fprintf(out, "  bytes requested  : %zu\n", st.bytes_requested);
+    fprintf(out, "  padding          : %zu\n", st.bytes_padding);
+    fprintf(out, "  stranded realloc : %zu (%zu copied, %zu in place)\n", st.bytes_stranded, st.realloc_copied,
+            st.realloc_in_place);
+    fprintf(out, "  block tail waste : %zu\n", st.bytes_tail_waste);
+    if (st.bytes_requested + overhead) {
+        fprintf(out, "  overhead         : %.2f%%\n",
+                100.0 * (double)overhead / (double)(st.bytes_requested + overhead));
+    }
+    fprintf(out, "  used / peak      : %zu / %zu\n", st.bytes_used, st.peak_used);
+    fprintf(out, "  committed        : %zu in %zu block(s)\n", st.bytes_committed, st.block_count);
+    fprintf(out, "  resets/restores  : %zu\n", st.reclaim_count);
+
+    size_t i = 0;
+    for (const ArenaBlock* b = a->head; b; b = b->next, i++) {
+        const char* hw = b->high_water;
+        if (b == a->current_block && a->curr > hw) hw = a->curr;
+        size_t cap = (size_t)(b->end - b->base);
+        size_t fill = hw > b->base ? (size_t)(hw - b->base) : 0;
+        fprintf(out, "  block %-3zu: %10zu / %10zu bytes (%5.1f%%)%s\n", i, fill, cap,
+                cap ? 100.0 * (double)fill / (double)cap : 0.0, b == a->current_block ? "  <- current" : "");
+    }
+}
+#endif /* ARENA_STATS */
+
 /* -------------------------------------------------------------------------
  * Public API — lifecycle
  * ---------------------------------------------------------------------- */
@@ -98,9 +361,52 @@ Arena* arena_create(size_t reserve_size) {
     return a;
 }
 
+Arena* arena_create_reserved(size_t reserve_size) {
+    size_t page_size = get_page_size();
+    if (reserve_size == 0) reserve_size = ARENA_DEFAULT_RESERVE_SIZE;
+    if (reserve_size > (size_t)-1 - page_size) return NULL;
+    reserve_size = (reserve_size + page_size - 1) & ~(page_size - 1);
+
+    Arena* a = (Arena*)aligned_alloc_xp(64, sizeof(Arena));
+#ifdef ARENA_ABORT_ON_OOM
+    if (ARENA_UNLIKELY(!a)) ARENA_OOM_HANDLER(sizeof(Arena));
+#endif
+    if (!a) return NULL;
+
+    char* base = vm_reserve(reserve_size);
+    size_t initial = ARENA_COMMIT_GRANULE < reserve_size ? ARENA_COMMIT_GRANULE : reserve_size;
+    initial = (initial + page_size - 1) & ~(page_size - 1);
+    if (!base || !vm_commit(base, initial)) {
+        if (base) vm_release(base, reserve_size);
+        aligned_free_xp(a);
+#ifdef ARENA_ABORT_ON_OOM
+        ARENA_OOM_HANDLER(initial);
+#endif
+        return NULL;
+    }
+
+    arena_init(a, base, initial);
+    a->first_block.is_static = false;
+    a->reserve_end = base + reserve_size;
+    a->heap_allocated = true;
+    return a;
+}
+
 void arena_destroy(Arena* a) {
     if (!a) return;
 
+#ifdef ARENA_DEBUG
+    arena_debug_check(a);
+    /* Caller-owned buffers outlive the arena; leave nothing poisoned behind. */
+    for (ArenaBlock* b = a->head; b; b = b->next) ARENA_UNPOISON(b->base, (size_t)(b->end - b->base));
+#endif
+
+    if (a->reserve_end) {
+        vm_release(a->first_block.base, (size_t)(a->reserve_end - a->first_block.base));
+        if (a->heap_allocated) aligned_free_xp(a);
+        return;
+    }
+
     ArenaBlock* block = a->head;
 
     /* Free the first block's buffer only if we heap-allocated it.
@@ -126,11 +432,77 @@ void arena_destroy(Arena* a) {
     if (a->heap_allocated) aligned_free_xp(a);
 }
 
+size_t arena_decommit(Arena* a) {
+    if (!a || !a->current_block) return 0;
+
+    if (a->reserve_end) {
+        /* Keep the pages under the cursor plus one granule of headroom, so
+         * the next allocations do not immediately commit the pages back. */
+        ArenaBlock* block = &a->first_block;
+        uintptr_t keep = ((uintptr_t)a->curr + a->page_size - 1) & ~(uintptr_t)(a->page_size - 1);
+        keep += ARENA_COMMIT_GRANULE;
+        if (keep >= (uintptr_t)block->end) return 0;
+
+        size_t released = (size_t)((uintptr_t)block->end - keep);
+        ARENA_UNPOISON((char*)keep, released);
+        vm_decommit((char*)keep, released);
+        block->end = (char*)keep;
+        a->end = block->end;
+        a->total_committed -= released;
+        return released;
+    }
+
+    /* Blocks after the current one hold nothing live. */
+    size_t released = 0;
+    ArenaBlock* block = a->current_block->next;
+    a->current_block->next = NULL;
+    while (block) {
+        ArenaBlock* next = block->next;
+        released += (size_t)(block->end - (char*)block);
+        aligned_free_xp(block);
+        block = next;
+    }
+    a->total_committed -= released;
+    return released;
+}
+
 /* -------------------------------------------------------------------------
  * Slow path — new block allocation
  * ---------------------------------------------------------------------- */
 
+bool _arena_extend(Arena* a, char* new_end) {
+    ArenaBlock* block = &a->first_block;
+    if (!a->reserve_end || new_end > a->reserve_end) return false;
+
+    if (new_end > block->end) {
+        size_t step = (size_t)(new_end - block->end);
+        if (step < ARENA_COMMIT_GRANULE) step = ARENA_COMMIT_GRANULE;
+        step = (step + a->page_size - 1) & ~(a->page_size - 1);
+        if (step > (size_t)(a->reserve_end - block->end)) step = (size_t)(a->reserve_end - block->end);
+
+        if (!vm_commit(block->end, step)) return false;
+        block->end += step;
+        a->total_committed += step;
+    }
+    a->end = block->end;
+    return true;
+}
+
 void* _arena_alloc_slow(Arena* a, size_t size, size_t alignment) {
+    /* --- Reserved arena: commit more of the one contiguous range -------- */
+
+    if (a->reserve_end) {
+        uintptr_t aligned = ((uintptr_t)a->curr + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        if (aligned > (uintptr_t)a->reserve_end || size > (uintptr_t)a->reserve_end - aligned) return NULL;
+        if (!_arena_extend(a, (char*)(aligned + size))) return NULL;
+        STAT_ADD(a, bytes_padding, aligned - (uintptr_t)a->curr);
+        a->curr = (char*)(aligned + size);
+        return (void*)aligned;
+    }
+
+    stats_leave_block(a);
+    STAT_ADD(a, bytes_tail_waste, (size_t)(a->end - a->curr));
+
     /* --- Try existing cached blocks after current_block first ------------ */
 
     ArenaBlock* next = a->current_block->next;
@@ -138,6 +510,7 @@ void* _arena_alloc_slow(Arena* a, size_t size, size_t alignment) {
         uintptr_t aligned = ((uintptr_t)next->base + alignment - 1) & ~(uintptr_t)(alignment - 1);
         if (aligned + size <= (uintptr_t)next->end) {
             /* Found a cached block with enough room. */
+            STAT_ADD(a, bytes_padding, aligned - (uintptr_t)next->base);
             a->current_block = next;
             a->curr = (char*)(aligned + size);
             a->end = next->end;
@@ -178,6 +551,10 @@ void* _arena_alloc_slow(Arena* a, size_t size, size_t alignment) {
     block->base = (char*)base_addr; /* record the true start for capacity math */
     block->end = ptr + next_size;
     block->is_static = false;
+#ifdef ARENA_STATS
+    block->high_water = NULL;
+#endif
+    STAT_ADD(a, bytes_padding, aligned - base_addr);
     /* Insert at the tail of the chain so skipped cached blocks are revisited
      * on future slow-path calls instead of being orphaned mid-chain. */
     block->next = NULL;
@@ -190,3 +567,197 @@ void* _arena_alloc_slow(Arena* a, size_t size, size_t alignment) {
 
     return (void*)aligned;
 }
+
+/* -------------------------------------------------------------------------
+ * Concurrent arena
+ *
+ * Shared blocks hand out space with an atomic fetch-add on `used`; a block
+ * is exhausted once `used` passes its capacity, after which the lock holder
+ * moves `current` to the next cached block (after a reset) or a new one.
+ * Each thread keeps its chunks in a small 2-way set-associative TLS table
+ * keyed by arena id, most recently used way first, so two arenas whose ids
+ * share a set can be used alternately without abandoning each other's
+ * chunk.  Ids are never reused and carena_reset() assigns a fresh one, so a
+ * chunk from a reset or destroyed arena is never mistaken for a live one.
+ * ---------------------------------------------------------------------- */
+
+#define CARENA_TLS_SETS 4 /* power of 2 */
+#define CARENA_TLS_WAYS 2 /* arenas per set one thread can hold chunks of at once */
+#define CARENA_ALIGN     64
+
+typedef struct CArenaBlock {
+    struct CArenaBlock* next;
+    _Atomic size_t used; /* may overshoot capacity once exhausted */
+    size_t capacity;
+    alignas(CARENA_ALIGN) char data[];
+} CArenaBlock;
+
+struct ConcurrentArena {
+    _Atomic(CArenaBlock*) current; /* block chunks are carved from */
+    _Atomic uint64_t id;           /* TLS chunk key; renewed by reset */
+    CArenaBlock* head;             /* shared blocks, kept across resets */
+    CArenaBlock* tail;
+    CArenaBlock* large;            /* dedicated blocks, freed by reset */
+    size_t block_size;
+    _Atomic size_t committed;
+    Lock lock; /* guards block replacement and the lists */
+};
+
+typedef struct {
+    uint64_t arena_id;
+    char* curr;
+    char* end;
+} CArenaChunk;
+
+static _Atomic uint64_t g_carena_next_id = 1;
+static THREAD_LOCAL CArenaChunk tl_carena_chunks[CARENA_TLS_SETS][CARENA_TLS_WAYS];
+
+static CArenaBlock* carena_block_new(ConcurrentArena* a, size_t capacity) {
+    CArenaBlock* b = (CArenaBlock*)aligned_alloc_xp(CARENA_ALIGN, sizeof(CArenaBlock) + capacity);
+    if (!b) return NULL;
+    b->next = NULL;
+    atomic_init(&b->used, 0);
+    b->capacity = capacity;
+    atomic_fetch_add_explicit(&a->committed, sizeof(CArenaBlock) + capacity, memory_order_relaxed);
+    return b;
+}
+
+/**
+ * Claims @p bytes (a multiple of CARENA_ALIGN) from the shared block.  The
+ * fast path is one fetch-add; the lock is taken only to replace a block.
+ */
+static char* carena_carve(ConcurrentArena* a, size_t bytes) {
+    for (;;) {
+        CArenaBlock* b = atomic_load_explicit(&a->current, memory_order_acquire);
+        size_t off = atomic_fetch_add_explicit(&b->used, bytes, memory_order_relaxed);
+        if (ARENA_LIKELY(off + bytes <= b->capacity)) return b->data + off;
+
+        lock_acquire(&a->lock);
+        if (atomic_load_explicit(&a->current, memory_order_relaxed) == b) {
+            /* Blocks after current are only ever empty ones kept by a reset. */
+            CArenaBlock* next = b->next;
+            if (!next) {
+                next = carena_block_new(a, a->block_size);
+                if (!next) {
+                    lock_release(&a->lock);
+                    return NULL;
+                }
+                a->tail->next = next;
+                a->tail = next;
+            }
+            atomic_store_explicit(&a->current, next, memory_order_release);
+        }
+        lock_release(&a->lock);
+    }
+}
+
+/** Gives an oversized request a block of its own. */
+static char* carena_alloc_large(ConcurrentArena* a, size_t size) {
+    CArenaBlock* b = carena_block_new(a, size);
+    if (!b) return NULL;
+    atomic_store_explicit(&b->used, size, memory_order_relaxed);
+
+    lock_acquire(&a->lock);
+    b->next = a->large;
+    a->large = b;
+    lock_release(&a->lock);
+    return b->data;
+}
+
+ConcurrentArena* carena_create(size_t block_size) {
+    if (block_size == 0) block_size = ARENA_CONCURRENT_BLOCK_SIZE;
+    if (block_size < 4 * ARENA_CHUNK_SIZE) block_size = 4 * ARENA_CHUNK_SIZE;
+    block_size = (block_size + CARENA_ALIGN - 1) & ~(size_t)(CARENA_ALIGN - 1);
+
+    ConcurrentArena* a = (ConcurrentArena*)aligned_alloc_xp(CARENA_ALIGN, sizeof(ConcurrentArena));
+    if (!a) return NULL;
+    memset(a, 0, sizeof(*a));
+    a->block_size = block_size;
+    atomic_init(&a->committed, 0);
+    atomic_init(&a->id, atomic_fetch_add_explicit(&g_carena_next_id, 1, memory_order_relaxed));
+
+    CArenaBlock* b = carena_block_new(a, block_size);
+    if (!b) {
+        aligned_free_xp(a);
+        return NULL;
+    }
+    a->head = a->tail = b;
+    atomic_init(&a->current, b);
+    lock_init(&a->lock);
+    return a;
+}
+
+void* carena_alloc_align(ConcurrentArena* a, size_t size, size_t alignment) {
+    if (ARENA_UNLIKELY(!a || size == 0 || alignment > CARENA_ALIGN)) return NULL;
+
+    if (ARENA_UNLIKELY(size > ARENA_CHUNK_SIZE / 4)) {
+        size_t bytes = (size + CARENA_ALIGN - 1) & ~(size_t)(CARENA_ALIGN - 1);
+        if (bytes > a->block_size / 2) return carena_alloc_large(a, bytes);
+        return carena_carve(a, bytes);
+    }
+
+    uint64_t id = atomic_load_explicit(&a->id, memory_order_relaxed);
+    CArenaChunk* set = tl_carena_chunks[id & (CARENA_TLS_SETS - 1)];
+    if (ARENA_UNLIKELY(set[0].arena_id != id)) {
+        /* Move this arena's way (or the least recently used one, which is
+         * then replaced) to the front. */
+        int way = CARENA_TLS_WAYS - 1;
+        for (int i = 1; i < CARENA_TLS_WAYS - 1; i++) {
+            if (set[i].arena_id == id) way = i;
+        }
+        CArenaChunk hit = set[way];
+        memmove(&set[1], &set[0], (size_t)way * sizeof(CArenaChunk));
+        set[0] = hit;
+    }
+    CArenaChunk* c = &set[0];
+    if (ARENA_LIKELY(c->arena_id == id)) {
+        uintptr_t aligned = ((uintptr_t)c->curr + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        if (ARENA_LIKELY(aligned + size <= (uintptr_t)c->end)) {
+            c->curr = (char*)(aligned + size);
+            return (void*)aligned;
+        }
+    }
+
+    /* New chunk: the rest of the old one is abandoned. */
+    char* chunk = carena_carve(a, ARENA_CHUNK_SIZE);
+    if (ARENA_UNLIKELY(!chunk)) return NULL;
+    c->arena_id = id;
+    c->curr = chunk + size; /* chunk starts CARENA_ALIGN-aligned, enough for any allowed alignment */
+    c->end = chunk + ARENA_CHUNK_SIZE;
+    return chunk;
+}
+
+void carena_reset(ConcurrentArena* a) {
+    if (!a) return;
+
+    for (CArenaBlock* b = a->head; b; b = b->next) atomic_store_explicit(&b->used, 0, memory_order_relaxed);
+    while (a->large) {
+        CArenaBlock* next = a->large->next;
+        atomic_fetch_sub_explicit(&a->committed, sizeof(CArenaBlock) + a->large->capacity, memory_order_relaxed);
+        aligned_free_xp(a->large);
+        a->large = next;
+    }
+    atomic_store_explicit(&a->current, a->head, memory_order_release);
+    atomic_store_explicit(&a->id, atomic_fetch_add_explicit(&g_carena_next_id, 1, memory_order_relaxed),
+                          memory_order_release);
+}
+
+void carena_destroy(ConcurrentArena* a) {
+    if (!a) return;
+
+    CArenaBlock* lists[2] = {a->head, a->large};
+    for (int i = 0; i < 2; i++) {
+        CArenaBlock* b = lists[i];
+        while (b) {
+            CArenaBlock* next = b->next;
+            aligned_free_xp(b);
+            b = next;
+        }
+    }
+    lock_free(&a->lock);
+    aligned_free_xp(a);
+}
+
+size_t carena_committed_size(ConcurrentArena* a) {
+    return a ? atomic_load_explicit(&a->committed, memory_order_relaxed) : 0;
+}
@@ -28,32 +28,98 @@
  *
  * Probe-length instrumentation is compiled in when CACHE_PROBE_STATS is
  * defined; it is zero-overhead in release builds.
+ *
+ * Optimistic reads (CACHE_READ_OPTIMISTIC): every shard carries a sequence
+ * counter that writers make odd for the duration of a write-locked section.
+ * Readers probe tags[]/entries[] without touching the lock word and validate
+ * the counter afterwards, retrying (then falling back to the read lock) only
+ * when a writer raced.  Because such a reader may dereference an entry that
+ * a writer is concurrently unlinking, the cache's own reference on unlinked
+ * entries and superseded slot arrays are retired through a process-wide
+ * epoch scheme and only dropped once no reader that could have observed
+ * them is still inside its read-side critical section.
+ *
+ * Expiry uses a coarse monotonic millisecond clock published by one shared
+ * ticker thread (started by the first live cache, stopped with the last),
+ * so lookups read a single mostly-read-only word instead of calling into
+ * the OS clock on every operation.
+ *
+ * Keys are hashed with XXH3 under a random per-process seed (or a caller's
+ * hash and seed from cache_config_t), so key placement cannot be predicted
+ * and an attacker cannot pre-compute keys that pile into one shard.
+ *
+ * Entries can optionally be carved from a per-shard, size-classed slab
+ * allocator (cache_config_t.slab_alloc) so high-churn workloads reuse
+ * blocks instead of round-tripping through malloc, and a byte budget
+ * (cache_config_t.max_bytes) bounds the memory charged to entries
+ * independently of the entry-count capacity.
  */
 
 #include "../include/cache.h"
 
 #include "../include/align.h"
 #include "../include/aligned_alloc.h"
+#include "../include/file.h"
+#include "../include/lock.h"
+#include "../include/macros.h"
 #include "../include/spinlock.h"
+#include "../include/thread.h"
 
 #include <errno.h>
 #include <inttypes.h>
+#include <math.h>
 #include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#define XXH_INLINE_ALL
+#include <xxhash.h>
+
 #if defined(__linux__) && defined(MADV_HUGEPAGE)
 #include <sys/mman.h>
 #endif
 
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 /* ---------------------------------------------------------------- constants */
 
 #define CACHE_LINE_SIZE           64         /* bytes per cache line */
-#define INITIAL_BUCKET_MULTIPLIER 2          /* target 50 % load factor */
+#define CACHE_DEFAULT_LOAD_FACTOR 0.5f       /* live slots per bucket at capacity */
+#define CACHE_MAX_LOAD_FACTOR     0.95f      /* upper bound for cache_config_t.max_load_factor */
+#define CACHE_REHASH_STEP         16         /* old-table slots migrated per cache_set() */
+#define CACHE_SHRINK_STEP         16         /* extra evictions per insert while over capacity */
 #define CACHE_FILE_MAGIC          0x45484346 /* ASCII "FCHE" in little-endian */
-#define CACHE_FILE_VERSION        1
+#define CACHE_FILE_END_MAGIC      0x444E4546 /* ASCII "FEND": last word of a complete snapshot */
+#define CACHE_FILE_VERSION        2
+#define CACHE_FILE_VERSION_V1     1          /* flat record stream; still loadable */
+#define CACHE_SNAPSHOT_BUFFER     (1u << 16) /* bytes buffered per snapshot write */
+#define CACHE_LOAD_MAX_THREADS    64         /* threads used by one cache_load_ex() */
+#define CACHE_BATCH_CHUNK         64 /* keys grouped per pass in the batch API */
+#define CACHE_EPOCH_SLOTS         256 /* concurrent optimistic readers; power of 2 */
+#define CACHE_EPOCH_PROBE         8   /* slots tried before falling back to the lock */
+#define CACHE_RETIRE_BATCH        64  /* retired entries per shard before reclaiming */
+#define CACHE_OPTIMISTIC_RETRIES  4   /* seqlock validation failures before locking */
+#define CACHE_MAX_SHARDS          4096 /* upper bound for cache_config_t.shard_count */
+#define CACHE_MAX_NUMA_NODES      64   /* nodes addressable by the placement mask */
+#define CACHE_CLOCK_TICK_MS       5    /* coarse clock refresh period */
+#define CACHE_SWEEP_SLICE         256  /* slots examined per lock hold by cache_tick() */
+#define CACHE_SWEEP_BUDGET        4096 /* default slots per sweeper-thread tick */
+#define CACHE_SLAB_MAX_BLOCK      32768 /* largest slab-served block; bigger entries use malloc */
+#define CACHE_SLAB_CLASSES        32    /* 64 B steps to 256 B, then 4 classes per power of two up to 32 KiB */
+#define CACHE_SLAB_CHUNK          65536 /* minimum bytes requested from malloc per refill */
+#define CACHE_SLAB_LARGE          0xFFu /* size_class of malloc-backed entries */
+#define CACHE_SKETCH_DEPTH        4     /* count-min rows (hash functions) */
+#define CACHE_SKETCH_WIDTH_MULT   16    /* counters per entry of shard capacity */
+#define CACHE_SKETCH_MAX_COUNT    15    /* counter saturation value */
+#define CACHE_SKETCH_SAMPLE_MULT  10    /* recorded accesses per capacity before aging */
+#define CACHE_SKETCH_READ_SAMPLE  8     /* one get in this many is recorded in the sketch */
+#define CACHE_STAT_SLOTS          64    /* per-thread counter slots per cache; power of 2 */
+#define CACHE_HOT_SAMPLE          64    /* default: one get in this many feeds the hot-key tracker */
 
 /*
  * Tag byte encoding (8 bits):
@@ -68,7 +134,7 @@
  *
  * The 6-bit fragment is derived from the full 32-bit hash (bits 8-13, chosen
  * to avoid overlap with the bits used for bucket index selection).  Because
- * bucket_count is always a power of 2 and INITIAL_BUCKET_MULTIPLIER=2, the
+ * bucket_count is always a power of 2 and the default load factor is 0.5, the
  * bucket index uses at most log2(131072)=17 low bits.  Taking fragment bits
  * from bits 18-23 gives maximum independence from the index selection.
  */
@@ -87,6 +153,13 @@
 #define unlikely(x) (x)
 #endif
 
+/** Read prefetch into all cache levels; no-op where unsupported. */
+#if defined(__GNUC__) || defined(__clang__)
+#define prefetch_read(addr) __builtin_prefetch((addr), 0, 3)
+#else
+#define prefetch_read(addr) ((void)(addr))
+#endif
+
 /* ---------------------------------------------------------------- probe-length instrumentation
  *
  * Enabled only when CACHE_PROBE_STATS is defined at compile time.
@@ -164,13 +237,20 @@ void cache_probe_stats_dump(void) {
  * Fields are ordered specifically to keep the hot hash and key_len at offset 0
  * for simpler assembly encoding (no base register displacement necessary).
  */
-typedef struct ALIGN(CACHE_LINE_SIZE) {
-    uint32_t hash;             /**< Full 32-bit FNV-1a hash of the key. */
+struct cache_slab_s;
+
+typedef struct ALIGN(CACHE_LINE_SIZE) cache_entry_s {
+    uint32_t hash;             /**< 32-bit fold of the cache's seeded key hash. */
     uint32_t key_len;          /**< Key length in bytes, excluding null terminator. */
     atomic_int ref_count;      /**< Reference count; freed when it reaches zero. */
     _Atomic uint8_t clock_bit; /**< CLOCK algorithm: 1 = recently used. */
-    time_t expires_at;         /**< Absolute UNIX expiry timestamp. */
+    uint8_t size_class;        /**< Slab class, or CACHE_SLAB_LARGE for malloc'd entries. */
+    uint64_t expires_at;       /**< Absolute expiry on the coarse monotonic clock, in ms. */
     size_t value_len;          /**< Value length in bytes. */
+    struct cache_entry_s* retire_next; /**< Shard retire list link (optimistic mode). */
+    uint64_t retire_epoch;             /**< Global epoch observed when retired. */
+    struct cache_slab_s* slab;         /**< Owning slab, or NULL when malloc'd. */
+    uint32_t load_ms;                  /**< Loader run time for cache_get_or_load() entries, else 0. */
     /* Flexible array: [key]['\0'][back_ptr][value] */
 #if defined(_MSC_VER) && !defined(__cplusplus)
     unsigned char data[1]; /* MSVC C-mode workaround */
@@ -179,8 +259,30 @@ typedef struct ALIGN(CACHE_LINE_SIZE) {
 #endif
 } cache_entry_t;
 
+/**
+ * @brief Slot arrays superseded by a rehash, kept until no optimistic
+ * reader can still be probing them.
+ */
+typedef struct retired_table_s {
+    uint8_t* tags;
+    cache_entry_t** entries;
+    uint64_t retire_epoch;
+    struct retired_table_s* next;
+} retired_table_t;
+
+/** Borrowed view of one slot table: the live one or, during a rehash, the old one. */
+typedef struct {
+    uint8_t* tags;
+    cache_entry_t** entries;
+    size_t bucket_count;
+} slot_table_t;
+
 /**
  * @brief Optimized structure-of-arrays slot representation.
+ *
+ * While a rehash is in flight the shard owns two tables: tags/entries (the
+ * new table, which receives every insert) and old_tags/old_entries, which
+ * is drained a few slots per write.  A key lives in exactly one of them.
  */
 typedef struct ALIGN(CACHE_LINE_SIZE) {
     uint8_t* tags;           /**< 1-byte tag per slot; size == bucket_count. */
@@ -189,19 +291,422 @@ typedef struct ALIGN(CACHE_LINE_SIZE) {
     size_t size;             /**< Number of live (non-tombstone) entries. */
     size_t capacity;         /**< Maximum live entries before eviction triggers. */
     size_t tombstone_count;  /**< Number of TAG_DELETED slots. */
+    size_t compact_at;       /**< Compact once live + tombstone slots exceed this. */
     size_t clock_hand;       /**< CLOCK eviction scan position. */
     fast_rwlock_t lock;      /**< Per-shard reader-writer spinlock. */
+    _Atomic uint32_t seq;    /**< Seqlock counter; odd while a writer holds the lock. */
+    uint32_t retired_count;  /**< Length of the retired list. */
+    int16_t numa_node;       /**< Preferred node for the slot arrays, or -1. */
+    bool deferred_reclaim;   /**< Retire unlinked entries instead of releasing them. */
+    cache_entry_t* retired;  /**< Entries awaiting a grace period (cache ref still held). */
+    retired_table_t* retired_tables; /**< Slot arrays awaiting a grace period. */
+    retired_table_t* old_retire;     /**< Retire node reserved for the old table while a rehash is in flight. */
+    _Atomic size_t sweep_pos; /**< Next slot cache_tick() examines in this shard. */
+    struct cache_slab_s* slab; /**< Entry allocator, or NULL to use malloc. */
+    size_t bytes;             /**< Bytes charged to live entries. */
+    size_t byte_budget;       /**< Upper bound for bytes (0 = unlimited). */
+    struct cache_sketch_s* sketch; /**< TinyLFU frequency sketch, or NULL for plain CLOCK. */
+    uint8_t* old_tags;             /**< Table being migrated away from, or NULL. */
+    cache_entry_t** old_entries;   /**< Entry pointers of the old table. */
+    size_t old_bucket_count;       /**< Size of the old table. */
+    size_t old_live;               /**< Live entries still in the old table. */
+    size_t migrate_pos;            /**< Next old slot to migrate. */
+    size_t target_buckets;         /**< Table size requested by cache_resize(). */
+    size_t target_capacity;        /**< Capacity that takes effect with target_buckets. */
+    struct cache_flight_s* flights; /**< Loads in progress in cache_get_or_load(). */
+
+    /* Write-side statistics; only touched under the write lock, whose line the writer already owns. */
+    uint64_t stat_sets;        /**< Entries linked by inserts. */
+    uint64_t stat_rejections;  /**< Inserts refused by admission or the byte budget. */
+    uint64_t stat_evictions;   /**< Entries evicted for capacity or bytes. */
+    uint64_t stat_expirations; /**< Expired entries unlinked. */
+    uint64_t stat_compactions; /**< Same-size rehashes started to drop tombstones. */
+    uint64_t stat_write_spins; /**< Failed write-lock attempts before acquiring. */
 } aligned_cache_shard_t;
 
-_Static_assert(sizeof(aligned_cache_shard_t) <= 2 * CACHE_LINE_SIZE,
+_Static_assert(sizeof(aligned_cache_shard_t) <= 4 * CACHE_LINE_SIZE,
                "Shard struct too large; consider padding or splitting fields");
 
+/**
+ * Read-side statistics of the threads mapped to one slot.  Each slot owns a
+ * cache line, so counting a get never writes a line another thread reads.
+ */
+typedef struct ALIGN(CACHE_LINE_SIZE) {
+    _Atomic uint64_t hits;
+    _Atomic uint64_t misses;
+    _Atomic uint64_t read_spins;  /**< Failed read-lock attempts before acquiring. */
+    _Atomic uint32_t sample_tick; /**< Gets since this slot last fed the hot-key tracker. */
+    _Atomic uint32_t sketch_tick; /**< Gets since this slot last fed a TinyLFU sketch. */
+} cache_stat_slot_t;
+
+/** One Space-Saving counter of the hot-key tracker. */
+typedef struct {
+    uint32_t hash;
+    uint32_t key_len; /* full length; key keeps at most CACHE_HOT_KEY_MAX - 1 bytes */
+    uint64_t count;
+    char key[CACHE_HOT_KEY_MAX];
+} hot_key_counter_t;
+
+/**
+ * Sampled top-K tracker (Space-Saving): a key that is not tracked replaces
+ * the smallest counter and inherits its count, so the heaviest keys stay
+ * tracked with a bounded overestimate.
+ */
+typedef struct {
+    fast_rwlock_t lock; /* write-locked only; samplers skip the sample when it is busy */
+    uint32_t sample;    /* one get in `sample` is recorded */
+    size_t size;
+    size_t used;
+    hot_key_counter_t counters[];
+} hot_key_tracker_t;
+
 /** Top-level cache object. */
 struct cache_s {
-    aligned_cache_shard_t shards[CACHE_SHARD_COUNT]; /**< Fixed array of independent shards. */
-    uint32_t default_ttl;                            /**< Default TTL in seconds when ttl=0 is passed to cache_set(). */
+    aligned_cache_shard_t* shards; /**< Array of shard_count independent shards. */
+    size_t shard_count;            /**< Number of shards; always a power of 2. */
+    uint64_t default_ttl_ms;       /**< Default TTL in ms when no TTL is passed to cache_set(). */
+    cache_read_mode_t read_mode;   /**< How cache_get() synchronises with writers. */
+    cache_hash_fn hash_fn;         /**< Custom key hash, or NULL for seeded XXH3. */
+    uint64_t hash_seed;            /**< Seed passed to the key hash. */
+    float load_factor;             /**< Live slots per bucket at capacity. */
+    float refresh_beta;            /**< Early-refresh aggressiveness for loaded entries; 0 = off. */
+    _Atomic size_t sweep_cursor;   /**< Round-robin shard cursor for cache_tick(). */
+    cache_stat_slot_t* stats;      /**< CACHE_STAT_SLOTS per-thread counter slots. */
+    hot_key_tracker_t* hot_keys;   /**< Sampled hot-key tracker, or NULL when disabled. */
+
+    /* Optional background sweeper (cache_config_t.sweep_interval_ms). */
+    bool sweeper_running;
+    uint32_t sweep_interval_ms;
+    size_t sweep_budget;
+    Lock sweeper_lock;
+    Condition sweeper_cond;
+    Thread sweeper_thread;
 };
 
+/* ---------------------------------------------------------------- slab allocator
+ *
+ * One allocator per shard.  Blocks are grouped into size classes (64 B
+ * steps up to 256 B, then four classes per power of two up to
+ * CACHE_SLAB_MAX_BLOCK) and freed
+ * blocks go back onto their class's free list for reuse; memory is only
+ * returned to the system when the slab itself is destroyed.  The slab lock
+ * is independent of the shard lock because the last cache_release() of an
+ * entry can run on any thread at any time.
+ *
+ * A slab outlives its cache while callers still hold references: destroy
+ * marks it orphaned and the last block to come back frees it.
+ */
+typedef struct cache_slab_s {
+    fast_rwlock_t lock;                     /**< Used as a mutex (write side only). */
+    void* free_lists[CACHE_SLAB_CLASSES];   /**< Intrusive singly-linked free blocks. */
+    void* chunks;                           /**< Chunk list; first word links to the next. */
+    size_t live_blocks;                     /**< Blocks handed out and not yet freed. */
+    bool orphaned;                          /**< Owning cache destroyed. */
+} cache_slab_t;
+
+/*
+ * Chunks are cache-line aligned and every class size is a multiple of the
+ * line, so each block meets cache_entry_t's alignment; the header that links
+ * the chunk is padded to a full line for the same reason.
+ */
+#define SLAB_CHUNK_HEADER CACHE_LINE_SIZE
+
+/** floor(log2(n)) for n > 0. */
+static inline size_t floor_log2(size_t n) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (size_t)(63 - __builtin_clzll((unsigned long long)n));
+#else
+    size_t r = 0;
+    while (n >>= 1) r++;
+    return r;
+#endif
+}
+
+/** Size class for a request of sz bytes, or -1 when it is too large for a slab. */
+static inline int slab_class_of(size_t sz) {
+    if (sz <= 256) return sz == 0 ? 0 : (int)((sz - 1) / 64);
+    if (sz > CACHE_SLAB_MAX_BLOCK) return -1;
+    size_t k = floor_log2(sz - 1);
+    size_t sub = ((sz - 1) >> (k - 2)) & 3u;
+    return 4 + (int)((k - 8) * 4 + sub);
+}
+
+/** Block size of class c. */
+static inline size_t slab_class_size(int c) {
+    if (c < 4) return 64 * ((size_t)c + 1);
+    size_t k = 8 + (size_t)(c - 4) / 4;
+    size_t sub = (size_t)(c - 4) % 4;
+    return ((size_t)1 << k) + (sub + 1) * ((size_t)1 << (k - 2));
+}
+
+static cache_slab_t* slab_create(void) {
+    cache_slab_t* slab = calloc(1, sizeof(cache_slab_t));
+    if (slab) fast_rwlock_init(&slab->lock);
+    return slab;
+}
+
+static void slab_release_memory(cache_slab_t* slab) {
+    void* chunk = slab->chunks;
+    while (chunk) {
+        void* next = *(void**)chunk;
+        aligned_free_xp(chunk);
+        chunk = next;
+    }
+    free(slab);
+}
+
+/** Pops a block of class c, refilling the class from a fresh chunk when empty. */
+static void* slab_alloc(cache_slab_t* slab, int c) {
+    fast_rwlock_wrlock(&slab->lock);
+    void* block = slab->free_lists[c];
+    if (unlikely(!block)) {
+        size_t bsz = slab_class_size(c);
+        size_t count = (CACHE_SLAB_CHUNK - SLAB_CHUNK_HEADER) / bsz;
+        if (count < 8) count = 8;
+
+        char* chunk = aligned_alloc_xp(CACHE_LINE_SIZE, SLAB_CHUNK_HEADER + count * bsz);
+        if (!chunk) {
+            fast_rwlock_unlock_wr(&slab->lock);
+            return NULL;
+        }
+        *(void**)chunk = slab->chunks;
+        slab->chunks = chunk;
+
+        /* Thread the new blocks so they are handed out in address order. */
+        char* first = chunk + SLAB_CHUNK_HEADER;
+        for (size_t i = 0; i + 1 < count; i++) *(void**)(first + i * bsz) = first + (i + 1) * bsz;
+        *(void**)(first + (count - 1) * bsz) = NULL;
+        block = first;
+    }
+    slab->free_lists[c] = *(void**)block;
+    slab->live_blocks++;
+    fast_rwlock_unlock_wr(&slab->lock);
+    return block;
+}
+
+/** Returns a block to its class; frees the whole slab if it is orphaned and now empty. */
+static void slab_free(cache_slab_t* slab, void* block, int c) {
+    fast_rwlock_wrlock(&slab->lock);
+    *(void**)block = slab->free_lists[c];
+    slab->free_lists[c] = block;
+    bool release = --slab->live_blocks == 0 && slab->orphaned;
+    fast_rwlock_unlock_wr(&slab->lock);
+    if (release) slab_release_memory(slab);
+}
+
+/** Detaches a slab from its cache; it is freed once every block has come back. */
+static void slab_orphan(cache_slab_t* slab) {
+    if (!slab) return;
+    fast_rwlock_wrlock(&slab->lock);
+    slab->orphaned = true;
+    bool release = slab->live_blocks == 0;
+    fast_rwlock_unlock_wr(&slab->lock);
+    if (release) slab_release_memory(slab);
+}
+
+/* ---------------------------------------------------------------- coarse clock
+ *
+ * A single ticker thread stores the monotonic time in ms every
+ * CACHE_CLOCK_TICK_MS.  Expiry checks therefore see the time up to one tick
+ * late, so an entry may outlive its TTL by a few ms; that is well inside the
+ * slack of any real TTL, while keeping the ticker to 200 wakeups a second
+ * and none at all once the last cache is destroyed.  If the ticker could not
+ * be started the clock falls back to reading the OS clock directly.
+ */
+static _Atomic uint64_t g_clock_now_ms; /* 0 while no ticker is running */
+static _Atomic bool g_clock_running;
+static size_t g_clock_users;             /* live caches; guarded by g_clock_lock */
+static fast_rwlock_t g_clock_lock;       /* zero-initialised == unlocked */
+static Thread g_clock_thread;
+
+static void* clock_ticker(void* arg) {
+    (void)arg;
+    while (atomic_load_explicit(&g_clock_running, memory_order_acquire)) {
+        atomic_store_explicit(&g_clock_now_ms, get_time_ms(), memory_order_relaxed);
+        sleep_ms(CACHE_CLOCK_TICK_MS);
+    }
+    return NULL;
+}
+
+/** Current coarse monotonic time in ms. */
+static inline uint64_t cache_now_ms(void) {
+    uint64_t now = atomic_load_explicit(&g_clock_now_ms, memory_order_relaxed);
+    if (unlikely(now == 0)) return get_time_ms();
+    return now;
+}
+
+/** Registers a cache with the shared ticker, starting it for the first user. */
+static void clock_acquire(void) {
+    fast_rwlock_wrlock(&g_clock_lock);
+    if (g_clock_users++ == 0) {
+        atomic_store_explicit(&g_clock_now_ms, get_time_ms(), memory_order_relaxed);
+        atomic_store_explicit(&g_clock_running, true, memory_order_release);
+        if (thread_create(&g_clock_thread, clock_ticker, NULL) != 0) {
+            atomic_store_explicit(&g_clock_running, false, memory_order_relaxed);
+            atomic_store_explicit(&g_clock_now_ms, 0, memory_order_relaxed);
+        }
+    }
+    fast_rwlock_unlock_wr(&g_clock_lock);
+}
+
+/** Unregisters a cache, stopping the ticker when the last one goes away. */
+static void clock_release(void) {
+    fast_rwlock_wrlock(&g_clock_lock);
+    if (--g_clock_users == 0 && atomic_load_explicit(&g_clock_running, memory_order_relaxed)) {
+        atomic_store_explicit(&g_clock_running, false, memory_order_release);
+        thread_join(g_clock_thread, NULL);
+        atomic_store_explicit(&g_clock_now_ms, 0, memory_order_relaxed);
+    }
+    fast_rwlock_unlock_wr(&g_clock_lock);
+}
+
+/* ---------------------------------------------------------------- epoch-based reclamation
+ *
+ * One process-wide domain shared by every cache.  An optimistic reader
+ * claims a slot (normally the same one every time, so the line stays in its
+ * core's cache) and announces the global epoch it observed; the slot is
+ * cleared again as soon as the lookup finishes.  Anything a writer unlinks is
+ * tagged with the epoch read after the unlink and may be reclaimed once every
+ * announced epoch is strictly newer.
+ */
+typedef struct ALIGN(CACHE_LINE_SIZE) {
+    _Atomic uint64_t state; /**< 0 = idle, otherwise (epoch << 1) | 1. */
+} epoch_slot_t;
+
+static epoch_slot_t g_epoch_slots[CACHE_EPOCH_SLOTS];
+static _Atomic uint64_t g_epoch = 1;
+static _Atomic uint32_t g_epoch_next_hint;
+static _Thread_local uint32_t tl_epoch_hint = UINT32_MAX;
+
+/**
+ * Enters a read-side critical section.  Returns NULL when every probed slot
+ * is busy, in which case the caller must use the locked path.
+ */
+static inline epoch_slot_t* epoch_enter(void) {
+    uint32_t hint = tl_epoch_hint;
+    if (unlikely(hint == UINT32_MAX)) {
+        hint = atomic_fetch_add_explicit(&g_epoch_next_hint, 1, memory_order_relaxed) & (CACHE_EPOCH_SLOTS - 1);
+        tl_epoch_hint = hint;
+    }
+
+    uint64_t announce = (atomic_load_explicit(&g_epoch, memory_order_relaxed) << 1) | 1u;
+    for (uint32_t i = 0; i < CACHE_EPOCH_PROBE; i++) {
+        uint32_t idx = (hint + i) & (CACHE_EPOCH_SLOTS - 1);
+        uint64_t idle = 0;
+        if (atomic_compare_exchange_strong_explicit(&g_epoch_slots[idx].state, &idle, announce, memory_order_seq_cst,
+                                                    memory_order_relaxed)) {
+            tl_epoch_hint = idx;
+            /* The announcement must be globally visible before any slot array is read. */
+            atomic_thread_fence(memory_order_seq_cst);
+            return &g_epoch_slots[idx];
+        }
+    }
+    return NULL;
+}
+
+/** Leaves a read-side critical section entered with epoch_enter(). */
+static inline void epoch_exit(epoch_slot_t* slot) {
+    atomic_store_explicit(&slot->state, 0, memory_order_release);
+}
+
+/* Slot pinned by this thread's cache_read_begin(), and how deeply it is nested. */
+static _Thread_local epoch_slot_t* tl_read_pin;
+static _Thread_local uint32_t tl_read_depth;
+
+/**
+ * Advances the global epoch and returns the oldest epoch still announced by
+ * an active reader (or the new epoch when none is active).  Anything retired
+ * with an older epoch is unreachable by every current and future reader.
+ */
+static uint64_t epoch_safe_bound(void) {
+    /* Order the caller's unlinking stores before the slot scan. */
+    atomic_thread_fence(memory_order_seq_cst);
+    uint64_t bound = atomic_fetch_add_explicit(&g_epoch, 1, memory_order_seq_cst) + 1;
+    for (size_t i = 0; i < CACHE_EPOCH_SLOTS; i++) {
+        uint64_t st = atomic_load_explicit(&g_epoch_slots[i].state, memory_order_acquire);
+        if ((st & 1u) && (st >> 1) < bound) bound = st >> 1;
+    }
+    return bound;
+}
+
+/* ---------------------------------------------------------------- statistics
+ *
+ * Counters that writers update under the shard write lock live in the
+ * shard.  Read-side counters (hits, misses, read-lock spins) live in
+ * per-thread slots instead, so cache_get() never writes a line that other
+ * threads write; a thread keeps one slot index for its lifetime and
+ * cache_stats() sums the slots on read.
+ */
+
+static _Atomic uint32_t g_stat_next_slot;
+static _Thread_local uint32_t tl_stat_slot = UINT32_MAX;
+
+/** The calling thread's counter slot. */
+static inline cache_stat_slot_t* stat_slot(const struct cache_s* cache) {
+    uint32_t idx = tl_stat_slot;
+    if (unlikely(idx == UINT32_MAX)) {
+        idx = atomic_fetch_add_explicit(&g_stat_next_slot, 1, memory_order_relaxed) & (CACHE_STAT_SLOTS - 1);
+        tl_stat_slot = idx;
+    }
+    return &cache->stats[idx];
+}
+
+/**
+ * Adds to a slot counter with a plain load and store rather than a locked
+ * read-modify-write.  Slots are private unless more than CACHE_STAT_SLOTS
+ * threads use the cache, in which case an occasional increment may be lost.
+ */
+static inline void stat_add(_Atomic uint64_t* counter, uint64_t n) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+/** Records one sampled access in the tracker; skips the sample rather than wait for the lock. */
+static void hot_key_record(hot_key_tracker_t* t, const char* key, size_t klen, uint32_t hash) {
+    if (!fast_rwlock_trywrlock(&t->lock)) return;
+
+    size_t stored = klen < CACHE_HOT_KEY_MAX - 1 ? klen : CACHE_HOT_KEY_MAX - 1;
+    hot_key_counter_t* min = NULL;
+    for (size_t i = 0; i < t->used; i++) {
+        hot_key_counter_t* c = &t->counters[i];
+        if (c->hash == hash && c->key_len == klen && memcmp(c->key, key, stored) == 0) {
+            c->count++;
+            fast_rwlock_unlock_wr(&t->lock);
+            return;
+        }
+        if (!min || c->count < min->count) min = c;
+    }
+
+    hot_key_counter_t* c;
+    uint64_t inherited = 0;
+    if (t->used < t->size) {
+        c = &t->counters[t->used++];
+    } else {
+        c = min;
+        inherited = min->count;
+    }
+    c->hash = hash;
+    c->key_len = (uint32_t)klen;
+    c->count = inherited + 1;
+    memcpy(c->key, key, stored);
+    c->key[stored] = '\0';
+    fast_rwlock_unlock_wr(&t->lock);
+}
+
+/** Feeds one get in every `sample` from this thread's slot to the hot-key tracker. */
+static inline void hot_key_sample(const struct cache_s* cache, cache_stat_slot_t* st, const char* key, size_t klen,
+                                  uint32_t hash) {
+    hot_key_tracker_t* t = cache->hot_keys;
+    if (likely(!t)) return;
+
+    uint32_t tick = atomic_load_explicit(&st->sample_tick, memory_order_relaxed) + 1;
+    if (likely(tick < t->sample)) {
+        atomic_store_explicit(&st->sample_tick, tick, memory_order_relaxed);
+        return;
+    }
+    atomic_store_explicit(&st->sample_tick, 0, memory_order_relaxed);
+    hot_key_record(t, key, klen, hash);
+}
+
 /* ---------------------------------------------------------------- utility functions */
 
 /**
@@ -220,16 +725,49 @@ static inline size_t next_power_of_2(size_t n) {
 }
 
 /**
- * FNV-1a hash for string keys.
+ * Returns the random per-process seed, drawing it on first use.  The OS
+ * entropy source is preferred; the fallback mixes the clock with stack and
+ * image addresses, which is still unpredictable enough under ASLR to stop
+ * precomputed collision sets.
  */
-static inline uint32_t hash_key(const char* key, size_t len) {
-    uint32_t hash = 2166136261u; /* FNV offset basis */
-    const unsigned char* p = (const unsigned char*)key;
-    const unsigned char* end = p + len;
-    while (p < end) {
-        hash ^= *p++;
-        hash *= 16777619u; /* FNV prime */
+static uint64_t process_hash_seed(void) {
+    static _Atomic uint64_t seed_cache = 0;
+    uint64_t seed = atomic_load_explicit(&seed_cache, memory_order_acquire);
+    if (likely(seed != 0)) return seed;
+
+    bool have_entropy = false;
+#if defined(__linux__) && defined(SYS_getrandom)
+    have_entropy = syscall(SYS_getrandom, &seed, sizeof(seed), 0) == (long)sizeof(seed);
+#elif !defined(_WIN32)
+    FILE* f = fopen("/dev/urandom", "rb");
+    if (f) {
+        have_entropy = fread(&seed, sizeof(seed), 1, f) == 1;
+        fclose(f);
+    }
+#endif
+    if (!have_entropy) {
+        uint64_t mix[3] = {get_time_ns(), (uint64_t)(uintptr_t)&seed, (uint64_t)(uintptr_t)&process_hash_seed};
+        seed = XXH3_64bits(mix, sizeof(mix));
     }
+    if (seed == 0) seed = 0x9E3779B97F4A7C15ull;
+
+    /* First writer wins so every cache in the process agrees. */
+    uint64_t expected = 0;
+    if (!atomic_compare_exchange_strong_explicit(&seed_cache, &expected, seed, memory_order_acq_rel,
+                                                 memory_order_acquire)) {
+        seed = expected;
+    }
+    return seed;
+}
+
+/**
+ * Hashes a key with the cache's seeded hash and folds it to 32 bits.
+ * The built-in XXH3 path is inlined; a custom hash costs one indirect call.
+ */
+static inline uint32_t hash_key(const struct cache_s* cache, const char* key, size_t len) {
+    uint64_t h = likely(cache->hash_fn == NULL) ? XXH3_64bits_withSeed(key, len, cache->hash_seed)
+                                                : cache->hash_fn(key, len, cache->hash_seed);
+    uint32_t hash = (uint32_t)(h ^ (h >> 32));
     /* Reserve 0 and 1 as historical control values */
     if (unlikely(hash < 2u)) return hash + 2u;
     return hash;
@@ -238,9 +776,9 @@ static inline uint32_t hash_key(const char* key, size_t len) {
 /**
  * Mixes high bits of the hash into low bits to flatten shard distribution.
  */
-static inline size_t get_shard_idx(uint32_t hash) {
+static inline size_t get_shard_idx(uint32_t hash, size_t shard_count) {
     hash ^= hash >> 16;
-    return hash & (CACHE_SHARD_COUNT - 1);
+    return hash & (shard_count - 1);
 }
 
 /**
@@ -273,13 +811,146 @@ static inline void entry_ref_inc(cache_entry_t* entry) {
     if (entry) atomic_fetch_add_explicit(&entry->ref_count, 1, memory_order_relaxed);
 }
 
+/**
+ * Returns an entry's memory to its slab, or to malloc.
+ */
+static inline void entry_free(cache_entry_t* entry) {
+    if (!entry) return;
+    if (entry->slab) {
+        slab_free(entry->slab, entry, entry->size_class);
+    } else {
+        free(entry);
+    }
+}
+
+/**
+ * Bytes an entry is charged against the shard's byte budget: the slab block
+ * size when slab-allocated, else the requested allocation size.
+ */
+static inline size_t entry_charge(const cache_entry_t* entry) {
+    if (entry->size_class != CACHE_SLAB_LARGE) return slab_class_size(entry->size_class);
+    return offsetof(cache_entry_t, data) + entry->key_len + 1 + sizeof(void*) + entry->value_len;
+}
+
 /**
  * Decrements the entry reference count and frees the entry if it reaches zero.
  */
 static inline void entry_ref_dec(cache_entry_t* entry) {
     if (!entry) return;
     int prev = atomic_fetch_sub_explicit(&entry->ref_count, 1, memory_order_acq_rel);
-    if (unlikely(prev == 1)) free(entry);
+    if (unlikely(prev == 1)) entry_free(entry);
+}
+
+/* ---------------------------------------------------------------- shard write side */
+
+/**
+ * Acquires the shard write lock and opens a seqlock write section.
+ */
+static inline void shard_write_lock(aligned_cache_shard_t* shard) {
+    uint64_t spins = 0;
+    while (!fast_rwlock_trywrlock(&shard->lock)) {
+        spins++;
+        cpu_relax();
+    }
+    shard->stat_write_spins += spins;
+    uint32_t seq = atomic_load_explicit(&shard->seq, memory_order_relaxed);
+    atomic_store_explicit(&shard->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/**
+ * Closes the seqlock write section and releases the shard write lock.
+ */
+static inline void shard_write_unlock(aligned_cache_shard_t* shard) {
+    uint32_t seq = atomic_load_explicit(&shard->seq, memory_order_relaxed);
+    atomic_store_explicit(&shard->seq, seq + 1, memory_order_release);
+    fast_rwlock_unlock_wr(&shard->lock);
+}
+
+/**
+ * Acquires the shard read lock, counting failed attempts in the caller's
+ * stat slot rather than in the shard.
+ */
+static inline void shard_read_lock(aligned_cache_shard_t* shard, cache_stat_slot_t* st) {
+    if (likely(fast_rwlock_tryrdlock(&shard->lock))) return;
+    uint64_t spins = 0;
+    do {
+        spins++;
+        cpu_relax();
+    } while (!fast_rwlock_tryrdlock(&shard->lock));
+    stat_add(&st->read_spins, spins);
+}
+
+/**
+ * Drops every retired entry and slot array that no optimistic reader can
+ * still reach.  Caller holds the write lock.
+ */
+static void shard_reclaim_locked(aligned_cache_shard_t* shard) {
+    uint64_t bound = epoch_safe_bound();
+
+    cache_entry_t** link = &shard->retired;
+    while (*link) {
+        cache_entry_t* entry = *link;
+        if (entry->retire_epoch < bound) {
+            *link = entry->retire_next;
+            shard->retired_count--;
+            entry_ref_dec(entry);
+        } else {
+            link = &entry->retire_next;
+        }
+    }
+
+    retired_table_t** tlink = &shard->retired_tables;
+    while (*tlink) {
+        retired_table_t* t = *tlink;
+        if (t->retire_epoch < bound) {
+            *tlink = t->next;
+            free(t->tags);
+            free(t->entries);
+            free(t);
+        } else {
+            tlink = &t->next;
+        }
+    }
+}
+
+/**
+ * Releases the cache's reference to an entry that was just unlinked.
+ * In optimistic mode the release is deferred past a grace period so a
+ * concurrent reader can still safely take its own reference.
+ * Caller holds the write lock.
+ */
+static inline void shard_drop_entry(aligned_cache_shard_t* shard, cache_entry_t* entry) {
+    shard->bytes -= entry_charge(entry);
+    if (likely(!shard->deferred_reclaim)) {
+        entry_ref_dec(entry);
+        return;
+    }
+    entry->retire_epoch = atomic_load_explicit(&g_epoch, memory_order_seq_cst);
+    entry->retire_next = shard->retired;
+    shard->retired = entry;
+    if (unlikely(++shard->retired_count >= CACHE_RETIRE_BATCH)) shard_reclaim_locked(shard);
+}
+
+/**
+ * Frees slot arrays that a rehash replaced, deferring in optimistic mode.
+ * The retire node was reserved when the rehash started, so deferral cannot
+ * fail here.  Caller holds the write lock.
+ */
+static void shard_drop_table(aligned_cache_shard_t* shard, uint8_t* tags, cache_entry_t** entries) {
+    retired_table_t* t = shard->old_retire;
+    shard->old_retire = NULL;
+    if (shard->deferred_reclaim) {
+        t->tags = tags;
+        t->entries = entries;
+        t->retire_epoch = atomic_load_explicit(&g_epoch, memory_order_seq_cst);
+        t->next = shard->retired_tables;
+        shard->retired_tables = t;
+        return;
+    }
+    free(t);
+    free(tags);
+    free(entries);
 }
 
 /**
@@ -315,123 +986,537 @@ static inline bool keys_equal(const void* k1, const void* k2, size_t len) {
     return memcmp(k1, k2, len) == 0;
 }
 
-/* ---------------------------------------------------------------- find_slot (optimised) */
+/* ---------------------------------------------------------------- NUMA placement
+ *
+ * Slot arrays of a shard can be given a preferred NUMA node.  On Linux the
+ * preference is applied with mbind(MPOL_PREFERRED) before the arrays are
+ * first touched, so it holds for arrays rebuilt later by any thread, not
+ * only for the initial allocation.  Elsewhere placement is a no-op.
+ */
+
+#if defined(__linux__) && defined(SYS_mbind)
+#define CACHE_MPOL_PREFERRED 1 /* from <linux/mempolicy.h>; avoids a libnuma dependency */
 
 /**
- * Locates a slot in the hash table using the compact tag array.
+ * Parses /sys/devices/system/node/online (e.g. "0-1,3") into node ids.
+ * Returns the number of ids written, 0 when NUMA topology is unavailable.
  */
-static size_t find_slot(aligned_cache_shard_t* shard, uint32_t hash, const char* key, size_t klen, uint8_t target_tag,
-                        bool* found) {
-    size_t mask = shard->bucket_count - 1;
-    size_t idx = hash & mask; /* initial probe position */
+static size_t numa_online_nodes(int* nodes, size_t max_nodes) {
+    FILE* f = fopen("/sys/devices/system/node/online", "r");
+    if (!f) return 0;
+
+    char buf[256];
+    size_t n = 0;
+    if (fgets(buf, sizeof(buf), f)) {
+        char* p = buf;
+        while (*p && *p != '\n' && n < max_nodes) {
+            char* end;
+            long lo = strtol(p, &end, 10);
+            if (end == p) break;
+            long hi = lo;
+            if (*end == '-') {
+                p = end + 1;
+                hi = strtol(p, &end, 10);
+            }
+            for (long id = lo; id <= hi && n < max_nodes; id++) {
+                if (id < CACHE_MAX_NUMA_NODES) nodes[n++] = (int)id;
+            }
+            p = (*end == ',') ? end + 1 : end;
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+/** Best-effort preferred-node policy for [addr, addr + len); addr is page-aligned. */
+static void numa_prefer_node(void* addr, size_t len, int node) {
+    unsigned long mask = 1UL << node;
+    (void)syscall(SYS_mbind, addr, len, CACHE_MPOL_PREFERRED, &mask, (unsigned long)CACHE_MAX_NUMA_NODES + 1, 0);
+}
+#else
+static size_t numa_online_nodes(int* nodes, size_t max_nodes) {
+    (void)nodes;
+    (void)max_nodes;
+    return 0;
+}
+#endif
+
+/**
+ * Allocates one slot array for a shard.  Arrays with a NUMA preference are
+ * page-aligned and page-rounded so the policy never spills onto memory
+ * shared with unrelated allocations.
+ */
+static void* shard_array_alloc(const aligned_cache_shard_t* shard, size_t bytes) {
+    void* p;
+#if defined(__linux__) && defined(SYS_mbind)
+    if (shard->numa_node >= 0) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t rounded = (bytes + page - 1) & ~(page - 1);
+        p = ALIGNED_ALLOC(page, rounded);
+        if (p) numa_prefer_node(p, rounded, shard->numa_node);
+        return p;
+    }
+#else
+    (void)shard;
+#endif
+    p = ALIGNED_ALLOC(CACHE_LINE_SIZE, bytes);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (p) madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    return p;
+}
+
+/**
+ * Allocates and initialises (EMPTY) a tag/entry array pair of n slots.
+ * The memset is the first touch, which places the pages per the policy.
+ */
+static bool shard_alloc_table(const aligned_cache_shard_t* shard, size_t n, uint8_t** out_tags,
+                              cache_entry_t*** out_entries) {
+    uint8_t* tags = shard_array_alloc(shard, n * sizeof(uint8_t));
+    if (!tags) return false;
+
+    cache_entry_t** entries = shard_array_alloc(shard, n * sizeof(cache_entry_t*));
+    if (!entries) {
+        free(tags);
+        return false;
+    }
+
+    memset(tags, TAG_EMPTY, n * sizeof(uint8_t));
+    memset(entries, 0, n * sizeof(cache_entry_t*));
+    *out_tags = tags;
+    *out_entries = entries;
+    return true;
+}
+
+/* ---------------------------------------------------------------- group tag probing
+ *
+ * Swiss-table style probing: one vector load covers a whole aligned group of
+ * tags and yields three lane masks (fragment match, EMPTY, DELETED), so a
+ * probe only touches entries[] for lanes whose fragment matches.  The probe
+ * order is exactly that of the scalar linear probe: the home group from the
+ * home slot onwards, then whole groups, then the home group's leading lanes
+ * after wrapping.  Both paths therefore agree on every slot they return.
+ *
+ * SSE2 and NEON scan 16 tags per step, AVX2 32.  Shards smaller than one
+ * group, targets without a vector unit, and builds with CACHE_SCALAR_PROBE
+ * defined use the byte-at-a-time loop.
+ */
+#if !defined(CACHE_SCALAR_PROBE) && defined(__AVX2__)
+#include <immintrin.h>
+#define TAG_GROUP_WIDTH      32u
+#define TAG_GROUP_LANE_SHIFT 0u
+typedef uint32_t group_mask_t;
+#define TAG_GROUP_ALL 0xFFFFFFFFu
+
+static inline void group_scan(const uint8_t* g, uint8_t target, group_mask_t* match, group_mask_t* empty,
+                              group_mask_t* deleted) {
+    __m256i v = _mm256_load_si256((const __m256i*)(const void*)g);
+    *match = (group_mask_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)target)));
+    *empty = (group_mask_t)_mm256_movemask_epi8(v); /* TAG_EMPTY is the sign bit */
+    *deleted = (group_mask_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)TAG_DELETED)));
+}
+#elif !defined(CACHE_SCALAR_PROBE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define TAG_GROUP_WIDTH      16u
+#define TAG_GROUP_LANE_SHIFT 0u
+typedef uint32_t group_mask_t;
+#define TAG_GROUP_ALL 0xFFFFu
+
+static inline void group_scan(const uint8_t* g, uint8_t target, group_mask_t* match, group_mask_t* empty,
+                              group_mask_t* deleted) {
+    __m128i v = _mm_load_si128((const __m128i*)(const void*)g);
+    *match = (group_mask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8((char)target)));
+    *empty = (group_mask_t)_mm_movemask_epi8(v); /* TAG_EMPTY is the sign bit */
+    *deleted = (group_mask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8((char)TAG_DELETED)));
+}
+#elif !defined(CACHE_SCALAR_PROBE) && (defined(__aarch64__) || defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define TAG_GROUP_WIDTH      16u
+#define TAG_GROUP_LANE_SHIFT 2u /* NEON has no movemask: 4 mask bits per lane */
+typedef uint64_t group_mask_t;
+#define TAG_GROUP_ALL 0x8888888888888888ull
+
+/** Narrows a 0x00/0xFF byte-lane comparison into one bit per nibble lane. */
+static inline group_mask_t neon_lane_mask(uint8x16_t cmp) {
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & TAG_GROUP_ALL;
+}
+
+static inline void group_scan(const uint8_t* g, uint8_t target, group_mask_t* match, group_mask_t* empty,
+                              group_mask_t* deleted) {
+    uint8x16_t v = vld1q_u8(g);
+    *match = neon_lane_mask(vceqq_u8(v, vdupq_n_u8(target)));
+    *empty = neon_lane_mask(vtstq_u8(v, vdupq_n_u8(TAG_EMPTY)));
+    *deleted = neon_lane_mask(vceqq_u8(v, vdupq_n_u8(TAG_DELETED)));
+}
+#endif
+
+#ifdef TAG_GROUP_WIDTH
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+/** Index of the lowest lane set in a non-zero mask. */
+static inline size_t group_lowest_lane(group_mask_t m) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long bit;
+    _BitScanForward64(&bit, (unsigned long long)m);
+    return (size_t)bit >> TAG_GROUP_LANE_SHIFT;
+#else
+    return (size_t)__builtin_ctzll((unsigned long long)m) >> TAG_GROUP_LANE_SHIFT;
+#endif
+}
+
+/** Lanes at or above lane `from`. */
+static inline group_mask_t group_lanes_from(size_t from) {
+    return (group_mask_t)(TAG_GROUP_ALL & ((group_mask_t)TAG_GROUP_ALL << (from << TAG_GROUP_LANE_SHIFT)));
+}
+
+/**
+ * Group-probing equivalent of the scalar find_slot() loop.
+ * Requires bucket_count >= TAG_GROUP_WIDTH (tag arrays are cache-line aligned,
+ * so every group load is aligned).
+ */
+static size_t find_slot_group(const slot_table_t* t, uint32_t hash, const char* key, size_t klen, uint8_t target_tag,
+                              bool* found) {
+    size_t mask = t->bucket_count - 1;
+    size_t home = hash & mask;
+    size_t group = home & ~(size_t)(TAG_GROUP_WIDTH - 1);
+    size_t offset = home - group;
+    size_t groups = t->bucket_count / TAG_GROUP_WIDTH;
+    const uint8_t* tags = t->tags;
+    cache_entry_t** entries = t->entries;
+    uint64_t target_meta = ((uint64_t)klen << 32) | hash;
     size_t first_tombstone = SIZE_MAX;
-    uint8_t* tags = shard->tags;
-    cache_entry_t** entries = shard->entries;
 
     *found = false;
 
     PROBE_INIT(probes);
 
-    for (size_t probe_count = 0; probe_count < shard->bucket_count; probe_count++) {
-        uint8_t tag = tags[idx];
+    for (size_t n = 0; n <= groups; n++) {
+        group_mask_t match, empty, deleted;
+        group_scan(tags + group, target_tag, &match, &empty, &deleted);
         PROBE_INC(probes);
 
-        /*
-         * Since target_tag is built by masking with 0x3F, it can never have bits 6 or 7 set.
-         * Therefore, any tag exactly matching target_tag is guaranteed to be a live entry.
-         */
-        if (likely(tag == target_tag)) {
-            cache_entry_t* entry = entries[idx];
+        group_mask_t valid = TAG_GROUP_ALL;
+        if (n == 0) {
+            valid = group_lanes_from(offset);
+        } else if (n == groups) {
+            valid = (group_mask_t)(TAG_GROUP_ALL & ~group_lanes_from(offset)); /* wrapped to the home group */
+        }
+        empty &= valid;
+
+        /* Only lanes before the first EMPTY are part of the probe chain. */
+        group_mask_t chain = empty ? (group_mask_t)((empty & (group_mask_t)(0 - empty)) - 1) : TAG_GROUP_ALL;
+        chain &= valid;
+        match &= chain;
+
+        while (match) {
+            size_t slot = group + group_lowest_lane(match);
+            cache_entry_t* entry = entries[slot];
 
             /* Pack hash:32 and key_len:32 into a single 64-bit load/comparison */
             uint64_t entry_meta;
             memcpy(&entry_meta, &entry->hash, 8);
-            uint64_t target_meta = ((uint64_t)klen << 32) | hash;
-
             if (likely(entry_meta == target_meta) && keys_equal(entry->data, key, klen)) {
                 *found = true;
                 PROBE_RECORD(probes);
-                return idx;
+                return slot;
             }
-        } else if (tag & TAG_EMPTY) {
-            /* Empty slot terminates the probe chain */
-            PROBE_RECORD(probes);
-            return (first_tombstone != SIZE_MAX) ? first_tombstone : idx;
-        } else if (tag & TAG_DELETED) {
-            /* Tombstone: keep probing, record for potential reuse. */
-            if (first_tombstone == SIZE_MAX) first_tombstone = idx;
+            match &= match - 1;
         }
 
-        idx = (idx + 1) & mask; /* advance: linear probing with power-of-2 wrap */
+        deleted &= chain;
+        if (first_tombstone == SIZE_MAX && deleted) first_tombstone = group + group_lowest_lane(deleted);
+
+        if (empty) {
+            PROBE_RECORD(probes);
+            return (first_tombstone != SIZE_MAX) ? first_tombstone : group + group_lowest_lane(empty);
+        }
+        group = (group + TAG_GROUP_WIDTH) & mask;
     }
 
     /* Table fully probed (should not happen under normal operation). */
     PROBE_RECORD(probes);
-    return (first_tombstone != SIZE_MAX) ? first_tombstone : idx;
+    return (first_tombstone != SIZE_MAX) ? first_tombstone : home;
 }
 
-/* ---------------------------------------------------------------- compact_shard */
-
 /**
- * Re-hashes all live entries into a fresh pair of tag/entry arrays to
- * eliminate tombstones and restore probe-chain integrity.
+ * Lock-free variant for optimistic readers.  Tags may change under the
+ * probe; the caller's seqlock validation discards any inconsistent result.
  */
-static void compact_shard(aligned_cache_shard_t* shard) {
-    size_t n = shard->bucket_count;
-
-    uint8_t* new_tags = ALIGNED_ALLOC(CACHE_LINE_SIZE, n * sizeof(uint8_t));
-    if (!new_tags) return;
-
-    cache_entry_t** new_entries = ALIGNED_ALLOC(CACHE_LINE_SIZE, n * sizeof(cache_entry_t*));
-    if (!new_entries) {
-        free(new_tags);
-        return;
+static cache_entry_t* find_entry_group_optimistic(const slot_table_t* t, uint32_t hash, const char* key, size_t klen,
+                                                  uint8_t target_tag) {
+    size_t mask = t->bucket_count - 1;
+    size_t home = hash & mask;
+    size_t group = home & ~(size_t)(TAG_GROUP_WIDTH - 1);
+    size_t offset = home - group;
+    size_t groups = t->bucket_count / TAG_GROUP_WIDTH;
+    const uint8_t* tags = t->tags;
+    cache_entry_t* const* entries = t->entries;
+    uint64_t target_meta = ((uint64_t)klen << 32) | hash;
+
+    for (size_t n = 0; n <= groups; n++) {
+        group_mask_t match, empty, deleted;
+        group_scan(tags + group, target_tag, &match, &empty, &deleted);
+        (void)deleted;
+
+        group_mask_t valid = TAG_GROUP_ALL;
+        if (n == 0) {
+            valid = group_lanes_from(offset);
+        } else if (n == groups) {
+            valid = (group_mask_t)(TAG_GROUP_ALL & ~group_lanes_from(offset));
+        }
+        empty &= valid;
+        group_mask_t chain = empty ? (group_mask_t)((empty & (group_mask_t)(0 - empty)) - 1) : TAG_GROUP_ALL;
+        match &= chain & valid;
+
+        while (match) {
+            cache_entry_t* entry = entries[group + group_lowest_lane(match)];
+            if (likely(entry != NULL)) {
+                uint64_t entry_meta;
+                memcpy(&entry_meta, &entry->hash, 8);
+                if (likely(entry_meta == target_meta) && keys_equal(entry->data, key, klen)) return entry;
+            }
+            match &= match - 1;
+        }
+        if (empty) return NULL;
+        group = (group + TAG_GROUP_WIDTH) & mask;
     }
+    return NULL;
+}
+#endif /* TAG_GROUP_WIDTH */
 
-#if defined(__linux__) && defined(MADV_HUGEPAGE)
-    madvise(new_tags, n * sizeof(uint8_t), MADV_HUGEPAGE);
-    madvise(new_entries, n * sizeof(cache_entry_t*), MADV_HUGEPAGE);
+/* ---------------------------------------------------------------- find_slot (optimised) */
+
+/** View of the shard's live (insert-target) table. */
+static inline slot_table_t shard_table(const aligned_cache_shard_t* shard) {
+    slot_table_t t = {shard->tags, shard->entries, shard->bucket_count};
+    return t;
+}
+
+/** View of the table a rehash is draining; tags is NULL when none is. */
+static inline slot_table_t shard_old_table(const aligned_cache_shard_t* shard) {
+    slot_table_t t = {shard->old_tags, shard->old_entries, shard->old_bucket_count};
+    return t;
+}
+
+/**
+ * Locates a slot in one table using the compact tag array.
+ */
+static size_t find_slot_in(const slot_table_t* t, uint32_t hash, const char* key, size_t klen, uint8_t target_tag,
+                           bool* found) {
+#ifdef TAG_GROUP_WIDTH
+    if (likely(t->bucket_count >= TAG_GROUP_WIDTH)) return find_slot_group(t, hash, key, klen, target_tag, found);
 #endif
+    size_t mask = t->bucket_count - 1;
+    size_t idx = hash & mask; /* initial probe position */
+    size_t first_tombstone = SIZE_MAX;
+    uint8_t* tags = t->tags;
+    cache_entry_t** entries = t->entries;
 
-    /* Initialize all slots to EMPTY. */
-    memset(new_tags, TAG_EMPTY, n * sizeof(uint8_t));
-    memset(new_entries, 0, n * sizeof(cache_entry_t*));
+    *found = false;
 
-    size_t mask = n - 1;
-    uint8_t* old_tags = shard->tags;
-    cache_entry_t** old_entries = shard->entries;
+    PROBE_INIT(probes);
 
-    for (size_t i = 0; i < n; i++) {
-        uint8_t tag = old_tags[i];
-        if (tag & TAG_CONTROL_MASK) continue;
+    for (size_t probe_count = 0; probe_count < t->bucket_count; probe_count++) {
+        uint8_t tag = tags[idx];
+        PROBE_INC(probes);
+
+        /*
+         * Since target_tag is built by masking with 0x3F, it can never have bits 6 or 7 set.
+         * Therefore, any tag exactly matching target_tag is guaranteed to be a live entry.
+         */
+        if (likely(tag == target_tag)) {
+            cache_entry_t* entry = entries[idx];
 
-        cache_entry_t* entry = old_entries[i];
-        uint32_t h = entry->hash;
-        uint8_t ntag = make_tag(h);
-        size_t idx = h & mask;
+            /* Pack hash:32 and key_len:32 into a single 64-bit load/comparison */
+            uint64_t entry_meta;
+            memcpy(&entry_meta, &entry->hash, 8);
+            uint64_t target_meta = ((uint64_t)klen << 32) | hash;
 
-        while (!(new_tags[idx] & TAG_EMPTY)) {
-            idx = (idx + 1) & mask;
+            if (likely(entry_meta == target_meta) && keys_equal(entry->data, key, klen)) {
+                *found = true;
+                PROBE_RECORD(probes);
+                return idx;
+            }
+        } else if (tag & TAG_EMPTY) {
+            /* Empty slot terminates the probe chain */
+            PROBE_RECORD(probes);
+            return (first_tombstone != SIZE_MAX) ? first_tombstone : idx;
+        } else if (tag & TAG_DELETED) {
+            /* Tombstone: keep probing, record for potential reuse. */
+            if (first_tombstone == SIZE_MAX) first_tombstone = idx;
         }
-        new_tags[idx] = ntag;
-        new_entries[idx] = entry;
+
+        idx = (idx + 1) & mask; /* advance: linear probing with power-of-2 wrap */
     }
 
-    shard->tags = new_tags;
-    shard->entries = new_entries;
-    shard->tombstone_count = 0;
-    shard->clock_hand = 0;
+    /* Table fully probed (should not happen under normal operation). */
+    PROBE_RECORD(probes);
+    return (first_tombstone != SIZE_MAX) ? first_tombstone : idx;
+}
+
+/**
+ * Locates a slot in the shard's live table: the key's slot when found,
+ * otherwise its insert position.
+ */
+static inline size_t find_slot(const aligned_cache_shard_t* shard, uint32_t hash, const char* key, size_t klen,
+                               uint8_t target_tag, bool* found) {
+    slot_table_t t = shard_table(shard);
+    return find_slot_in(&t, hash, key, klen, target_tag, found);
+}
+
+/**
+ * Lock-free variant of find_slot() for optimistic readers.
+ *
+ * The slot arrays may be mutated concurrently, so a live tag can be paired
+ * with a not-yet-published (NULL) entry pointer; such slots are skipped and
+ * the caller's seqlock validation discards any inconsistent result.
+ * Returns the matching entry or NULL.
+ */
+static cache_entry_t* find_entry_optimistic(const slot_table_t* t, uint32_t hash, const char* key, size_t klen,
+                                            uint8_t target_tag) {
+#ifdef TAG_GROUP_WIDTH
+    if (likely(t->bucket_count >= TAG_GROUP_WIDTH)) return find_entry_group_optimistic(t, hash, key, klen, target_tag);
+#endif
+    size_t bucket_count = t->bucket_count;
+    size_t mask = bucket_count - 1;
+    size_t idx = hash & mask;
+    const uint8_t* tags = t->tags;
+    cache_entry_t* const* entries = t->entries;
+    uint64_t target_meta = ((uint64_t)klen << 32) | hash;
+
+    for (size_t probe_count = 0; probe_count < bucket_count; probe_count++) {
+        uint8_t tag = tags[idx];
+        if (likely(tag == target_tag)) {
+            cache_entry_t* entry = entries[idx];
+            if (likely(entry != NULL)) {
+                uint64_t entry_meta;
+                memcpy(&entry_meta, &entry->hash, 8);
+                if (likely(entry_meta == target_meta) && keys_equal(entry->data, key, klen)) return entry;
+            }
+        } else if (tag & TAG_EMPTY) {
+            return NULL;
+        }
+        idx = (idx + 1) & mask;
+    }
+    return NULL;
+}
+
+/* ---------------------------------------------------------------- TinyLFU frequency sketch
+ *
+ * A count-min sketch of recent access frequency per shard.  Counters are
+ * bytes saturating at CACHE_SKETCH_MAX_COUNT; once the number of recorded
+ * accesses reaches the sample size every counter is halved, so the sketch
+ * follows shifts in popularity instead of accumulating forever.
+ *
+ * Inserts record every access; gets record one access in
+ * CACHE_SKETCH_READ_SAMPLE per stats slot, so readers of a hot shard do not
+ * all store to the same counters and `additions` on every hit.  Recording
+ * uses relaxed atomics: concurrent increments of one counter may be lost,
+ * which is accepted because the sketch only has to rank keys.  Once the
+ * sample is full, reads stop recording until the sketch is aged, which
+ * happens under the write lock on the next insert or cache_tick() pass.
+ */
+typedef struct cache_sketch_s {
+    size_t mask;                 /**< Counter count - 1; power-of-2 width. */
+    uint32_t sample_size;        /**< Recorded accesses between agings. */
+    _Atomic uint32_t additions;  /**< Accesses recorded since the last aging. */
+    _Atomic uint8_t counters[];  /**< One shared row indexed by DEPTH hashes. */
+} cache_sketch_t;
+
+static cache_sketch_t* sketch_create(size_t shard_cap) {
+    size_t width = next_power_of_2(shard_cap * CACHE_SKETCH_WIDTH_MULT);
+    if (width < 64) width = 64;
+    cache_sketch_t* sk = calloc(1, sizeof(cache_sketch_t) + width);
+    if (!sk) return NULL;
+    sk->mask = width - 1;
+    size_t sample = shard_cap * CACHE_SKETCH_SAMPLE_MULT;
+    sk->sample_size = sample > UINT32_MAX / 2 ? UINT32_MAX / 2 : (uint32_t)(sample < 64 ? 64 : sample);
+    return sk;
+}
+
+/**
+ * Derives the DEPTH counter indices from the key hash by double hashing.
+ * The hash is remixed first because the shard index already fixes some of
+ * its low bits for every key in this shard.
+ */
+static inline void sketch_indices(const cache_sketch_t* sk, uint32_t hash, size_t idx[CACHE_SKETCH_DEPTH]) {
+    uint64_t h = (uint64_t)hash * 0x9E3779B97F4A7C15ull;
+    uint32_t a = (uint32_t)(h >> 32);
+    uint32_t b = (uint32_t)h | 1u;
+    for (int i = 0; i < CACHE_SKETCH_DEPTH; i++) idx[i] = (a + (uint32_t)i * b) & sk->mask;
+}
+
+/** Estimated access frequency of the key with this hash. */
+static inline uint8_t sketch_estimate(const cache_sketch_t* sk, uint32_t hash) {
+    size_t idx[CACHE_SKETCH_DEPTH];
+    sketch_indices(sk, hash, idx);
+    uint8_t min = CACHE_SKETCH_MAX_COUNT;
+    for (int i = 0; i < CACHE_SKETCH_DEPTH; i++) {
+        uint8_t c = atomic_load_explicit(&((cache_sketch_t*)sk)->counters[idx[i]], memory_order_relaxed);
+        if (c < min) min = c;
+    }
+    return min;
+}
+
+/**
+ * Records one access.  Conservative update: only the counters equal to the
+ * current minimum are bumped, which limits over-estimation from collisions.
+ */
+static inline void sketch_record(cache_sketch_t* sk, uint32_t hash) {
+    size_t idx[CACHE_SKETCH_DEPTH];
+    sketch_indices(sk, hash, idx);
+    uint8_t vals[CACHE_SKETCH_DEPTH];
+    uint8_t min = CACHE_SKETCH_MAX_COUNT;
+    for (int i = 0; i < CACHE_SKETCH_DEPTH; i++) {
+        vals[i] = atomic_load_explicit(&sk->counters[idx[i]], memory_order_relaxed);
+        if (vals[i] < min) min = vals[i];
+    }
+    if (min == CACHE_SKETCH_MAX_COUNT) return;
+    for (int i = 0; i < CACHE_SKETCH_DEPTH; i++) {
+        if (vals[i] == min) atomic_store_explicit(&sk->counters[idx[i]], (uint8_t)(min + 1), memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&sk->additions, 1, memory_order_relaxed);
+}
 
-    free(old_tags);
-    free(old_entries);
+/** True once enough accesses are recorded that the sketch is due for aging. */
+static inline bool sketch_full(const cache_sketch_t* sk) {
+    return atomic_load_explicit(&((cache_sketch_t*)sk)->additions, memory_order_relaxed) >= sk->sample_size;
+}
+
+/** Records one get in every CACHE_SKETCH_READ_SAMPLE from this thread's slot. */
+static inline void sketch_sample(cache_sketch_t* sk, cache_stat_slot_t* st, uint32_t hash) {
+    if (likely(!sk)) return;
+
+    uint32_t tick = atomic_load_explicit(&st->sketch_tick, memory_order_relaxed) + 1;
+    if (likely(tick < CACHE_SKETCH_READ_SAMPLE)) {
+        atomic_store_explicit(&st->sketch_tick, tick, memory_order_relaxed);
+        return;
+    }
+    atomic_store_explicit(&st->sketch_tick, 0, memory_order_relaxed);
+    if (!sketch_full(sk)) sketch_record(sk, hash);
+}
+
+/** Halves every counter once the sample is full.  Caller holds the write lock. */
+static void sketch_age_locked(cache_sketch_t* sk) {
+    if (!sketch_full(sk)) return;
+    for (size_t i = 0; i <= sk->mask; i++) {
+        uint8_t c = atomic_load_explicit(&sk->counters[i], memory_order_relaxed);
+        atomic_store_explicit(&sk->counters[i], (uint8_t)(c >> 1), memory_order_relaxed);
+    }
+    atomic_store_explicit(&sk->additions, sk->sample_size / 2, memory_order_relaxed);
 }
 
 /* ---------------------------------------------------------------- clock_evict */
 
 /**
- * Evicts one entry using the CLOCK algorithm (approximate LRU).
+ * Advances the CLOCK hand to the next eviction victim (approximate LRU),
+ * clearing reference bits on the way.  The victim stays linked.
+ * Returns its slot index, or SIZE_MAX when the shard is empty.
  */
-static bool clock_evict(aligned_cache_shard_t* shard) {
+static size_t clock_victim(aligned_cache_shard_t* shard) {
     size_t scanned = 0;
     size_t mask = shard->bucket_count - 1;
     uint8_t* tags = shard->tags;
@@ -449,15 +1534,7 @@ static bool clock_evict(aligned_cache_shard_t* shard) {
 
         cache_entry_t* entry = entries[idx];
         uint8_t bit = atomic_load_explicit(&entry->clock_bit, memory_order_relaxed);
-
-        if (bit == 0) {
-            tags[idx] = TAG_DELETED;
-            entries[idx] = NULL;
-            shard->size--;
-            shard->tombstone_count++;
-            entry_ref_dec(entry);
-            return true;
-        }
+        if (bit == 0) return idx;
 
         atomic_store_explicit(&entry->clock_bit, 0, memory_order_relaxed);
         scanned++;
@@ -466,68 +1543,757 @@ static bool clock_evict(aligned_cache_shard_t* shard) {
     for (size_t i = 0; i < shard->bucket_count; i++) {
         size_t idx = shard->clock_hand;
         shard->clock_hand = (shard->clock_hand + 1) & mask;
-        if (!(tags[idx] & TAG_CONTROL_MASK)) {
-            cache_entry_t* entry = entries[idx];
-            tags[idx] = TAG_DELETED;
-            entries[idx] = NULL;
-            shard->size--;
-            shard->tombstone_count++;
-            entry_ref_dec(entry);
-            return true;
+        if (!(tags[idx] & TAG_CONTROL_MASK)) return idx;
+    }
+    return SIZE_MAX;
+}
+
+/**
+ * Frees a slot of t.  The slot normally becomes a tombstone.  When the next
+ * slot is EMPTY no probe chain continues past this one, so it becomes EMPTY
+ * instead, along with the run of tombstones directly before it.  This keeps
+ * chains short under churn, which is what makes high load factors usable.
+ * Returns the change in the table's tombstone count.
+ */
+static inline ptrdiff_t table_free_slot(const slot_table_t* t, size_t idx) {
+    size_t mask = t->bucket_count - 1;
+
+    t->entries[idx] = NULL;
+    if (!(t->tags[(idx + 1) & mask] & TAG_EMPTY)) {
+        t->tags[idx] = TAG_DELETED;
+        return 1;
+    }
+    ptrdiff_t delta = 0;
+    t->tags[idx] = TAG_EMPTY;
+    for (size_t i = (idx - 1) & mask; t->tags[i] == TAG_DELETED; i = (i - 1) & mask) {
+        t->tags[i] = TAG_EMPTY;
+        delta--;
+    }
+    return delta;
+}
+
+/**
+ * Unlinks the entry in a live slot of the current table and drops the
+ * cache's reference.  Because freed slots can turn EMPTY, a slot index found
+ * before an unlink may no longer be a valid insert position afterwards.
+ * Caller holds the write lock.
+ */
+static inline void shard_unlink_slot_locked(aligned_cache_shard_t* shard, size_t idx) {
+    cache_entry_t* entry = shard->entries[idx];
+    slot_table_t t = shard_table(shard);
+
+    shard->tombstone_count = (size_t)((ptrdiff_t)shard->tombstone_count + table_free_slot(&t, idx));
+    shard->size--;
+    shard_drop_entry(shard, entry);
+}
+
+/**
+ * Unlinks the entry in a live slot of the table being migrated.  Caller
+ * holds the write lock.
+ */
+static inline void shard_unlink_old_locked(aligned_cache_shard_t* shard, size_t idx) {
+    cache_entry_t* entry = shard->old_entries[idx];
+    slot_table_t t = shard_old_table(shard);
+
+    table_free_slot(&t, idx);
+    shard->old_live--;
+    shard->size--;
+    shard_drop_entry(shard, entry);
+}
+
+/** Unlinks slot idx of the current table, or of the old one when in_old. */
+static inline void shard_unlink_at_locked(aligned_cache_shard_t* shard, size_t idx, bool in_old) {
+    if (in_old) {
+        shard_unlink_old_locked(shard, idx);
+    } else {
+        shard_unlink_slot_locked(shard, idx);
+    }
+}
+
+/**
+ * First free (EMPTY or tombstone) slot on the probe chain of hash; the
+ * insert position for a key known to be absent.  The shard must have a
+ * free slot.
+ */
+static inline size_t shard_first_free_slot(const aligned_cache_shard_t* shard, uint32_t hash) {
+    size_t mask = shard->bucket_count - 1;
+    size_t idx = hash & mask;
+    while (!(shard->tags[idx] & TAG_CONTROL_MASK)) idx = (idx + 1) & mask;
+    return idx;
+}
+
+/* ---------------------------------------------------------------- incremental rehash
+ *
+ * Growing, shrinking and compacting a shard all move its entries into a
+ * freshly allocated table.  Instead of one O(bucket_count) pass under the
+ * write lock, the current table is kept as old_tags/old_entries and drained
+ * CACHE_REHASH_STEP slots per insert (and per cache_tick() slice).  Inserts
+ * always go to the new table; lookups check the new table, then the old
+ * one, and a key lives in exactly one of them.  Old slots are only ever
+ * freed through table_free_slot(), so the probe chains of entries still
+ * waiting there stay intact, and every live old slot sits at or after
+ * migrate_pos.
+ */
+
+/** Slot count that holds capacity entries at the given load factor. */
+static inline size_t shard_buckets_for(size_t capacity, float load_factor) {
+    size_t desired = (size_t)ceil((double)capacity / (double)load_factor);
+    return next_power_of_2(desired);
+}
+
+/**
+ * compact_at sits halfway between capacity and bucket_count, so a
+ * compaction always reclaims at least a quarter of the slack the load
+ * factor leaves.
+ */
+static inline void shard_update_compact_at(aligned_cache_shard_t* shard) {
+    shard->compact_at = shard->capacity + (shard->bucket_count - shard->capacity) / 2;
+}
+
+/**
+ * True when the current table should be rebuilt at the same size.
+ *
+ * Live slots plus tombstones can leave too few empty slots for a miss to
+ * terminate early; tombstones alone are not enough, since a shard at
+ * capacity may never accumulate enough of them while every miss walks the
+ * whole table.  A table that is mostly tombstones (typically after an
+ * expiry sweep) is cheap to rebuild and slow to probe, so it qualifies too.
+ */
+static inline bool shard_needs_compaction(const aligned_cache_shard_t* shard) {
+    size_t live = shard->size - shard->old_live;
+    if (live + shard->tombstone_count > shard->compact_at) return true;
+    return shard->tombstone_count > live && shard->tombstone_count > shard->bucket_count / 4;
+}
+
+/**
+ * Makes a new table of n slots the insert target and keeps the current one
+ * for migration.  Caller holds the write lock and no rehash is in flight.
+ */
+static bool shard_start_rehash_locked(aligned_cache_shard_t* shard, size_t n) {
+    uint8_t* tags;
+    cache_entry_t** entries;
+    /* Reserve the old table's retire node now, so retiring it later cannot fail; no node, no rehash. */
+    retired_table_t* node = malloc(sizeof(*node));
+    if (!node) return false;
+    if (!shard_alloc_table(shard, n, &tags, &entries)) {
+        free(node);
+        return false;
+    }
+    shard->old_retire = node;
+
+    shard->old_tags = shard->tags;
+    shard->old_entries = shard->entries;
+    shard->old_bucket_count = shard->bucket_count;
+    shard->old_live = shard->size;
+    shard->migrate_pos = 0;
+
+    shard->tags = tags;
+    shard->entries = entries;
+    shard->bucket_count = n;
+    shard->tombstone_count = 0;
+    shard->clock_hand = 0;
+    if (n == shard->target_buckets) shard->capacity = shard->target_capacity;
+    shard_update_compact_at(shard);
+    return true;
+}
+
+/**
+ * Moves the live entries of up to `budget` old slots into the current
+ * table, and retires the old table once it is empty.  Caller holds the
+ * write lock and a rehash is in flight.
+ */
+static void shard_migrate_locked(aligned_cache_shard_t* shard, size_t budget) {
+    slot_table_t old = shard_old_table(shard);
+    size_t end = shard->migrate_pos + budget;
+    if (end > old.bucket_count) end = old.bucket_count;
+
+    for (size_t i = shard->migrate_pos; i < end && shard->old_live > 0; i++) {
+        if (old.tags[i] & TAG_CONTROL_MASK) continue;
+
+        cache_entry_t* entry = old.entries[i];
+        size_t slot = shard_first_free_slot(shard, entry->hash);
+        if (shard->tags[slot] == TAG_DELETED) shard->tombstone_count--;
+        shard->entries[slot] = entry;
+        shard->tags[slot] = old.tags[i];
+        table_free_slot(&old, i);
+        shard->old_live--;
+    }
+    shard->migrate_pos = end;
+
+    if (shard->old_live == 0) {
+        shard_drop_table(shard, old.tags, old.entries);
+        shard->old_tags = NULL;
+        shard->old_entries = NULL;
+        shard->old_bucket_count = 0;
+        shard->migrate_pos = 0;
+    }
+}
+
+/**
+ * Picks the next eviction victim.  While a rehash is in flight the
+ * migration cursor doubles as a CLOCK hand over the old table: an entry
+ * there with a clear reference bit is the victim, one with the bit set is
+ * migrated as its second chance.  After CACHE_REHASH_STEP second chances,
+ * or with no rehash in flight, the current table's CLOCK hand decides.
+ * May migrate entries, so insert positions must be re-probed afterwards.
+ * Returns SIZE_MAX when the shard is empty.
+ */
+static size_t shard_victim_locked(aligned_cache_shard_t* shard, bool* in_old) {
+    *in_old = false;
+    for (int chances = 0; shard->old_live > 0; chances++) {
+        /* Slots before the first live one hold nothing to migrate, so skip them for good. */
+        while (shard->old_tags[shard->migrate_pos] & TAG_CONTROL_MASK) shard->migrate_pos++;
+
+        cache_entry_t* entry = shard->old_entries[shard->migrate_pos];
+        if (chances == CACHE_REHASH_STEP || atomic_load_explicit(&entry->clock_bit, memory_order_relaxed) == 0) {
+            *in_old = true;
+            return shard->migrate_pos;
+        }
+        atomic_store_explicit(&entry->clock_bit, 0, memory_order_relaxed);
+        shard_migrate_locked(shard, 1);
+    }
+    return clock_victim(shard);
+}
+
+/**
+ * Does a bounded amount of table maintenance: migrates up to `budget` old
+ * slots, evicts up to CACHE_SHRINK_STEP entries of a shard left over
+ * capacity by cache_resize(), and otherwise starts a pending resize or a
+ * compaction.  Caller holds the write lock.
+ */
+static void shard_rehash_step_locked(aligned_cache_shard_t* shard, size_t budget) {
+    for (size_t n = 0; n < CACHE_SHRINK_STEP && shard->size > shard->capacity; n++) {
+        bool in_old;
+        size_t victim = shard_victim_locked(shard, &in_old);
+        if (victim == SIZE_MAX) break;
+        shard_unlink_at_locked(shard, victim, in_old);
+        shard->stat_evictions++;
+    }
+
+    if (shard->old_tags) {
+        /* Probe chains in the current table are degrading: finish sooner. */
+        if (unlikely(shard_needs_compaction(shard))) budget *= 8;
+        shard_migrate_locked(shard, budget);
+    } else if (shard->target_buckets != shard->bucket_count) {
+        /* A smaller table can only be filled once the shard fits its new capacity. */
+        if (shard->size <= shard->target_capacity) shard_start_rehash_locked(shard, shard->target_buckets);
+    } else if (unlikely(shard_needs_compaction(shard))) {
+        if (shard_start_rehash_locked(shard, shard->bucket_count)) shard->stat_compactions++;
+    }
+}
+
+/** True when shard_rehash_step_locked() has work to do. */
+static inline bool shard_rehash_pending(const aligned_cache_shard_t* shard) {
+    return shard->old_tags || shard->size > shard->capacity || shard->target_buckets != shard->bucket_count ||
+           shard_needs_compaction(shard);
+}
+
+/**
+ * Finds key in the current table, then in the table being migrated.
+ * Returns its slot index and sets *in_old, or SIZE_MAX when absent.  On a
+ * miss in the current table *insert_pos receives the key's insert position
+ * there (when insert_pos is not NULL).  Caller holds a lock.
+ */
+static size_t shard_lookup_locked(const aligned_cache_shard_t* shard, uint32_t hash, const char* key, size_t klen,
+                                  uint8_t target_tag, bool* in_old, size_t* insert_pos) {
+    bool found;
+    size_t idx = find_slot(shard, hash, key, klen, target_tag, &found);
+    *in_old = false;
+    if (found) return idx;
+    if (insert_pos) *insert_pos = idx;
+
+    if (shard->old_live == 0) return SIZE_MAX;
+    slot_table_t old = shard_old_table(shard);
+    idx = find_slot_in(&old, hash, key, klen, target_tag, &found);
+    if (!found) return SIZE_MAX;
+    *in_old = true;
+    return idx;
+}
+
+/** Entry in slot idx of the current table, or of the old one when in_old. */
+static inline cache_entry_t* shard_entry_at(const aligned_cache_shard_t* shard, size_t idx, bool in_old) {
+    return in_old ? shard->old_entries[idx] : shard->entries[idx];
+}
+
+/* ---------------------------------------------------------------- entry helpers */
+
+/**
+ * Allocates a new entry holding one reference (the cache's), with its key
+ * and back pointer filled in and value_len bytes of value left unwritten.
+ * Uses the shard's slab when it has one and the entry fits a size class.
+ */
+static cache_entry_t* entry_alloc(cache_slab_t* slab, const char* key, size_t klen, uint32_t hash, size_t value_len,
+                                  uint64_t expires_at) {
+    size_t alloc_sz = offsetof(cache_entry_t, data) + klen + 1 + sizeof(void*) + value_len;
+    int cls = slab ? slab_class_of(alloc_sz) : -1;
+
+    cache_entry_t* new_entry;
+    if (cls >= 0) {
+        new_entry = slab_alloc(slab, cls);
+        if (!new_entry) return NULL;
+        new_entry->slab = slab;
+        new_entry->size_class = (uint8_t)cls;
+    } else {
+        /*
+         * Reverted to fast malloc() to avoid aligned_alloc() overhead in glibc.
+         * With hash and key_len moved to offset 0, the hot metadata is guaranteed 
+         * to align to a 16-byte boundary and cannot span across a cache-line split.
+         */
+        new_entry = malloc(alloc_sz);
+        if (!new_entry) return NULL;
+        new_entry->slab = NULL;
+        new_entry->size_class = CACHE_SLAB_LARGE;
+    }
+
+    new_entry->hash = hash;
+    new_entry->key_len = (uint32_t)klen;
+    new_entry->value_len = value_len;
+    new_entry->expires_at = expires_at;
+    atomic_init(&new_entry->ref_count, 1);
+    atomic_init(&new_entry->clock_bit, 1);
+    new_entry->load_ms = 0;
+
+    unsigned char* dp = new_entry->data;
+    memcpy(dp, key, klen);
+    dp[klen] = '\0';
+    *(cache_entry_t**)(dp + klen + 1) = new_entry;
+    return new_entry;
+}
+
+/**
+ * Allocates a new entry holding one reference (the cache's) and a copy of value.
+ */
+static cache_entry_t* entry_create(cache_slab_t* slab, const char* key, size_t klen, uint32_t hash, const void* value,
+                                   size_t value_len, uint64_t expires_at) {
+    cache_entry_t* new_entry = entry_alloc(slab, key, klen, hash, value_len, expires_at);
+    if (new_entry) memcpy((void*)value_ptr_from_entry(new_entry), value, value_len);
+    return new_entry;
+}
+
+/**
+ * Links new_entry into the shard, replacing any entry with the same key.
+ * Caller holds the write lock.  On false the entry was not linked and the
+ * caller still owns it.
+ */
+static bool shard_insert_locked(aligned_cache_shard_t* shard, cache_entry_t* new_entry, const char* key, size_t klen,
+                                uint8_t target_tag) {
+    uint32_t hash = new_entry->hash;
+    size_t charge = entry_charge(new_entry);
+
+    if (unlikely(shard->byte_budget && charge > shard->byte_budget)) {
+        shard->stat_rejections++;
+        return false;
+    }
+
+    /* Publish the entry's contents before an optimistic reader can load its pointer. */
+    if (shard->deferred_reclaim) atomic_thread_fence(memory_order_release);
+
+    if (shard_rehash_pending(shard)) shard_rehash_step_locked(shard, CACHE_REHASH_STEP);
+
+    /*
+     * Entries beyond capacity (a shrink still converging) are left to the
+     * rehash step; this insert only has to keep the count from growing.
+     */
+    size_t limit = (shard->size > shard->capacity ? shard->size : shard->capacity) - 1;
+
+    bool in_old;
+    size_t insert_idx = 0;
+    size_t found_idx = shard_lookup_locked(shard, hash, key, klen, target_tag, &in_old, &insert_idx);
+
+    /*
+     * An update unlinks the old entry first, so the eviction loop below can
+     * never pick it.  Readers cannot observe the gap: it lies inside one
+     * write-locked section.
+     */
+    bool freed = false;
+    if (found_idx != SIZE_MAX) {
+        freed = !in_old;
+        shard_unlink_at_locked(shard, found_idx, in_old);
+    }
+
+    cache_sketch_t* sk = shard->sketch;
+    if (sk) {
+        sketch_record(sk, hash);
+        sketch_age_locked(sk);
+    }
+
+    bool admitted = found_idx != SIZE_MAX || !sk;
+    while (shard->size > limit || (shard->byte_budget && shard->bytes + charge > shard->byte_budget)) {
+        size_t victim = shard_victim_locked(shard, &in_old);
+        if (victim == SIZE_MAX) {
+            shard->stat_rejections++;
+            return false;
+        }
+
+        /*
+         * TinyLFU admission: a new key has to be estimated strictly hotter
+         * than the first victim it would displace, so a one-off scan cannot
+         * flush entries that are hit repeatedly.  Ties keep the incumbent.
+         */
+        if (!admitted) {
+            uint32_t victim_hash = shard_entry_at(shard, victim, in_old)->hash;
+            if (sketch_estimate(sk, hash) <= sketch_estimate(sk, victim_hash)) {
+                shard->stat_rejections++;
+                return false;
+            }
+            admitted = true;
         }
+        shard_unlink_at_locked(shard, victim, in_old);
+        shard->stat_evictions++;
+        freed = true;
+    }
+
+    /* Unlinking may have emptied slots on our chain; only then re-probe. */
+    size_t slot = freed ? shard_first_free_slot(shard, hash) : insert_idx;
+    if (shard->tags[slot] == TAG_DELETED) shard->tombstone_count--;
+
+    shard->entries[slot] = new_entry;
+    shard->tags[slot] = target_tag;
+    shard->size++;
+    shard->bytes += charge;
+    shard->stat_sets++;
+    return true;
+}
+
+/**
+ * Unlinks the entry for key if it is still present and expired at `now`.
+ * Caller holds the write lock; the double-check makes it safe to call after
+ * dropping a read lock that observed the expiry.
+ */
+static void shard_remove_expired_locked(aligned_cache_shard_t* shard, uint32_t hash, const char* key, size_t klen,
+                                        uint8_t target_tag, uint64_t now) {
+    bool in_old;
+    size_t idx = shard_lookup_locked(shard, hash, key, klen, target_tag, &in_old, NULL);
+    if (idx == SIZE_MAX) return;
+
+    if (now < shard_entry_at(shard, idx, in_old)->expires_at) return;
+    shard_unlink_at_locked(shard, idx, in_old);
+    shard->stat_expirations++;
+}
+
+/**
+ * Unlinks every expired entry in one slice of slots starting at `start`.
+ * Caller holds the write lock.  Returns the number of entries removed.
+ */
+static size_t shard_sweep_slice_locked(aligned_cache_shard_t* shard, size_t start, size_t count, uint64_t now) {
+    size_t mask = shard->bucket_count - 1;
+    size_t removed = 0;
+    for (size_t n = 0; n < count; n++) {
+        size_t idx = (start + n) & mask;
+        if (shard->tags[idx] & TAG_CONTROL_MASK) continue;
+        if (now < shard->entries[idx]->expires_at) continue;
+
+        shard_unlink_slot_locked(shard, idx);
+        removed++;
+    }
+    shard->stat_expirations += removed;
+    return removed;
+}
+
+/**
+ * Returns true if any live slot in the slice is expired.  Runs under the
+ * read lock so a clean slice never blocks readers behind the write lock.
+ */
+static bool shard_slice_has_expired(const aligned_cache_shard_t* shard, size_t start, size_t count, uint64_t now) {
+    size_t mask = shard->bucket_count - 1;
+    for (size_t n = 0; n < count; n++) {
+        size_t idx = (start + n) & mask;
+        if (!(shard->tags[idx] & TAG_CONTROL_MASK) && now >= shard->entries[idx]->expires_at) return true;
     }
     return false;
 }
 
+/**
+ * Stable insertion sort of batch positions by shard index.  Batches are at
+ * most CACHE_BATCH_CHUNK long, where this beats a counting sort whose
+ * histogram would be as large as the shard array.
+ */
+static void batch_sort_by_shard(uint16_t* order, const uint16_t* shard_of, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        uint16_t cur = order[i];
+        size_t j = i;
+        while (j > 0 && shard_of[order[j - 1]] > shard_of[cur]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = cur;
+    }
+}
+
+/* ---------------------------------------------------------------- single-flight loads
+ *
+ * cache_get_or_load() links a flight into the shard's list, under the write
+ * lock, before running the loader.  Other callers that miss the same key
+ * find the flight and wait for its result instead of running the loader
+ * again.  The leader links the loaded entry and unlinks the flight in one
+ * write-locked section, so every caller sees either the flight or the entry.
+ */
+
+typedef struct cache_flight_s {
+    struct cache_flight_s* next; /* shard list link; guarded by the shard write lock */
+    const char* key;             /* the leader's key, valid while the flight is linked */
+    size_t key_len;
+    uint32_t hash;
+    atomic_int refs;      /* the leader plus one per waiter */
+    bool done;            /* guarded by lock */
+    cache_entry_t* entry; /* loaded entry with the flight's own reference, or NULL */
+    Lock lock;
+    Condition cond;
+} cache_flight_t;
+
+static _Thread_local uint64_t tl_refresh_rng;
+
+/** Returns the flight loading key, or NULL.  Caller holds the shard write lock. */
+static cache_flight_t* shard_find_flight_locked(const aligned_cache_shard_t* shard, uint32_t hash, const char* key,
+                                                size_t klen) {
+    for (cache_flight_t* f = shard->flights; f; f = f->next) {
+        if (f->hash == hash && f->key_len == klen && keys_equal(f->key, key, klen)) return f;
+    }
+    return NULL;
+}
+
+/** Unlinks a flight from the shard list.  Caller holds the shard write lock. */
+static void shard_unlink_flight_locked(aligned_cache_shard_t* shard, cache_flight_t* flight) {
+    cache_flight_t** link = &shard->flights;
+    while (*link != flight) link = &(*link)->next;
+    *link = flight->next;
+}
+
+/** Drops one reference to a flight, freeing it (and its entry reference) with the last. */
+static void flight_release(cache_flight_t* flight) {
+    if (atomic_fetch_sub_explicit(&flight->refs, 1, memory_order_acq_rel) != 1) return;
+    entry_ref_dec(flight->entry);
+    cond_free(&flight->cond);
+    lock_free(&flight->lock);
+    free(flight);
+}
+
+/** Blocks until the flight's leader publishes a result; returns it with a reference taken, or NULL. */
+static cache_entry_t* flight_wait(cache_flight_t* flight) {
+    lock_acquire(&flight->lock);
+    while (!flight->done) cond_wait(&flight->cond, &flight->lock);
+    cache_entry_t* entry = flight->entry;
+    entry_ref_inc(entry);
+    lock_release(&flight->lock);
+    flight_release(flight);
+    return entry;
+}
+
+/**
+ * Probabilistic early refresh (XFetch): a hit triggers a reload with a
+ * probability that rises as expiry approaches, scaled by how long the
+ * value took to load, so one caller usually refreshes a hot key before it
+ * expires instead of every caller missing at once.
+ */
+static inline bool refresh_due(const struct cache_s* cache, const cache_entry_t* entry, uint64_t now) {
+    if (cache->refresh_beta == 0.0f || entry->load_ms == 0) return false;
+
+    /* -log(u) for u in (0, 1] never exceeds ~37, so distant expiries skip the RNG. */
+    double window = (double)entry->load_ms * (double)cache->refresh_beta;
+    double remaining = (double)(entry->expires_at - now);
+    if (remaining > window * 37.0) return false;
+
+    uint64_t x = tl_refresh_rng;
+    if (unlikely(x == 0)) x = (uint64_t)(uintptr_t)&tl_refresh_rng ^ get_time_ns() ^ 0x9E3779B97F4A7C15ull;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    tl_refresh_rng = x;
+    double u = (double)((x * 0x2545F4914F6CDD1Dull) >> 11 | 1u) * (1.0 / 9007199254740992.0);
+    return -log(u) * window >= remaining;
+}
+
 /* ---------------------------------------------------------------- public API */
 
+/**
+ * Incremental expiry sweep over at most `budget` slots.
+ */
+size_t cache_tick(cache_t* cache_ptr, size_t budget) {
+    if (!cache_ptr || !budget) return 0;
+
+    struct cache_s* cache = (struct cache_s*)cache_ptr;
+    uint64_t now = cache_now_ms();
+    size_t removed = 0;
+
+    while (budget > 0) {
+        size_t s_idx = atomic_fetch_add_explicit(&cache->sweep_cursor, 1, memory_order_relaxed) & (cache->shard_count - 1);
+        aligned_cache_shard_t* shard = &cache->shards[s_idx];
+        size_t slice = budget < CACHE_SWEEP_SLICE ? budget : CACHE_SWEEP_SLICE;
+
+        fast_rwlock_rdlock(&shard->lock);
+        if (slice > shard->bucket_count) slice = shard->bucket_count;
+        size_t start = atomic_load_explicit(&shard->sweep_pos, memory_order_relaxed) & (shard->bucket_count - 1);
+        bool dirty = shard_slice_has_expired(shard, start, slice, now);
+        bool pending = shard_rehash_pending(shard);
+        bool aging = shard->sketch && sketch_full(shard->sketch);
+        fast_rwlock_unlock_rd(&shard->lock);
+
+        if (dirty || pending || aging) {
+            shard_write_lock(shard);
+            /* The table may have been rebuilt meanwhile; re-derive the window. */
+            if (slice > shard->bucket_count) slice = shard->bucket_count;
+            start = atomic_load_explicit(&shard->sweep_pos, memory_order_relaxed) & (shard->bucket_count - 1);
+            removed += shard_sweep_slice_locked(shard, start, slice, now);
+            atomic_store_explicit(&shard->sweep_pos, start + slice, memory_order_relaxed);
+
+            /* Idle shards still finish a resize, and sweep tombstones get compacted away. */
+            if (shard_rehash_pending(shard)) shard_rehash_step_locked(shard, slice);
+            /* Read-only shards never reach the insert path, so their sketch is aged here. */
+            if (shard->sketch) sketch_age_locked(shard->sketch);
+            shard_write_unlock(shard);
+        } else {
+            /* A lost update between concurrent callers only repeats a clean slice. */
+            atomic_store_explicit(&shard->sweep_pos, start + slice, memory_order_relaxed);
+        }
+
+        budget -= slice;
+    }
+    return removed;
+}
+
+/** Background sweeper: one cache_tick() per interval until stopped. */
+static void* sweeper_main(void* arg) {
+    struct cache_s* cache = arg;
+    lock_acquire(&cache->sweeper_lock);
+    while (cache->sweeper_running) {
+        lock_release(&cache->sweeper_lock);
+        cache_tick((cache_t*)cache, cache->sweep_budget);
+        lock_acquire(&cache->sweeper_lock);
+        if (cache->sweeper_running) {
+            cond_wait_timeout(&cache->sweeper_cond, &cache->sweeper_lock, (int)cache->sweep_interval_ms);
+        }
+    }
+    lock_release(&cache->sweeper_lock);
+    return NULL;
+}
+
 /**
  * Creates a new cache with the specified capacity and default TTL.
  */
 cache_t* cache_create(size_t capacity, uint32_t default_ttl) {
+    cache_config_t config = {0};
+    config.capacity = capacity;
+    config.default_ttl = default_ttl;
+    return cache_create_ex(&config);
+}
+
+/**
+ * Creates a new cache from an explicit configuration.
+ */
+cache_t* cache_create_ex(const cache_config_t* config) {
+    if (!config) return NULL;
+
+    size_t shard_count = config->shard_count ? config->shard_count : CACHE_SHARD_COUNT;
+    if ((shard_count & (shard_count - 1)) != 0 || shard_count > CACHE_MAX_SHARDS) return NULL;
+    if (config->read_mode != CACHE_READ_LOCKED && config->read_mode != CACHE_READ_OPTIMISTIC) return NULL;
+    if (config->policy != CACHE_POLICY_CLOCK && config->policy != CACHE_POLICY_TINYLFU) return NULL;
+    float load_factor = config->max_load_factor != 0.0f ? config->max_load_factor : CACHE_DEFAULT_LOAD_FACTOR;
+    if (!(load_factor > 0.0f && load_factor <= CACHE_MAX_LOAD_FACTOR)) return NULL;
+    if (!(config->refresh_beta >= 0.0f)) return NULL;
+
     struct cache_s* c = calloc(1, sizeof(struct cache_s));
     if (!c) return NULL;
 
-    if (capacity == 0) capacity = 1000;
-    size_t shard_cap = capacity / CACHE_SHARD_COUNT;
+    c->shards = ALIGNED_ALLOC(CACHE_LINE_SIZE, shard_count * sizeof(aligned_cache_shard_t));
+    if (!c->shards) {
+        free(c);
+        return NULL;
+    }
+    memset(c->shards, 0, shard_count * sizeof(aligned_cache_shard_t));
+    c->shard_count = shard_count;
+
+    size_t capacity = config->capacity ? config->capacity : 1000;
+    size_t shard_cap = capacity / shard_count;
     if (shard_cap < 1) shard_cap = 1;
 
-    c->default_ttl = default_ttl ? default_ttl : CACHE_DEFAULT_TTL;
+    if (config->default_ttl_ms) {
+        c->default_ttl_ms = config->default_ttl_ms;
+    } else {
+        c->default_ttl_ms = (uint64_t)(config->default_ttl ? config->default_ttl : CACHE_DEFAULT_TTL) * 1000u;
+    }
+    c->read_mode = config->read_mode;
+    c->hash_fn = config->hash_fn;
+    c->hash_seed = config->hash_seed ? config->hash_seed : process_hash_seed();
+    c->load_factor = load_factor;
+    c->refresh_beta = config->refresh_beta;
+
+    c->stats = ALIGNED_ALLOC(CACHE_LINE_SIZE, CACHE_STAT_SLOTS * sizeof(cache_stat_slot_t));
+    if (!c->stats) goto cleanup_error;
+    memset(c->stats, 0, CACHE_STAT_SLOTS * sizeof(cache_stat_slot_t));
+    if (config->hot_keys) {
+        c->hot_keys = calloc(1, sizeof(hot_key_tracker_t) + config->hot_keys * sizeof(hot_key_counter_t));
+        if (!c->hot_keys) goto cleanup_error;
+        fast_rwlock_init(&c->hot_keys->lock);
+        c->hot_keys->size = config->hot_keys;
+        c->hot_keys->sample = config->hot_key_sample ? config->hot_key_sample : CACHE_HOT_SAMPLE;
+    }
+
+    int nodes[CACHE_MAX_NUMA_NODES];
+    size_t node_count = 0;
+    if (!config->shard_numa_nodes && config->numa_interleave) {
+        node_count = numa_online_nodes(nodes, CACHE_MAX_NUMA_NODES);
+    }
 
-    for (size_t i = 0; i < CACHE_SHARD_COUNT; i++) {
+    for (size_t i = 0; i < shard_count; i++) {
         aligned_cache_shard_t* s = &c->shards[i];
         s->capacity = shard_cap;
+        s->deferred_reclaim = config->read_mode == CACHE_READ_OPTIMISTIC;
+        s->byte_budget = config->max_bytes / shard_count;
+        if (config->max_bytes && s->byte_budget == 0) s->byte_budget = 1;
+        if (config->slab_alloc) {
+            s->slab = slab_create();
+            if (!s->slab) goto cleanup_error;
+        }
+        if (config->policy == CACHE_POLICY_TINYLFU) {
+            s->sketch = sketch_create(shard_cap);
+            if (!s->sketch) goto cleanup_error;
+        }
 
-        size_t desired = (size_t)(shard_cap * INITIAL_BUCKET_MULTIPLIER);
-        s->bucket_count = next_power_of_2(desired);
-
-        s->tags = ALIGNED_ALLOC(CACHE_LINE_SIZE, s->bucket_count * sizeof(uint8_t));
-        if (!s->tags) goto cleanup_error;
-
-        s->entries = ALIGNED_ALLOC(CACHE_LINE_SIZE, s->bucket_count * sizeof(cache_entry_t*));
-        if (!s->entries) {
-            free(s->tags);
-            s->tags = NULL;
-            goto cleanup_error;
+        s->numa_node = -1;
+        if (config->shard_numa_nodes) {
+            int node = config->shard_numa_nodes[i];
+            if (node >= 0 && node < CACHE_MAX_NUMA_NODES) s->numa_node = (int16_t)node;
+        } else if (node_count > 1) {
+            s->numa_node = (int16_t)nodes[i % node_count];
         }
 
-#if defined(__linux__) && defined(MADV_HUGEPAGE)
-        madvise(s->tags, s->bucket_count * sizeof(uint8_t), MADV_HUGEPAGE);
-        madvise(s->entries, s->bucket_count * sizeof(cache_entry_t*), MADV_HUGEPAGE);
-#endif
-        memset(s->tags, TAG_EMPTY, s->bucket_count * sizeof(uint8_t));
-        memset(s->entries, 0, s->bucket_count * sizeof(cache_entry_t*));
+        s->bucket_count = shard_buckets_for(shard_cap, load_factor);
+        s->target_buckets = s->bucket_count;
+        s->target_capacity = shard_cap;
+        shard_update_compact_at(s);
+
+        if (!shard_alloc_table(s, s->bucket_count, &s->tags, &s->entries)) goto cleanup_error;
 
         fast_rwlock_init(&s->lock);
+        atomic_init(&s->seq, 0);
     }
 
+    clock_acquire();
+
+    if (config->sweep_interval_ms) {
+        c->sweep_interval_ms = config->sweep_interval_ms;
+        c->sweep_budget = config->sweep_budget ? config->sweep_budget : CACHE_SWEEP_BUDGET;
+        lock_init(&c->sweeper_lock);
+        cond_init(&c->sweeper_cond);
+        c->sweeper_running = true;
+        if (thread_create(&c->sweeper_thread, sweeper_main, c) != 0) {
+            c->sweeper_running = false;
+            cache_destroy((cache_t*)c);
+            return NULL;
+        }
+    }
     return (cache_t*)c;
 
 cleanup_error:
-    for (size_t j = 0; j < CACHE_SHARD_COUNT; j++) {
+    for (size_t j = 0; j < shard_count; j++) {
         free(c->shards[j].tags);
         free(c->shards[j].entries);
+        slab_orphan(c->shards[j].slab);
+        free(c->shards[j].sketch);
     }
+    ALIGNED_FREE(c->stats);
+    free(c->hot_keys);
+    ALIGNED_FREE(c->shards);
     free(c);
     return NULL;
 }
@@ -539,150 +2305,691 @@ void cache_destroy(cache_t* cache_ptr) {
     if (!cache_ptr) return;
     struct cache_s* cache = (struct cache_s*)cache_ptr;
 
-    for (int i = 0; i < CACHE_SHARD_COUNT; i++) {
+    if (cache->sweep_interval_ms) {
+        lock_acquire(&cache->sweeper_lock);
+        bool was_running = cache->sweeper_running;
+        cache->sweeper_running = false;
+        cond_signal(&cache->sweeper_cond);
+        lock_release(&cache->sweeper_lock);
+        if (was_running) thread_join(cache->sweeper_thread, NULL);
+        cond_free(&cache->sweeper_cond);
+        lock_free(&cache->sweeper_lock);
+    }
+
+    for (size_t i = 0; i < cache->shard_count; i++) {
         aligned_cache_shard_t* s = &cache->shards[i];
-        fast_rwlock_wrlock(&s->lock);
+        shard_write_lock(s);
         if (s->tags && s->entries) {
             for (size_t j = 0; j < s->bucket_count; j++) {
                 if (!(s->tags[j] & TAG_CONTROL_MASK)) { entry_ref_dec(s->entries[j]); }
             }
         }
+        for (size_t j = 0; j < s->old_bucket_count; j++) {
+            if (!(s->old_tags[j] & TAG_CONTROL_MASK)) entry_ref_dec(s->old_entries[j]);
+        }
         free(s->tags);
         free(s->entries);
+        free(s->old_tags);
+        free(s->old_entries);
+        free(s->old_retire);
         s->tags = NULL;
         s->entries = NULL;
-        fast_rwlock_unlock_wr(&s->lock);
+        s->old_tags = NULL;
+        s->old_entries = NULL;
+
+        /* No reader may use a destroyed cache, so retired items go without a grace period. */
+        while (s->retired) {
+            cache_entry_t* e = s->retired;
+            s->retired = e->retire_next;
+            entry_ref_dec(e);
+        }
+        s->retired_count = 0;
+        while (s->retired_tables) {
+            retired_table_t* t = s->retired_tables;
+            s->retired_tables = t->next;
+            free(t->tags);
+            free(t->entries);
+            free(t);
+        }
+        shard_write_unlock(s);
+
+        /* Entries still referenced by callers keep the slab alive. */
+        slab_orphan(s->slab);
+        free(s->sketch);
     }
+    ALIGNED_FREE(cache->stats);
+    free(cache->hot_keys);
+    ALIGNED_FREE(cache->shards);
     free(cache);
+    clock_release();
+}
+
+/**
+ * Probes both tables without the lock, validated against the shard's
+ * seqlock.  Returns false when writers kept racing; otherwise *out is the
+ * entry or NULL on a miss.  The caller must be inside an epoch critical
+ * section to dereference *out.
+ */
+static inline bool shard_find_optimistic(aligned_cache_shard_t* shard, uint32_t hash, const char* key, size_t klen,
+                                         uint8_t target_tag, cache_entry_t** out) {
+    for (int attempt = 0; attempt < CACHE_OPTIMISTIC_RETRIES; attempt++) {
+        uint32_t seq = atomic_load_explicit(&shard->seq, memory_order_acquire);
+        if (unlikely(seq & 1u)) {
+            cpu_relax();
+            continue;
+        }
+
+        /* Validate the table snapshot before probing: a torn one may mix sizes mid-resize. */
+        slot_table_t t = shard_table(shard);
+        slot_table_t old = shard_old_table(shard);
+        size_t old_live = shard->old_live;
+        atomic_thread_fence(memory_order_acquire);
+        if (unlikely(atomic_load_explicit(&shard->seq, memory_order_relaxed) != seq)) continue;
+
+        cache_entry_t* entry = find_entry_optimistic(&t, hash, key, klen, target_tag);
+        if (!entry && old_live) entry = find_entry_optimistic(&old, hash, key, klen, target_tag);
+
+        atomic_thread_fence(memory_order_acquire);
+        if (unlikely(atomic_load_explicit(&shard->seq, memory_order_relaxed) != seq)) continue;
+
+        *out = entry;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Finds key and returns its entry with a reference taken, or NULL.
+ *
+ * An expired entry counts as a miss.  It is unlinked and NULL returned,
+ * unless keep_stale is set: then it is returned as is and the caller
+ * checks expires_at itself.
+ */
+static inline cache_entry_t* cache_lookup(struct cache_s* cache, const char* key, size_t klen, uint32_t hash,
+                                          uint64_t now, bool keep_stale) {
+    uint8_t target_tag = make_tag(hash);
+    aligned_cache_shard_t* shard = &cache->shards[get_shard_idx(hash, cache->shard_count)];
+    cache_stat_slot_t* st = stat_slot(cache);
+
+    /* Misses count too: a key that keeps missing is worth admitting. */
+    sketch_sample(shard->sketch, st, hash);
+    hot_key_sample(cache, st, key, klen, hash);
+
+    if (cache->read_mode == CACHE_READ_OPTIMISTIC) {
+        epoch_slot_t* slot = epoch_enter();
+        if (likely(slot != NULL)) {
+            cache_entry_t* entry;
+            if (likely(shard_find_optimistic(shard, hash, key, klen, target_tag, &entry))) {
+                if (!entry) {
+                    epoch_exit(slot);
+                    stat_add(&st->misses, 1);
+                    return NULL;
+                }
+                /* Expired entries fall through: the locked path unlinks them (or hands them out as stale). */
+                if (likely(now < entry->expires_at)) {
+                    if (atomic_load_explicit(&entry->clock_bit, memory_order_relaxed) == 0) {
+                        atomic_store_explicit(&entry->clock_bit, 1, memory_order_relaxed);
+                    }
+
+                    /* Safe even if unlinked since validation: the cache's own
+                     * reference is only dropped after our epoch slot is cleared. */
+                    entry_ref_inc(entry);
+                    epoch_exit(slot);
+                    stat_add(&st->hits, 1);
+                    return entry;
+                }
+            }
+            /* Leave the critical section before possibly blocking on the lock. */
+            epoch_exit(slot);
+        }
+    }
+
+    shard_read_lock(shard, st);
+
+    bool in_old;
+    size_t found_idx = shard_lookup_locked(shard, hash, key, klen, target_tag, &in_old, NULL);
+    if (found_idx == SIZE_MAX) {
+        fast_rwlock_unlock_rd(&shard->lock);
+        stat_add(&st->misses, 1);
+        return NULL;
+    }
+
+    cache_entry_t* entry = shard_entry_at(shard, found_idx, in_old);
+
+    if (unlikely(now >= entry->expires_at)) {
+        if (keep_stale) entry_ref_inc(entry);
+        fast_rwlock_unlock_rd(&shard->lock);
+        stat_add(&st->misses, 1);
+        if (keep_stale) return entry;
+
+        /* Upgrade to write lock for removal with double-check logic */
+        shard_write_lock(shard);
+        shard_remove_expired_locked(shard, hash, key, klen, target_tag, now);
+        shard_write_unlock(shard);
+        return NULL;
+    }
+
+    /* Silent-store optimisation: write the clock bit only if it is clear */
+    if (atomic_load_explicit(&entry->clock_bit, memory_order_relaxed) == 0) {
+        atomic_store_explicit(&entry->clock_bit, 1, memory_order_relaxed);
+    }
+
+    entry_ref_inc(entry);
+
+    fast_rwlock_unlock_rd(&shard->lock);
+    stat_add(&st->hits, 1);
+    return entry;
+}
+
+/**
+ * Retrieves a value from the cache by key (zero-copy).
+ */
+const void* cache_get(cache_t* cache_ptr, const char* key, size_t klen, size_t* out_len) {
+    if (unlikely(!cache_ptr || !key || !klen)) return NULL;
+
+    struct cache_s* cache = (struct cache_s*)cache_ptr;
+    cache_entry_t* entry = cache_lookup(cache, key, klen, hash_key(cache, key, klen), cache_now_ms(), false);
+    if (!entry) return NULL;
+
+    if (out_len) *out_len = entry->value_len;
+    return value_ptr_from_entry(entry);
+}
+
+/**
+ * Links a filled-in entry into its shard, replacing any entry with the same
+ * key.  Consumes the entry: it is freed when the insert is refused.
+ */
+static bool cache_link_entry(struct cache_s* cache, cache_entry_t* new_entry) {
+    uint32_t hash = new_entry->hash;
+    aligned_cache_shard_t* shard = &cache->shards[get_shard_idx(hash, cache->shard_count)];
+
+    /* Speculatively prefetch the entry pointer slot before acquiring the lock */
+    size_t mask = shard->bucket_count - 1;
+    size_t idx = hash & mask;
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(&shard->entries[idx], 0, 3);
+#endif
+
+    shard_write_lock(shard);
+    bool ok = shard_insert_locked(shard, new_entry, (const char*)new_entry->data, new_entry->key_len, make_tag(hash));
+    shard_write_unlock(shard);
+
+    if (!ok) entry_free(new_entry);
+    return ok;
+}
+
+/**
+ * Pins the calling thread's epoch for cache_get_pinned().
+ */
+bool cache_read_begin(cache_t* cache_ptr) {
+    if (unlikely(!cache_ptr)) return false;
+    if (((struct cache_s*)cache_ptr)->read_mode != CACHE_READ_OPTIMISTIC) return false;
+
+    if (tl_read_depth == 0) {
+        epoch_slot_t* slot = epoch_enter();
+        if (unlikely(!slot)) return false;
+        tl_read_pin = slot;
+    }
+    tl_read_depth++;
+    return true;
+}
+
+/**
+ * Ends a section opened by cache_read_begin().
+ */
+void cache_read_end(cache_t* cache_ptr) {
+    (void)cache_ptr;
+    if (unlikely(tl_read_depth == 0)) return;
+    if (--tl_read_depth == 0) {
+        epoch_exit(tl_read_pin);
+        tl_read_pin = NULL;
+    }
+}
+
+/**
+ * Zero-copy retrieval without a reference count.  Entries unlinked while
+ * the thread is pinned are retired with an epoch no older than the pin, so
+ * they outlive the section; nothing on the hit path writes shared memory.
+ */
+const void* cache_get_pinned(cache_t* cache_ptr, const char* key, size_t klen, size_t* out_len) {
+    if (unlikely(!cache_ptr || !key || !klen || !tl_read_pin)) return NULL;
+
+    struct cache_s* cache = (struct cache_s*)cache_ptr;
+    if (unlikely(cache->read_mode != CACHE_READ_OPTIMISTIC)) return NULL;
+
+    uint32_t hash = hash_key(cache, key, klen);
+    uint8_t target_tag = make_tag(hash);
+    aligned_cache_shard_t* shard = &cache->shards[get_shard_idx(hash, cache->shard_count)];
+    uint64_t now = cache_now_ms();
+    cache_stat_slot_t* st = stat_slot(cache);
+
+    sketch_sample(shard->sketch, st, hash);
+    hot_key_sample(cache, st, key, klen, hash);
+
+    cache_entry_t* entry;
+    if (unlikely(!shard_find_optimistic(shard, hash, key, klen, target_tag, &entry))) {
+        /* Writers kept racing.  The pin still protects whatever the locked probe finds. */
+        shard_read_lock(shard, st);
+        bool in_old;
+        size_t idx = shard_lookup_locked(shard, hash, key, klen, target_tag, &in_old, NULL);
+        entry = idx == SIZE_MAX ? NULL : shard_entry_at(shard, idx, in_old);
+        fast_rwlock_unlock_rd(&shard->lock);
+    }
+
+    if (!entry) {
+        stat_add(&st->misses, 1);
+        return NULL;
+    }
+    if (unlikely(now >= entry->expires_at)) {
+        stat_add(&st->misses, 1);
+        shard_write_lock(shard);
+        shard_remove_expired_locked(shard, hash, key, klen, target_tag, now);
+        shard_write_unlock(shard);
+        return NULL;
+    }
+
+    if (atomic_load_explicit(&entry->clock_bit, memory_order_relaxed) == 0) {
+        atomic_store_explicit(&entry->clock_bit, 1, memory_order_relaxed);
+    }
+    stat_add(&st->hits, 1);
+
+    if (out_len) *out_len = entry->value_len;
+    return value_ptr_from_entry(entry);
+}
+
+/**
+ * Inserts or updates a key-value pair with a TTL in ms (0 = default).
+ */
+static bool cache_set_internal(struct cache_s* cache, const char* key, size_t klen, const void* value,
+                               size_t value_len, uint64_t ttl_ms) {
+    uint32_t hash = hash_key(cache, key, klen);
+    uint64_t expires_at = cache_now_ms() + (ttl_ms ? ttl_ms : cache->default_ttl_ms);
+    aligned_cache_shard_t* shard = &cache->shards[get_shard_idx(hash, cache->shard_count)];
+
+    cache_entry_t* new_entry = entry_create(shard->slab, key, klen, hash, value, value_len, expires_at);
+    if (!new_entry) return false;
+    return cache_link_entry(cache, new_entry);
+}
+
+/**
+ * Inserts or updates a key-value pair in the cache.
+ */
+bool cache_set(cache_t* cache_ptr, const char* key, size_t klen, const void* value, size_t value_len, uint32_t ttl) {
+    if (unlikely(!cache_ptr || !key || !klen || !value || !value_len)) return false;
+    return cache_set_internal((struct cache_s*)cache_ptr, key, klen, value, value_len, (uint64_t)ttl * 1000u);
+}
+
+/**
+ * Inserts or updates a key-value pair with a millisecond TTL.
+ */
+bool cache_set_ms(cache_t* cache_ptr, const char* key, size_t klen, const void* value, size_t value_len,
+                  uint64_t ttl_ms) {
+    if (unlikely(!cache_ptr || !key || !klen || !value || !value_len)) return false;
+    return cache_set_internal((struct cache_s*)cache_ptr, key, klen, value, value_len, ttl_ms);
+}
+
+/**
+ * Allocates an unlinked entry whose value the caller fills in place.
+ */
+void* cache_reserve(cache_t* cache_ptr, const char* key, size_t klen, size_t value_len) {
+    if (unlikely(!cache_ptr || !key || !klen || !value_len)) return NULL;
+
+    struct cache_s* cache = (struct cache_s*)cache_ptr;
+    uint32_t hash = hash_key(cache, key, klen);
+    aligned_cache_shard_t* shard = &cache->shards[get_shard_idx(hash, cache->shard_count)];
+
+    /* expires_at is set by cache_commit(), once the value is complete. */
+    cache_entry_t* entry = entry_alloc(shard->slab, key, klen, hash, value_len, 0);
+    return entry ? (void*)value_ptr_from_entry(entry) : NULL;
+}
+
+/**
+ * Publishes a reserved entry, starting its TTL now.
+ */
+bool cache_commit(cache_t* cache_ptr, void* value, uint64_t ttl_ms) {
+    if (unlikely(!cache_ptr || !value)) return false;
+
+    struct cache_s* cache = (struct cache_s*)cache_ptr;
+    cache_entry_t* entry = entry_from_value(value);
+    entry->expires_at = cache_now_ms() + (ttl_ms ? ttl_ms : cache->default_ttl_ms);
+    return cache_link_entry(cache, entry);
 }
 
 /**
- * Retrieves a value from the cache by key (zero-copy).
+ * Discards a reserved entry without publishing it.
  */
-const void* cache_get(cache_t* cache_ptr, const char* key, size_t klen, size_t* out_len) {
-    if (unlikely(!cache_ptr || !key || !klen)) return NULL;
-
-    struct cache_s* cache = (struct cache_s*)cache_ptr;
-    uint32_t hash = hash_key(key, klen);
-    uint8_t target_tag = make_tag(hash);
-    aligned_cache_shard_t* shard = &cache->shards[get_shard_idx(hash)];
+void cache_abort(void* value) {
+    entry_free(entry_from_value(value));
+}
 
-    fast_rwlock_rdlock(&shard->lock);
+/**
+ * Runs the loader for a flight this thread leads, links the result and
+ * hands it to the waiters.  Returns the entry with the caller's reference,
+ * or NULL when the loader failed.
+ */
+static cache_entry_t* flight_lead(struct cache_s* cache, aligned_cache_shard_t* shard, cache_flight_t* flight,
+                                  cache_loader_fn loader, void* ctx) {
+    cache_loaded_t loaded = {0};
+    uint64_t start_ns = get_time_ns();
+    bool ok = loader(flight->key, flight->key_len, ctx, &loaded);
+    uint64_t load_ms = (get_time_ns() - start_ns + 999999u) / 1000000u;
+
+    cache_entry_t* entry = NULL;
+    if (ok && loaded.value && loaded.value_len) {
+        uint64_t ttl_ms = loaded.ttl_ms ? loaded.ttl_ms : cache->default_ttl_ms;
+        entry = entry_create(shard->slab, flight->key, flight->key_len, flight->hash, loaded.value, loaded.value_len,
+                             cache_now_ms() + ttl_ms);
+    }
+    if (loaded.free_value) loaded.free_value((void*)loaded.value);
 
-    bool found;
-    size_t found_idx = find_slot(shard, hash, key, klen, target_tag, &found);
-    if (!found) {
-        fast_rwlock_unlock_rd(&shard->lock);
-        return NULL;
+    if (entry) {
+        entry->load_ms = load_ms < UINT32_MAX ? (uint32_t)load_ms : UINT32_MAX;
+        entry_ref_inc(entry); /* the flight's, for waiters */
+        entry_ref_inc(entry); /* the caller's */
     }
 
-    cache_entry_t* entry = shard->entries[found_idx];
-    time_t now = time(NULL);
+    shard_write_lock(shard);
+    /* Rejected by admission or the byte budget: callers still get the value. */
+    if (entry && !shard_insert_locked(shard, entry, flight->key, flight->key_len, make_tag(flight->hash))) {
+        entry_ref_dec(entry);
+    }
+    shard_unlink_flight_locked(shard, flight);
+    shard_write_unlock(shard);
+
+    lock_acquire(&flight->lock);
+    flight->entry = entry;
+    flight->done = true;
+    cond_broadcast(&flight->cond);
+    lock_release(&flight->lock);
+    flight_release(flight);
+    return entry;
+}
 
-    if (unlikely(now >= entry->expires_at)) {
-        fast_rwlock_unlock_rd(&shard->lock);
+/**
+ * Get-or-compute with request coalescing.
+ */
+const void* cache_get_or_load(cache_t* cache_ptr, const char* key, size_t klen, cache_loader_fn loader, void* ctx,
+                              size_t* out_len) {
+    if (unlikely(!cache_ptr || !key || !klen || !loader)) return NULL;
 
-        /* Upgrade to write lock for removal with double-check logic */
-        fast_rwlock_wrlock(&shard->lock);
-        bool re_found;
-        size_t re_idx = find_slot(shard, hash, key, klen, target_tag, &re_found);
-        if (re_found) {
-            cache_entry_t* re_entry = shard->entries[re_idx];
-            if (now >= re_entry->expires_at) {
-                shard->tags[re_idx] = TAG_DELETED;
-                shard->entries[re_idx] = NULL;
-                shard->size--;
-                shard->tombstone_count++;
-                entry_ref_dec(re_entry);
-            }
+    struct cache_s* cache = (struct cache_s*)cache_ptr;
+    uint32_t hash = hash_key(cache, key, klen);
+    aligned_cache_shard_t* shard = &cache->shards[get_shard_idx(hash, cache->shard_count)];
+    uint64_t now = cache_now_ms();
+
+    /* current: a fresh entry due for early refresh, or an expired one kept as a fallback. */
+    cache_entry_t* current = cache_lookup(cache, key, klen, hash, now, true);
+    if (current && now < current->expires_at && !refresh_due(cache, current, now)) goto done;
+
+    shard_write_lock(shard);
+    cache_flight_t* flight = shard_find_flight_locked(shard, hash, key, klen);
+    if (flight) {
+        /* Someone is already loading: serve what we have, else wait for theirs. */
+        if (current) {
+            shard_write_unlock(shard);
+            goto done;
         }
-        fast_rwlock_unlock_wr(&shard->lock);
-        return NULL;
+        atomic_fetch_add_explicit(&flight->refs, 1, memory_order_relaxed);
+        shard_write_unlock(shard);
+        current = flight_wait(flight);
+        goto done;
     }
 
-    /* Silent-store optimisation: write the clock bit only if it is clear */
-    if (atomic_load_explicit(&entry->clock_bit, memory_order_relaxed) == 0) {
-        atomic_store_explicit(&entry->clock_bit, 1, memory_order_relaxed);
+    /* A flight may have completed between the lookup and the lock. */
+    bool in_old;
+    size_t idx = shard_lookup_locked(shard, hash, key, klen, make_tag(hash), &in_old, NULL);
+    if (idx != SIZE_MAX) {
+        cache_entry_t* entry = shard_entry_at(shard, idx, in_old);
+        if (entry != current && now < entry->expires_at) {
+            entry_ref_inc(entry);
+            shard_write_unlock(shard);
+            entry_ref_dec(current);
+            current = entry;
+            goto done;
+        }
     }
 
-    entry_ref_inc(entry);
-
-    if (out_len) *out_len = entry->value_len;
+    flight = malloc(sizeof(cache_flight_t));
+    if (!flight) {
+        shard_write_unlock(shard);
+        goto done;
+    }
+    flight->key = key;
+    flight->key_len = klen;
+    flight->hash = hash;
+    atomic_init(&flight->refs, 1);
+    flight->done = false;
+    flight->entry = NULL;
+    lock_init(&flight->lock);
+    cond_init(&flight->cond);
+    flight->next = shard->flights;
+    shard->flights = flight;
+    shard_write_unlock(shard);
+
+    cache_entry_t* loaded = flight_lead(cache, shard, flight, loader, ctx);
+    if (loaded) {
+        entry_ref_dec(current);
+        current = loaded;
+    }
 
-    fast_rwlock_unlock_rd(&shard->lock);
-    return value_ptr_from_entry(entry);
+done:
+    if (!current) return NULL;
+    if (out_len) *out_len = current->value_len;
+    return value_ptr_from_entry(current);
 }
 
 /**
- * Inserts or updates a key-value pair in the cache.
+ * Batched zero-copy retrieval: one read lock per shard group.
  */
-bool cache_set(cache_t* cache_ptr, const char* key, size_t klen, const void* value, size_t value_len, uint32_t ttl) {
-    if (unlikely(!cache_ptr || !key || !klen || !value || !value_len)) return false;
+size_t cache_get_many(cache_t* cache_ptr, size_t n, const char* const* keys, const size_t* key_lens,
+                      const void** out_values, size_t* out_lens) {
+    if (unlikely(!cache_ptr || !keys || !key_lens || !out_values)) return 0;
 
     struct cache_s* cache = (struct cache_s*)cache_ptr;
-    uint32_t hash = hash_key(key, klen);
-    uint8_t target_tag = make_tag(hash);
-    time_t now = time(NULL);
+    uint32_t hashes[CACHE_BATCH_CHUNK];
+    uint16_t shard_of[CACHE_BATCH_CHUNK];
+    uint16_t order[CACHE_BATCH_CHUNK];
+    uint16_t expired_at[CACHE_BATCH_CHUNK]; /* batch indices of the current group found expired */
+    size_t hits = 0;
+    uint64_t now = cache_now_ms();
+    cache_stat_slot_t* st = stat_slot(cache);
+
+    for (size_t base = 0; base < n; base += CACHE_BATCH_CHUNK) {
+        size_t m = n - base < CACHE_BATCH_CHUNK ? n - base : CACHE_BATCH_CHUNK;
+
+        for (size_t i = 0; i < m; i++) {
+            size_t k = base + i;
+            out_values[k] = NULL;
+            if (out_lens) out_lens[k] = 0;
+            order[i] = (uint16_t)i;
+            if (unlikely(!keys[k] || !key_lens[k])) {
+                shard_of[i] = UINT16_MAX; /* sorts last, skipped below */
+                continue;
+            }
+            hashes[i] = hash_key(cache, keys[k], key_lens[k]);
+            shard_of[i] = (uint16_t)get_shard_idx(hashes[i], cache->shard_count);
+            hot_key_sample(cache, st, keys[k], key_lens[k], hashes[i]);
+        }
 
-    /*
-     * Reverted to fast malloc() to avoid aligned_alloc() overhead in glibc.
-     * With hash and key_len moved to offset 0, the hot metadata is guaranteed 
-     * to align to a 16-byte boundary and cannot span across a cache-line split.
-     */
-    size_t alloc_sz = offsetof(cache_entry_t, data) + klen + 1 + sizeof(void*) + value_len;
-    cache_entry_t* new_entry = malloc(alloc_sz);
-    if (!new_entry) return false;
+        batch_sort_by_shard(order, shard_of, m);
+
+        size_t g = 0;
+        while (g < m && shard_of[order[g]] != UINT16_MAX) {
+            size_t s_idx = shard_of[order[g]];
+            size_t g_end = g + 1;
+            while (g_end < m && shard_of[order[g_end]] == s_idx) g_end++;
+
+            aligned_cache_shard_t* shard = &cache->shards[s_idx];
+            size_t expired = 0;
+
+            shard_read_lock(shard, st);
+
+            /* Issue every home-slot tag load of the group before the first probe. */
+            size_t mask = shard->bucket_count - 1;
+            for (size_t j = g; j < g_end; j++) prefetch_read(&shard->tags[hashes[order[j]] & mask]);
+
+            for (size_t j = g; j < g_end; j++) {
+                size_t i = order[j];
+                size_t k = base + i;
+                sketch_sample(shard->sketch, st, hashes[i]);
+                bool in_old;
+                size_t idx = shard_lookup_locked(shard, hashes[i], keys[k], key_lens[k], make_tag(hashes[i]), &in_old,
+                                                 NULL);
+                if (idx == SIZE_MAX) continue;
+
+                cache_entry_t* entry = shard_entry_at(shard, idx, in_old);
+                if (unlikely(now >= entry->expires_at)) {
+                    expired_at[expired++] = (uint16_t)i;
+                    continue;
+                }
+
+                if (atomic_load_explicit(&entry->clock_bit, memory_order_relaxed) == 0) {
+                    atomic_store_explicit(&entry->clock_bit, 1, memory_order_relaxed);
+                }
+                entry_ref_inc(entry);
+                out_values[k] = value_ptr_from_entry(entry);
+                if (out_lens) out_lens[k] = entry->value_len;
+                hits++;
+            }
 
-    new_entry->hash = hash;
-    new_entry->key_len = (uint32_t)klen;
-    new_entry->value_len = value_len;
-    new_entry->expires_at = now + (time_t)(ttl ? ttl : cache->default_ttl);
-    atomic_init(&new_entry->ref_count, 1);
-    atomic_init(&new_entry->clock_bit, 1);
+            fast_rwlock_unlock_rd(&shard->lock);
+
+            /* Drop the expired hits of this group under a single write lock; plain misses are not re-probed. */
+            if (unlikely(expired)) {
+                shard_write_lock(shard);
+                for (size_t e = 0; e < expired; e++) {
+                    size_t i = expired_at[e];
+                    size_t k = base + i;
+                    shard_remove_expired_locked(shard, hashes[i], keys[k], key_lens[k], make_tag(hashes[i]), now);
+                }
+                shard_write_unlock(shard);
+            }
 
-    unsigned char* dp = new_entry->data;
-    memcpy(dp, key, klen);
-    dp[klen] = '\0';
-    *(cache_entry_t**)(dp + klen + 1) = new_entry;
-    memcpy(dp + klen + 1 + sizeof(cache_entry_t*), value, value_len);
+            g = g_end;
+        }
+    }
+    stat_add(&st->hits, hits);
+    stat_add(&st->misses, n - hits);
+    return hits;
+}
+
+/**
+ * Batched insert: entries are built outside the locks, then linked with one
+ * write lock per shard group.
+ */
+size_t cache_set_many(cache_t* cache_ptr, size_t n, const char* const* keys, const size_t* key_lens,
+                      const void* const* values, const size_t* value_lens, uint32_t ttl) {
+    if (unlikely(!cache_ptr || !keys || !key_lens || !values || !value_lens)) return 0;
 
-    aligned_cache_shard_t* shard = &cache->shards[get_shard_idx(hash)];
+    struct cache_s* cache = (struct cache_s*)cache_ptr;
+    cache_entry_t* built[CACHE_BATCH_CHUNK];
+    uint16_t shard_of[CACHE_BATCH_CHUNK];
+    uint16_t order[CACHE_BATCH_CHUNK];
+    size_t stored = 0;
+    uint64_t expires_at = cache_now_ms() + (ttl ? (uint64_t)ttl * 1000u : cache->default_ttl_ms);
+
+    for (size_t base = 0; base < n; base += CACHE_BATCH_CHUNK) {
+        size_t m = n - base < CACHE_BATCH_CHUNK ? n - base : CACHE_BATCH_CHUNK;
+
+        for (size_t i = 0; i < m; i++) {
+            size_t k = base + i;
+            order[i] = (uint16_t)i;
+            built[i] = NULL;
+            shard_of[i] = UINT16_MAX;
+            if (unlikely(!keys[k] || !key_lens[k] || !values[k] || !value_lens[k])) continue;
+
+            uint32_t hash = hash_key(cache, keys[k], key_lens[k]);
+            size_t s_idx = get_shard_idx(hash, cache->shard_count);
+            built[i] = entry_create(cache->shards[s_idx].slab, keys[k], key_lens[k], hash, values[k], value_lens[k],
+                                    expires_at);
+            if (built[i]) shard_of[i] = (uint16_t)s_idx;
+        }
 
-    /* Speculatively prefetch the entry pointer slot before acquiring the lock */
-    size_t mask = shard->bucket_count - 1;
-    size_t idx = hash & mask;
-#if defined(__GNUC__) || defined(__clang__)
-    __builtin_prefetch(&shard->entries[idx], 0, 3);
-#endif
+        batch_sort_by_shard(order, shard_of, m);
 
-    fast_rwlock_wrlock(&shard->lock);
+        size_t g = 0;
+        while (g < m && shard_of[order[g]] != UINT16_MAX) {
+            size_t s_idx = shard_of[order[g]];
+            size_t g_end = g + 1;
+            while (g_end < m && shard_of[order[g_end]] == s_idx) g_end++;
 
-    if (unlikely(shard->tombstone_count > (shard->bucket_count * 3) / 4)) { compact_shard(shard); }
+            aligned_cache_shard_t* shard = &cache->shards[s_idx];
 
-    bool found;
-    size_t found_idx = find_slot(shard, hash, key, klen, target_tag, &found);
+            shard_write_lock(shard);
 
-    if (found) {
-        cache_entry_t* old = shard->entries[found_idx];
-        shard->entries[found_idx] = new_entry;
-        entry_ref_dec(old);
-    } else {
-        if (shard->size >= shard->capacity) {
-            if (!clock_evict(shard)) {
-                fast_rwlock_unlock_wr(&shard->lock);
-                free(new_entry);
-                return false;
+            size_t mask = shard->bucket_count - 1;
+            for (size_t j = g; j < g_end; j++) prefetch_read(&shard->tags[built[order[j]]->hash & mask]);
+
+            /* Stable order keeps "last write wins" for duplicate keys. */
+            for (size_t j = g; j < g_end; j++) {
+                size_t i = order[j];
+                size_t k = base + i;
+                cache_entry_t* e = built[i];
+                if (shard_insert_locked(shard, e, keys[k], key_lens[k], make_tag(e->hash))) {
+                    built[i] = NULL;
+                    stored++;
+                }
             }
+
+            shard_write_unlock(shard);
+            g = g_end;
         }
 
-        if (shard->tags[found_idx] == TAG_DELETED) shard->tombstone_count--;
+        /* Anything left was rejected (no evictable slot); it was never linked. */
+        for (size_t i = 0; i < m; i++) entry_free(built[i]);
+    }
+    return stored;
+}
+
+/**
+ * Switches how cache_get() synchronises with writers.
+ */
+bool cache_set_read_mode(cache_t* cache_ptr, cache_read_mode_t mode) {
+    if (!cache_ptr) return false;
+    if (mode != CACHE_READ_LOCKED && mode != CACHE_READ_OPTIMISTIC) return false;
 
-        shard->tags[found_idx] = target_tag;
-        shard->entries[found_idx] = new_entry;
-        shard->size++;
+    struct cache_s* cache = (struct cache_s*)cache_ptr;
+    for (size_t i = 0; i < cache->shard_count; i++) {
+        aligned_cache_shard_t* s = &cache->shards[i];
+        shard_write_lock(s);
+        /*
+         * Once any shard has deferred a release it stays deferred: a reader
+         * that sampled the old mode may still be in its critical section.
+         */
+        s->deferred_reclaim = s->deferred_reclaim || mode == CACHE_READ_OPTIMISTIC;
+        shard_write_unlock(s);
     }
+    cache->read_mode = mode;
+    return true;
+}
 
-    fast_rwlock_unlock_wr(&shard->lock);
+/**
+ * Changes the total capacity; tables follow incrementally.
+ */
+bool cache_resize(cache_t* cache_ptr, size_t capacity) {
+    if (!cache_ptr || !capacity) return false;
+    struct cache_s* cache = (struct cache_s*)cache_ptr;
+
+    size_t shard_cap = capacity / cache->shard_count;
+    if (shard_cap < 1) shard_cap = 1;
+    size_t buckets = shard_buckets_for(shard_cap, cache->load_factor);
+
+    for (size_t i = 0; i < cache->shard_count; i++) {
+        aligned_cache_shard_t* s = &cache->shards[i];
+        shard_write_lock(s);
+        s->target_buckets = buckets;
+        s->target_capacity = shard_cap;
+        /*
+         * A lower capacity applies at once and is reached by eviction; a
+         * higher one waits for the larger table so inserts cannot outrun it.
+         */
+        if (shard_cap < s->capacity || buckets == s->bucket_count) {
+            s->capacity = shard_cap;
+            shard_update_compact_at(s);
+        }
+        if (shard_rehash_pending(s)) shard_rehash_step_locked(s, CACHE_REHASH_STEP);
+        shard_write_unlock(s);
+    }
     return true;
 }
 
@@ -693,9 +3000,9 @@ void cache_invalidate(cache_t* cache_ptr, const char* key) {
     if (!cache_ptr || !key) return;
     struct cache_s* cache = (struct cache_s*)cache_ptr;
     size_t klen = strlen(key);
-    uint32_t hash = hash_key(key, klen);
+    uint32_t hash = hash_key(cache, key, klen);
     uint8_t target_tag = make_tag(hash);
-    aligned_cache_shard_t* shard = &cache->shards[get_shard_idx(hash)];
+    aligned_cache_shard_t* shard = &cache->shards[get_shard_idx(hash, cache->shard_count)];
 
     /* Speculatively prefetch the entry pointer slot before acquiring the lock */
     size_t mask = shard->bucket_count - 1;
@@ -704,23 +3011,17 @@ void cache_invalidate(cache_t* cache_ptr, const char* key) {
     __builtin_prefetch(&shard->entries[idx], 0, 3);
 #endif
 
-    fast_rwlock_wrlock(&shard->lock);
-
-    bool found;
-    size_t found_idx = find_slot(shard, hash, key, klen, target_tag, &found);
+    shard_write_lock(shard);
 
-    if (found) {
-        cache_entry_t* entry = shard->entries[found_idx];
-        shard->tags[found_idx] = TAG_DELETED;
-        shard->entries[found_idx] = NULL;
-        shard->size--;
-        shard->tombstone_count++;
+    bool in_old;
+    size_t found_idx = shard_lookup_locked(shard, hash, key, klen, target_tag, &in_old, NULL);
 
-        if (unlikely(shard->tombstone_count > (shard->bucket_count * 3) / 4)) { compact_shard(shard); }
-        entry_ref_dec(entry);
+    if (found_idx != SIZE_MAX) {
+        shard_unlink_at_locked(shard, found_idx, in_old);
+        if (shard_rehash_pending(shard)) shard_rehash_step_locked(shard, CACHE_REHASH_STEP);
     }
 
-    fast_rwlock_unlock_wr(&shard->lock);
+    shard_write_unlock(shard);
 }
 
 /**
@@ -738,18 +3039,30 @@ void cache_clear(cache_t* cache_ptr) {
     if (!cache_ptr) return;
     struct cache_s* cache = (struct cache_s*)cache_ptr;
 
-    for (int i = 0; i < CACHE_SHARD_COUNT; i++) {
+    for (size_t i = 0; i < cache->shard_count; i++) {
         aligned_cache_shard_t* s = &cache->shards[i];
-        fast_rwlock_wrlock(&s->lock);
+        shard_write_lock(s);
         for (size_t j = 0; j < s->bucket_count; j++) {
-            if (!(s->tags[j] & TAG_CONTROL_MASK)) { entry_ref_dec(s->entries[j]); }
+            if (!(s->tags[j] & TAG_CONTROL_MASK)) { shard_drop_entry(s, s->entries[j]); }
         }
         memset(s->tags, TAG_EMPTY, s->bucket_count * sizeof(uint8_t));
         memset(s->entries, 0, s->bucket_count * sizeof(cache_entry_t*));
+        if (s->old_tags) {
+            for (size_t j = s->migrate_pos; j < s->old_bucket_count; j++) {
+                if (!(s->old_tags[j] & TAG_CONTROL_MASK)) shard_drop_entry(s, s->old_entries[j]);
+            }
+            shard_drop_table(s, s->old_tags, s->old_entries);
+            s->old_tags = NULL;
+            s->old_entries = NULL;
+            s->old_bucket_count = 0;
+            s->old_live = 0;
+            s->migrate_pos = 0;
+        }
         s->size = 0;
+        s->bytes = 0;
         s->tombstone_count = 0;
         s->clock_hand = 0;
-        fast_rwlock_unlock_wr(&s->lock);
+        shard_write_unlock(s);
     }
 }
 
@@ -760,7 +3073,7 @@ size_t get_total_cache_size(cache_t* cache_ptr) {
     if (!cache_ptr) return 0;
     struct cache_s* cache = (struct cache_s*)cache_ptr;
     size_t total = 0;
-    for (int i = 0; i < CACHE_SHARD_COUNT; i++) {
+    for (size_t i = 0; i < cache->shard_count; i++) {
         fast_rwlock_rdlock(&cache->shards[i].lock);
         total += cache->shards[i].size;
         fast_rwlock_unlock_rd(&cache->shards[i].lock);
@@ -768,6 +3081,21 @@ size_t get_total_cache_size(cache_t* cache_ptr) {
     return total;
 }
 
+/**
+ * Returns the bytes charged to live entries across all shards.
+ */
+size_t get_total_memory_usage(cache_t* cache_ptr) {
+    if (!cache_ptr) return 0;
+    struct cache_s* cache = (struct cache_s*)cache_ptr;
+    size_t total = 0;
+    for (size_t i = 0; i < cache->shard_count; i++) {
+        fast_rwlock_rdlock(&cache->shards[i].lock);
+        total += cache->shards[i].bytes;
+        fast_rwlock_unlock_rd(&cache->shards[i].lock);
+    }
+    return total;
+}
+
 /**
  * Returns the total capacity of the cache across all shards.
  */
@@ -775,7 +3103,7 @@ size_t get_total_capacity(cache_t* cache_ptr) {
     if (!cache_ptr) return 0;
     struct cache_s* cache = (struct cache_s*)cache_ptr;
     size_t total = 0;
-    for (int i = 0; i < CACHE_SHARD_COUNT; i++) {
+    for (size_t i = 0; i < cache->shard_count; i++) {
         fast_rwlock_rdlock(&cache->shards[i].lock);
         total += cache->shards[i].capacity;
         fast_rwlock_unlock_rd(&cache->shards[i].lock);
@@ -783,102 +3111,508 @@ size_t get_total_capacity(cache_t* cache_ptr) {
     return total;
 }
 
-/* ---------------------------------------------------------------- persistence */
+/**
+ * Aggregates the per-thread slots and per-shard counters.
+ */
+bool cache_stats(cache_t* cache_ptr, cache_stats_t* out) {
+    if (!cache_ptr || !out) return false;
+    struct cache_s* cache = (struct cache_s*)cache_ptr;
 
-static inline bool file_write_chk(const void* ptr, size_t size, size_t count, FILE* stream) {
-    return fwrite(ptr, size, count, stream) == count;
-}
+    memset(out, 0, sizeof(*out));
+    for (size_t i = 0; i < CACHE_STAT_SLOTS; i++) {
+        const cache_stat_slot_t* st = &cache->stats[i];
+        out->hits += atomic_load_explicit(&st->hits, memory_order_relaxed);
+        out->misses += atomic_load_explicit(&st->misses, memory_order_relaxed);
+        out->lock_spins += atomic_load_explicit(&st->read_spins, memory_order_relaxed);
+    }
 
-static inline bool file_read_chk(void* ptr, size_t size, size_t count, FILE* stream) {
-    return fread(ptr, size, count, stream) == count;
+    for (size_t i = 0; i < cache->shard_count; i++) {
+        cache_shard_stats_t s;
+        cache_shard_stats(cache_ptr, i, &s);
+        out->sets += s.sets;
+        out->rejections += s.rejections;
+        out->evictions += s.evictions;
+        out->expirations += s.expirations;
+        out->compactions += s.compactions;
+        out->lock_spins += s.write_spins;
+        out->entries += s.entries;
+        out->capacity += s.capacity;
+        out->bytes += s.bytes;
+    }
+    out->shard_count = cache->shard_count;
+    return true;
 }
 
 /**
- * Serialises all non-expired entries to a binary file.
+ * Snapshot of one shard's occupancy and write-side counters.
  */
-bool cache_save(cache_t* cache_ptr, const char* filename) {
-    if (!cache_ptr || !filename) return false;
+bool cache_shard_stats(cache_t* cache_ptr, size_t shard_idx, cache_shard_stats_t* out) {
+    if (!cache_ptr || !out) return false;
     struct cache_s* cache = (struct cache_s*)cache_ptr;
+    if (shard_idx >= cache->shard_count) return false;
 
-    FILE* f = fopen(filename, "wb");
-    if (!f) return false;
+    aligned_cache_shard_t* shard = &cache->shards[shard_idx];
+    fast_rwlock_rdlock(&shard->lock);
+    out->entries = shard->size;
+    out->capacity = shard->capacity;
+    out->buckets = shard->bucket_count;
+    out->tombstones = shard->tombstone_count;
+    out->bytes = shard->bytes;
+    out->rehashing = shard->old_tags != NULL;
+    out->sets = shard->stat_sets;
+    out->rejections = shard->stat_rejections;
+    out->evictions = shard->stat_evictions;
+    out->expirations = shard->stat_expirations;
+    out->compactions = shard->stat_compactions;
+    out->write_spins = shard->stat_write_spins;
+    fast_rwlock_unlock_rd(&shard->lock);
+    return true;
+}
 
-    uint32_t magic = CACHE_FILE_MAGIC;
-    uint32_t version = CACHE_FILE_VERSION;
-    uint64_t total_entries = 0;
+static int hot_key_cmp_desc(const void* a, const void* b) {
+    uint64_t ca = ((const hot_key_counter_t*)a)->count;
+    uint64_t cb = ((const hot_key_counter_t*)b)->count;
+    return (ca < cb) - (ca > cb);
+}
 
-    if (!file_write_chk(&magic, sizeof(magic), 1, f) || !file_write_chk(&version, sizeof(version), 1, f) ||
-        !file_write_chk(&total_entries, sizeof(total_entries), 1, f)) {
-        fclose(f);
-        return false;
+/**
+ * Copies the hottest tracked keys, hottest first.
+ */
+size_t cache_hot_keys(cache_t* cache_ptr, cache_hot_key_t* out, size_t k) {
+    if (!cache_ptr || !out || !k) return 0;
+    struct cache_s* cache = (struct cache_s*)cache_ptr;
+    hot_key_tracker_t* t = cache->hot_keys;
+    if (!t) return 0;
+
+    hot_key_counter_t* copy = malloc(t->size * sizeof(*copy));
+    if (!copy) return 0;
+
+    fast_rwlock_wrlock(&t->lock);
+    size_t used = t->used;
+    memcpy(copy, t->counters, used * sizeof(*copy));
+    fast_rwlock_unlock_wr(&t->lock);
+
+    qsort(copy, used, sizeof(*copy), hot_key_cmp_desc);
+    if (k > used) k = used;
+    for (size_t i = 0; i < k; i++) {
+        memcpy(out[i].key, copy[i].key, sizeof(out[i].key));
+        out[i].key_len = copy[i].key_len;
+        out[i].hits = copy[i].count * t->sample;
     }
+    free(copy);
+    return k;
+}
 
-    uint64_t actual_count = 0;
-    time_t now = time(NULL);
+/* ---------------------------------------------------------------- persistence
+ *
+ * Snapshot format, version 2 (host byte order, like version 1):
+ *
+ *   header    magic, version, section count, flags, wall-clock save time (ms), reserved
+ *   sections  one per shard, records back to back:
+ *             key_len u32, reserved u32, value_len u64, wall-clock expiry (ms) i64, key, value
+ *   index     per section: file offset, byte length, record count, XXH3 of the section bytes
+ *   footer    index offset, XXH3 of the index, section count, version, end magic, reserved
+ *
+ * The file is written under a temporary name, synced and then renamed over
+ * the target, so a crash mid-save leaves the previous snapshot intact.  The
+ * footer is written last and every section is checksummed, so a truncated
+ * or corrupted file is rejected rather than half-trusted.
+ */
 
-    for (int i = 0; i < CACHE_SHARD_COUNT; i++) {
-        aligned_cache_shard_t* shard = &cache->shards[i];
-        fast_rwlock_rdlock(&shard->lock);
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t section_count;
+    uint32_t flags;
+    int64_t saved_at_ms;
+    uint64_t reserved;
+} snapshot_header_t;
+
+typedef struct {
+    uint32_t key_len;
+    uint32_t reserved;
+    uint64_t value_len;
+    int64_t expires_at_ms;
+} snapshot_record_t;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t length;
+    uint64_t count;
+    uint64_t checksum;
+} snapshot_section_t;
+
+typedef struct {
+    uint64_t index_offset;
+    uint64_t index_checksum;
+    uint32_t section_count;
+    uint32_t version;
+    uint32_t magic;
+    uint32_t reserved;
+} snapshot_footer_t;
+
+_Static_assert(sizeof(snapshot_header_t) == 32, "snapshot header layout");
+_Static_assert(sizeof(snapshot_record_t) == 24, "snapshot record layout");
+_Static_assert(sizeof(snapshot_section_t) == 32, "snapshot index entry layout");
+_Static_assert(sizeof(snapshot_footer_t) == 32, "snapshot footer layout");
 
-        for (size_t j = 0; j < shard->bucket_count; j++) {
-            if (shard->tags[j] & TAG_CONTROL_MASK) continue;
+static inline bool file_write_chk(const void* ptr, size_t size, size_t count, FILE* stream) {
+    return fwrite(ptr, size, count, stream) == count;
+}
 
-            cache_entry_t* entry = shard->entries[j];
-            if (!entry || entry->expires_at <= now) continue;
+static inline bool file_read_chk(void* ptr, size_t size, size_t count, FILE* stream) {
+    return fread(ptr, size, count, stream) == count;
+}
 
-            uint32_t klen = entry->key_len;
-            uint64_t vlen = (uint64_t)entry->value_len;
-            int64_t expiry = (int64_t)entry->expires_at;
+/** Wall-clock milliseconds since the UNIX epoch; snapshot expiries use this so they survive restarts. */
+static int64_t wall_now_ms(void) {
+    struct timespec ts;
+    if (timespec_get(&ts, TIME_UTC) != TIME_UTC) return (int64_t)time(NULL) * 1000;
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-            const void* val_ptr = value_ptr_from_entry(entry);
-            if (!val_ptr) continue;
+/** One shard's unexpired entries, each holding a reference so they outlive the shard lock. */
+typedef struct {
+    cache_entry_t** entries;
+    size_t count;
+} snapshot_pin_t;
 
-            if (!file_write_chk(&klen, sizeof(klen), 1, f) || !file_write_chk(&vlen, sizeof(vlen), 1, f) ||
-                !file_write_chk(&expiry, sizeof(expiry), 1, f) || !file_write_chk(entry->data, 1, klen, f) ||
-                !file_write_chk(val_ptr, 1, (size_t)vlen, f)) {
-                fast_rwlock_unlock_rd(&shard->lock);
-                fclose(f);
-                return false;
+static void snapshot_unpin(snapshot_pin_t* pins, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < pins[i].count; j++) entry_ref_dec(pins[i].entries[j]);
+        free(pins[i].entries);
+    }
+    free(pins);
+}
+
+/**
+ * Takes a reference to every unexpired entry while holding all shard read
+ * locks at once, so the snapshot is one point in time across shards.  Only
+ * pointers are copied under the locks: writers wait for that, not for the
+ * I/O.  Returns NULL on allocation failure.
+ */
+static snapshot_pin_t* snapshot_pin(struct cache_s* cache, uint64_t now) {
+    snapshot_pin_t* pins = calloc(cache->shard_count, sizeof(*pins));
+    if (!pins) return NULL;
+
+    for (size_t i = 0; i < cache->shard_count; i++) fast_rwlock_rdlock(&cache->shards[i].lock);
+
+    bool ok = true;
+    for (size_t i = 0; i < cache->shard_count && ok; i++) {
+        aligned_cache_shard_t* shard = &cache->shards[i];
+        pins[i].entries = malloc((shard->size ? shard->size : 1) * sizeof(cache_entry_t*));
+        if (!pins[i].entries) {
+            ok = false;
+            break;
+        }
+
+        /* Mid-rehash, entries are split between the current and the old table. */
+        slot_table_t tables[2] = {shard_table(shard), shard_old_table(shard)};
+        for (size_t t = 0; t < 2; t++) {
+            for (size_t j = 0; j < tables[t].bucket_count; j++) {
+                if (tables[t].tags[j] & TAG_CONTROL_MASK) continue;
+                cache_entry_t* entry = tables[t].entries[j];
+                if (entry->expires_at <= now) continue;
+                entry_ref_inc(entry);
+                pins[i].entries[pins[i].count++] = entry;
             }
-            actual_count++;
         }
+    }
 
-        fast_rwlock_unlock_rd(&shard->lock);
+    for (size_t i = 0; i < cache->shard_count; i++) fast_rwlock_unlock_rd(&cache->shards[i].lock);
+
+    if (!ok) {
+        snapshot_unpin(pins, cache->shard_count);
+        return NULL;
     }
+    return pins;
+}
 
-    fseek(f, (long)(sizeof(magic) + sizeof(version)), SEEK_SET);
-    if (!file_write_chk(&actual_count, sizeof(actual_count), 1, f)) {
-        fclose(f);
-        return false;
+/** Buffered snapshot output that checksums the current section as it goes. */
+typedef struct {
+    FILE* f;
+    unsigned char* buf;
+    size_t used;
+    uint64_t offset; /* file offset of buf[0] */
+    XXH3_state_t* xxh;
+    bool hashing;
+    bool ok;
+} snapshot_writer_t;
+
+static void snapshot_flush(snapshot_writer_t* w) {
+    if (w->ok && w->used && !file_write_chk(w->buf, 1, w->used, w->f)) w->ok = false;
+    w->offset += w->used;
+    w->used = 0;
+}
+
+static void snapshot_write(snapshot_writer_t* w, const void* data, size_t len) {
+    if (w->hashing) XXH3_64bits_update(w->xxh, data, len);
+    if (len > CACHE_SNAPSHOT_BUFFER - w->used) {
+        snapshot_flush(w);
+        if (len >= CACHE_SNAPSHOT_BUFFER) {
+            if (w->ok && !file_write_chk(data, 1, len, w->f)) w->ok = false;
+            w->offset += len;
+            return;
+        }
     }
+    memcpy(w->buf + w->used, data, len);
+    w->used += len;
+}
 
-    fclose(f);
+static inline uint64_t snapshot_tell(const snapshot_writer_t* w) {
+    return w->offset + w->used;
+}
+
+/** Forces the written snapshot to stable storage before it is renamed into place. */
+static bool snapshot_sync(file_t* file) {
+    if (file_flush(file) != FILE_SUCCESS) return false;
+#ifdef _WIN32
+    return FlushFileBuffers(file->native_handle) != 0;
+#else
+    return fsync(file->native_handle) == 0;
+#endif
+}
+
+/** Atomically replaces filename with the finished temporary file. */
+static bool snapshot_publish(const char* tmp_name, const char* filename) {
+#ifdef _WIN32
+    return MoveFileExA(tmp_name, filename, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (rename(tmp_name, filename) != 0) return false;
+
+    /* Persist the directory entry as well, or a crash could still undo the rename. */
+    const char* slash = strrchr(filename, '/');
+    size_t dir_len = slash ? (size_t)(slash - filename) : 0;
+    char* dir = malloc(dir_len + 2);
+    if (dir) {
+        if (!slash) {
+            strcpy(dir, ".");
+        } else if (dir_len == 0) {
+            strcpy(dir, "/");
+        } else {
+            memcpy(dir, filename, dir_len);
+            dir[dir_len] = '\0';
+        }
+        int fd = open(dir, O_RDONLY);
+        if (fd >= 0) {
+            (void)fsync(fd);
+            close(fd);
+        }
+        free(dir);
+    }
     return true;
+#endif
 }
 
 /**
- * Loads entries from a binary file previously written by cache_save().
+ * Writes a version 2 snapshot from a point-in-time view of all shards.
  */
-bool cache_load(cache_t* cache_ptr, const char* filename) {
+bool cache_save(cache_t* cache_ptr, const char* filename) {
     if (!cache_ptr || !filename) return false;
+    struct cache_s* cache = (struct cache_s*)cache_ptr;
 
-    FILE* f = fopen(filename, "rb");
-    if (!f) return false;
+    size_t name_len = strlen(filename);
+    char* tmp_name = malloc(name_len + sizeof(".tmp"));
+    if (!tmp_name) return false;
+    memcpy(tmp_name, filename, name_len);
+    memcpy(tmp_name + name_len, ".tmp", sizeof(".tmp"));
+
+    uint64_t now = cache_now_ms();
+    int64_t wall_now = wall_now_ms();
+    size_t n = cache->shard_count;
+
+    snapshot_pin_t* pins = snapshot_pin(cache, now);
+    snapshot_section_t* index = calloc(n, sizeof(*index));
+    snapshot_writer_t w = {.buf = malloc(CACHE_SNAPSHOT_BUFFER), .xxh = XXH3_createState(), .ok = true};
+    file_t file;
+    bool opened = false;
+
+    if (!pins || !index || !w.buf || !w.xxh) goto done;
+    if (file_open(&file, tmp_name, "wb") != FILE_SUCCESS) goto done;
+    opened = true;
+    w.f = file.stream;
+
+    snapshot_header_t header = {CACHE_FILE_MAGIC, CACHE_FILE_VERSION, (uint32_t)n, 0, wall_now, 0};
+    snapshot_write(&w, &header, sizeof(header));
+
+    for (size_t i = 0; i < n && w.ok; i++) {
+        index[i].offset = snapshot_tell(&w);
+        index[i].count = pins[i].count;
+        XXH3_64bits_reset(w.xxh);
+        w.hashing = true;
+
+        for (size_t j = 0; j < pins[i].count; j++) {
+            cache_entry_t* entry = pins[i].entries[j];
+            snapshot_record_t rec = {entry->key_len, 0, (uint64_t)entry->value_len,
+                                     wall_now + (int64_t)(entry->expires_at - now)};
+            snapshot_write(&w, &rec, sizeof(rec));
+            snapshot_write(&w, entry->data, entry->key_len);
+            snapshot_write(&w, value_ptr_from_entry(entry), entry->value_len);
+        }
 
-    uint32_t magic = 0;
-    uint32_t version = 0;
-    uint64_t stored_count = 0;
+        w.hashing = false;
+        index[i].length = snapshot_tell(&w) - index[i].offset;
+        index[i].checksum = XXH3_64bits_digest(w.xxh);
 
-    if (!file_read_chk(&magic, sizeof(magic), 1, f) || !file_read_chk(&version, sizeof(version), 1, f) ||
-        !file_read_chk(&stored_count, sizeof(stored_count), 1, f)) {
-        fclose(f);
-        return false;
+        /* Written entries no longer need pinning; let evicted ones go now. */
+        for (size_t j = 0; j < pins[i].count; j++) entry_ref_dec(pins[i].entries[j]);
+        pins[i].count = 0;
     }
 
-    if (magic != CACHE_FILE_MAGIC || version != CACHE_FILE_VERSION) {
-        fclose(f);
+    snapshot_footer_t footer = {snapshot_tell(&w), XXH3_64bits(index, n * sizeof(*index)), (uint32_t)n,
+                                CACHE_FILE_VERSION, CACHE_FILE_END_MAGIC, 0};
+    snapshot_write(&w, index, n * sizeof(*index));
+    snapshot_write(&w, &footer, sizeof(footer));
+    snapshot_flush(&w);
+    w.ok = w.ok && snapshot_sync(&file);
+
+done:
+    if (opened) file_close(&file);
+    bool ok = opened && w.ok && snapshot_publish(tmp_name, filename);
+    if (opened && !ok) remove(tmp_name);
+
+    if (pins) snapshot_unpin(pins, n);
+    if (w.xxh) XXH3_freeState(w.xxh);
+    free(w.buf);
+    free(index);
+    free(tmp_name);
+    return ok;
+}
+
+/**
+ * Shared state of one snapshot load; workers claim sections by index.  The
+ * load runs twice over the sections: a verify pass that inserts nothing, and
+ * only if every section passed, an insert pass.
+ */
+typedef struct {
+    struct cache_s* cache;
+    const unsigned char* base;
+    const snapshot_section_t* index;
+    uint32_t section_count;
+    int64_t wall_now;
+    bool insert; /* false: verify pass */
+    _Atomic uint32_t next;
+    atomic_bool failed;
+} snapshot_load_t;
+
+/**
+ * Verify pass: checks one section's checksum and record framing.  Insert
+ * pass: inserts its unexpired records straight from the mapping.  Returns
+ * false if the section is corrupt.
+ */
+static bool snapshot_load_section(snapshot_load_t* ld, const snapshot_section_t* sec) {
+    const unsigned char* p = ld->base + sec->offset;
+    const unsigned char* end = p + sec->length;
+    if (!ld->insert && XXH3_64bits(p, (size_t)sec->length) != sec->checksum) return false;
+
+    for (uint64_t n = 0; n < sec->count; n++) {
+        snapshot_record_t rec;
+        if ((size_t)(end - p) < sizeof(rec)) return false;
+        memcpy(&rec, p, sizeof(rec));
+        p += sizeof(rec);
+
+        size_t left = (size_t)(end - p);
+        if (rec.key_len == 0 || rec.value_len > left || rec.key_len > left - rec.value_len) return false;
+        const char* key = (const char*)p;
+        const void* value = p + rec.key_len;
+        p += rec.key_len + rec.value_len;
+
+        /* Entries the cache declines (admission policy, byte budget) are skipped, not errors. */
+        if (ld->insert && rec.expires_at_ms > ld->wall_now) {
+            (void)cache_set_internal(ld->cache, key, rec.key_len, value, (size_t)rec.value_len,
+                                     (uint64_t)(rec.expires_at_ms - ld->wall_now));
+        }
+    }
+    return p == end;
+}
+
+static void* snapshot_load_worker(void* arg) {
+    snapshot_load_t* ld = arg;
+    for (;;) {
+        uint32_t i = atomic_fetch_add_explicit(&ld->next, 1, memory_order_relaxed);
+        if (i >= ld->section_count) break;
+        if (!snapshot_load_section(ld, &ld->index[i])) atomic_store_explicit(&ld->failed, true, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+/** Runs one pass over every section on up to `threads` threads, the caller included. */
+static bool snapshot_load_pass(snapshot_load_t* ld, size_t threads, bool insert) {
+    ld->insert = insert;
+    atomic_store_explicit(&ld->next, 0, memory_order_relaxed);
+
+    /* A helper that fails to start just leaves more sections to the others. */
+    Thread helpers[CACHE_LOAD_MAX_THREADS];
+    size_t started = 0;
+    for (size_t t = 1; t < threads; t++) {
+        if (thread_create(&helpers[started], snapshot_load_worker, ld) != 0) break;
+        started++;
+    }
+    snapshot_load_worker(ld);
+    for (size_t t = 0; t < started; t++) thread_join(helpers[t], NULL);
+    return !atomic_load_explicit(&ld->failed, memory_order_relaxed);
+}
+
+/**
+ * Validates the footer and index of a mapped version 2 snapshot, then
+ * loads its sections on up to `threads` threads (the caller included).
+ * Nothing is inserted unless every section verifies.
+ */
+static bool snapshot_load_mapped(struct cache_s* cache, const unsigned char* base, size_t size, size_t threads) {
+    snapshot_header_t header;
+    snapshot_footer_t footer;
+    if (size < sizeof(header) + sizeof(footer)) return false;
+    memcpy(&header, base, sizeof(header));
+    memcpy(&footer, base + size - sizeof(footer), sizeof(footer));
+
+    if (footer.magic != CACHE_FILE_END_MAGIC || footer.version != CACHE_FILE_VERSION ||
+        footer.section_count != header.section_count) {
+        return false;
+    }
+    size_t index_len = (size_t)footer.section_count * sizeof(snapshot_section_t);
+    size_t index_end = size - sizeof(footer);
+    if (footer.index_offset < sizeof(header) || footer.index_offset > index_end ||
+        index_end - footer.index_offset != index_len) {
         return false;
     }
+    if (XXH3_64bits(base + footer.index_offset, index_len) != footer.index_checksum) return false;
+
+    /* Sections have arbitrary lengths, so the index is not aligned in the file. */
+    snapshot_section_t* index = malloc(index_len ? index_len : 1);
+    if (!index) return false;
+    memcpy(index, base + footer.index_offset, index_len);
+    for (uint32_t i = 0; i < footer.section_count; i++) {
+        if (index[i].offset < sizeof(header) || index[i].offset > footer.index_offset ||
+            index[i].length > footer.index_offset - index[i].offset) {
+            free(index);
+            return false;
+        }
+    }
+
+    snapshot_load_t ld = {.cache = cache, .base = base, .index = index, .section_count = footer.section_count};
+    ld.wall_now = wall_now_ms();
+    atomic_init(&ld.next, 0);
+    atomic_init(&ld.failed, false);
+
+    if (threads == 0) {
+        long ncpus = get_ncpus();
+        threads = ncpus > 0 ? (size_t)ncpus : 1;
+    }
+    if (threads > footer.section_count) threads = footer.section_count;
+    if (threads > CACHE_LOAD_MAX_THREADS) threads = CACHE_LOAD_MAX_THREADS;
+
+    bool ok = snapshot_load_pass(&ld, threads, false) && snapshot_load_pass(&ld, threads, true);
+    free(index);
+    return ok;
+}
+
+/**
+ * Loads a version 1 file: one stdio read per field, inserted one at a time.
+ * The stream is positioned just after the magic and version.
+ */
+static bool cache_load_v1(struct cache_s* cache, FILE* f) {
+    uint64_t stored_count = 0;
+    if (!file_read_chk(&stored_count, sizeof(stored_count), 1, f)) return false;
 
     char key_buf[512];
     char* big_key_buf = NULL;
@@ -926,8 +3660,8 @@ bool cache_load(cache_t* cache_ptr, const char* filename) {
         kptr[klen] = '\0';
 
         if ((time_t)expiry > now) {
-            uint32_t remaining_ttl = (uint32_t)((time_t)expiry - now);
-            if (!cache_set(cache_ptr, kptr, klen, val_buf, (size_t)vlen, remaining_ttl)) {
+            uint64_t remaining_ms = (uint64_t)((time_t)expiry - now) * 1000u;
+            if (!cache_set_internal(cache, kptr, klen, val_buf, (size_t)vlen, remaining_ms)) {
                 success = false;
                 break;
             }
@@ -936,6 +3670,46 @@ bool cache_load(cache_t* cache_ptr, const char* filename) {
 
     free(big_key_buf);
     free(val_buf);
-    fclose(f);
     return success;
 }
+
+/**
+ * Loads a snapshot, reading version 2 through a read-only mapping.
+ */
+bool cache_load_ex(cache_t* cache_ptr, const char* filename, size_t threads) {
+    if (!cache_ptr || !filename) return false;
+    struct cache_s* cache = (struct cache_s*)cache_ptr;
+
+    file_t file;
+    if (file_open(&file, filename, "rb") != FILE_SUCCESS) return false;
+
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    bool ok = false;
+    if (file_read_chk(&magic, sizeof(magic), 1, file.stream) && file_read_chk(&version, sizeof(version), 1, file.stream) &&
+        magic == CACHE_FILE_MAGIC) {
+        if (version == CACHE_FILE_VERSION_V1) {
+            ok = cache_load_v1(cache, file.stream);
+        } else if (version == CACHE_FILE_VERSION && file.attr.size > 0) {
+            size_t size = file.attr.size;
+            const unsigned char* base = file_mmap(&file, size, true, false);
+            if (base) {
+#if defined(POSIX_MADV_WILLNEED)
+                posix_madvise((void*)base, size, POSIX_MADV_WILLNEED);
+#endif
+                ok = snapshot_load_mapped(cache, base, size, threads);
+                file_munmap((void*)base, size);
+            }
+        }
+    }
+
+    file_close(&file);
+    return ok;
+}
+
+/**
+ * Loads entries from a file previously written by cache_save().
+ */
+bool cache_load(cache_t* cache_ptr, const char* filename) {
+    return cache_load_ex(cache_ptr, filename, 1);
+}
@@ -24,6 +24,11 @@
  *    Single forward scan with a fixed-size stack-local offset table to avoid
  *    heap allocation for the common case (< 64 matches).
  *
+ *  Arena strings
+ *    Arena mode is the heap path with a different allocator: the Arena* is
+ *    stored in the otherwise unused SSO buffer and realloc/free become
+ *    arena_realloc()/no-op.
+ *
  *  Growth policy
  *    Exact doubling from the next power-of-two above the request, ensuring
  *    amortised O(1) appends with no fractional-factor rounding surprises.
@@ -79,6 +84,13 @@ static inline uint32_t cstr_grow_cap(uint32_t current, uint32_t need) {
     return cap;
 }
 
+/* Arena backing an arena-mode string (stored in the unused SSO buffer). */
+static inline Arena* cstr_arena(const cstr* s) {
+    Arena* arena;
+    memcpy(&arena, s->buf, sizeof(arena));
+    return arena;
+}
+
 /* -------------------------------------------------------------------------
  * Internal: promote SSO → heap, or grow existing heap.
  *
@@ -112,6 +124,14 @@ static bool cstr_ensure_cap(cstr* s, size_t need) {
     uint32_t new_cap = cstr_grow_cap(cur_cap, need32);
     if (new_cap == 0) return false;
 
+    if (cstr_is_arena(s)) {
+        char* mem = (char*)arena_realloc(cstr_arena(s), s->data, cur_cap, new_cap, 1);
+        if (CSTR_UNLIKELY(!mem)) return false;
+        s->data     = mem;
+        s->capacity = CSTR_HEAP_FLAG | CSTR_ARENA_FLAG | new_cap;
+        return true;
+    }
+
     char* mem = (char*)realloc(s->data, new_cap);
     if (CSTR_UNLIKELY(!mem)) return false;
 
@@ -167,9 +187,38 @@ cstr* cstr_new_len(const char* data, size_t length) {
     return s;
 }
 
+cstr* cstr_new_arena(Arena* arena, const char* input) {
+    if (CSTR_UNLIKELY(!input)) return NULL;
+    return cstr_new_len_arena(arena, input, strlen(input));
+}
+
+cstr* cstr_new_len_arena(Arena* arena, const char* data, size_t length) {
+    if (CSTR_UNLIKELY(!arena || (!data && length > 0))) return NULL;
+    if (CSTR_UNLIKELY(length >= CSTR_MAX_SIZE)) return NULL;
+
+    cstr* s = (cstr*)arena_alloc_align(arena, sizeof(cstr), _Alignof(cstr));
+    if (CSTR_UNLIKELY(!s)) return NULL;
+
+    /* The bytes follow the struct, so appends grow in place until the
+     * arena hands out something else. */
+    uint32_t cap = cstr_grow_cap(CSTR_MIN_HEAP, (uint32_t)length + 1);
+    char* mem    = (char*)arena_alloc_unaligned(arena, cap);
+    if (CSTR_UNLIKELY(!mem)) return NULL;
+
+    if (length > 0) memcpy(mem, data, length);
+    mem[length] = '\0';
+    s->data     = mem;
+    s->length   = (uint32_t)length;
+    s->capacity = CSTR_HEAP_FLAG | CSTR_ARENA_FLAG | cap;
+    memcpy(s->buf, &arena, sizeof(arena));
+    return s;
+}
+
 void cstr_drop(cstr* s) {
     if (!s) return;
-    if (cstr_is_heap(s)) {
+    if (cstr_is_arena(s)) {
+        cstr_init_inplace(s); /* bytes stay with the arena */
+    } else if (cstr_is_heap(s)) {
         free(s->data);
         s->data = NULL;
         cstr_init_inplace(s); /* reset to safe SSO state */
@@ -177,7 +226,7 @@ void cstr_drop(cstr* s) {
 }
 
 void cstr_free(cstr* s) {
-    if (!s) return;
+    if (!s || cstr_is_arena(s)) return; /* struct and bytes belong to the arena */
     if (cstr_is_heap(s)) {
         free(s->data);
         s->data = NULL;
@@ -196,7 +245,7 @@ void cstr_debug(const cstr* s) {
             "  content: \"%.*s\"\n",
             (const void*)s->data, s->length,
             (unsigned)(cstr_is_heap(s) ? cstr_heap_cap(s) : CSTR_SSO_CAP - 1u),
-            cstr_is_heap(s) ? "heap" : "sso", (int)s->length, s->data);
+            cstr_is_arena(s) ? "arena" : cstr_is_heap(s) ? "heap" : "sso", (int)s->length, s->data);
 }
 
 /* -------------------------------------------------------------------------
@@ -208,7 +257,7 @@ bool cstr_reserve(cstr* s, size_t capacity) {
 }
 
 void cstr_shrink_to_fit(cstr* s) {
-    if (!cstr_is_heap(s)) return;
+    if (!cstr_is_heap(s) || cstr_is_arena(s)) return; /* arena bytes cannot be given back */
     uint32_t needed = s->length + 1;
     if (cstr_heap_cap(s) == needed) return;
 
@@ -59,6 +59,19 @@ static inline size_t calculate_growth_for(size_t current, size_t min_capacity, s
     return new_capacity;
 }
 
+/**
+ * Resizes the buffer to new_capacity elements, from the arena if the array has one.
+ * Arena buffers are only ever grown here.
+ * @param arr Pointer to the array.
+ * @param new_capacity New capacity; the caller has checked it for overflow.
+ * @return The new buffer, or NULL on allocation failure.
+ */
+static void* resize_buffer(dynarray_t* arr, size_t new_capacity) {
+    size_t new_bytes = new_capacity * arr->element_size;
+    if (arr->arena == NULL) { return realloc(arr->data, new_bytes); }
+    return arena_realloc(arr->arena, arr->data, arr->capacity * arr->element_size, new_bytes, ARENA_DEFAULT_ALIGN);
+}
+
 bool dynarray_init(dynarray_t* arr, size_t element_size, size_t initial_capacity) {
     if (arr == NULL || element_size == 0) { return false; }
 
@@ -80,10 +93,32 @@ bool dynarray_init(dynarray_t* arr, size_t element_size, size_t initial_capacity
     return true;
 }
 
+bool dynarray_init_arena(dynarray_t* arr, Arena* arena, size_t element_size, size_t initial_capacity) {
+    if (arr == NULL || arena == NULL || element_size == 0) { return false; }
+
+    if (initial_capacity == 0) { initial_capacity = DYNARRAY_INITIAL_CAPACITY; }
+
+    // Check for potential overflow
+    if (initial_capacity > SIZE_MAX / element_size) { return false; }
+
+    void* data = arena_alloc(arena, element_size * initial_capacity);
+    if (data == NULL) { return false; }
+
+    *arr = (dynarray_t){
+        .data = data,
+        .size = 0,
+        .capacity = initial_capacity,
+        .element_size = element_size,
+        .arena = arena,
+    };
+
+    return true;
+}
+
 void dynarray_free(dynarray_t* arr) {
     if (arr == NULL) { return; }
 
-    free(arr->data);
+    if (arr->arena == NULL) { free(arr->data); }
     *arr = (dynarray_t){0};  // Zero out the structure
 }
 
@@ -155,8 +190,9 @@ bool dynarray_pop(dynarray_t* arr, void* out_element) {
     // current allocation and we're shrinking, not growing. That makes
     // dynarray_reserve()'s NULL/overflow/clamp checks redundant on this
     // specific path, so we go straight to realloc() to avoid re-validating
-    // already-guaranteed invariants on every pop.
-    if (arr->capacity > DYNARRAY_INITIAL_CAPACITY && arr->size < arr->capacity / DYNARRAY_SHRINK_THRESHOLD) {
+    // already-guaranteed invariants on every pop. Arena buffers never shrink.
+    if (arr->arena == NULL && arr->capacity > DYNARRAY_INITIAL_CAPACITY &&
+        arr->size < arr->capacity / DYNARRAY_SHRINK_THRESHOLD) {
         size_t new_capacity = arr->capacity / DYNARRAY_GROWTH_DENOMINATOR;
         if (new_capacity < DYNARRAY_INITIAL_CAPACITY) { new_capacity = DYNARRAY_INITIAL_CAPACITY; }
 
@@ -201,10 +237,14 @@ bool dynarray_reserve(dynarray_t* arr, size_t new_capacity) {
     // No-op if already at desired capacity
     if (new_capacity == arr->capacity) { return true; }
 
+    // Arena buffers never shrink: the bytes could not be reused anyway, and keeping
+    // the full capacity lets a later grow stay in place.
+    if (arr->arena != NULL && new_capacity < arr->capacity) { return true; }
+
     // Check for overflow
     if (new_capacity > SIZE_MAX / arr->element_size) { return false; }
 
-    void* new_data = realloc(arr->data, new_capacity * arr->element_size);
+    void* new_data = resize_buffer(arr, new_capacity);
     if (new_data == NULL && new_capacity > 0) { return false; }
 
     arr->data = new_data;
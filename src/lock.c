@@ -6,10 +6,18 @@
 
 #include <errno.h>   // for errno constants
 #include <stdio.h>   // for fprintf, stderr
+#include <stdint.h>  // for uintptr_t
 #include <stdlib.h>  // for NULL
 #include <string.h>  // for strerror
 #include <time.h>    // for clock_gettime, timespec
 
+#ifdef __linux__
+#include <limits.h>       // for INT_MAX
+#include <linux/futex.h>  // for FUTEX_WAIT_PRIVATE, FUTEX_WAKE_PRIVATE
+#include <sys/syscall.h>  // for SYS_futex
+#include <unistd.h>       // for syscall
+#endif
+
 #ifdef _WIN32
 
 int lock_init(Lock* lock) {
@@ -127,6 +135,36 @@ int cond_free(Condition* condition) {
     return 0;
 }
 
+int futex_wait(atomic_uint* addr, unsigned int expected, int timeout_ms) {
+    if (addr == NULL) {
+        return -1;
+    }
+
+    DWORD timeout = (timeout_ms < 0) ? INFINITE : (DWORD)timeout_ms;
+    if (WaitOnAddress((volatile VOID*)addr, &expected, sizeof(expected), timeout)) {
+        return 0;
+    }
+    return -1;
+}
+
+int futex_wake_one(atomic_uint* addr) {
+    if (addr == NULL) {
+        return -1;
+    }
+
+    WakeByAddressSingle((PVOID)addr);
+    return 0;
+}
+
+int futex_wake_all(atomic_uint* addr) {
+    if (addr == NULL) {
+        return -1;
+    }
+
+    WakeByAddressAll((PVOID)addr);
+    return 0;
+}
+
 #else  // POSIX implementation
 
 int lock_init(Lock* lock) {
@@ -327,4 +365,119 @@ int cond_free(Condition* condition) {
     return 0;
 }
 
+#ifdef __linux__
+
+int futex_wait(atomic_uint* addr, unsigned int expected, int timeout_ms) {
+    if (addr == NULL) {
+        return -1;
+    }
+
+    struct timespec ts;
+    struct timespec* tsp = NULL;
+    if (timeout_ms >= 0) {
+        ts.tv_sec  = timeout_ms / 1000;
+        ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+        tsp        = &ts;
+    }
+
+    if (syscall(SYS_futex, (unsigned int*)addr, FUTEX_WAIT_PRIVATE, expected, tsp, NULL, 0) == 0) {
+        return 0;
+    }
+    switch (errno) {
+        case EAGAIN:  // *addr already differs from expected
+        case EINTR:
+            return 0;
+        case ETIMEDOUT:
+            return -1;
+        default:
+            fprintf(stderr, "futex wait failed: %s\n", strerror(errno));
+            return -1;
+    }
+}
+
+static int futex_wake(atomic_uint* addr, int count) {
+    if (addr == NULL) {
+        return -1;
+    }
+
+    if (syscall(SYS_futex, (unsigned int*)addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0) < 0) {
+        fprintf(stderr, "futex wake failed: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int futex_wake_one(atomic_uint* addr) {
+    return futex_wake(addr, 1);
+}
+
+int futex_wake_all(atomic_uint* addr) {
+    return futex_wake(addr, INT_MAX);
+}
+
+#else  // No futex: waiters sleep on a lock/condition pair chosen by address
+
+#define FUTEX_BUCKETS 64
+
+typedef struct {
+    Lock lock;
+    Condition cond;
+} FutexBucket;
+
+static FutexBucket futex_buckets[FUTEX_BUCKETS];
+static pthread_once_t futex_buckets_once = PTHREAD_ONCE_INIT;
+
+static void futex_buckets_init(void) {
+    for (size_t i = 0; i < FUTEX_BUCKETS; i++) {
+        lock_init(&futex_buckets[i].lock);
+        cond_init(&futex_buckets[i].cond);
+    }
+}
+
+static FutexBucket* futex_bucket(atomic_uint* addr) {
+    pthread_once(&futex_buckets_once, futex_buckets_init);
+    uintptr_t h = (uintptr_t)addr >> 2;
+    h ^= h >> 7;
+    return &futex_buckets[h % FUTEX_BUCKETS];
+}
+
+/*
+ * The word is re-read under the bucket lock, and wakers take the same lock
+ * after changing it, so a wake cannot slip in between the check and the
+ * sleep.  Buckets are shared by unrelated addresses, hence every wake is a
+ * broadcast and waiters must tolerate spurious returns.
+ */
+int futex_wait(atomic_uint* addr, unsigned int expected, int timeout_ms) {
+    if (addr == NULL) {
+        return -1;
+    }
+
+    FutexBucket* b = futex_bucket(addr);
+    int ret        = 0;
+    lock_acquire(&b->lock);
+    if (atomic_load_explicit(addr, memory_order_acquire) == expected) {
+        ret = cond_wait_timeout(&b->cond, &b->lock, timeout_ms);
+    }
+    lock_release(&b->lock);
+    return ret;
+}
+
+int futex_wake_one(atomic_uint* addr) {
+    return futex_wake_all(addr);
+}
+
+int futex_wake_all(atomic_uint* addr) {
+    if (addr == NULL) {
+        return -1;
+    }
+
+    FutexBucket* b = futex_bucket(addr);
+    lock_acquire(&b->lock);
+    int ret = cond_broadcast(&b->cond);
+    lock_release(&b->lock);
+    return ret;
+}
+
+#endif  // __linux__
+
 #endif
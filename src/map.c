@@ -102,6 +102,7 @@ typedef struct hash_map {
     KeyCmpFunction key_compare;    // Key comparison function
     KeyFreeFunction key_free;      // Key free function (optional)
     ValueFreeFunction value_free;  // Value free function (optional)
+    Arena* arena;                  // Backing arena, or NULL for the heap
     Lock lock;                     // Lock for thread safety
 } HashMap;
 
@@ -160,6 +161,17 @@ static inline size_t xxhash_wrapper(const void* key, size_t len) {
     return (size_t)xxhash(key, (size_t)len);
 }
 
+// Zeroed table allocation from the arena, or calloc when there is none
+static inline void* map_calloc(Arena* arena, size_t count, size_t size) {
+    if (arena) return arena_alloc_array_zero(arena, size, ARENA_DEFAULT_ALIGN, count);
+    return calloc(count, size);
+}
+
+// Arena memory is only reclaimed with the arena
+static inline void map_dealloc(Arena* arena, void* ptr) {
+    if (!arena) free(ptr);
+}
+
 // Map creation with better error handling and memory optimization
 HashMap* map_create(const MapConfig* config) {
     if (!config || !config->key_compare) {
@@ -178,19 +190,21 @@ HashMap* map_create(const MapConfig* config) {
                                 ? config->max_load_factor
                                 : DEFAULT_MAX_LOAD_FACTOR;
 
-    HashMap* m = (HashMap*)malloc(sizeof(HashMap));
+    Arena* arena = config->arena;
+    HashMap* m   = arena ? (HashMap*)arena_alloc_align(arena, sizeof(HashMap), alignof(HashMap))
+                         : (HashMap*)malloc(sizeof(HashMap));
     if (!m) {
         return NULL;
     }
 
     // Allocate interleaved keys and values for better cache locality
-    m->keys_values = (void**)calloc(capacity * 2, sizeof(void*));
-    m->deleted     = (size_t*)calloc(capacity, sizeof(size_t));
+    m->keys_values = (void**)map_calloc(arena, capacity * 2, sizeof(void*));
+    m->deleted     = (size_t*)map_calloc(arena, capacity, sizeof(size_t));
 
     if (!m->keys_values || !m->deleted) {
-        free(m->keys_values);
-        free(m->deleted);
-        free(m);
+        map_dealloc(arena, m->keys_values);
+        map_dealloc(arena, m->deleted);
+        map_dealloc(arena, m);
         return NULL;
     }
 
@@ -201,6 +215,7 @@ HashMap* map_create(const MapConfig* config) {
     m->key_compare     = config->key_compare;
     m->key_free        = config->key_free;
     m->value_free      = config->value_free;
+    m->arena           = arena;
 
     lock_init(&m->lock);
     return m;
@@ -222,12 +237,12 @@ static bool map_resize(HashMap* m, size_t new_capacity, size_t key_len) {
         return false;
     }
 
-    void** new_keys_values = (void**)calloc(new_capacity * 2, sizeof(void*));
-    size_t* new_deleted    = (size_t*)calloc(new_capacity, sizeof(size_t));
+    void** new_keys_values = (void**)map_calloc(m->arena, new_capacity * 2, sizeof(void*));
+    size_t* new_deleted    = (size_t*)map_calloc(m->arena, new_capacity, sizeof(size_t));
 
     if (!new_keys_values || !new_deleted) {
-        free(new_keys_values);
-        free(new_deleted);
+        map_dealloc(m->arena, new_keys_values);
+        map_dealloc(m->arena, new_deleted);
         return false;
     }
 
@@ -285,16 +300,16 @@ static bool map_resize(HashMap* m, size_t new_capacity, size_t key_len) {
 
     if (success) {
         // Free old arrays
-        free(old_keys_values);
-        free(old_deleted);
+        map_dealloc(m->arena, old_keys_values);
+        map_dealloc(m->arena, old_deleted);
     } else {
         // Restore original state on failure
         m->keys_values = old_keys_values;
         m->deleted     = old_deleted;
         m->capacity    = old_capacity;
         m->size        = old_size;
-        free(new_keys_values);
-        free(new_deleted);
+        map_dealloc(m->arena, new_keys_values);
+        map_dealloc(m->arena, new_deleted);
         return false;
     }
 
@@ -459,10 +474,10 @@ void map_destroy(HashMap* m) {
     }
 
 cleanup:
-    free(m->keys_values);
-    free(m->deleted);
+    map_dealloc(m->arena, m->keys_values);
+    map_dealloc(m->arena, m->deleted);
     lock_free(&m->lock);
-    free(m);
+    map_dealloc(m->arena, m);
 }
 
 map_iterator map_iter(HashMap* map) {
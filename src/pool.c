@@ -0,0 +1,265 @@
+#include "pool.h"
+#include "align.h"
+#include "macros.h"
+#include "spinlock.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h> /* memset */
+
+/* -------------------------------------------------------------------------
+ * Tuning constants
+ * ---------------------------------------------------------------------- */
+
+#define POOL_THREAD_SLOTS  32          /* per-thread magazine sets per pool; power of 2 */
+#define POOL_REFILL_BYTES  (16 * 1024) /* bytes carved from the arena per class refill */
+#define POOL_OBJECT_ALIGN  16
+#define POOL_SMALL_CLASSES 8 /* 16-byte classes up to 128 */
+
+/* -------------------------------------------------------------------------
+ * Core types
+ * ---------------------------------------------------------------------- */
+
+/** A fixed-capacity stack of free objects of one class. */
+typedef struct PoolMagazine {
+    struct PoolMagazine* next; /* depot list link */
+    uint32_t count;
+    void* rounds[POOL_MAGAZINE_SIZE];
+} PoolMagazine;
+
+/**
+ * Magazines of the threads mapped to one slot.  The lock is almost always
+ * uncontended: a thread keeps its slot for life, and slots are only shared
+ * once more than POOL_THREAD_SLOTS threads use the pool.
+ */
+typedef struct ALIGN(64) {
+    fast_rwlock_t lock; /* write-locked only */
+    PoolMagazine* loaded[POOL_CLASS_COUNT];
+    PoolMagazine* previous[POOL_CLASS_COUNT];
+} PoolThreadCache;
+
+/** Per-class exchange of whole magazines between threads. */
+typedef struct ALIGN(64) {
+    fast_rwlock_t lock; /* write-locked only */
+    PoolMagazine* full;
+    PoolMagazine* empty;
+} PoolDepot;
+
+struct ArenaPool {
+    PoolThreadCache threads[POOL_THREAD_SLOTS];
+    PoolDepot depots[POOL_CLASS_COUNT];
+    fast_rwlock_t arena_lock; /* serialises every call into the arena */
+    Arena* arena;
+};
+
+static _Atomic uint32_t g_pool_next_slot;
+static THREAD_LOCAL uint32_t tl_pool_slot = UINT32_MAX;
+
+/* -------------------------------------------------------------------------
+ * Internal helpers
+ * ---------------------------------------------------------------------- */
+
+static inline unsigned floor_log2(size_t n) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse64(&idx, (unsigned long long)n);
+    return (unsigned)idx;
+#else
+    return (unsigned)(sizeof(unsigned long long) * 8 - 1 - (unsigned)__builtin_clzll((unsigned long long)n));
+#endif
+}
+
+/** Size class of a request in [1, POOL_MAX_SIZE]. */
+static inline unsigned pool_class_of(size_t size) {
+    if (size <= 128) return (unsigned)((size + 15) / 16 - 1);
+    unsigned lg = floor_log2(size - 1); /* 7 .. 11 */
+    unsigned quarter = (unsigned)((size - 1 - ((size_t)1 << lg)) >> (lg - 2));
+    return POOL_SMALL_CLASSES + (lg - 7) * 4 + quarter;
+}
+
+/** Object size of a class. */
+static inline size_t pool_class_bytes(unsigned c) {
+    if (c < POOL_SMALL_CLASSES) return (size_t)(c + 1) * 16;
+    unsigned k = c - POOL_SMALL_CLASSES;
+    unsigned lg = 7 + k / 4;
+    return ((size_t)1 << lg) + (size_t)(k % 4 + 1) * ((size_t)1 << (lg - 2));
+}
+
+/** The calling thread's magazine set. */
+static inline PoolThreadCache* pool_thread_cache(ArenaPool* pool) {
+    uint32_t idx = tl_pool_slot;
+    if (ARENA_UNLIKELY(idx == UINT32_MAX)) {
+        idx = atomic_fetch_add_explicit(&g_pool_next_slot, 1, memory_order_relaxed) & (POOL_THREAD_SLOTS - 1);
+        tl_pool_slot = idx;
+    }
+    return &pool->threads[idx];
+}
+
+/** Allocates from the arena under the pool's arena lock. */
+static void* pool_arena_alloc(ArenaPool* pool, size_t size, size_t alignment) {
+    fast_rwlock_wrlock(&pool->arena_lock);
+    void* p = arena_alloc_align(pool->arena, size, alignment);
+    fast_rwlock_unlock_wr(&pool->arena_lock);
+    return p;
+}
+
+/**
+ * Trades an empty (or missing) magazine for one with free objects: a full
+ * one from the depot if there is one, else a batch freshly carved from the
+ * arena.  Returns NULL only when the arena is exhausted and no magazine
+ * could be had at all; the result may still be empty.
+ */
+static PoolMagazine* pool_refill(ArenaPool* pool, unsigned c, PoolMagazine* empty) {
+    PoolDepot* d = &pool->depots[c];
+
+    fast_rwlock_wrlock(&d->lock);
+    PoolMagazine* full = d->full;
+    if (full) {
+        d->full = full->next;
+        if (empty) {
+            empty->next = d->empty;
+            d->empty = empty;
+        }
+        fast_rwlock_unlock_wr(&d->lock);
+        return full;
+    }
+    if (!empty && d->empty) {
+        empty = d->empty;
+        d->empty = empty->next;
+    }
+    fast_rwlock_unlock_wr(&d->lock);
+
+    if (!empty) {
+        empty = (PoolMagazine*)pool_arena_alloc(pool, sizeof(PoolMagazine), 64);
+        if (!empty) return NULL;
+        empty->count = 0;
+    }
+
+    size_t bytes = pool_class_bytes(c);
+    size_t batch = POOL_REFILL_BYTES / bytes;
+    if (batch > POOL_MAGAZINE_SIZE) batch = POOL_MAGAZINE_SIZE;
+    if (batch == 0) batch = 1;
+
+    char* run = (char*)pool_arena_alloc(pool, bytes * batch, POOL_OBJECT_ALIGN);
+    if (!run) return empty;
+
+    /* Hand out the run front to back: rounds pop from the top. */
+    for (size_t i = 0; i < batch; i++) empty->rounds[i] = run + (batch - 1 - i) * bytes;
+    empty->count = (uint32_t)batch;
+    return empty;
+}
+
+/**
+ * Trades a full magazine for an empty one from the depot (or a new one
+ * from the arena).  Returns NULL when no empty magazine can be had, in
+ * which case @p full stays with the caller.
+ */
+static PoolMagazine* pool_exchange_full(ArenaPool* pool, unsigned c, PoolMagazine* full) {
+    PoolDepot* d = &pool->depots[c];
+
+    fast_rwlock_wrlock(&d->lock);
+    PoolMagazine* empty = d->empty;
+    if (empty) d->empty = empty->next;
+    fast_rwlock_unlock_wr(&d->lock);
+
+    if (!empty) {
+        empty = (PoolMagazine*)pool_arena_alloc(pool, sizeof(PoolMagazine), 64);
+        if (!empty) return NULL;
+    }
+    empty->count = 0;
+
+    if (full) {
+        fast_rwlock_wrlock(&d->lock);
+        full->next = d->full;
+        d->full = full;
+        fast_rwlock_unlock_wr(&d->lock);
+    }
+    return empty;
+}
+
+/* -------------------------------------------------------------------------
+ * Public API
+ * ---------------------------------------------------------------------- */
+
+ArenaPool* pool_create(Arena* arena) {
+    if (!arena) return NULL;
+
+    ArenaPool* pool = (ArenaPool*)arena_alloc_align(arena, sizeof(ArenaPool), 64);
+    if (!pool) return NULL;
+    memset(pool, 0, sizeof(ArenaPool));
+
+    for (size_t i = 0; i < POOL_THREAD_SLOTS; i++) fast_rwlock_init(&pool->threads[i].lock);
+    for (size_t c = 0; c < POOL_CLASS_COUNT; c++) fast_rwlock_init(&pool->depots[c].lock);
+    fast_rwlock_init(&pool->arena_lock);
+    pool->arena = arena;
+    return pool;
+}
+
+void* pool_alloc(ArenaPool* pool, size_t size) {
+    if (ARENA_UNLIKELY(!pool || size == 0)) return NULL;
+    if (ARENA_UNLIKELY(size > POOL_MAX_SIZE)) return pool_arena_alloc(pool, size, POOL_OBJECT_ALIGN);
+
+    unsigned c = pool_class_of(size);
+    PoolThreadCache* tc = pool_thread_cache(pool);
+
+    fast_rwlock_wrlock(&tc->lock);
+    PoolMagazine* m = tc->loaded[c];
+    if (ARENA_UNLIKELY(!m || m->count == 0)) {
+        PoolMagazine* prev = tc->previous[c];
+        if (prev && prev->count) {
+            /* Swapping the two magazines keeps alloc/free churn at a boundary off the depot. */
+            tc->previous[c] = m;
+            m = prev;
+        } else {
+            m = pool_refill(pool, c, m);
+        }
+        tc->loaded[c] = m;
+        if (ARENA_UNLIKELY(!m || m->count == 0)) {
+            fast_rwlock_unlock_wr(&tc->lock);
+            return NULL;
+        }
+    }
+    void* p = m->rounds[--m->count];
+    fast_rwlock_unlock_wr(&tc->lock);
+    return p;
+}
+
+void* pool_alloc_zero(ArenaPool* pool, size_t size) {
+    void* p = pool_alloc(pool, size);
+    if (p) memset(p, 0, size);
+    return p;
+}
+
+void pool_free(ArenaPool* pool, void* ptr, size_t size) {
+    if (ARENA_UNLIKELY(!pool || !ptr || size == 0)) return;
+    if (ARENA_UNLIKELY(size > POOL_MAX_SIZE)) return; /* reclaimed with the arena */
+
+    unsigned c = pool_class_of(size);
+    PoolThreadCache* tc = pool_thread_cache(pool);
+
+    fast_rwlock_wrlock(&tc->lock);
+    PoolMagazine* m = tc->loaded[c];
+    if (ARENA_UNLIKELY(!m || m->count == POOL_MAGAZINE_SIZE)) {
+        PoolMagazine* prev = tc->previous[c];
+        if (prev && prev->count < POOL_MAGAZINE_SIZE) {
+            tc->previous[c] = m;
+            m = prev;
+        } else {
+            PoolMagazine* empty = pool_exchange_full(pool, c, m);
+            if (ARENA_UNLIKELY(!empty)) {
+                /* No magazine to hold it: the object stays in the arena until reset. */
+                fast_rwlock_unlock_wr(&tc->lock);
+                return;
+            }
+            m = empty;
+        }
+        tc->loaded[c] = m;
+    }
+    m->rounds[m->count++] = ptr;
+    fast_rwlock_unlock_wr(&tc->lock);
+}
+
+size_t pool_size_class(size_t size) {
+    if (size == 0 || size > POOL_MAX_SIZE) return size;
+    return pool_class_bytes(pool_class_of(size));
+}
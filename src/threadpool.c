@@ -6,13 +6,17 @@
 
 #include "../include/align.h"
 #include "../include/aligned_alloc.h"
+#include "../include/arena.h"
 #include "../include/lock.h"
+#include "../include/pool.h"
 #include "../include/thread.h"
 
 #include <stdatomic.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #ifdef _WIN32
@@ -75,6 +79,39 @@
  *          This reduces submission mutex acquisitions from O(N) to
  *          O(N / GLOBAL_Q_SIZE) — a 16384× reduction for large workloads.
  *
+ * Perf #5: Even batched, every external submit and every worker drain took
+ *          gq_mutex, so with many producer threads (network I/O threads
+ *          submitting one request each) the mutex saturated long before the
+ *          workers did, and producers blocked on a full queue woke through
+ *          not_full condvar broadcasts on every drain.
+ *          Fix: the GlobalQueue is a bounded lock-free MPMC ring (Vyukov)
+ *          with a sequence number per slot.  Batches claim a whole run of
+ *          ready slots with one CAS on either side.  Producers that find
+ *          the ring full sleep on an event count, which costs consumers one
+ *          load when nobody is waiting.
+ *
+ * Bug  #4: Idle detection counted a task as active only once a worker had
+ *          popped it and incremented num_active.  A worker that had just
+ *          drained a batch from the global queue, but not yet pushed the
+ *          extras into its deque, made every queue look empty with
+ *          num_active == 0; threadpool_destroy() then shut down and the
+ *          extras were never run.
+ *          Fix: num_pending counts tasks from submission until their
+ *          function returns, so there is no window in which a task is in
+ *          neither a queue nor the count.
+ *
+ * Perf #6: All parked workers slept on one work_available condvar behind
+ *          park_lock, so every wakeup from a busy submitter serialised on
+ *          that mutex and woke whichever waiter the condvar picked.  The
+ *          num_parked fast path was a relaxed load racing the parker's
+ *          re-check, which could lose a wakeup, and threadpool_destroy()
+ *          spun with sched_yield() until every worker had left its loop.
+ *          Fix: each worker parks on its own futex word (futex_wait() from
+ *          lock.h).  unpark_one() claims one specific sleeper with a CAS and
+ *          wakes only it; a fence on each side closes the lost-wakeup window.
+ *          A worker that pulls a batch from the global queue wakes a
+ *          neighbour for the extras, and destroy simply joins the workers.
+ *
  * ============================================================================
  * DESIGN
  * ============================================================================
@@ -90,14 +127,25 @@
  *   [ tN | ... | t1 | t0 ]
  *                    <─── top
  *
- * External submitters push to a GlobalQueue (single mutex).
+ * External submitters push to a GlobalQueue (lock-free MPMC ring).
  * Workers drain it in batches during their steal scan.
  *
+ * TaskGroups (fork-join) reuse the same queues: a Task carries an optional
+ * group whose pending count is dropped when it finishes.  tg_wait() runs
+ * queued tasks until the count reaches zero, so a worker waiting on its
+ * children pops them straight back off its own deque.
+ *
+ * Futures are ordinary tasks too.  A continuation is submitted by whoever
+ * completes its parent, so on a worker it goes to that worker's deque and
+ * is popped next, while the parent's result is still in cache.
+ *
  * MEMORY ORDERS
  *   deque_push_bottom:  task[b]=relaxed, bottom=release
  *   deque_pop_bottom:   early-exit if b==t (no atomics); else bottom=seq_cst,
  *                       top=seq_cst, last-item CAS=seq_cst
  *   deque_steal_top:    top=acquire, bottom=acquire, CAS=seq_cst
+ *   GlobalQueue slot:   seq=acquire before use, seq=release after; the
+ *                       position CAS only arbitrates and is relaxed
  * ============================================================================
  */
 
@@ -112,9 +160,16 @@
 
 #define CACHE_LINE_SIZE 64
 #define YIELD_THRESHOLD 8
+#define TG_SLEEP_MS     1 /* tg_wait re-scans for work at least this often while asleep */
+#define PF_AUTO_SPLITS  64 /* grain 0: aim for this many grains per worker */
 
 #define CACHE_ALIGNED ALIGN(CACHE_LINE_SIZE)
 
+/* worker.park_state */
+#define PARK_RUNNING  0u
+#define PARK_SLEEPING 1u /* asleep or about to be; unpark_one() may claim it */
+#define PARK_NOTIFIED 2u /* claimed by a waker; the worker is on its way back */
+
 typedef enum { STEAL_SUCCESS, STEAL_EMPTY, STEAL_ABORT } StealResult;
 
 /* ── Chase-Lev private deque ─────────────────────────────────────────────── */
@@ -124,13 +179,29 @@ typedef struct {
     CACHE_ALIGNED Task tasks[DEQUE_SIZE];
 } WorkStealDeque;
 
+/* ── Event count ─────────────────────────────────────────────────────────── */
+typedef struct {
+    atomic_uint epoch;   /* bumped by every notify that finds waiters; the futex word */
+    atomic_uint waiters; /* threads between ec_prepare_wait and the end of their wait */
+} EventCount;
+
 /* ── Global submission queue ─────────────────────────────────────────────── */
+
+/*
+ * Slot `i` is free for the producer claiming position p when seq == p, and
+ * holds a task for the consumer claiming position p when seq == p + 1; the
+ * consumer hands it to the next lap by storing p + GLOBAL_Q_SIZE.
+ */
 typedef struct {
-    CACHE_ALIGNED Lock mutex;
-    CACHE_ALIGNED atomic_uint head;
-    CACHE_ALIGNED atomic_uint tail;
-    CACHE_ALIGNED Task tasks[GLOBAL_Q_SIZE];
-    Condition not_full;
+    atomic_size_t seq;
+    Task task;
+} GqSlot;
+
+typedef struct {
+    CACHE_ALIGNED atomic_size_t enqueue_pos;
+    CACHE_ALIGNED atomic_size_t dequeue_pos;
+    CACHE_ALIGNED GqSlot slots[GLOBAL_Q_SIZE];
+    EventCount not_full;
     struct Threadpool* pool;
 } GlobalQueue;
 
@@ -140,12 +211,12 @@ typedef struct worker {
     CACHE_ALIGNED Thread pthread;
     CACHE_ALIGNED size_t index;
     struct Threadpool* pool;
+    CACHE_ALIGNED atomic_uint park_state; /* PARK_*; the futex word this worker sleeps on */
 } worker;
 
 /* ── Threadpool ──────────────────────────────────────────────────────────── */
 struct Threadpool {
     CACHE_ALIGNED atomic_int shutdown;
-    CACHE_ALIGNED atomic_int num_threads_alive;
 
     CACHE_ALIGNED worker** workers;
     CACHE_ALIGNED size_t num_workers;
@@ -155,144 +226,219 @@ struct Threadpool {
 
     CACHE_ALIGNED GlobalQueue gq;
 
-    /* Parking */
-    CACHE_ALIGNED Lock park_lock;
-    CACHE_ALIGNED atomic_int num_parked;
-    Condition work_available;
+    /* Parking — see Perf #6 fix. */
+    CACHE_ALIGNED atomic_uint num_parked; /* workers between worker_park() entry and exit */
 
-    /* Idle detection */
+    /* Idle detection — see Bug #4 fix. */
     CACHE_ALIGNED Lock idle_lock;
-    CACHE_ALIGNED atomic_int num_active;
+    CACHE_ALIGNED atomic_size_t num_pending; /* submitted and not yet finished */
     Condition all_idle;
+
+    /* tg_wait callers asleep on group_done (guarded by idle_lock). */
+    CACHE_ALIGNED atomic_int num_tg_sleepers;
+    Condition group_done;
+
+    /* Futures and their links are recycled here, created on first use; see Futures below. */
+    Arena* future_arena;
+    _Atomic(ArenaPool*) future_pool;
 };
 
-/* TLS: SIZE_MAX = external thread; anything else = worker index. */
+/* TLS: SIZE_MAX = external thread; anything else = worker index in tls_pool. */
 static _Thread_local size_t tls_worker_index = SIZE_MAX;
+static _Thread_local Threadpool* tls_pool = NULL;
+
+/* The calling thread's worker in `pool`, or NULL for any other thread. */
+static inline worker* current_worker(Threadpool* pool) {
+    return tls_pool == pool ? pool->workers[tls_worker_index] : NULL;
+}
+
+/* ============================================================================
+ * Event count
+ * ============================================================================
+ *
+ * A condition variable without the mutex.  A waiter announces itself, reads
+ * the epoch, re-checks its condition and only then sleeps on the epoch; a
+ * notifier changes the condition and bumps the epoch only if someone has
+ * announced.  The two seq_cst fences make sure that either the waiter sees
+ * the new condition or the notifier sees the waiter, so no wakeup is lost,
+ * and a notify with no waiters is a fence plus one load.
+ *
+ *   key = ec_prepare_wait(ec);
+ *   if (condition_holds()) ec_cancel_wait(ec);
+ *   else                   ec_wait(ec, key);
+ *
+ * Waiters sleep on the epoch with futex_wait() from lock.h.
+ */
+
+static void ec_init(EventCount* ec) {
+    atomic_store_explicit(&ec->epoch, 0, memory_order_relaxed);
+    atomic_store_explicit(&ec->waiters, 0, memory_order_relaxed);
+}
+
+static inline unsigned ec_prepare_wait(EventCount* ec) {
+    atomic_fetch_add_explicit(&ec->waiters, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    return atomic_load_explicit(&ec->epoch, memory_order_acquire);
+}
+
+static inline void ec_cancel_wait(EventCount* ec) {
+    atomic_fetch_sub_explicit(&ec->waiters, 1, memory_order_relaxed);
+}
+
+/* Sleeps until a notify after ec_prepare_wait() returned `key`.  May wake spuriously. */
+static void ec_wait(EventCount* ec, unsigned key) {
+    futex_wait(&ec->epoch, key, -1);
+    atomic_fetch_sub_explicit(&ec->waiters, 1, memory_order_relaxed);
+}
+
+static inline void ec_notify_all(EventCount* ec) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&ec->waiters, memory_order_relaxed) == 0) return;
+    atomic_fetch_add_explicit(&ec->epoch, 1, memory_order_release);
+    futex_wake_all(&ec->epoch);
+}
 
 /* ============================================================================
  * Global queue
  * ============================================================================ */
 
 static void gq_init(GlobalQueue* gq, struct Threadpool* pool) {
-    lock_init(&gq->mutex);
-    cond_init(&gq->not_full);
-    atomic_store_explicit(&gq->head, 0, memory_order_relaxed);
-    atomic_store_explicit(&gq->tail, 0, memory_order_relaxed);
+    for (size_t i = 0; i < GLOBAL_Q_SIZE; i++) {
+        atomic_store_explicit(&gq->slots[i].seq, i, memory_order_relaxed);
+    }
+    atomic_store_explicit(&gq->enqueue_pos, 0, memory_order_relaxed);
+    atomic_store_explicit(&gq->dequeue_pos, 0, memory_order_relaxed);
+    ec_init(&gq->not_full);
     gq->pool = pool;
 }
 
-static void gq_destroy(GlobalQueue* gq) {
-    lock_free(&gq->mutex);
-    cond_free(&gq->not_full);
+/*
+ * True if no task is queued.  A producer that has claimed a slot but not yet
+ * filled it already counts as queued, which is what the parking checks want.
+ */
+static inline bool gq_empty(GlobalQueue* gq) {
+    return atomic_load_explicit(&gq->dequeue_pos, memory_order_acquire) ==
+           atomic_load_explicit(&gq->enqueue_pos, memory_order_acquire);
 }
 
-/* Push one task. Blocks if full (only happens if all 16384 slots are in-flight). */
-static bool gq_push(GlobalQueue* gq, Task task) {
-    lock_acquire(&gq->mutex);
+static inline bool gq_full(GlobalQueue* gq) {
+    size_t pos = atomic_load_explicit(&gq->enqueue_pos, memory_order_relaxed);
+    size_t seq = atomic_load_explicit(&gq->slots[pos & GLOBAL_Q_MASK].seq, memory_order_acquire);
+    return (ptrdiff_t)(seq - pos) < 0;
+}
 
-    while (((atomic_load_explicit(&gq->head, memory_order_relaxed) + 1) & GLOBAL_Q_MASK) ==
-           atomic_load_explicit(&gq->tail, memory_order_relaxed)) {
-        if (atomic_load_explicit(&gq->pool->shutdown, memory_order_acquire)) {
-            lock_release(&gq->mutex);
-            return false;
+/*
+ * gq_try_push — enqueue up to `count` tasks without blocking.
+ *
+ * Scans the run of free slots from enqueue_pos and claims all of them with
+ * one CAS.  Free slots cannot be taken by anyone but the winner of that CAS,
+ * so the scan stays valid until it either succeeds or the position moves.
+ *
+ * Returns the number of tasks enqueued; 0 means the ring is full.
+ */
+static size_t gq_try_push(GlobalQueue* gq, const Task* tasks, size_t count) {
+    size_t pos = atomic_load_explicit(&gq->enqueue_pos, memory_order_relaxed);
+
+    for (;;) {
+        size_t n = 0;
+        while (n < count && n < GLOBAL_Q_SIZE) {
+            size_t seq = atomic_load_explicit(&gq->slots[(pos + n) & GLOBAL_Q_MASK].seq, memory_order_acquire);
+            if (seq != pos + n) break;
+            n++;
         }
-        cond_wait(&gq->not_full, &gq->mutex);
-    }
 
-    uint32_t h   = atomic_load_explicit(&gq->head, memory_order_relaxed);
-    gq->tasks[h] = task;
-    atomic_store_explicit(&gq->head, (h + 1) & GLOBAL_Q_MASK, memory_order_release);
-    lock_release(&gq->mutex);
-    return true;
+        if (n == 0) {
+            size_t seq = atomic_load_explicit(&gq->slots[pos & GLOBAL_Q_MASK].seq, memory_order_acquire);
+            if ((ptrdiff_t)(seq - pos) < 0) return 0; /* still holds last lap's task */
+            pos = atomic_load_explicit(&gq->enqueue_pos, memory_order_relaxed);
+            continue;
+        }
+
+        if (atomic_compare_exchange_weak_explicit(&gq->enqueue_pos, &pos, pos + n, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            for (size_t i = 0; i < n; i++) {
+                GqSlot* slot = &gq->slots[(pos + i) & GLOBAL_Q_MASK];
+                slot->task   = tasks[i];
+                atomic_store_explicit(&slot->seq, pos + i + 1, memory_order_release);
+            }
+            return n;
+        }
+        /* Lost the race: pos now holds the current position. */
+    }
 }
 
 /*
- * gq_push_batch — push up to `count` tasks in one mutex acquisition.
- *
- * Perf #4 fix: the single-task gq_push pays the full mutex round-trip for
- * every task.  With 10M external submissions that is 10M lock acquisitions.
- *
- * Here we hold the lock for the entire write of min(count, free_slots) tasks,
- * releasing only when the queue is full (at which point we wait on not_full
- * and continue from where we left off).  The caller sees a single logical
- * operation even if it internally flushes in multiple chunks.
+ * gq_push_batch — enqueue `count` tasks, sleeping while the ring is full.
  *
- * Returns the number of tasks successfully pushed (== count unless shutdown).
+ * Returns the number of tasks pushed (== count unless the pool shuts down).
  */
-static size_t gq_push_batch(GlobalQueue* gq, Task* tasks, size_t count) {
+static size_t gq_push_batch(GlobalQueue* gq, const Task* tasks, size_t count) {
     size_t pushed = 0;
 
     while (pushed < count) {
-        lock_acquire(&gq->mutex);
-
-        /* Wait while full. */
-        while (((atomic_load_explicit(&gq->head, memory_order_relaxed) + 1) & GLOBAL_Q_MASK) ==
-               atomic_load_explicit(&gq->tail, memory_order_relaxed)) {
-            if (atomic_load_explicit(&gq->pool->shutdown, memory_order_acquire)) {
-                lock_release(&gq->mutex);
-                return pushed;
-            }
-            cond_wait(&gq->not_full, &gq->mutex);
+        size_t n = gq_try_push(gq, tasks + pushed, count - pushed);
+        if (n) {
+            pushed += n;
+            continue;
         }
+        if (atomic_load_explicit(&gq->pool->shutdown, memory_order_acquire)) break;
 
-        /*
-         * Write as many tasks as fit without releasing the lock.
-         * free_slots = GLOBAL_Q_SIZE - 1 - current occupancy (one slot
-         * wasted as the full/empty sentinel).
-         */
-        uint32_t h  = atomic_load_explicit(&gq->head, memory_order_relaxed);
-        uint32_t t  = atomic_load_explicit(&gq->tail, memory_order_relaxed);
-        size_t free = (GLOBAL_Q_SIZE - 1) - ((h - t) & GLOBAL_Q_MASK);
-        size_t todo = count - pushed;
-        size_t n    = todo < free ? todo : free;
-
-        for (size_t i = 0; i < n; i++) {
-            gq->tasks[(h + i) & GLOBAL_Q_MASK] = tasks[pushed + i];
+        unsigned key = ec_prepare_wait(&gq->not_full);
+        if (gq_full(gq) && !atomic_load_explicit(&gq->pool->shutdown, memory_order_acquire)) {
+            ec_wait(&gq->not_full, key);
+        } else {
+            ec_cancel_wait(&gq->not_full);
         }
-        atomic_store_explicit(&gq->head, (h + (uint32_t)n) & GLOBAL_Q_MASK, memory_order_release);
-        pushed += n;
-
-        lock_release(&gq->mutex);
     }
-
     return pushed;
 }
 
+static bool gq_push(GlobalQueue* gq, Task task) {
+    return gq_push_batch(gq, &task, 1) == 1;
+}
+
 /*
- * gq_pull_batch — pull up to `max` tasks in one mutex acquisition.
- *
- * Perf #1 fix: the previous version pulled only 1 task per call.  With N
- * workers all hitting the global queue, that was N mutex acquisitions per
- * N tasks — every task paid the full lock round-trip.
+ * gq_pull_batch — dequeue up to `max` tasks with one CAS.
  *
- * Now we pull min(available, max) tasks at once.  The caller pushes the
- * extras into its own private deque so subsequent iterations are lock-free.
+ * Mirror image of gq_try_push: scan the run of filled slots from
+ * dequeue_pos, claim them together, copy the tasks out and release the
+ * slots to the next lap.
  *
- * Returns the number of tasks pulled (0 = empty, -1 = shutdown).
+ * Returns the number of tasks pulled (0 = empty, -1 = empty and shutdown).
  */
 static int gq_pull_batch(GlobalQueue* gq, Task* out, size_t max) {
-    lock_acquire(&gq->mutex);
+    size_t pos = atomic_load_explicit(&gq->dequeue_pos, memory_order_relaxed);
 
-    uint32_t h = atomic_load_explicit(&gq->head, memory_order_relaxed);
-    uint32_t t = atomic_load_explicit(&gq->tail, memory_order_relaxed);
-
-    if (h == t) {
-        lock_release(&gq->mutex);
-        return atomic_load_explicit(&gq->pool->shutdown, memory_order_acquire) ? -1 : 0;
-    }
+    for (;;) {
+        size_t n = 0;
+        while (n < max) {
+            size_t seq = atomic_load_explicit(&gq->slots[(pos + n) & GLOBAL_Q_MASK].seq, memory_order_acquire);
+            if (seq != pos + n + 1) break;
+            n++;
+        }
 
-    size_t available = (h - t) & GLOBAL_Q_MASK;
-    size_t to_take   = available < max ? available : max;
+        if (n == 0) {
+            size_t seq = atomic_load_explicit(&gq->slots[pos & GLOBAL_Q_MASK].seq, memory_order_acquire);
+            if ((ptrdiff_t)(seq - (pos + 1)) < 0) {
+                /* Empty (or the next slot is claimed but not yet filled). */
+                return atomic_load_explicit(&gq->pool->shutdown, memory_order_acquire) ? -1 : 0;
+            }
+            pos = atomic_load_explicit(&gq->dequeue_pos, memory_order_relaxed);
+            continue;
+        }
 
-    for (size_t i = 0; i < to_take; i++) {
-        out[i] = gq->tasks[(t + i) & GLOBAL_Q_MASK];
+        if (atomic_compare_exchange_weak_explicit(&gq->dequeue_pos, &pos, pos + n, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            for (size_t i = 0; i < n; i++) {
+                GqSlot* slot = &gq->slots[(pos + i) & GLOBAL_Q_MASK];
+                out[i]       = slot->task;
+                atomic_store_explicit(&slot->seq, pos + i + GLOBAL_Q_SIZE, memory_order_release);
+            }
+            /* Wake producers blocked on a full ring; one load when there are none. */
+            ec_notify_all(&gq->not_full);
+            return (int)n;
+        }
     }
-    atomic_store_explicit(&gq->tail, (t + (uint32_t)to_take) & GLOBAL_Q_MASK, memory_order_release);
-
-    /* Signal any blocked producers now that slots are free. */
-    cond_broadcast(&gq->not_full);
-    lock_release(&gq->mutex);
-    return (int)to_take;
 }
 
 /* ============================================================================
@@ -385,51 +531,116 @@ static StealResult deque_steal_top(WorkStealDeque* dq, Task* out) {
 }
 
 /* ============================================================================
- * Parking
+ * Task accounting
  * ============================================================================ */
 
-static void worker_park(Threadpool* pool) {
-    atomic_fetch_add_explicit(&pool->num_parked, 1, memory_order_relaxed);
-    lock_acquire(&pool->park_lock);
+/* Retires `n` pending tasks; the last one out wakes threadpool_wait(). */
+static void pending_done(Threadpool* pool, size_t n) {
+    if (n && atomic_fetch_sub_explicit(&pool->num_pending, n, memory_order_acq_rel) == n) {
+        lock_acquire(&pool->idle_lock);
+        cond_broadcast(&pool->all_idle);
+        lock_release(&pool->idle_lock);
+    }
+}
 
-    /*
-     * Re-check under lock: work or shutdown could have arrived between our
-     * decision to park and acquiring park_lock.  The signal would have been
-     * sent before we could receive it.  Skipping cond_wait here avoids
-     * sleeping on a non-empty queue (lost-wakeup prevention).
-     */
-    bool all_empty = true;
-    {
-        uint32_t h = atomic_load_explicit(&pool->gq.head, memory_order_acquire);
-        uint32_t t = atomic_load_explicit(&pool->gq.tail, memory_order_acquire);
-        if (h != t) all_empty = false;
+/*
+ * Retires one task of `tg`.  The group usually lives on the waiter's stack
+ * and may be gone as soon as pending reads zero, so nothing in it is touched
+ * after the decrement.  seq_cst pairs with the sleeper registration in
+ * tg_wait(): either the waiter sees pending == 0 or we see it asleep.
+ */
+static void group_done(Threadpool* pool, TaskGroup* tg) {
+    if (atomic_fetch_sub_explicit(&tg->pending, 1, memory_order_seq_cst) == 1 &&
+        atomic_load_explicit(&pool->num_tg_sleepers, memory_order_seq_cst) > 0) {
+        lock_acquire(&pool->idle_lock);
+        cond_broadcast(&pool->group_done);
+        lock_release(&pool->idle_lock);
     }
-    for (size_t i = 0; i < pool->num_workers && all_empty; i++) {
+}
+
+static inline void task_run(Threadpool* pool, const Task* task) {
+    task->function(task->arg);
+    if (task->group) group_done(pool, task->group);
+    pending_done(pool, 1);
+}
+
+/* ============================================================================
+ * Parking
+ * ============================================================================ */
+
+/*
+ * Each worker sleeps on its own park_state word, so waking one worker touches
+ * that worker's cache line only and nothing is serialised on a shared lock.
+ *
+ * Parking and waking form a Dekker pair.  The parker publishes SLEEPING and
+ * bumps num_parked, fences, then re-checks the queues; the waker publishes
+ * work, fences, then loads num_parked.  Either the parker sees the work and
+ * stays up, or the waker sees the parker and claims it by CAS
+ * SLEEPING -> NOTIFIED before the futex wake.  The CAS hands each wakeup to
+ * exactly one worker, and a worker that already gave up on sleeping simply
+ * fails it, so the waker moves on to the next one.
+ */
+
+/* True if any deque or the global queue holds a task. */
+static bool pool_has_queued_work(Threadpool* pool) {
+    if (!gq_empty(&pool->gq)) return true;
+    for (size_t i = 0; i < pool->num_workers; i++) {
         size_t b = atomic_load_explicit(&pool->workers[i]->deque.bottom, memory_order_acquire);
         size_t t = atomic_load_explicit(&pool->workers[i]->deque.top, memory_order_acquire);
-        if ((ptrdiff_t)(b - t) > 0) all_empty = false;
+        if ((ptrdiff_t)(b - t) > 0) return true;
     }
+    return false;
+}
+
+static void worker_park(worker* self) {
+    Threadpool* pool = self->pool;
 
-    if (all_empty && !atomic_load_explicit(&pool->shutdown, memory_order_acquire)) {
-        cond_wait(&pool->work_available, &pool->park_lock);
+    atomic_store_explicit(&self->park_state, PARK_SLEEPING, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool->num_parked, 1, memory_order_release);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (!pool_has_queued_work(pool) && !atomic_load_explicit(&pool->shutdown, memory_order_acquire)) {
+        while (atomic_load_explicit(&self->park_state, memory_order_acquire) == PARK_SLEEPING) {
+            futex_wait(&self->park_state, PARK_SLEEPING, -1);
+        }
     }
 
-    lock_release(&pool->park_lock);
+    atomic_store_explicit(&self->park_state, PARK_RUNNING, memory_order_relaxed);
     atomic_fetch_sub_explicit(&pool->num_parked, 1, memory_order_relaxed);
 }
 
-static inline void unpark_one(Threadpool* pool) {
-    if (atomic_load_explicit(&pool->num_parked, memory_order_relaxed) > 0) {
-        lock_acquire(&pool->park_lock);
-        cond_signal(&pool->work_available);
-        lock_release(&pool->park_lock);
+/*
+ * Wakes one parked worker, if any.  Called after every push; with nobody
+ * parked it costs a fence and one load.  Scans start at a per-thread cursor
+ * so concurrent submitters tend to claim different workers.
+ */
+static void unpark_one(Threadpool* pool) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&pool->num_parked, memory_order_acquire) == 0) return;
+
+    static _Thread_local size_t cursor = 0;
+    size_t n = pool->num_workers;
+    for (size_t i = 0; i < n; i++) {
+        worker* w         = pool->workers[(cursor + i) % n];
+        unsigned expected = PARK_SLEEPING;
+        if (atomic_compare_exchange_strong_explicit(&w->park_state, &expected, PARK_NOTIFIED,
+                                                    memory_order_acq_rel, memory_order_relaxed)) {
+            cursor += i + 1;
+            futex_wake_one(&w->park_state);
+            return;
+        }
     }
 }
 
-static inline void unpark_all(Threadpool* pool) {
-    lock_acquire(&pool->park_lock);
-    cond_broadcast(&pool->work_available);
-    lock_release(&pool->park_lock);
+/* Wakes every worker; used on shutdown, after the flag is set. */
+static void unpark_all(Threadpool* pool) {
+    atomic_thread_fence(memory_order_seq_cst);
+    for (size_t i = 0; i < pool->num_workers; i++) {
+        worker* w = pool->workers[i];
+        if (w && atomic_exchange_explicit(&w->park_state, PARK_NOTIFIED, memory_order_acq_rel) == PARK_SLEEPING) {
+            futex_wake_one(&w->park_state);
+        }
+    }
 }
 
 /* ============================================================================
@@ -440,11 +651,12 @@ static inline void unpark_all(Threadpool* pool) {
  * try_steal — attempt to find work from another worker or the global queue.
  *
  * Private deques are scanned first in randomised order (xorshift64 per
- * worker, no shared state).  The global queue is last: it requires a mutex
- * so we only pay that cost after exhausting all lock-free steal attempts.
+ * worker, no shared state).  The global queue is last: its positions are
+ * shared by every producer and consumer, so we only touch them after
+ * exhausting the per-worker deques.
  *
- * When the global queue has tasks, we pull a full BATCH_SIZE chunk in one
- * mutex acquisition (Perf #1 fix).  The first task is returned immediately;
+ * When the global queue has tasks, we pull a full BATCH_SIZE chunk with one
+ * CAS (Perf #1 / #5 fixes).  The first task is returned immediately;
  * the remaining tasks are pushed into the caller's own deque so subsequent
  * iterations are purely lock-free pops from bottom.
  */
@@ -471,10 +683,9 @@ static bool try_steal(worker* self, Task* out) {
     /*
      * 2. Drain global queue in a batch.
      *
-     * Pull up to BATCH_SIZE tasks in one mutex acquisition.  Distribute
-     * them: return tasks[0] to the caller immediately, push tasks[1..N-1]
-     * into our own deque so they are consumed lock-free on subsequent
-     * iterations.  One mutex lock amortised over up to 64 tasks.
+     * Pull up to BATCH_SIZE tasks in one claim.  Distribute them: return
+     * tasks[0] to the caller immediately, push tasks[1..N-1] into our own
+     * deque so they are consumed without touching the shared ring again.
      */
     Task batch[BATCH_SIZE];
     int got = gq_pull_batch(&pool->gq, batch, BATCH_SIZE);
@@ -495,6 +706,9 @@ static bool try_steal(worker* self, Task* out) {
         }
     }
 
+    /* The extras are stealable now; hand them to a parked neighbour. */
+    if (got > 1) unpark_one(pool);
+
     *out = batch[0];
     return true;
 }
@@ -506,6 +720,7 @@ static void* worker_thread(void* arg) {
     int spin = 0;
 
     tls_worker_index = self->index;
+    tls_pool         = pool;
 
     /*
      * Startup barrier (Bug #3 fix).
@@ -521,8 +736,6 @@ static void* worker_thread(void* arg) {
         thread_yield();
     }
 
-    atomic_fetch_add_explicit(&pool->num_threads_alive, 1, memory_order_relaxed);
-
     while (!atomic_load_explicit(&pool->shutdown, memory_order_acquire)) {
         /* Own deque first — zero contention, best cache locality. */
         if (deque_pop_bottom(&self->deque, &task)) goto execute;
@@ -538,43 +751,12 @@ static void* worker_thread(void* arg) {
         }
 
         spin = 0;
-        worker_park(pool);
+        worker_park(self);
         continue;
 
     execute:
         spin = 0;
-        atomic_fetch_add_explicit(&pool->num_active, 1, memory_order_relaxed);
-        task.function(task.arg);
-        int active = atomic_fetch_sub_explicit(&pool->num_active, 1, memory_order_acq_rel) - 1;
-        if (active == 0) {
-            /* Potential transition to fully idle — check and signal. */
-            bool any_work = false;
-            {
-                uint32_t h = atomic_load_explicit(&pool->gq.head, memory_order_relaxed);
-                uint32_t t = atomic_load_explicit(&pool->gq.tail, memory_order_relaxed);
-                if (h != t) any_work = true;
-            }
-            for (size_t i = 0; i < pool->num_workers && !any_work; i++) {
-                size_t b =
-                    atomic_load_explicit(&pool->workers[i]->deque.bottom, memory_order_relaxed);
-                size_t t = atomic_load_explicit(&pool->workers[i]->deque.top, memory_order_relaxed);
-                if ((ptrdiff_t)(b - t) > 0) any_work = true;
-            }
-            if (!any_work) {
-                lock_acquire(&pool->idle_lock);
-                if (atomic_load_explicit(&pool->num_active, memory_order_relaxed) == 0) {
-                    cond_broadcast(&pool->all_idle);
-                }
-                lock_release(&pool->idle_lock);
-            }
-        }
-    }
-
-    int alive = atomic_fetch_sub_explicit(&pool->num_threads_alive, 1, memory_order_acq_rel) - 1;
-    if (alive == 0) {
-        lock_acquire(&pool->idle_lock);
-        cond_broadcast(&pool->all_idle);
-        lock_release(&pool->idle_lock);
+        task_run(pool, &task);
     }
 
     return NULL;
@@ -589,6 +771,7 @@ static int worker_init(Threadpool* pool, worker** w, size_t index) {
     if (!*w) return -1;
     (*w)->pool  = pool;
     (*w)->index = index;
+    atomic_store_explicit(&(*w)->park_state, PARK_RUNNING, memory_order_relaxed);
     deque_init(&(*w)->deque);
     return thread_create(&(*w)->pthread, worker_thread, *w);
 }
@@ -604,22 +787,26 @@ Threadpool* threadpool_create(size_t num_threads) {
     if (!pool) return NULL;
 
     atomic_store_explicit(&pool->shutdown, 0, memory_order_relaxed);
-    atomic_store_explicit(&pool->num_threads_alive, 0, memory_order_relaxed);
     atomic_store_explicit(&pool->num_parked, 0, memory_order_relaxed);
-    atomic_store_explicit(&pool->num_active, 0, memory_order_relaxed);
+    atomic_store_explicit(&pool->num_pending, 0, memory_order_relaxed);
+    atomic_store_explicit(&pool->num_tg_sleepers, 0, memory_order_relaxed);
     atomic_store_explicit(&pool->workers_ready, 0, memory_order_relaxed);
 
     pool->num_workers = num_threads;
     gq_init(&pool->gq, pool);
 
-    lock_init(&pool->park_lock);
-    cond_init(&pool->work_available);
     lock_init(&pool->idle_lock);
     cond_init(&pool->all_idle);
+    cond_init(&pool->group_done);
+
+    pool->future_arena = NULL;
+    atomic_store_explicit(&pool->future_pool, NULL, memory_order_relaxed);
 
     pool->workers = (worker**)malloc(num_threads * sizeof(worker*));
     if (!pool->workers) {
-        gq_destroy(&pool->gq);
+        lock_free(&pool->idle_lock);
+        cond_free(&pool->all_idle);
+        cond_free(&pool->group_done);
         free(pool);
         return NULL;
     }
@@ -650,7 +837,7 @@ Threadpool* threadpool_create(size_t num_threads) {
  * threadpool_submit
  *
  * Worker thread  → push directly into own deque (zero-contention hot path).
- * External thread → push to global queue (single mutex, cold path).
+ * External thread → push to global queue (one CAS on the shared ring).
  *
  * After pushing, wake one parked worker if any are sleeping.  Because
  * try_steal now pulls BATCH_SIZE tasks at once from the global queue,
@@ -660,17 +847,22 @@ Threadpool* threadpool_create(size_t num_threads) {
 bool threadpool_submit(Threadpool* pool, void (*function)(void*), void* arg) {
     if (!pool || !function) return false;
 
-    Task task = {function, arg};
+    Task task = {function, arg, NULL};
+    worker* self = current_worker(pool);
 
-    if (tls_worker_index != SIZE_MAX) {
-        if (deque_push_bottom(&pool->workers[tls_worker_index]->deque, task)) {
-            unpark_one(pool);
-            return true;
-        }
+    atomic_fetch_add_explicit(&pool->num_pending, 1, memory_order_relaxed);
+
+    if (self && deque_push_bottom(&self->deque, task)) {
+        unpark_one(pool);
+        return true;
     }
 
     bool ok = gq_push(&pool->gq, task);
-    if (ok) unpark_one(pool);
+    if (ok) {
+        unpark_one(pool);
+    } else {
+        pending_done(pool, 1);
+    }
     return ok;
 }
 
@@ -683,10 +875,9 @@ bool threadpool_submit(Threadpool* pool, void (*function)(void*), void* arg) {
  * gq_push_batch.
  *
  * External thread: all tasks go to the global queue via gq_push_batch, which
- * holds gq_mutex for the entire write of each chunk.  For a batch of N tasks
- * this costs ceil(N / (GLOBAL_Q_SIZE-1)) mutex acquisitions instead of N —
- * at GLOBAL_Q_SIZE=16384 that is a 16384× reduction in lock traffic for large
- * submissions.
+ * claims every free slot it needs with one CAS per run of free slots — one
+ * CAS for the whole batch unless the ring fills up or another producer wins
+ * the race in between.
  *
  * Returns the number of tasks successfully submitted.  On shutdown this may
  * be less than count; the caller should treat a short return as an error.
@@ -695,7 +886,13 @@ size_t threadpool_submit_batch(Threadpool* pool, void (**functions)(void*), void
                                size_t count) {
     if (!pool || !functions || count == 0) return 0;
 
-    if (tls_worker_index != SIZE_MAX) {
+    /* Count the whole batch as pending up front; the shortfall is retired below. */
+    size_t nvalid = 0;
+    for (size_t i = 0; i < count; i++) nvalid += functions[i] != NULL;
+    atomic_fetch_add_explicit(&pool->num_pending, nvalid, memory_order_relaxed);
+
+    worker* self = current_worker(pool);
+    if (self) {
         /*
          * Worker thread: push directly into own deque one at a time.
          * Spill to global queue if the deque fills (extremely rare at
@@ -704,8 +901,8 @@ size_t threadpool_submit_batch(Threadpool* pool, void (**functions)(void*), void
         size_t pushed = 0;
         for (size_t i = 0; i < count; i++) {
             if (!functions[i]) continue;
-            Task task = {functions[i], args ? args[i] : NULL};
-            if (deque_push_bottom(&pool->workers[tls_worker_index]->deque, task)) {
+            Task task = {functions[i], args ? args[i] : NULL, NULL};
+            if (deque_push_bottom(&self->deque, task)) {
                 pushed++;
             } else {
                 /* Deque full — spill remainder to global queue. */
@@ -714,7 +911,7 @@ size_t threadpool_submit_batch(Threadpool* pool, void (**functions)(void*), void
                 size_t nspill = 0;
                 for (size_t j = i; j < count; j++) {
                     if (functions[j]) {
-                        spill[nspill++] = (Task){functions[j], args ? args[j] : NULL};
+                        spill[nspill++] = (Task){functions[j], args ? args[j] : NULL, NULL};
                     }
                 }
                 pushed += gq_push_batch(&pool->gq, spill, nspill);
@@ -723,25 +920,29 @@ size_t threadpool_submit_batch(Threadpool* pool, void (**functions)(void*), void
             }
         }
         if (pushed > 0) unpark_one(pool);
+        pending_done(pool, nvalid - pushed);
         return pushed;
     }
 
     /*
      * External thread: build a flat Task array and hand it to gq_push_batch
-     * in one call.  gq_push_batch flushes in chunks that fit the queue,
-     * blocking only when the queue is completely full.
+     * in one call.  gq_push_batch claims runs of free slots, sleeping only
+     * when the ring is completely full.
      *
      * Optimisation: if count <= BATCH_SIZE we use a stack-allocated array
      * to avoid the malloc entirely on small batches.
      */
     Task stack_buf[BATCH_SIZE];
     Task* tasks = (count <= BATCH_SIZE) ? stack_buf : (Task*)malloc(count * sizeof(Task));
-    if (!tasks) return 0;
+    if (!tasks) {
+        pending_done(pool, nvalid);
+        return 0;
+    }
 
     size_t ntasks = 0;
     for (size_t i = 0; i < count; i++) {
         if (functions[i]) {
-            tasks[ntasks++] = (Task){functions[i], args ? args[i] : NULL};
+            tasks[ntasks++] = (Task){functions[i], args ? args[i] : NULL, NULL};
         }
     }
 
@@ -749,6 +950,7 @@ size_t threadpool_submit_batch(Threadpool* pool, void (**functions)(void*), void
     if (tasks != stack_buf) free(tasks);
 
     if (pushed > 0) unpark_one(pool);
+    pending_done(pool, nvalid - pushed);
     return pushed;
 }
 
@@ -756,22 +958,7 @@ void threadpool_wait(Threadpool* pool) {
     if (!pool) return;
 
     lock_acquire(&pool->idle_lock);
-    for (;;) {
-        if (atomic_load_explicit(&pool->num_active, memory_order_relaxed) == 0) {
-            bool any_work = false;
-            {
-                uint32_t h = atomic_load_explicit(&pool->gq.head, memory_order_acquire);
-                uint32_t t = atomic_load_explicit(&pool->gq.tail, memory_order_acquire);
-                if (h != t) any_work = true;
-            }
-            for (size_t i = 0; i < pool->num_workers && !any_work; i++) {
-                size_t b =
-                    atomic_load_explicit(&pool->workers[i]->deque.bottom, memory_order_acquire);
-                size_t t = atomic_load_explicit(&pool->workers[i]->deque.top, memory_order_acquire);
-                if ((ptrdiff_t)(b - t) > 0) any_work = true;
-            }
-            if (!any_work) break;
-        }
+    while (atomic_load_explicit(&pool->num_pending, memory_order_acquire) > 0) {
         cond_wait(&pool->all_idle, &pool->idle_lock);
     }
     lock_release(&pool->idle_lock);
@@ -781,21 +968,7 @@ void threadpool_destroy(Threadpool* pool, int timeout_ms) {
     if (!pool) return;
 
     lock_acquire(&pool->idle_lock);
-    for (;;) {
-        bool any_work = false;
-        {
-            uint32_t h = atomic_load_explicit(&pool->gq.head, memory_order_acquire);
-            uint32_t t = atomic_load_explicit(&pool->gq.tail, memory_order_acquire);
-            if (h != t) any_work = true;
-        }
-        for (size_t i = 0; i < pool->num_workers && !any_work; i++) {
-            size_t b = atomic_load_explicit(&pool->workers[i]->deque.bottom, memory_order_acquire);
-            size_t t = atomic_load_explicit(&pool->workers[i]->deque.top, memory_order_acquire);
-            if ((ptrdiff_t)(b - t) > 0) any_work = true;
-        }
-        bool busy = atomic_load_explicit(&pool->num_active, memory_order_relaxed) > 0;
-        if (!any_work && !busy) break;
-
+    while (atomic_load_explicit(&pool->num_pending, memory_order_acquire) > 0) {
         int r = cond_wait_timeout(&pool->all_idle, &pool->idle_lock, timeout_ms);
         if (r == -1) perror("cond_wait_timeout");
     }
@@ -804,23 +977,545 @@ void threadpool_destroy(Threadpool* pool, int timeout_ms) {
     lock_release(&pool->idle_lock);
 
     unpark_all(pool);
+    ec_notify_all(&pool->gq.not_full); /* producers blocked on a full ring give up */
 
-    while (atomic_load_explicit(&pool->num_threads_alive, memory_order_acquire) > 0) {
-        thread_yield();
-    }
-
+    /* Join all before freeing any: a worker still running may be stealing from another's deque. */
     for (size_t i = 0; i < pool->num_workers; i++) {
-        if (pool->workers[i]) {
-            thread_join(pool->workers[i]->pthread, NULL);
-            free(pool->workers[i]);
-        }
+        if (pool->workers[i]) thread_join(pool->workers[i]->pthread, NULL);
     }
+    for (size_t i = 0; i < pool->num_workers; i++) free(pool->workers[i]);
     free(pool->workers);
 
-    gq_destroy(&pool->gq);
-    lock_free(&pool->park_lock);
-    cond_free(&pool->work_available);
+    arena_destroy(pool->future_arena); /* NULL if no future was ever created */
     lock_free(&pool->idle_lock);
     cond_free(&pool->all_idle);
+    cond_free(&pool->group_done);
     free(pool);
 }
+
+/* ============================================================================
+ * Task groups
+ * ============================================================================ */
+
+void tg_init(TaskGroup* tg, Threadpool* pool) {
+    tg->pool = pool;
+    atomic_store_explicit(&tg->pending, 0, memory_order_relaxed);
+}
+
+/*
+ * tg_spawn — the fork half of fork-join.
+ *
+ * Both counts go up before the push so a thief that runs the task at once
+ * can never drive either below zero.
+ */
+bool tg_spawn(TaskGroup* tg, void (*function)(void*), void* arg) {
+    if (!tg || !tg->pool || !function) return false;
+
+    Threadpool* pool = tg->pool;
+    Task task        = {function, arg, tg};
+    worker* self     = current_worker(pool);
+
+    atomic_fetch_add_explicit(&tg->pending, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool->num_pending, 1, memory_order_relaxed);
+
+    if ((self && deque_push_bottom(&self->deque, task)) || gq_push(&pool->gq, task)) {
+        unpark_one(pool);
+        return true;
+    }
+
+    group_done(pool, tg);
+    pending_done(pool, 1);
+    return false;
+}
+
+/*
+ * Finds a task for a tg_wait() caller.  A worker behaves as in its main
+ * loop.  An external thread owns no deque, so it may only steal and take
+ * single tasks from the global queue.
+ */
+static bool tg_find_task(Threadpool* pool, worker* self, Task* out) {
+    if (self) return deque_pop_bottom(&self->deque, out) || try_steal(self, out);
+
+    for (size_t i = 0; i < pool->num_workers; i++) {
+        if (deque_steal_top(&pool->workers[i]->deque, out) == STEAL_SUCCESS) return true;
+    }
+    return gq_pull_batch(&pool->gq, out, 1) > 0;
+}
+
+/*
+ * tg_wait — the join half.
+ *
+ * Helps while the group is unfinished, so a worker joining its children
+ * never idles while there is runnable work.  With nothing to run it sleeps
+ * on group_done, but with a short timeout: work may reach a queue without
+ * anyone waking this thread (unpark_one() only wakes parked workers).
+ */
+void tg_wait(TaskGroup* tg) {
+    if (!tg || !tg->pool) return;
+
+    Threadpool* pool = tg->pool;
+    worker* self     = current_worker(pool);
+    Task task;
+    int spin = 0;
+
+    while (atomic_load_explicit(&tg->pending, memory_order_acquire) > 0) {
+        if (tg_find_task(pool, self, &task)) {
+            spin = 0;
+            task_run(pool, &task);
+            continue;
+        }
+        if (spin < YIELD_THRESHOLD) {
+            spin++;
+            thread_yield();
+            continue;
+        }
+
+        spin = 0;
+        lock_acquire(&pool->idle_lock);
+        atomic_fetch_add_explicit(&pool->num_tg_sleepers, 1, memory_order_seq_cst);
+        if (atomic_load_explicit(&tg->pending, memory_order_seq_cst) > 0) {
+            cond_wait_timeout(&pool->group_done, &pool->idle_lock, TG_SLEEP_MS);
+        }
+        atomic_fetch_sub_explicit(&pool->num_tg_sleepers, 1, memory_order_relaxed);
+        lock_release(&pool->idle_lock);
+    }
+}
+
+/* ============================================================================
+ * Parallel loops
+ * ============================================================================
+ *
+ * Lazy binary splitting (Tzannes et al., 2010).  Whoever holds a range
+ * offers its upper half only while nothing it offered before is still
+ * waiting in its queue; otherwise it processes one grain and asks again.
+ * An idle pool drains offers as fast as they appear, so ranges keep halving
+ * until every worker is busy; a busy pool leaves them queued and the owner
+ * just runs through its range.  The same check doubles as the steal signal:
+ * a heavy region that stalls one worker leaves its queue empty as soon as a
+ * thief takes the pending half, and the next check splits again.
+ *
+ * Each split-off range is a heap PfSplit linked into the job, so reduce
+ * partials survive until the caller merges them after the join.
+ */
+
+typedef struct PfSplit PfSplit;
+
+typedef struct {
+    Threadpool* pool;
+    size_t grain;
+    parallel_for_fn for_fn;
+    parallel_reduce_fn reduce_fn; /* NULL for parallel_for */
+    const void* identity;
+    size_t result_size;
+    void* ctx;
+    _Atomic(PfSplit*) splits; /* every split, for cleanup and merging */
+    TaskGroup tg;
+} PfJob;
+
+struct PfSplit {
+    PfJob* job;
+    PfSplit* next;
+    size_t begin;
+    size_t end;
+    max_align_t acc[]; /* reduce partial, result_size bytes */
+};
+
+/* True when the calling thread's queue is empty, i.e. its last offer was taken. */
+static inline bool pf_should_split(Threadpool* pool, worker* self) {
+    if (self) {
+        size_t b = atomic_load_explicit(&self->deque.bottom, memory_order_relaxed);
+        size_t t = atomic_load_explicit(&self->deque.top, memory_order_relaxed);
+        return (ptrdiff_t)(b - t) <= 0;
+    }
+    /* An external thread's offers go to the global queue. */
+    return gq_empty(&pool->gq);
+}
+
+static inline void pf_body(const PfJob* job, size_t begin, size_t end, void* acc) {
+    if (job->reduce_fn) {
+        job->reduce_fn(begin, end, acc, job->ctx);
+    } else {
+        job->for_fn(begin, end, job->ctx);
+    }
+}
+
+static void pf_task(void* arg);
+
+/* Offers [begin, end) to other workers.  False if it could not be queued. */
+static bool pf_offer(PfJob* job, size_t begin, size_t end) {
+    PfSplit* sp = (PfSplit*)malloc(sizeof(PfSplit) + job->result_size);
+    if (!sp) return false;
+    sp->job   = job;
+    sp->begin = begin;
+    sp->end   = end;
+    if (job->reduce_fn) memcpy(sp->acc, job->identity, job->result_size);
+
+    /* Link first: a split that fails to queue stays listed and is simply never run. */
+    sp->next = atomic_load_explicit(&job->splits, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&job->splits, &sp->next, sp, memory_order_release,
+                                                  memory_order_relaxed)) {
+    }
+    if (!tg_spawn(&job->tg, pf_task, sp)) {
+        sp->end = sp->begin; /* empty: contributes the identity */
+        return false;
+    }
+    return true;
+}
+
+static void pf_range(PfJob* job, size_t begin, size_t end, void* acc) {
+    worker* self = current_worker(job->pool);
+
+    while (end - begin > job->grain) {
+        if (pf_should_split(job->pool, self)) {
+            size_t mid = begin + (end - begin) / 2;
+            if (!pf_offer(job, mid, end)) break; /* out of memory: finish here */
+            end = mid;
+        } else {
+            pf_body(job, begin, begin + job->grain, acc);
+            begin += job->grain;
+        }
+    }
+    pf_body(job, begin, end, acc);
+}
+
+static void pf_task(void* arg) {
+    PfSplit* sp = (PfSplit*)arg;
+    pf_range(sp->job, sp->begin, sp->end, sp->acc);
+}
+
+/* Runs the job with the caller holding the whole range, joins, merges and frees. */
+static void pf_run(PfJob* job, size_t begin, size_t end, void* result,
+                   parallel_combine_fn combine) {
+    if (job->grain == 0) {
+        size_t per = (end - begin) / (job->pool->num_workers * PF_AUTO_SPLITS);
+        job->grain = per ? per : 1;
+    }
+    atomic_init(&job->splits, NULL);
+    tg_init(&job->tg, job->pool);
+
+    pf_range(job, begin, end, result);
+    tg_wait(&job->tg);
+
+    PfSplit* sp = atomic_load_explicit(&job->splits, memory_order_acquire);
+    while (sp) {
+        PfSplit* next = sp->next;
+        if (combine) combine(result, sp->acc, job->ctx);
+        free(sp);
+        sp = next;
+    }
+}
+
+bool threadpool_parallel_for(Threadpool* pool, size_t begin, size_t end, size_t grain,
+                             parallel_for_fn fn, void* ctx) {
+    if (!pool || !fn) return false;
+    if (begin >= end) return true;
+
+    PfJob job = {.pool = pool, .grain = grain, .for_fn = fn, .ctx = ctx};
+    pf_run(&job, begin, end, NULL, NULL);
+    return true;
+}
+
+bool threadpool_parallel_reduce(Threadpool* pool, size_t begin, size_t end, size_t grain,
+                                parallel_reduce_fn fn, parallel_combine_fn combine,
+                                const void* identity, void* result, size_t result_size, void* ctx) {
+    if (!pool || !fn || !combine || !identity || !result || result_size == 0) return false;
+
+    memcpy(result, identity, result_size);
+    if (begin >= end) return true;
+
+    PfJob job = {
+        .pool        = pool,
+        .grain       = grain,
+        .reduce_fn   = fn,
+        .identity    = identity,
+        .result_size = result_size,
+        .ctx         = ctx,
+    };
+    pf_run(&job, begin, end, result, combine);
+    return true;
+}
+
+/* ============================================================================
+ * Futures
+ * ============================================================================
+ *
+ * A future is produced by exactly one party: its task (submit_future and
+ * then) or, for when_all, the last input to complete.  The producer and the
+ * caller each hold a reference, so the producer may keep touching the future
+ * while it wakes waiters even if the caller has already released it.
+ *
+ * Dependents register a FutureLink on the future's lock-free link stack.
+ * Completion publishes the result and swaps the stack for FUTURE_CLOSED in
+ * one exchange; a registration that finds FUTURE_CLOSED instead acts on the
+ * result itself.  Either way every dependent fires exactly once, and a
+ * continuation fired by a worker lands on that worker's own deque.
+ */
+
+#define FUTURE_PENDING 0u
+#define FUTURE_READY   1u
+
+typedef enum { FUTURE_TASK, FUTURE_THEN, FUTURE_ALL } FutureKind;
+
+typedef struct FutureLink {
+    struct FutureLink* next;
+    Future* target;
+} FutureLink;
+
+#define FUTURE_CLOSED ((FutureLink*)(uintptr_t)1)
+
+struct Future {
+    Threadpool* pool;
+    FutureKind kind;
+    void* (*fn)(void*);              /* FUTURE_TASK */
+    void* (*then_fn)(void*, void*);  /* FUTURE_THEN */
+    void* arg;
+    void* input;                     /* FUTURE_THEN: the parent's result */
+    void* result;
+    atomic_size_t remaining;         /* FUTURE_ALL: inputs outstanding, +1 while registering */
+    _Atomic(FutureLink*) links;      /* dependents, or FUTURE_CLOSED once complete */
+    atomic_uint state;               /* FUTURE_PENDING / FUTURE_READY; the futex word */
+    atomic_uint waiters;             /* threads about to sleep on state */
+    atomic_uint refs;
+};
+
+/*
+ * Sized above the arena's 1 MB thread-local buffer, so the arena gets a heap
+ * block of its own instead of borrowing the buffer of whichever thread made
+ * the first future, which may not outlive the pool.
+ */
+#define FUTURE_ARENA_SIZE (2 * 1024 * 1024)
+
+/* The pool's future allocator, created by the first future; NULL if that fails. */
+static ArenaPool* future_pool_get(Threadpool* pool) {
+    ArenaPool* fp = atomic_load_explicit(&pool->future_pool, memory_order_acquire);
+    if (fp) return fp;
+
+    Arena* arena     = arena_create(FUTURE_ARENA_SIZE);
+    ArenaPool* fresh = arena ? pool_create(arena) : NULL;
+    if (!fresh) {
+        arena_destroy(arena);
+        return NULL;
+    }
+    if (!atomic_compare_exchange_strong_explicit(&pool->future_pool, &fp, fresh, memory_order_acq_rel,
+                                                 memory_order_acquire)) {
+        arena_destroy(arena); /* another thread got there first */
+        return fp;
+    }
+    pool->future_arena = arena; /* read only by threadpool_destroy() */
+    return fresh;
+}
+
+/* The future allocator of a pool that already has futures. */
+static inline ArenaPool* future_pool_of(Threadpool* pool) {
+    return atomic_load_explicit(&pool->future_pool, memory_order_acquire);
+}
+
+static Future* future_alloc(Threadpool* pool, FutureKind kind) {
+    ArenaPool* fp = future_pool_get(pool);
+    if (!fp) return NULL;
+    Future* f = (Future*)pool_alloc(fp, sizeof(Future));
+    if (!f) return NULL;
+    f->pool    = pool;
+    f->kind    = kind;
+    f->fn      = NULL;
+    f->then_fn = NULL;
+    f->arg     = NULL;
+    f->input   = NULL;
+    f->result  = NULL;
+    atomic_store_explicit(&f->remaining, 0, memory_order_relaxed);
+    atomic_store_explicit(&f->links, NULL, memory_order_relaxed);
+    atomic_store_explicit(&f->state, FUTURE_PENDING, memory_order_relaxed);
+    atomic_store_explicit(&f->waiters, 0, memory_order_relaxed);
+    atomic_store_explicit(&f->refs, 2, memory_order_relaxed); /* caller + producer */
+    return f;
+}
+
+static void future_unref(Future* f) {
+    if (atomic_fetch_sub_explicit(&f->refs, 1, memory_order_acq_rel) == 1) {
+        pool_free(future_pool_of(f->pool), f, sizeof(Future));
+    }
+}
+
+/* Pushes `link` onto f's dependents; false if f has completed already. */
+static bool future_add_link(Future* f, FutureLink* link) {
+    FutureLink* head = atomic_load_explicit(&f->links, memory_order_acquire);
+    do {
+        if (head == FUTURE_CLOSED) return false;
+        link->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&f->links, &head, link, memory_order_release,
+                                                    memory_order_acquire));
+    return true;
+}
+
+static void future_complete(Future* f, void* result);
+
+static void future_task(void* arg) {
+    Future* f = (Future*)arg;
+    future_complete(f, f->kind == FUTURE_THEN ? f->then_fn(f->arg, f->input) : f->fn(f->arg));
+}
+
+/*
+ * Submits a continuation.  Submission only fails once the pool is shutting
+ * down, which cannot happen while the parent's task is still pending, so
+ * running it inline is a safety net rather than a real path.
+ */
+static void future_schedule(Future* f) {
+    if (!threadpool_submit(f->pool, future_task, f)) future_task(f);
+}
+
+/* Tells dependent `target` that one of its inputs produced `result`. */
+static void future_fire(Future* target, void* result) {
+    if (target->kind == FUTURE_THEN) {
+        target->input = result;
+        future_schedule(target);
+    } else if (atomic_fetch_sub_explicit(&target->remaining, 1, memory_order_acq_rel) == 1) {
+        future_complete(target, NULL);
+    }
+}
+
+/* Publishes the result, fires dependents, wakes waiters and drops the producer's reference. */
+static void future_complete(Future* f, void* result) {
+    f->result = result;
+    atomic_store_explicit(&f->state, FUTURE_READY, memory_order_release);
+
+    FutureLink* link = atomic_exchange_explicit(&f->links, FUTURE_CLOSED, memory_order_acq_rel);
+    while (link) {
+        FutureLink* next = link->next;
+        ArenaPool* owner = future_pool_of(link->target->pool); /* target may be freed by the fire */
+        future_fire(link->target, result);
+        pool_free(owner, link, sizeof(FutureLink));
+        link = next;
+    }
+
+    /* Pairs with the fence in future_wait(): either it sees READY or we see it waiting. */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&f->waiters, memory_order_relaxed) > 0) futex_wake_all(&f->state);
+    future_unref(f);
+}
+
+Future* threadpool_submit_future(Threadpool* pool, void* (*function)(void*), void* arg) {
+    if (!pool || !function) return NULL;
+
+    Future* f = future_alloc(pool, FUTURE_TASK);
+    if (!f) return NULL;
+    f->fn  = function;
+    f->arg = arg;
+
+    if (!threadpool_submit(pool, future_task, f)) {
+        pool_free(future_pool_of(pool), f, sizeof(Future));
+        return NULL;
+    }
+    return f;
+}
+
+/*
+ * future_wait — a worker keeps running tasks as in tg_wait(), and sleeps
+ * with TG_SLEEP_MS timeouts so it notices new work; any other thread just
+ * sleeps on the state word until future_complete() wakes it.
+ */
+void* future_wait(Future* future) {
+    if (!future) return NULL;
+
+    Threadpool* pool = future->pool;
+    worker* self     = current_worker(pool);
+    Task task;
+    int spin = 0;
+
+    while (atomic_load_explicit(&future->state, memory_order_acquire) != FUTURE_READY) {
+        if (self && tg_find_task(pool, self, &task)) {
+            spin = 0;
+            task_run(pool, &task);
+            continue;
+        }
+        if (spin < YIELD_THRESHOLD) {
+            spin++;
+            thread_yield();
+            continue;
+        }
+
+        spin = 0;
+        atomic_fetch_add_explicit(&future->waiters, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load_explicit(&future->state, memory_order_relaxed) != FUTURE_READY) {
+            futex_wait(&future->state, FUTURE_PENDING, self ? TG_SLEEP_MS : -1);
+        }
+        atomic_fetch_sub_explicit(&future->waiters, 1, memory_order_relaxed);
+    }
+    return future->result;
+}
+
+bool future_try_get(Future* future, void** result) {
+    if (!future || atomic_load_explicit(&future->state, memory_order_acquire) != FUTURE_READY) return false;
+    if (result) *result = future->result;
+    return true;
+}
+
+Future* future_then(Future* future, void* (*function)(void* arg, void* result), void* arg) {
+    if (!future || !function) return NULL;
+
+    Threadpool* pool = future->pool;
+    Future* g        = future_alloc(pool, FUTURE_THEN);
+    if (!g) return NULL;
+    g->then_fn = function;
+    g->arg     = arg;
+
+    ArenaPool* fp    = future_pool_of(pool);
+    FutureLink* link = (FutureLink*)pool_alloc(fp, sizeof(FutureLink));
+    if (!link) {
+        pool_free(fp, g, sizeof(Future));
+        return NULL;
+    }
+    link->target = g;
+
+    if (!future_add_link(future, link)) {
+        pool_free(fp, link, sizeof(FutureLink));
+        future_fire(g, future->result);
+    }
+    return g;
+}
+
+Future* future_when_all(Threadpool* pool, Future* const* futures, size_t count) {
+    if (!pool || (count > 0 && !futures)) return NULL;
+    for (size_t i = 0; i < count; i++) {
+        if (!futures[i]) return NULL;
+    }
+
+    Future* all = future_alloc(pool, FUTURE_ALL);
+    if (!all) return NULL;
+
+    /* Allocate every link first so a failure leaves nothing registered. */
+    ArenaPool* fp     = future_pool_of(pool);
+    FutureLink* links = NULL;
+    for (size_t i = 0; i < count; i++) {
+        FutureLink* link = (FutureLink*)pool_alloc(fp, sizeof(FutureLink));
+        if (!link) {
+            while (links) {
+                FutureLink* next = links->next;
+                pool_free(fp, links, sizeof(FutureLink));
+                links = next;
+            }
+            pool_free(fp, all, sizeof(Future));
+            return NULL;
+        }
+        link->next = links;
+        links      = link;
+    }
+
+    /* The extra count keeps `all` from completing before every input is registered. */
+    atomic_store_explicit(&all->remaining, count + 1, memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+        FutureLink* link = links;
+        links            = link->next;
+        link->target     = all;
+        if (!future_add_link(futures[i], link)) {
+            pool_free(fp, link, sizeof(FutureLink));
+            atomic_fetch_sub_explicit(&all->remaining, 1, memory_order_acq_rel);
+        }
+    }
+    if (atomic_fetch_sub_explicit(&all->remaining, 1, memory_order_acq_rel) == 1) future_complete(all, NULL);
+    return all;
+}
+
+void future_release(Future* future) {
+    if (future) future_unref(future);
+}
@@ -74,7 +74,7 @@ static void test_basic_allocations(void) {
     char* u1 = (char*)arena_alloc_unaligned(a, 1);
     char* u2 = (char*)arena_alloc_unaligned(a, 1);
     print_result("arena_alloc_unaligned non-NULL", u1 != NULL && u2 != NULL);
-    print_result("arena_alloc_unaligned consecutive", u2 == u1 + 1);
+    print_result("arena_alloc_unaligned consecutive", u2 == u1 + 1 + ARENA_GUARD_SIZE);
 
     // Consecutive allocs don't overlap
     char* a1 = arena_alloc(a, 64);
@@ -474,6 +474,163 @@ static void test_destroy_edge_cases(void) {
     print_result("arena_destroy on heap arena does not crash", 1);
 }
 
+// ============================================================================
+// Reserved (virtual memory) arena
+// ============================================================================
+
+static void test_reserved_arena(void) {
+    print_section("Reserved arena (arena_create_reserved)");
+
+    const size_t reserve = 16UL << 20;
+    Arena* a = arena_create_reserved(reserve);
+    ASSERT(a);
+    print_result("starts with one commit granule", arena_committed_size(a) == ARENA_COMMIT_GRANULE);
+
+    // Growing the last allocation never moves it
+    size_t len = 64;
+    char* buf = arena_alloc(a, len);
+    memset(buf, 0x5A, len);
+    int in_place = 1;
+    while (len < (4UL << 20)) {
+        char* grown = arena_realloc(a, buf, len, len * 2, ARENA_DEFAULT_ALIGN);
+        if (grown != buf) in_place = 0;
+        memset(buf + len, 0x5A, len);
+        len *= 2;
+    }
+    print_result("realloc grows in place across commits", in_place);
+    print_result("grown buffer keeps its contents", validate_pattern(buf, len, 0x5A));
+    print_result("commits track the cursor", arena_committed_size(a) >= len && arena_committed_size(a) < len * 2);
+
+    // Allocations after the buffer stay contiguous
+    char* next = arena_alloc_unaligned(a, 1);
+    print_result("next alloc follows the grown buffer", next == buf + len + ARENA_GUARD_SIZE);
+
+    // The reservation is a hard limit
+    print_result("alloc beyond the reservation returns NULL", arena_alloc(a, reserve) == NULL);
+
+    // Decommit after a spike and reuse
+    arena_reset(a);
+    size_t released = arena_decommit(a);
+    print_result("decommit after reset releases the spike", released > 0);
+    print_result("committed back to one granule", arena_committed_size(a) == ARENA_COMMIT_GRANULE);
+    char* again = arena_alloc(a, 1UL << 20);
+    memset(again, 0x33, 1UL << 20);
+    print_result("decommitted pages are recommitted on demand", validate_pattern(again, 1UL << 20, 0x33));
+
+    // A checkpoint taken before decommit stays usable
+    arena_reset(a);
+    ArenaCheckpoint cp = arena_save(a);
+    arena_alloc(a, 2UL << 20);
+    arena_restore(a, cp);
+    arena_decommit(a);
+    char* after = arena_alloc(a, ARENA_COMMIT_GRANULE * 2);
+    memset(after, 0x44, ARENA_COMMIT_GRANULE * 2);
+    print_result("restore then decommit keeps the arena usable",
+                 validate_pattern(after, ARENA_COMMIT_GRANULE * 2, 0x44));
+    print_result("nothing more to decommit below the cursor", arena_decommit(a) == 0);
+
+    // Decommit leaves headroom, so small follow-up allocations commit nothing
+    arena_reset(a);
+    arena_alloc(a, 4096);
+    ArenaCheckpoint mark = arena_save(a);
+    arena_alloc(a, 2UL << 20);
+    arena_restore(a, mark);
+    arena_decommit(a);
+    size_t trimmed = arena_committed_size(a);
+    arena_alloc(a, ARENA_COMMIT_GRANULE / 2);
+    print_result("decommit leaves a granule of headroom",
+                 trimmed > ARENA_COMMIT_GRANULE && arena_committed_size(a) == trimmed);
+
+    arena_destroy(a);
+
+    // Block-chain arenas drop their cached overflow blocks
+    Arena* h = arena_create(0);
+    ASSERT(h);
+    size_t base = arena_committed_size(h);
+    for (int i = 0; i < 8; i++) arena_alloc(h, 512 * 1024);
+    arena_reset(h);
+    print_result("block-chain decommit frees overflow blocks", arena_decommit(h) > 0);
+    print_result("block-chain committed back to the first block", arena_committed_size(h) == base);
+    print_result("block-chain arena usable after decommit", arena_alloc(h, 2UL << 20) != NULL);
+    arena_destroy(h);
+
+    print_result("arena_decommit(NULL) returns 0", arena_decommit(NULL) == 0);
+}
+
+// ============================================================================
+// Diagnostics (built with -DARENA_STATS / -DARENA_DEBUG)
+// ============================================================================
+
+static void test_diagnostics(void) {
+#ifdef ARENA_STATS
+    print_section("ARENA_STATS counters");
+
+    Arena* a = arena_create(64 * 1024);
+    ASSERT(a);
+    ArenaStats st;
+
+    arena_alloc_unaligned(a, 3);
+    arena_alloc_align(a, 16, 16); /* 13 bytes of padding after the 3-byte alloc */
+    arena_stats(a, &st);
+    print_result("alloc_count counts allocations", st.alloc_count == 2);
+    print_result("bytes_requested sums request sizes", st.bytes_requested == 19);
+    print_result("bytes_padding records alignment padding", st.bytes_padding == 13);
+
+    char* buf = arena_alloc(a, 64);
+    buf = arena_realloc(a, buf, 64, 128, ARENA_DEFAULT_ALIGN);
+    arena_alloc(a, 8);
+    arena_realloc(a, buf, 128, 256, ARENA_DEFAULT_ALIGN); /* no longer last: copies */
+    arena_stats(a, &st);
+    print_result("in-place realloc counted", st.realloc_in_place == 1);
+    print_result("copying realloc strands the old region", st.realloc_copied == 1 && st.bytes_stranded == 128);
+
+    arena_alloc(a, arena_committed_size(a)); /* does not fit: skips the first block's tail */
+    arena_stats(a, &st);
+    print_result("block tail waste recorded on spill", st.bytes_tail_waste > 0);
+    print_result("block_count sees the new block", st.block_count == 2);
+
+    size_t before = st.bytes_used;
+    arena_reset(a);
+    arena_stats(a, &st);
+    print_result("peak_used survives reset", st.peak_used >= before && st.bytes_used < before);
+    print_result("reclaim_count counts resets", st.reclaim_count == 1);
+
+    arena_stats_dump(a, "test", stdout);
+    arena_stats(NULL, &st);
+    print_result("arena_stats(NULL) zeroes the snapshot", st.alloc_count == 0 && st.bytes_committed == 0);
+    arena_destroy(a);
+#endif
+
+#ifdef ARENA_DEBUG
+    print_section("ARENA_DEBUG guards and poisoning");
+
+    Arena* d = arena_create(64 * 1024);
+    ASSERT(d);
+    char* p = arena_alloc(d, 24);
+    char* q = arena_alloc(d, 40);
+    print_result("allocations are separated by a guard", q >= p + 24 + ARENA_GUARD_SIZE);
+    print_result("intact guards pass the check", arena_debug_check(d));
+
+    ArenaCheckpoint cp = arena_save(d);
+    char* scratch = arena_alloc(d, 32);
+    memset(scratch, 0x11, 32);
+    arena_restore(d, cp);
+    print_result("restore keeps older guards linked", arena_debug_check(d));
+    arena_reset(d);
+    print_result("reset clears the guard list", arena_debug_check(d));
+
+#if !defined(__SANITIZE_ADDRESS__)
+    /* Under ASan these accesses trap instead, which is the point of poisoning. */
+    print_result("reclaimed memory is poisoned", (unsigned char)scratch[0] == ARENA_POISON_BYTE);
+    char* r = arena_alloc(d, 16);
+    r[16] = 0; /* one byte past the end */
+    print_result("overflow into a guard is detected", !arena_debug_check(d));
+    arena_reset(d);
+#endif
+    arena_destroy(d);
+#endif
+}
+
 // ============================================================================
 // Multithreaded (unchanged logic, kept for regression)
 // ============================================================================
@@ -515,6 +672,109 @@ static void test_multithreaded(void) {
     arena_destroy(a);
 }
 
+// ============================================================================
+// Concurrent Arena
+// ============================================================================
+
+#define CARENA_ALLOCS_PER_THREAD 20000
+
+typedef struct {
+    ConcurrentArena* arena;
+    unsigned char id;
+    unsigned char* ptrs[CARENA_ALLOCS_PER_THREAD];
+    size_t sizes[CARENA_ALLOCS_PER_THREAD];
+    int ok;
+} carena_worker_t;
+
+static void* carena_thread(void* arg) {
+    carena_worker_t* w = (carena_worker_t*)arg;
+    w->ok = 1;
+    for (int i = 0; i < CARENA_ALLOCS_PER_THREAD; i++) {
+        /* Mostly small objects, with an occasional carve straight from the shared block. */
+        size_t size = (i % 500 == 0) ? 8192 : 1 + (size_t)(i * 7) % 200;
+        unsigned char* p = (unsigned char*)carena_alloc(w->arena, size);
+        if (!p || !is_aligned(p, ARENA_DEFAULT_ALIGN)) {
+            w->ok = 0;
+            return NULL;
+        }
+        memset(p, w->id, size);
+        w->ptrs[i] = p;
+        w->sizes[i] = size;
+    }
+    return NULL;
+}
+
+static void test_concurrent_arena(void) {
+    print_section("Concurrent arena");
+
+    ConcurrentArena* ca = carena_create(0);
+    ASSERT(ca);
+    print_result("carena_create(0) succeeds", ca != NULL);
+    print_result("zero-size alloc returns NULL", carena_alloc(ca, 0) == NULL);
+    print_result("alignment above 64 rejected", carena_alloc_align(ca, 8, 128) == NULL);
+
+    void* p64 = carena_alloc_align(ca, 24, 64);
+    print_result("64-byte aligned alloc", p64 && is_aligned(p64, 64));
+    char* s = carena_strdup(ca, "shared");
+    print_result("carena_strdup copies the string", s && strcmp(s, "shared") == 0);
+
+    static carena_worker_t workers[NUM_THREADS];
+    Thread threads[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; i++) {
+        workers[i].arena = ca;
+        workers[i].id = (unsigned char)(i + 1);
+        thread_create(&threads[i], carena_thread, &workers[i]);
+    }
+    int ok = 1;
+    for (int i = 0; i < NUM_THREADS; i++) {
+        thread_join(threads[i], NULL);
+        ok = ok && workers[i].ok;
+    }
+    print_result("concurrent allocs all succeed and are aligned", ok);
+
+    /* Every object still holds its owner's byte: no two threads were handed overlapping memory. */
+    int intact = 1;
+    for (int t = 0; t < NUM_THREADS && intact; t++) {
+        for (int i = 0; i < CARENA_ALLOCS_PER_THREAD && intact; i++) {
+            intact = validate_pattern(workers[t].ptrs[i], workers[t].sizes[i], workers[t].id);
+        }
+    }
+    print_result("no allocation overlaps another thread's", intact);
+
+    void* huge = carena_alloc(ca, 4 * ARENA_CONCURRENT_BLOCK_SIZE);
+    print_result("oversized alloc gets a dedicated block", huge != NULL);
+    if (huge) memset(huge, 0x5A, 4 * ARENA_CONCURRENT_BLOCK_SIZE);
+
+    size_t committed = carena_committed_size(ca);
+    carena_reset(ca);
+    size_t after_reset = carena_committed_size(ca);
+    print_result("reset frees dedicated blocks, keeps shared ones",
+                 after_reset < committed && after_reset + 4 * ARENA_CONCURRENT_BLOCK_SIZE <= committed);
+
+    for (int i = 0; i < NUM_THREADS; i++) thread_create(&threads[i], carena_thread, &workers[i]);
+    for (int i = 0; i < NUM_THREADS; i++) thread_join(threads[i], NULL);
+    print_result("refilling after reset reuses committed blocks", carena_committed_size(ca) <= after_reset);
+
+    /* Ids are handed out in sequence, so the first and last of five arenas
+     * share a TLS set; alternating between them must keep both chunks. */
+    ConcurrentArena* peers[5];
+    for (int i = 0; i < 5; i++) peers[i] = carena_create(0);
+    size_t base_first = carena_committed_size(peers[0]);
+    size_t base_last = carena_committed_size(peers[4]);
+    int kept = 1;
+    for (int i = 0; i < 512; i++) {
+        kept = kept && carena_alloc(peers[0], 64) && carena_alloc(peers[4], 64);
+    }
+    kept = kept && carena_committed_size(peers[0]) == base_first && carena_committed_size(peers[4]) == base_last;
+    print_result("alternating arenas in one TLS set keep their chunks", kept);
+    for (int i = 0; i < 5; i++) carena_destroy(peers[i]);
+
+    carena_destroy(ca);
+    carena_destroy(NULL);
+    carena_reset(NULL);
+    print_result("destroy and NULL handling do not crash", 1);
+}
+
 // ============================================================================
 // Stress Test
 // ============================================================================
@@ -572,7 +832,10 @@ int main(void) {
     test_block_expansion();
     test_size_tracking();
     test_destroy_edge_cases();
+    test_reserved_arena();
+    test_diagnostics();
     test_multithreaded();
+    test_concurrent_arena();
     test_stress();
 
     printf("\n==========================\n");
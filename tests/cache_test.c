@@ -1,9 +1,11 @@
 #include "../include/cache.h"
 #include <assert.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "../include/thread.h"
 
 // Test statistics
@@ -50,6 +52,47 @@ static void test_create_destroy(void) {
     TEST_ASSERT(true, "Cache destroyed without crash");
 }
 
+/** Test: Runtime shard count and NUMA placement options. */
+static void test_create_ex(void) {
+    printf("\n[TEST] cache_create_ex Options\n");
+
+    cache_config_t bad = {.capacity = 1000, .shard_count = 48};
+    TEST_ASSERT(cache_create_ex(&bad) == NULL, "Non power-of-two shard count rejected");
+    TEST_ASSERT(cache_create_ex(NULL) == NULL, "NULL config rejected");
+
+    cache_config_t cfg = {.capacity = 4096, .default_ttl = 60, .shard_count = 256, .numa_interleave = true};
+    cache_t* cache = cache_create_ex(&cfg);
+    TEST_ASSERT(cache != NULL, "256-shard cache created");
+    if (!cache) return;
+    TEST_ASSERT(get_total_capacity(cache) == 4096, "Capacity split across 256 shards");
+
+    for (int i = 0; i < 500; i++) {
+        char key[32];
+        int len = snprintf(key, sizeof(key), "shard_key%d", i);
+        cache_set(cache, key, (size_t)len, key, (size_t)len, 0);
+    }
+    TEST_ASSERT(get_total_cache_size(cache) == 500, "All keys stored across many shards");
+
+    size_t len = 0;
+    const void* ptr = cache_get(cache, "shard_key123", 12, &len);
+    TEST_ASSERT(ptr && len == 12 && memcmp(ptr, "shard_key123", 12) == 0, "Lookup in many-shard cache");
+    if (ptr) cache_release(ptr);
+    cache_destroy(cache);
+
+    /* Explicit per-shard nodes; node 0 exists everywhere NUMA is reported. */
+    int nodes[4] = {0, -1, 0, -1};
+    cache_config_t pinned = {.capacity = 100, .shard_count = 4, .shard_numa_nodes = nodes};
+    cache = cache_create_ex(&pinned);
+    TEST_ASSERT(cache != NULL, "Explicit NUMA node map accepted");
+    if (cache) {
+        cache_set(cache, "k", 1, "v", 1, 0);
+        ptr = cache_get(cache, "k", 1, &len);
+        TEST_ASSERT(ptr != NULL, "Get works with NUMA-placed shards");
+        if (ptr) cache_release(ptr);
+        cache_destroy(cache);
+    }
+}
+
 /** Test: Basic set and get operations (Zero Copy). */
 static void test_set_get(void) {
     printf("\n[TEST] Set and Get Operations (Zero Copy)\n");
@@ -163,6 +206,723 @@ static void test_lru_eviction(void) {
     cache_destroy(cache);
 }
 
+/** Test: Millisecond TTLs on the coarse clock. */
+static void test_ms_ttl(void) {
+    printf("\n[TEST] Millisecond TTL\n");
+
+    cache_config_t cfg = {.capacity = 100, .default_ttl_ms = 80};
+    cache_t* cache = cache_create_ex(&cfg);
+    if (!cache) return;
+
+    cache_set_ms(cache, "short", 5, "v", 1, 40);
+    cache_set(cache, "dflt", 4, "v", 1, 0); /* 80 ms default */
+    cache_set_ms(cache, "long", 4, "v", 1, 60000);
+
+    size_t len;
+    const void* ptr = cache_get(cache, "short", 5, &len);
+    TEST_ASSERT(ptr != NULL, "Fresh 40ms entry is visible");
+    if (ptr) cache_release(ptr);
+
+    sleep_ms(60);
+    TEST_ASSERT(cache_get(cache, "short", 5, &len) == NULL, "40ms entry expired after 60ms");
+    ptr = cache_get(cache, "dflt", 4, &len);
+    TEST_ASSERT(ptr != NULL, "80ms default entry still live after 60ms");
+    if (ptr) cache_release(ptr);
+
+    sleep_ms(60);
+    TEST_ASSERT(cache_get(cache, "dflt", 4, &len) == NULL, "Default ms TTL expired");
+    ptr = cache_get(cache, "long", 4, &len);
+    TEST_ASSERT(ptr != NULL, "Long-lived entry unaffected");
+    if (ptr) cache_release(ptr);
+
+    cache_destroy(cache);
+}
+
+/** Test: Incremental and background expiry sweeping. */
+static void test_sweeper(void) {
+    printf("\n[TEST] Expiry Sweeper\n");
+
+    cache_t* cache = cache_create(1000, 300);
+    if (!cache) return;
+
+    for (int i = 0; i < 200; i++) {
+        char key[32];
+        int len = snprintf(key, sizeof(key), "sweep%d", i);
+        cache_set_ms(cache, key, (size_t)len, "v", 1, (i % 2) ? 20 : 60000);
+    }
+    TEST_ASSERT(cache_tick(cache, 1u << 20) == 0, "Nothing swept before expiry");
+
+    sleep_ms(40);
+    size_t removed = 0;
+    for (int i = 0; i < 64 && removed < 100; i++) removed += cache_tick(cache, 512);
+    TEST_ASSERT(removed == 100, "Small-budget ticks removed every expired entry");
+    TEST_ASSERT(get_total_cache_size(cache) == 100, "Live entries untouched by sweep");
+    cache_destroy(cache);
+
+    cache_config_t cfg = {.capacity = 1000, .sweep_interval_ms = 5};
+    cache = cache_create_ex(&cfg);
+    TEST_ASSERT(cache != NULL, "Cache with background sweeper created");
+    if (!cache) return;
+    for (int i = 0; i < 50; i++) {
+        char key[32];
+        int len = snprintf(key, sizeof(key), "bg%d", i);
+        cache_set_ms(cache, key, (size_t)len, "v", 1, 10);
+    }
+    for (int i = 0; i < 100 && get_total_cache_size(cache) > 0; i++) sleep_ms(5);
+    TEST_ASSERT(get_total_cache_size(cache) == 0, "Background sweeper removed expired entries");
+    cache_destroy(cache);
+}
+
+/** Test: Slab-allocated entries under a hard byte budget. */
+static void test_memory_budget(void) {
+    printf("\n[TEST] Slab Allocation and Byte Budget\n");
+
+    const size_t budget = 64 * 1024;
+    cache_config_t cfg = {.capacity = 100000, .shard_count = 4, .max_bytes = budget, .slab_alloc = true};
+    cache_t* cache = cache_create_ex(&cfg);
+    TEST_ASSERT(cache != NULL, "Budgeted slab cache created");
+    if (!cache) return;
+
+    char value[300];
+    memset(value, 'x', sizeof(value));
+    for (int i = 0; i < 5000; i++) {
+        char key[32];
+        int len = snprintf(key, sizeof(key), "mem%d", i);
+        cache_set(cache, key, (size_t)len, value, (size_t)(50 + i % 250), 0);
+    }
+    size_t used = get_total_memory_usage(cache);
+    printf("  Budget: %zu, Used: %zu, Entries: %zu\n", budget, used, get_total_cache_size(cache));
+    TEST_ASSERT(used <= budget, "Memory usage stays within the byte budget");
+    TEST_ASSERT(get_total_cache_size(cache) > 50, "Budget still holds a useful number of entries");
+
+    /* Oversized values bypass the slab but are still charged. */
+    char* big = malloc(40000);
+    if (big) {
+        memset(big, 'b', 40000);
+        TEST_ASSERT(cache_set(cache, "big", 3, big, 40000, 0) == false, "Entry larger than a shard's budget rejected");
+        free(big);
+    }
+
+    /* A reference held across destroy keeps its slab block alive. */
+    cache_set(cache, "keep", 4, "alive", 5, 0);
+    size_t len = 0;
+    const void* ptr = cache_get(cache, "keep", 4, &len);
+    cache_destroy(cache);
+    TEST_ASSERT(ptr && len == 5 && memcmp(ptr, "alive", 5) == 0, "Slab entry readable after cache_destroy");
+    if (ptr) cache_release(ptr);
+
+    /* Without a budget, churn through the slab reuses blocks and usage tracks live entries. */
+    cache_config_t churn_cfg = {.capacity = 256, .slab_alloc = true};
+    cache = cache_create_ex(&churn_cfg);
+    if (!cache) return;
+    for (int i = 0; i < 20000; i++) {
+        char key[32];
+        int klen = snprintf(key, sizeof(key), "churn%d", i % 1000);
+        cache_set(cache, key, (size_t)klen, value, (size_t)(i % 200 + 1), 0);
+        if (i % 3 == 0) cache_invalidate(cache, key);
+    }
+    size_t entries = get_total_cache_size(cache);
+    used = get_total_memory_usage(cache);
+    TEST_ASSERT(used >= entries * 64 && used <= entries * 512, "Charged bytes track live slab blocks");
+    cache_clear(cache);
+    TEST_ASSERT(get_total_memory_usage(cache) == 0, "Clear releases all charged bytes");
+    cache_destroy(cache);
+}
+
+/** Read-through access: get, and set on a miss.  Returns true on a hit. */
+static bool read_through(cache_t* cache, const char* key) {
+    size_t len = strlen(key);
+    const void* v = cache_get(cache, key, len, NULL);
+    if (v) {
+        cache_release(v);
+        return true;
+    }
+    cache_set(cache, key, len, "v", 1, 0);
+    return false;
+}
+
+/** Interleaves a hot set with a scan of one-off keys; returns hot-key hits. */
+static int scan_hot_hits(cache_policy_t policy) {
+    cache_config_t cfg = {.capacity = 64, .shard_count = 1, .policy = policy};
+    cache_t* cache = cache_create_ex(&cfg);
+    if (!cache) return -1;
+
+    char key[32];
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 32; i++) {
+            snprintf(key, sizeof(key), "hot%d", i);
+            read_through(cache, key);
+        }
+    }
+
+    /* Three never-repeated keys per hot access. */
+    int hits = 0;
+    for (int i = 0; i < 3000; i++) {
+        snprintf(key, sizeof(key), "cold%d", i);
+        read_through(cache, key);
+        if (i % 3 == 2) {
+            snprintf(key, sizeof(key), "hot%d", (i / 3) % 32);
+            if (read_through(cache, key)) hits++;
+        }
+    }
+    cache_destroy(cache);
+    return hits;
+}
+
+/** Test: TinyLFU admission keeps the hot set through a scan. */
+static void test_tinylfu_admission(void) {
+    printf("\n[TEST] TinyLFU Admission\n");
+
+    cache_config_t bad = {.capacity = 64, .policy = (cache_policy_t)7};
+    TEST_ASSERT(cache_create_ex(&bad) == NULL, "Unknown policy rejected");
+
+    int clock_hits = scan_hot_hits(CACHE_POLICY_CLOCK);
+    int lfu_hits = scan_hot_hits(CACHE_POLICY_TINYLFU);
+    printf("  Hot-key hits during a scan: CLOCK %d/1000, TinyLFU %d/1000\n", clock_hits, lfu_hits);
+    TEST_ASSERT(lfu_hits >= 400, "TinyLFU keeps most of the hot set through a scan");
+    TEST_ASSERT(lfu_hits > 4 * clock_hits, "TinyLFU beats CLOCK on a scan");
+
+    /* Updates of resident keys are always admitted. */
+    cache_config_t cfg = {.capacity = 4, .shard_count = 1, .policy = CACHE_POLICY_TINYLFU};
+    cache_t* cache = cache_create_ex(&cfg);
+    if (!cache) return;
+    TEST_ASSERT(cache_set(cache, "k", 1, "v1", 2, 0), "Insert into empty TinyLFU cache admitted");
+    TEST_ASSERT(cache_set(cache, "k", 1, "v2", 2, 0), "Update of resident key admitted");
+    size_t len = 0;
+    const void* v = cache_get(cache, "k", 1, &len);
+    TEST_ASSERT(v && len == 2 && memcmp(v, "v2", 2) == 0, "Updated value visible");
+    if (v) cache_release(v);
+    cache_destroy(cache);
+}
+
+static _Atomic size_t custom_hash_calls = 0;
+
+/** Deliberately terrible hash: every key collides. */
+static uint64_t constant_hash(const void* key, size_t len, uint64_t seed) {
+    (void)key;
+    (void)len;
+    atomic_fetch_add(&custom_hash_calls, 1);
+    return seed;
+}
+
+/** Test: Pluggable and seeded key hashing. */
+static void test_custom_hash(void) {
+    printf("\n[TEST] Custom and Seeded Hashing\n");
+
+    cache_config_t cfg = {.capacity = 64, .shard_count = 4, .hash_fn = constant_hash, .hash_seed = 42};
+    cache_t* cache = cache_create_ex(&cfg);
+    TEST_ASSERT(cache != NULL, "Cache with custom hash created");
+    if (!cache) return;
+
+    char key[32], val[32];
+    for (int i = 0; i < 16; i++) {
+        int klen = snprintf(key, sizeof(key), "col%d", i);
+        int vlen = snprintf(val, sizeof(val), "v%d", i);
+        cache_set(cache, key, (size_t)klen, val, (size_t)vlen, 0);
+    }
+    TEST_ASSERT(atomic_load(&custom_hash_calls) >= 16, "Custom hash is used");
+
+    bool all_ok = true;
+    for (int i = 0; i < 16; i++) {
+        int klen = snprintf(key, sizeof(key), "col%d", i);
+        int vlen = snprintf(val, sizeof(val), "v%d", i);
+        size_t len = 0;
+        const void* v = cache_get(cache, key, (size_t)klen, &len);
+        if (!v || len != (size_t)vlen || memcmp(v, val, len) != 0) all_ok = false;
+        if (v) cache_release(v);
+    }
+    TEST_ASSERT(all_ok, "Fully colliding keys stay distinguishable");
+    cache_destroy(cache);
+
+    /* Two caches with the default seed agree on lookups across save/load. */
+    cache_t* a = cache_create(100, 60);
+    cache_config_t seeded = {.capacity = 100, .hash_seed = 12345};
+    cache_t* b = cache_create_ex(&seeded);
+    if (a && b) {
+        cache_set(a, "seeded", 6, "ok", 2, 0);
+        bool saved = cache_save(a, "/tmp/cache_seed_test.bin");
+        bool loaded = saved && cache_load(b, "/tmp/cache_seed_test.bin");
+        const void* v = cache_get(b, "seeded", 6, NULL);
+        TEST_ASSERT(loaded && v != NULL, "Snapshot loads into a cache with a different seed");
+        if (v) cache_release(v);
+        remove("/tmp/cache_seed_test.bin");
+    }
+    cache_destroy(a);
+    cache_destroy(b);
+}
+
+/** Test: Group tag probing stays consistent at a 90% load factor under churn. */
+static void test_high_load_factor(void) {
+    printf("\n[TEST] High Load Factor Probing\n");
+
+    cache_config_t bad = {.capacity = 100, .max_load_factor = 1.0f};
+    TEST_ASSERT(cache_create_ex(&bad) == NULL, "Load factor above 0.95 rejected");
+
+    cache_config_t cfg = {.capacity = 900, .shard_count = 1, .max_load_factor = 0.9f};
+    cache_t* cache = cache_create_ex(&cfg);
+    TEST_ASSERT(cache != NULL, "Cache at 0.9 load factor created");
+    if (!cache) return;
+
+    enum { KEYS = 2000 };
+    static int latest[KEYS]; /* last value written, -1 after invalidation */
+    for (int i = 0; i < KEYS; i++) latest[i] = -1;
+
+    uint32_t rng = 12345;
+    bool consistent = true;
+    char key[32];
+    for (int op = 0; op < 50000; op++) {
+        rng = rng * 1103515245u + 12345u;
+        int k = (int)((rng >> 8) % KEYS);
+        snprintf(key, sizeof(key), "lf%d", k);
+        if ((rng >> 4) % 8 == 0) {
+            cache_invalidate(cache, key);
+            latest[k] = -1;
+        } else if ((rng >> 4) % 8 < 4) {
+            cache_set(cache, key, strlen(key), &op, sizeof(op), 0);
+            latest[k] = op;
+        } else {
+            size_t len = 0;
+            const int* v = cache_get(cache, key, strlen(key), &len);
+            if (v) {
+                if (latest[k] < 0 || len != sizeof(int) || *v != latest[k]) consistent = false;
+                cache_release(v);
+            }
+        }
+    }
+    TEST_ASSERT(consistent, "Lookups return the latest value and never an invalidated key");
+    TEST_ASSERT(get_total_cache_size(cache) <= 900, "Shard stays within capacity");
+
+    /* Drop the churn keys one by one (leaving tombstones), then fill to 89% load. */
+    for (int k = 0; k < KEYS; k++) {
+        snprintf(key, sizeof(key), "lf%d", k);
+        cache_invalidate(cache, key);
+    }
+    int found = 0;
+    for (int k = 0; k < 800; k++) {
+        snprintf(key, sizeof(key), "fill%d", k);
+        cache_set(cache, key, strlen(key), &k, sizeof(k), 0);
+    }
+    for (int k = 0; k < 800; k++) {
+        snprintf(key, sizeof(key), "fill%d", k);
+        size_t len = 0;
+        const int* v = cache_get(cache, key, strlen(key), &len);
+        if (v) {
+            if (len == sizeof(int) && *v == k) found++;
+            cache_release(v);
+        }
+    }
+    printf("  Keys found after filling to 89%% load: %d/800\n", found);
+    TEST_ASSERT(found == 800, "Every key is findable at high load");
+    cache_destroy(cache);
+}
+
+/** Counts how many of keys "<prefix>0".."<prefix>n-1" are present with their index as value. */
+static int count_present(cache_t* cache, const char* prefix, int n) {
+    char key[32];
+    int found = 0;
+    for (int k = 0; k < n; k++) {
+        snprintf(key, sizeof(key), "%s%d", prefix, k);
+        size_t len = 0;
+        const int* v = cache_get(cache, key, strlen(key), &len);
+        if (v) {
+            if (len == sizeof(int) && *v == k) found++;
+            cache_release(v);
+        }
+    }
+    return found;
+}
+
+/** Test: Runtime resize with incremental rehash. */
+static void test_resize(void) {
+    printf("\n[TEST] Incremental Resize\n");
+
+    cache_config_t cfg = {.capacity = 1000, .shard_count = 4, .read_mode = CACHE_READ_OPTIMISTIC};
+    cache_t* cache = cache_create_ex(&cfg);
+    TEST_ASSERT(cache != NULL, "Cache created");
+    if (!cache) return;
+
+    TEST_ASSERT(!cache_resize(NULL, 100), "NULL cache rejected");
+    TEST_ASSERT(!cache_resize(cache, 0), "Zero capacity rejected");
+
+    char key[32];
+    for (int k = 0; k < 800; k++) {
+        snprintf(key, sizeof(key), "base%d", k);
+        cache_set(cache, key, strlen(key), &k, sizeof(k), 0);
+    }
+    int base_present = count_present(cache, "base", 800);
+
+    TEST_ASSERT(cache_resize(cache, 8000), "Grow to 8000");
+    TEST_ASSERT(get_total_capacity(cache) == 8000, "Capacity grows once the larger tables exist");
+
+    /* Old tables drain a few slots per insert; every key must stay visible meanwhile. */
+    bool stable = true;
+    for (int k = 0; k < 6000; k++) {
+        snprintf(key, sizeof(key), "grow%d", k);
+        cache_set(cache, key, strlen(key), &k, sizeof(k), 0);
+        if ((k < 200 || k % 250 == 0) && count_present(cache, "base", 800) != base_present) stable = false;
+    }
+    TEST_ASSERT(stable, "Existing keys stay findable during migration");
+    TEST_ASSERT(count_present(cache, "grow", 6000) == 6000, "No evictions below the new capacity");
+    TEST_ASSERT(count_present(cache, "base", 800) == base_present, "Existing keys survive the grow");
+
+    TEST_ASSERT(cache_resize(cache, 400), "Shrink to 400");
+    TEST_ASSERT(get_total_capacity(cache) == 400, "Lower capacity applies immediately");
+    for (int i = 0; i < 1000 && get_total_cache_size(cache) > 400; i++) cache_tick(cache, 256);
+    TEST_ASSERT(get_total_cache_size(cache) <= 400, "cache_tick() evicts down to the new capacity");
+
+    for (int i = 0; i < 1000; i++) cache_tick(cache, 256); /* let the smaller tables take over */
+    for (int k = 0; k < 50; k++) {
+        snprintf(key, sizeof(key), "small%d", k);
+        cache_set(cache, key, strlen(key), &k, sizeof(k), 0);
+    }
+    TEST_ASSERT(count_present(cache, "small", 50) == 50, "Inserts after the shrink are findable");
+    TEST_ASSERT(get_total_cache_size(cache) <= 400, "Shrunk cache stays within capacity");
+
+    cache_destroy(cache);
+}
+
+static void* stats_reader(void* arg) {
+    cache_t* cache = arg;
+    for (int i = 0; i < 10000; i++) {
+        const void* v = cache_get(cache, "hot", 3, NULL);
+        if (v) cache_release(v);
+    }
+    return NULL;
+}
+
+/** Test: Statistics counters and the hot-key tracker. */
+static void test_stats(void) {
+    printf("\n[TEST] Statistics and Hot Keys\n");
+
+    cache_config_t cfg = {.capacity = 100, .shard_count = 1, .hot_keys = 16, .hot_key_sample = 1};
+    cache_t* cache = cache_create_ex(&cfg);
+    TEST_ASSERT(cache != NULL, "Cache with hot-key tracking created");
+    if (!cache) return;
+
+    char key[32];
+    for (int k = 0; k < 150; k++) {
+        snprintf(key, sizeof(key), "st%d", k);
+        cache_set(cache, key, strlen(key), &k, sizeof(k), 0);
+    }
+    cache_set(cache, "hot", 3, "v", 1, 0);
+    for (int i = 0; i < 500; i++) {
+        const void* v = cache_get(cache, "hot", 3, NULL);
+        if (v) cache_release(v);
+    }
+    TEST_ASSERT(cache_get(cache, "absent", 6, NULL) == NULL, "Miss");
+
+    cache_set_ms(cache, "brief", 5, "x", 1, 1);
+    sleep_ms(20);
+    TEST_ASSERT(cache_get(cache, "brief", 5, NULL) == NULL, "Expired key misses");
+
+    cache_stats_t st;
+    TEST_ASSERT(cache_stats(cache, &st), "Stats read");
+    TEST_ASSERT(st.hits == 500, "Hits counted");
+    TEST_ASSERT(st.misses == 2, "Misses counted, expired included");
+    TEST_ASSERT(st.sets == 152, "Sets counted");
+    TEST_ASSERT(st.evictions >= 51, "Evictions counted");
+    TEST_ASSERT(st.expirations == 1, "Expiration counted");
+    TEST_ASSERT(st.entries == get_total_cache_size(cache) && st.capacity == 100, "Occupancy matches");
+    TEST_ASSERT(st.shard_count == 1, "Shard count reported");
+
+    cache_shard_stats_t ss;
+    TEST_ASSERT(cache_shard_stats(cache, 0, &ss) && ss.sets == st.sets && ss.buckets >= ss.capacity,
+                "Shard stats agree with totals");
+    TEST_ASSERT(!cache_shard_stats(cache, 1, &ss), "Out-of-range shard rejected");
+
+    cache_hot_key_t hot[4];
+    size_t n = cache_hot_keys(cache, hot, 4);
+    TEST_ASSERT(n >= 1 && strcmp(hot[0].key, "hot") == 0 && hot[0].key_len == 3, "Hottest key reported first");
+    TEST_ASSERT(n >= 1 && hot[0].hits >= 500, "Hot-key estimate bounds the true count");
+
+    Thread threads[4];
+    for (int t = 0; t < 4; t++) thread_create(&threads[t], stats_reader, cache);
+    for (int t = 0; t < 4; t++) thread_join(threads[t], NULL);
+    cache_stats(cache, &st);
+    TEST_ASSERT(st.hits == 40500, "Per-thread hit slots sum on read");
+
+    cache_destroy(cache);
+
+    cache_t* plain = cache_create(100, 300);
+    TEST_ASSERT(cache_hot_keys(plain, hot, 4) == 0, "No hot keys when tracking is disabled");
+    cache_destroy(plain);
+}
+
+typedef struct {
+    _Atomic int calls;
+    int delay_ms;
+    bool fail;
+    const char* value;
+} loader_ctx_t;
+
+static bool slow_loader(const char* key, size_t key_len, void* ctx, cache_loaded_t* out) {
+    (void)key;
+    (void)key_len;
+    loader_ctx_t* lc = ctx;
+    atomic_fetch_add(&lc->calls, 1);
+    if (lc->delay_ms) sleep_ms(lc->delay_ms);
+    if (lc->fail) return false;
+    out->value = lc->value;
+    out->value_len = strlen(lc->value);
+    return true;
+}
+
+static bool heap_loader(const char* key, size_t key_len, void* ctx, cache_loaded_t* out) {
+    (void)ctx;
+    char* copy = malloc(key_len);
+    if (!copy) return false;
+    memcpy(copy, key, key_len);
+    out->value = copy;
+    out->value_len = key_len;
+    out->ttl_ms = 60000;
+    out->free_value = free;
+    return true;
+}
+
+typedef struct {
+    cache_t* cache;
+    const char* key;
+    loader_ctx_t* lc;
+    bool ok;
+} load_job_t;
+
+static void* load_worker(void* arg) {
+    load_job_t* job = arg;
+    size_t len = 0;
+    const void* v = cache_get_or_load(job->cache, job->key, strlen(job->key), slow_loader, job->lc, &len);
+    job->ok = v && len == strlen(job->lc->value) && memcmp(v, job->lc->value, len) == 0;
+    if (v) cache_release(v);
+    return NULL;
+}
+
+/** Test: Get-or-load coalescing, stale serving and early refresh. */
+static void test_get_or_load(void) {
+    printf("\n[TEST] Get-or-Load\n");
+
+    cache_t* cache = cache_create(100, 300);
+    if (!cache) return;
+
+    size_t len = 0;
+    const void* v = cache_get_or_load(cache, "heap", 4, heap_loader, NULL, &len);
+    TEST_ASSERT(v && len == 4 && memcmp(v, "heap", 4) == 0, "Loaded value returned and owned buffer freed");
+    if (v) cache_release(v);
+    v = cache_get(cache, "heap", 4, NULL);
+    TEST_ASSERT(v != NULL, "Loaded value is cached");
+    if (v) cache_release(v);
+
+    /* Eight concurrent misses run the loader once. */
+    loader_ctx_t lc = {.delay_ms = 50, .value = "loaded"};
+    load_job_t jobs[8];
+    Thread threads[8];
+    for (int t = 0; t < 8; t++) {
+        jobs[t] = (load_job_t){.cache = cache, .key = "sf", .lc = &lc};
+        thread_create(&threads[t], load_worker, &jobs[t]);
+    }
+    bool all_ok = true;
+    for (int t = 0; t < 8; t++) {
+        thread_join(threads[t], NULL);
+        all_ok = all_ok && jobs[t].ok;
+    }
+    TEST_ASSERT(atomic_load(&lc.calls) == 1, "Concurrent misses coalesce into one load");
+    TEST_ASSERT(all_ok, "Every caller received the loaded value");
+
+    /* While a reload is running, other callers get the expired value. */
+    cache_set_ms(cache, "stale", 5, "old", 3, 20);
+    sleep_ms(40);
+    loader_ctx_t fresh = {.delay_ms = 150, .value = "new"};
+    load_job_t leader = {.cache = cache, .key = "stale", .lc = &fresh};
+    Thread leader_thread;
+    thread_create(&leader_thread, load_worker, &leader);
+    sleep_ms(50);
+    v = cache_get_or_load(cache, "stale", 5, slow_loader, &fresh, &len);
+    TEST_ASSERT(v && len == 3 && memcmp(v, "old", 3) == 0, "Concurrent caller served the stale value");
+    if (v) cache_release(v);
+    thread_join(leader_thread, NULL);
+    TEST_ASSERT(leader.ok && atomic_load(&fresh.calls) == 1, "Leader loaded the fresh value once");
+
+    /* A failed load falls back to the stale value, or NULL without one. */
+    cache_set_ms(cache, "flaky", 5, "last", 4, 20);
+    sleep_ms(40);
+    loader_ctx_t failing = {.fail = true, .value = ""};
+    v = cache_get_or_load(cache, "flaky", 5, slow_loader, &failing, &len);
+    TEST_ASSERT(v && len == 4 && memcmp(v, "last", 4) == 0, "Failed reload returns the stale value");
+    if (v) cache_release(v);
+    v = cache_get_or_load(cache, "absent", 6, slow_loader, &failing, &len);
+    TEST_ASSERT(v == NULL, "Failed load of a missing key returns NULL");
+    TEST_ASSERT(cache_get_or_load(cache, "k", 1, NULL, NULL, NULL) == NULL, "NULL loader rejected");
+    cache_destroy(cache);
+
+    /* Early refresh reloads a value well before its TTL; without it, never. */
+    for (int beta = 0; beta <= 100; beta += 100) {
+        cache_config_t cfg = {.capacity = 100, .default_ttl_ms = 200, .refresh_beta = (float)beta};
+        cache = cache_create_ex(&cfg);
+        if (!cache) return;
+        loader_ctx_t early = {.delay_ms = 5, .value = "e"};
+        for (int i = 0; i < 20; i++) {
+            v = cache_get_or_load(cache, "early", 5, slow_loader, &early, NULL);
+            if (v) cache_release(v);
+        }
+        if (beta) {
+            TEST_ASSERT(atomic_load(&early.calls) > 1, "Early refresh reloads a value before expiry");
+        } else {
+            TEST_ASSERT(atomic_load(&early.calls) == 1, "No early refresh when refresh_beta is 0");
+        }
+        cache_destroy(cache);
+    }
+    cache_config_t bad = {.refresh_beta = -1.0f};
+    TEST_ASSERT(cache_create_ex(&bad) == NULL, "Negative refresh_beta rejected");
+}
+
+/** Test: Two-phase reserve/commit writes values in place. */
+static void test_reserve_commit(void) {
+    printf("\n[TEST] Reserve and Commit\n");
+
+    for (int slab = 0; slab <= 1; slab++) {
+        cache_config_t cfg = {.capacity = 100, .slab_alloc = slab};
+        cache_t* cache = cache_create_ex(&cfg);
+        if (!cache) return;
+
+        char* w = cache_reserve(cache, "doc", 3, 11);
+        TEST_ASSERT(w != NULL, "Reservation returns a writable region");
+        if (!w) {
+            cache_destroy(cache);
+            return;
+        }
+        memcpy(w, "hello world", 11);
+        TEST_ASSERT(cache_get(cache, "doc", 3, NULL) == NULL, "Reserved value invisible before commit");
+        TEST_ASSERT(cache_commit(cache, w, 0), "Commit publishes the value");
+
+        size_t len = 0;
+        const void* v = cache_get(cache, "doc", 3, &len);
+        TEST_ASSERT(v && len == 11 && memcmp(v, "hello world", 11) == 0, "Committed value readable");
+        if (v) cache_release(v);
+
+        /* Commit replaces an existing value like cache_set(). */
+        w = cache_reserve(cache, "doc", 3, 3);
+        if (w) memcpy(w, "new", 3);
+        cache_commit(cache, w, 0);
+        v = cache_get(cache, "doc", 3, &len);
+        TEST_ASSERT(v && len == 3 && memcmp(v, "new", 3) == 0, "Commit replaces the existing value");
+        if (v) cache_release(v);
+        TEST_ASSERT(get_total_cache_size(cache) == 1, "Replacement keeps one entry");
+
+        w = cache_reserve(cache, "gone", 4, 8);
+        cache_abort(w);
+        TEST_ASSERT(cache_get(cache, "gone", 4, NULL) == NULL, "Aborted reservation never visible");
+
+        /* Large value serialized in place. */
+        size_t big_len = (size_t)1 << 20;
+        unsigned char* big = cache_reserve(cache, "big", 3, big_len);
+        if (big) {
+            for (size_t i = 0; i < big_len; i++) big[i] = (unsigned char)(i * 31u);
+            cache_commit(cache, big, 0);
+        }
+        v = cache_get(cache, "big", 3, &len);
+        bool intact = v && len == big_len;
+        for (size_t i = 0; intact && i < big_len; i += 4099) {
+            intact = ((const unsigned char*)v)[i] == (unsigned char)(i * 31u);
+        }
+        TEST_ASSERT(intact, "1 MiB value committed intact");
+        if (v) cache_release(v);
+
+        w = cache_reserve(cache, "ttl", 3, 1);
+        if (w) *w = 't';
+        sleep_ms(30);
+        cache_commit(cache, w, 20);
+        v = cache_get(cache, "ttl", 3, NULL);
+        TEST_ASSERT(v != NULL, "TTL starts at commit, not at reserve");
+        if (v) cache_release(v);
+
+        TEST_ASSERT(cache_reserve(cache, "k", 1, 0) == NULL, "Zero-length reservation rejected");
+        TEST_ASSERT(!cache_commit(cache, NULL, 0), "Commit of NULL rejected");
+        cache_abort(NULL);
+        cache_destroy(cache);
+    }
+}
+
+typedef struct {
+    cache_t* cache;
+    _Atomic bool* stop;
+    bool consistent;
+} pinned_job_t;
+
+static void* pinned_reader(void* arg) {
+    pinned_job_t* job = arg;
+    char key[16];
+    while (!atomic_load(job->stop)) {
+        if (!cache_read_begin(job->cache)) continue;
+        for (int k = 0; k < 64; k++) {
+            snprintf(key, sizeof(key), "pin%d", k);
+            size_t len = 0;
+            const int* v = cache_get_pinned(job->cache, key, strlen(key), &len);
+            if (v && (len != 2 * sizeof(int) || v[0] != k || v[1] != -k)) job->consistent = false;
+        }
+        cache_read_end(job->cache);
+    }
+    return NULL;
+}
+
+/** Test: Pinned reads skip reference counting and survive concurrent unlinks. */
+static void test_pinned_reads(void) {
+    printf("\n[TEST] Pinned Reads\n");
+
+    cache_t* locked = cache_create(100, 300);
+    if (!locked) return;
+    TEST_ASSERT(!cache_read_begin(locked), "Pinning requires optimistic read mode");
+    cache_destroy(locked);
+
+    cache_config_t cfg = {.capacity = 256, .shard_count = 2, .read_mode = CACHE_READ_OPTIMISTIC};
+    cache_t* cache = cache_create_ex(&cfg);
+    if (!cache) return;
+
+    cache_set(cache, "a", 1, "first", 5, 0);
+    TEST_ASSERT(cache_get_pinned(cache, "a", 1, NULL) == NULL, "Pinned get outside a section returns NULL");
+
+    TEST_ASSERT(cache_read_begin(cache), "Read section opened");
+    TEST_ASSERT(cache_read_begin(cache), "Read sections nest");
+    size_t len = 0;
+    const char* v = cache_get_pinned(cache, "a", 1, &len);
+    TEST_ASSERT(v && len == 5 && memcmp(v, "first", 5) == 0, "Pinned get returns the value");
+    TEST_ASSERT(cache_get_pinned(cache, "zz", 2, NULL) == NULL, "Pinned get misses absent keys");
+
+    /* Replace the key and churn enough to trigger reclamation: the pinned value must survive. */
+    cache_set(cache, "a", 1, "second", 6, 0);
+    char key[16];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "churn%d", i);
+        cache_set(cache, key, strlen(key), "x", 1, 0);
+    }
+    cache_invalidate(cache, "a");
+    cache_read_end(cache);
+    TEST_ASSERT(memcmp(v, "first", 5) == 0, "Replaced value stays valid while still pinned");
+    cache_read_end(cache);
+    TEST_ASSERT(cache_get_pinned(cache, "a", 1, NULL) == NULL, "Outermost end closes the section");
+
+    /* Readers under pins while a writer rewrites the same keys. */
+    _Atomic bool stop = false;
+    pinned_job_t jobs[4];
+    Thread threads[4];
+    for (int t = 0; t < 4; t++) {
+        jobs[t] = (pinned_job_t){.cache = cache, .stop = &stop, .consistent = true};
+        thread_create(&threads[t], pinned_reader, &jobs[t]);
+    }
+    for (int round = 0; round < 200; round++) {
+        for (int k = 0; k < 64; k++) {
+            int val[2] = {k, -k};
+            snprintf(key, sizeof(key), "pin%d", k);
+            cache_set(cache, key, strlen(key), val, sizeof(val), 0);
+        }
+    }
+    atomic_store(&stop, true);
+    bool consistent = true;
+    for (int t = 0; t < 4; t++) {
+        thread_join(threads[t], NULL);
+        consistent = consistent && jobs[t].consistent;
+    }
+    TEST_ASSERT(consistent, "Pinned readers never see a torn or freed value");
+    cache_destroy(cache);
+}
+
 /** Test: Input validation. */
 static void test_input_validation(void) {
     printf("\n[TEST] Input Validation\n");
@@ -266,6 +1026,149 @@ static void test_concurrent_access(void) {
     cache_destroy(cache);
 }
 
+/** Writer for the optimistic test: rewrites, invalidates and churns a small key set. */
+static void* optimistic_writer(void* arg) {
+    thread_arg_t* targ = (thread_arg_t*)arg;
+    for (int i = 0; i < targ->iterations; i++) {
+        char key[32];
+        char value[64];
+        int keylen = snprintf(key, sizeof(key), "key%d", i % 50);
+        /* Value embeds its own key so readers can detect a torn or foreign entry. */
+        int value_len = snprintf(value, sizeof(value), "%s|t%d", key, targ->thread_id);
+        if (i % 7 == 0) {
+            cache_invalidate(targ->cache, key);
+        } else {
+            cache_set(targ->cache, key, (size_t)keylen, value, (size_t)value_len, 0);
+        }
+    }
+    return 0;
+}
+
+static _Atomic int optimistic_bad_reads;
+
+static void* optimistic_reader(void* arg) {
+    thread_arg_t* targ = (thread_arg_t*)arg;
+    for (int i = 0; i < targ->iterations; i++) {
+        char key[32];
+        int keylen = snprintf(key, sizeof(key), "key%d", i % 50);
+
+        size_t len;
+        const char* ptr = cache_get(targ->cache, key, (size_t)keylen, &len);
+        if (ptr) {
+            if (len <= (size_t)keylen || memcmp(ptr, key, (size_t)keylen) != 0 || ptr[keylen] != '|') {
+                optimistic_bad_reads++;
+            }
+            cache_release(ptr);
+        }
+    }
+    return 0;
+}
+
+/** Test: Optimistic (seqlock) reads racing writers, invalidations and evictions. */
+static void test_optimistic_reads(void) {
+    printf("\n[TEST] Optimistic Reads\n");
+
+    /* Small capacity so clock eviction and compaction run during the race. */
+    cache_t* cache = cache_create(64, 300);
+    if (!cache) return;
+
+    TEST_ASSERT(cache_set_read_mode(cache, CACHE_READ_OPTIMISTIC), "Optimistic read mode enabled");
+
+    cache_set(cache, "solo", 4, "value", 5, 0);
+    size_t len = 0;
+    const void* ptr = cache_get(cache, "solo", 4, &len);
+    TEST_ASSERT(ptr && len == 5 && memcmp(ptr, "value", 5) == 0, "Optimistic hit returns value");
+    if (ptr) cache_release(ptr);
+    TEST_ASSERT(cache_get(cache, "absent", 6, &len) == NULL, "Optimistic miss returns NULL");
+
+    Thread threads[NUM_THREADS];
+    thread_arg_t args[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; i++) {
+        args[i].cache = cache;
+        args[i].thread_id = i;
+        args[i].iterations = ITERATIONS * 5;
+        thread_create(&threads[i], (i % 2 == 0) ? optimistic_reader : optimistic_writer, &args[i]);
+    }
+    for (int i = 0; i < NUM_THREADS; i++) {
+        thread_join(threads[i], NULL);
+    }
+
+    TEST_ASSERT(optimistic_bad_reads == 0, "Optimistic readers never observed a foreign value");
+    TEST_ASSERT(get_total_cache_size(cache) <= get_total_capacity(cache), "Capacity respected under churn");
+    cache_destroy(cache);
+}
+
+/** Test: Batched get/set across shards. */
+static void test_batch_ops(void) {
+    printf("\n[TEST] Batched Get/Set\n");
+
+    cache_t* cache = cache_create(1000, 300);
+    if (!cache) return;
+
+    enum { N = 150 }; /* spans several internal chunks */
+    char key_buf[N][16];
+    char val_buf[N][16];
+    const char* keys[N];
+    size_t key_lens[N];
+    const void* values[N];
+    size_t value_lens[N];
+
+    for (int i = 0; i < N; i++) {
+        key_lens[i] = (size_t)snprintf(key_buf[i], sizeof(key_buf[i]), "bkey%d", i);
+        value_lens[i] = (size_t)snprintf(val_buf[i], sizeof(val_buf[i]), "bval%d", i);
+        keys[i] = key_buf[i];
+        values[i] = val_buf[i];
+    }
+
+    size_t stored = cache_set_many(cache, N, keys, key_lens, values, value_lens, 0);
+    TEST_ASSERT(stored == N, "All batch pairs stored");
+    TEST_ASSERT(get_total_cache_size(cache) == N, "Cache size matches batch");
+
+    /* Mix hits with misses: odd positions ask for keys that were never set. */
+    char miss_buf[N][16];
+    const char* lookup[N];
+    size_t lookup_lens[N];
+    for (int i = 0; i < N; i++) {
+        if (i % 2) {
+            lookup_lens[i] = (size_t)snprintf(miss_buf[i], sizeof(miss_buf[i]), "missing%d", i);
+            lookup[i] = miss_buf[i];
+        } else {
+            lookup[i] = keys[i];
+            lookup_lens[i] = key_lens[i];
+        }
+    }
+
+    const void* out[N];
+    size_t out_lens[N];
+    size_t hits = cache_get_many(cache, N, lookup, lookup_lens, out, out_lens);
+    TEST_ASSERT(hits == N / 2, "Batch get hit count matches");
+
+    bool ok = true;
+    for (int i = 0; i < N; i++) {
+        if (i % 2) {
+            ok = ok && out[i] == NULL && out_lens[i] == 0;
+        } else {
+            ok = ok && out[i] && out_lens[i] == value_lens[i] && memcmp(out[i], values[i], out_lens[i]) == 0;
+        }
+        if (out[i]) cache_release(out[i]);
+    }
+    TEST_ASSERT(ok, "Batch get results align with input order");
+
+    /* Duplicate keys in one batch: last occurrence wins. */
+    const char* dup_keys[3] = {"dup", "dup", "dup"};
+    size_t dup_lens[3] = {3, 3, 3};
+    const void* dup_vals[3] = {"a", "bb", "ccc"};
+    size_t dup_vlens[3] = {1, 2, 3};
+    cache_set_many(cache, 3, dup_keys, dup_lens, dup_vals, dup_vlens, 0);
+
+    size_t len = 0;
+    const void* ptr = cache_get(cache, "dup", 3, &len);
+    TEST_ASSERT(ptr && len == 3 && memcmp(ptr, "ccc", 3) == 0, "Last duplicate in batch wins");
+    if (ptr) cache_release(ptr);
+
+    cache_destroy(cache);
+}
+
 // ============= Benchmarks ============================
 
 #include <sys/time.h>
@@ -441,18 +1344,126 @@ static void test_serialization(void) {
     remove(filename);  // Delete temp file
 }
 
+/** Flips one byte of a file in place. */
+static void corrupt_byte(const char* filename, long offset) {
+    FILE* f = fopen(filename, "r+b");
+    if (!f) return;
+    fseek(f, offset, SEEK_SET);
+    int c = fgetc(f);
+    fseek(f, offset, SEEK_SET);
+    fputc(c ^ 0x5A, f);
+    fclose(f);
+}
+
+/** Test: Sectioned snapshots, parallel load and corruption handling. */
+static void test_snapshot(void) {
+    printf("\n[TEST] Snapshot Format\n");
+    const char* filename = "test_cache_snapshot.bin";
+
+    cache_config_t cfg = {.capacity = 8000, .shard_count = 8, .hash_seed = 7};
+    cache_t* c1 = cache_create_ex(&cfg);
+    if (!c1) return;
+
+    char key[32];
+    for (int k = 0; k < 5000; k++) {
+        snprintf(key, sizeof(key), "snap%d", k);
+        cache_set(c1, key, strlen(key), &k, sizeof(k), 0);
+    }
+    int saved_count = count_present(c1, "snap", 5000);
+    TEST_ASSERT(cache_save(c1, filename), "Snapshot saved");
+    cache_destroy(c1);
+
+    cache_t* c2 = cache_create_ex(&cfg);
+    TEST_ASSERT(cache_load_ex(c2, filename, 4), "Snapshot loaded on 4 threads");
+    TEST_ASSERT(count_present(c2, "snap", 5000) == saved_count, "Every saved entry restored");
+    cache_destroy(c2);
+
+    /* A different shard layout still loads, just without per-shard affinity. */
+    cache_config_t other = {.capacity = 8000, .shard_count = 2};
+    cache_t* c3 = cache_create_ex(&other);
+    TEST_ASSERT(cache_load_ex(c3, filename, 0), "Snapshot loads into a differently sharded cache");
+    TEST_ASSERT(count_present(c3, "snap", 5000) == saved_count, "Entries restored across shard layouts");
+    cache_destroy(c3);
+
+    /* Damage a record inside the first section: the whole load must be rejected. */
+    corrupt_byte(filename, 32 + 30);
+    cache_t* c4 = cache_create_ex(&cfg);
+    TEST_ASSERT(!cache_load_ex(c4, filename, 2), "Corrupt section reported");
+    TEST_ASSERT(get_total_cache_size(c4) == 0, "Nothing loaded from a snapshot with a corrupt section");
+    cache_destroy(c4);
+
+    /* A truncated file has no valid footer and loads nothing. */
+    FILE* f = fopen(filename, "rb");
+    if (f) {
+        static char bytes[1 << 20];
+        size_t size = fread(bytes, 1, sizeof(bytes), f);
+        fclose(f);
+        f = fopen(filename, "wb");
+        if (f) {
+            fwrite(bytes, 1, size - 16, f);
+            fclose(f);
+        }
+    }
+    cache_t* c5 = cache_create_ex(&cfg);
+    TEST_ASSERT(!cache_load(c5, filename), "Truncated snapshot rejected");
+    TEST_ASSERT(get_total_cache_size(c5) == 0, "Nothing loaded from a truncated snapshot");
+    cache_destroy(c5);
+
+    /* Version 1 files (flat record stream) still load. */
+    f = fopen(filename, "wb");
+    if (f) {
+        uint32_t header[2] = {0x45484346, 1};
+        uint64_t count = 1;
+        uint32_t klen = 6;
+        uint64_t vlen = 5;
+        int64_t expiry = (int64_t)time(NULL) + 300;
+        fwrite(header, sizeof(header), 1, f);
+        fwrite(&count, sizeof(count), 1, f);
+        fwrite(&klen, sizeof(klen), 1, f);
+        fwrite(&vlen, sizeof(vlen), 1, f);
+        fwrite(&expiry, sizeof(expiry), 1, f);
+        fwrite("legacy", 1, klen, f);
+        fwrite("value", 1, vlen, f);
+        fclose(f);
+    }
+    cache_t* c6 = cache_create(100, 300);
+    TEST_ASSERT(cache_load(c6, filename), "Version 1 file loaded");
+    size_t len = 0;
+    const void* v = cache_get(c6, "legacy", 6, &len);
+    TEST_ASSERT(v != NULL && len == 5 && memcmp(v, "value", 5) == 0, "Version 1 entry restored");
+    cache_release(v);
+    cache_destroy(c6);
+
+    remove(filename);
+}
+
 int main(void) {
     printf("=================================\n");
     printf("  Cache Implementation Tests (Phase 3)\n");
     printf("=================================\n");
 
     test_create_destroy();
+    test_create_ex();
     test_set_get();
     test_update();
     test_lru_eviction();
+    test_ms_ttl();
+    test_sweeper();
+    test_memory_budget();
+    test_tinylfu_admission();
+    test_custom_hash();
+    test_high_load_factor();
+    test_resize();
+    test_stats();
+    test_get_or_load();
+    test_reserve_commit();
+    test_pinned_reads();
     test_input_validation();
     test_concurrent_access();
+    test_batch_ops();
+    test_optimistic_reads();
     test_serialization();
+    test_snapshot();
 
     printf("\n=================================\n");
     printf("  Passed: %d, Failed: %d\n", tests_passed, tests_failed);
@@ -834,6 +834,51 @@ int main(void) {
         printf("Optimized Input tests passed!\n");
     }
 
+    // Test arena-backed strings
+    {
+        printf("\nTesting cstr_new_arena...\n");
+        Arena* arena = arena_create(0);
+        ASSERT(arena);
+
+        ASSERT(cstr_new_arena(NULL, "x") == NULL);
+        ASSERT(cstr_new_arena(arena, NULL) == NULL);
+
+        cstr* s = cstr_new_arena(arena, "Hello");
+        ASSERT_cstr_equals(s, "Hello", "cstr_new_arena");
+        ASSERT(cstr_is_arena(s) && cstr_allocated(s));
+
+        // The string is the arena's latest allocation, so growth is in place
+        const char* before = cstr_data_const(s);
+        for (int i = 0; i < 100; i++) {
+            ASSERT(cstr_append(s, ", World"));
+        }
+        ASSERT(cstr_len(s) == 5 + 100 * 7);
+        ASSERT(cstr_data_const(s) == before);
+        printf("cstr_append grows arena string in place: Passed\n");
+
+        // Once something else is allocated the bytes move but stay in the arena
+        cstr* t = cstr_new_len_arena(arena, "abc", 3);
+        ASSERT_cstr_equals(t, "abc", "cstr_new_len_arena");
+        ASSERT(cstr_reserve(s, cstr_capacity(s) * 2));
+        ASSERT(cstr_data_const(s) != before);
+        ASSERT(cstr_append_fmt(s, "%d", 42));
+        ASSERT(cstr_len(s) == 5 + 100 * 7 + 2 && strcmp(cstr_data_const(s) + cstr_len(s) - 2, "42") == 0);
+        ASSERT(cstr_is_arena(s));
+        printf("cstr_reserve after interleaved alloc: Passed\n");
+
+        // Derived strings are ordinary heap strings
+        cstr* sub = cstr_substr(t, 1, 2);
+        ASSERT_cstr_equals(sub, "bc", "cstr_substr of arena string");
+        ASSERT(!cstr_is_arena(sub));
+        cstr_free(sub);
+
+        cstr_shrink_to_fit(s);
+        cstr_free(s);  // no-op for arena strings
+        cstr_free(t);
+        arena_destroy(arena);
+        printf("Arena string tests passed!\n");
+    }
+
     printf("\nAll tests passed successfully!\n");
     return 0;
 }
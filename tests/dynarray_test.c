@@ -275,6 +275,52 @@ static void test_clear(void) {
     dynarray_clear(NULL);  // No-op, void return
 }
 
+static void test_arena(void) {
+    Arena* arena = arena_create_reserved(64UL << 20);
+    TEST_ASSERT(arena != NULL, "Failed to create arena");
+
+    dynarray_t arr;
+    TEST_ASSERT(!dynarray_init_arena(&arr, NULL, sizeof(int), 0), "Should fail on NULL arena");
+    TEST_ASSERT(dynarray_init_arena(&arr, arena, sizeof(int), 0), "Failed to init arena array");
+    TEST_ASSERT(arr.arena == arena, "Array should remember its arena");
+
+    // Sole user of a reserved arena: every grow extends the buffer in place
+    void* first = arr.data;
+    for (int i = 0; i < 100000; ++i) {
+        TEST_ASSERT(dynarray_push(&arr, &i), "Push %d failed", i);
+    }
+    TEST_ASSERT(arr.data == first, "Buffer should grow in place");
+    for (int i = 0; i < 100000; ++i) {
+        TEST_ASSERT(*(int*)dynarray_get(&arr, (size_t)i) == i, "Value %d mismatch", i);
+    }
+
+    // Shrinking keeps the buffer
+    size_t cap = arr.capacity;
+    int out;
+    while (arr.size > 10) {
+        dynarray_pop(&arr, &out);
+    }
+    TEST_ASSERT(dynarray_shrink_to_fit(&arr), "Shrink should succeed");
+    TEST_ASSERT(arr.capacity == cap && arr.data == first, "Arena buffer should not shrink");
+
+    // Interleaved allocations force a copy on the next grow
+    dynarray_t other;
+    TEST_ASSERT(dynarray_init_arena(&other, arena, sizeof(int), 4), "Failed to init second array");
+    int vals[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+    arena_alloc(arena, 64);
+    TEST_ASSERT(dynarray_push_n(&other, vals, 4), "push_n failed");
+    arena_alloc(arena, 64);
+    TEST_ASSERT(dynarray_push_n(&other, vals + 4, 12), "push_n across a copy failed");
+    for (int i = 0; i < 16; ++i) {
+        TEST_ASSERT(*(int*)dynarray_get(&other, (size_t)i) == i, "Copied value %d mismatch", i);
+    }
+
+    dynarray_free(&arr);
+    TEST_ASSERT(arr.data == NULL && arr.arena == NULL, "Free should reset the struct");
+    dynarray_free(&other);
+    arena_destroy(arena);
+}
+
 int main(void) {
     test_init();
     test_free();
@@ -284,6 +330,7 @@ int main(void) {
     test_reserve();
     test_shrink_to_fit();
     test_clear();
+    test_arena();
 
     printf("All tests passed!\n");
     return 0;
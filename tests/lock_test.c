@@ -2,6 +2,7 @@
 #include "../include/thread.h"
 
 #include <assert.h>
+#include <stdatomic.h>
 #include <stdio.h>
 
 #define NUM_THREADS 10
@@ -96,6 +97,39 @@ void test_cond_brodcast() {
     printf("Cond Broadcast variables test passed\n");
 }
 
+static atomic_uint futex_word = 0;
+
+void* futex_waker(void* arg) {
+    (void)arg;
+    atomic_store(&futex_word, 1);
+    futex_wake_all(&futex_word);
+    return NULL;
+}
+
+void test_futex() {
+    // A word that no longer holds the expected value returns at once.
+    atomic_store(&futex_word, 5);
+    assert(futex_wait(&futex_word, 0, -1) == 0);
+
+    // Nobody wakes: the wait times out.
+    atomic_store(&futex_word, 0);
+    assert(futex_wait(&futex_word, 0, 10) == -1);
+
+    // Waking with nobody asleep is harmless.
+    assert(futex_wake_one(&futex_word) == 0);
+    assert(futex_wake_all(&futex_word) == 0);
+
+    Thread thread = {0};
+    thread_create(&thread, futex_waker, NULL);
+    while (atomic_load(&futex_word) == 0) {
+        futex_wait(&futex_word, 0, -1);
+    }
+    thread_join(thread, NULL);
+
+    assert(atomic_load(&futex_word) == 1);
+    printf("Futex wait/wake test passed\n");
+}
+
 int main(void) {
     lock_init(&lock);
 
@@ -120,5 +154,6 @@ int main(void) {
 
     test_condition_variables();
     test_cond_brodcast();
+    test_futex();
     return 0;
 }
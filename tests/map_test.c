@@ -58,6 +58,35 @@ void test_concurrent_map() {
     map_destroy(m);
 }
 
+void test_arena_map() {
+    Arena* arena = arena_create(0);
+    ASSERT(arena);
+
+    MapConfig cfg = {.key_compare = key_compare_int, .arena = arena};
+    HashMap* m    = map_create(&cfg);
+    ASSERT(m);
+
+    // Grow through several resizes; outgrown tables stay in the arena
+    static int keys[4096];
+    for (int i = 0; i < 4096; ++i) {
+        keys[i] = i;
+        ASSERT(map_set(m, &keys[i], sizeof(int), &keys[i]));
+    }
+    ASSERT(map_length(m) == 4096);
+    for (int i = 0; i < 4096; ++i) {
+        int* value = map_get(m, &keys[i], sizeof(int));
+        ASSERT(value && *value == i);
+    }
+    ASSERT(map_remove(m, &keys[7], sizeof(int)));
+    ASSERT(map_get(m, &keys[7], sizeof(int)) == NULL);
+
+    size_t used = arena_used_size(arena);
+    ASSERT(used > 4096 * 3 * sizeof(void*));
+
+    map_destroy(m);  // releases the lock only; memory goes with the arena
+    arena_destroy(arena);
+}
+
 int main(void) {
 
     int* arr = malloc(MAP_SIZE * sizeof(int));
@@ -103,6 +132,7 @@ int main(void) {
     map_destroy(m);
 
     test_concurrent_map();
+    test_arena_map();
 
     clock_gettime(CLOCK_MONOTONIC, &end);
 
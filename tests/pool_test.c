@@ -0,0 +1,225 @@
+#include "../include/pool.h"
+#include "../include/macros.h"
+#include "../include/thread.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_THREADS    8
+#define THREAD_ROUNDS  20000
+#define LIVE_PER_ROUND 48
+
+// ============================================================================
+// Test Infrastructure
+// ============================================================================
+
+static int g_pass = 0;
+static int g_fail = 0;
+
+static void print_result(const char* name, int ok) {
+    printf("  %-56s %s\n", name, ok ? "PASS" : "FAIL");
+    ok ? g_pass++ : g_fail++;
+}
+
+static void print_section(const char* name) {
+    printf("\n%s\n", name);
+}
+
+static int is_aligned(const void* ptr, size_t alignment) {
+    return ((uintptr_t)ptr & (alignment - 1)) == 0;
+}
+
+// ============================================================================
+// Size Classes
+// ============================================================================
+
+static void test_size_classes(void) {
+    print_section("Size classes");
+
+    print_result("1 byte rounds to 16", pool_size_class(1) == 16);
+    print_result("128 bytes is its own class", pool_size_class(128) == 128);
+    print_result("129 bytes rounds to 160", pool_size_class(129) == 160);
+    print_result("257 bytes rounds to 320", pool_size_class(257) == 320);
+    print_result("POOL_MAX_SIZE is its own class", pool_size_class(POOL_MAX_SIZE) == POOL_MAX_SIZE);
+    print_result("sizes above POOL_MAX_SIZE are unrounded", pool_size_class(POOL_MAX_SIZE + 1) == POOL_MAX_SIZE + 1);
+
+    int monotonic = 1;
+    for (size_t s = 1; s <= POOL_MAX_SIZE; s++) {
+        size_t c = pool_size_class(s);
+        if (c < s || c % 16 != 0 || c > s + s / 4 + 16) monotonic = 0;
+    }
+    print_result("every class fits its request within 25% + 16 bytes", monotonic);
+}
+
+// ============================================================================
+// Reuse
+// ============================================================================
+
+static void test_reuse(void) {
+    print_section("Freelist reuse");
+
+    Arena* a = arena_create(0);
+    ASSERT(a);
+    ArenaPool* pool = pool_create(a);
+    print_result("pool_create succeeds", pool != NULL);
+    print_result("pool_create(NULL) returns NULL", pool_create(NULL) == NULL);
+
+    void* p = pool_alloc(pool, 40);
+    print_result("alloc returns 16-byte aligned memory", p && is_aligned(p, 16));
+    memset(p, 0xCD, 40);
+    pool_free(pool, p, 40);
+    void* q = pool_alloc(pool, 33); /* same 48-byte class */
+    print_result("freed object reused by the next same-class alloc", q == p);
+    pool_free(pool, q, 33);
+
+    print_result("zero-size alloc returns NULL", pool_alloc(pool, 0) == NULL);
+    pool_free(pool, NULL, 16);
+    print_result("free(NULL) is a no-op", 1);
+
+    int* z = pool_alloc_zero(pool, 64 * sizeof(int));
+    int zeroed = z != NULL;
+    for (int i = 0; zeroed && i < 64; i++) zeroed = z[i] == 0;
+    print_result("pool_alloc_zero returns zeroed memory", zeroed);
+    pool_free(pool, z, 64 * sizeof(int));
+
+    void* big = pool_alloc(pool, POOL_MAX_SIZE * 4);
+    print_result("large alloc served straight from the arena", big && is_aligned(big, 16));
+    pool_free(pool, big, POOL_MAX_SIZE * 4);
+
+    /* Steady-state churn must stop drawing on the arena. */
+    void* live[256];
+    for (int i = 0; i < 256; i++) live[i] = pool_alloc(pool, 100);
+    for (int i = 0; i < 256; i++) pool_free(pool, live[i], 100);
+    size_t used = arena_used_size(a);
+    for (int round = 0; round < 1000; round++) {
+        for (int i = 0; i < 256; i++) live[i] = pool_alloc(pool, 100);
+        for (int i = 0; i < 256; i++) pool_free(pool, live[i], 100);
+    }
+    print_result("steady alloc/free churn does not grow the arena", arena_used_size(a) == used);
+
+    /* Distinct live objects never overlap. */
+    int distinct = 1;
+    for (int i = 0; i < 256; i++) {
+        live[i] = pool_alloc(pool, 24);
+        memset(live[i], i & 0xFF, 24);
+    }
+    for (int i = 0; i < 256 && distinct; i++) {
+        const unsigned char* b = live[i];
+        for (int j = 0; j < 24; j++) distinct = distinct && b[j] == (unsigned char)(i & 0xFF);
+    }
+    for (int i = 0; i < 256; i++) pool_free(pool, live[i], 24);
+    print_result("live objects do not overlap", distinct);
+
+    arena_destroy(a);
+}
+
+// ============================================================================
+// Multithreaded
+// ============================================================================
+
+typedef struct {
+    ArenaPool* pool;
+    int id;
+    int ok;
+} churn_arg_t;
+
+static void* churn_thread(void* arg) {
+    churn_arg_t* c = arg;
+    void* live[LIVE_PER_ROUND];
+    size_t sizes[LIVE_PER_ROUND];
+    uint32_t rng = 0x9E3779B9u * (uint32_t)(c->id + 1);
+
+    c->ok = 1;
+    for (int round = 0; round < THREAD_ROUNDS / LIVE_PER_ROUND; round++) {
+        for (int i = 0; i < LIVE_PER_ROUND; i++) {
+            rng = rng * 1664525u + 1013904223u;
+            sizes[i] = 8 + (rng >> 16) % 600;
+            live[i] = pool_alloc(c->pool, sizes[i]);
+            if (!live[i]) {
+                c->ok = 0;
+                return NULL;
+            }
+            memset(live[i], c->id, sizes[i]);
+        }
+        for (int i = 0; i < LIVE_PER_ROUND; i++) {
+            const unsigned char* b = live[i];
+            if (b[0] != (unsigned char)c->id || b[sizes[i] - 1] != (unsigned char)c->id) c->ok = 0;
+            pool_free(c->pool, live[i], sizes[i]);
+        }
+    }
+    return NULL;
+}
+
+typedef struct {
+    ArenaPool* pool;
+    void** slots;
+    size_t count;
+} handoff_t;
+
+static void* producer_thread(void* arg) {
+    handoff_t* h = arg;
+    for (size_t i = 0; i < h->count; i++) h->slots[i] = pool_alloc(h->pool, 64);
+    return NULL;
+}
+
+static void test_multithreaded(void) {
+    print_section("Multithreaded");
+
+    Arena* a = arena_create(0);
+    ASSERT(a);
+    ArenaPool* pool = pool_create(a);
+    ASSERT(pool);
+
+    Thread threads[NUM_THREADS];
+    churn_arg_t args[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; i++) {
+        args[i] = (churn_arg_t){.pool = pool, .id = i + 1};
+        thread_create(&threads[i], churn_thread, &args[i]);
+    }
+    int ok = 1;
+    for (int i = 0; i < NUM_THREADS; i++) {
+        thread_join(threads[i], NULL);
+        ok = ok && args[i].ok;
+    }
+    print_result("concurrent churn keeps objects private to their owner", ok);
+
+    /* Objects allocated on one thread and freed on another are recycled.  The
+     * producer is joined before anything is freed, so it never sees the freed
+     * objects and every slot holds a distinct object. */
+    enum { HANDOFF = 4096 };
+    void** slots = malloc(HANDOFF * sizeof(void*));
+    ASSERT(slots);
+    handoff_t h = {.pool = pool, .slots = slots, .count = HANDOFF};
+    Thread producer;
+    thread_create(&producer, producer_thread, &h);
+    thread_join(producer, NULL);
+    for (size_t i = 0; i < HANDOFF; i++) pool_free(pool, slots[i], 64);
+
+    size_t used = arena_used_size(a);
+    for (size_t i = 0; i < HANDOFF; i++) slots[i] = pool_alloc(pool, 64);
+    for (size_t i = 0; i < HANDOFF; i++) pool_free(pool, slots[i], 64);
+    print_result("cross-thread frees are reused without arena growth", arena_used_size(a) == used);
+
+    free(slots);
+    arena_destroy(a);
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(void) {
+    printf("Arena Pool Test Suite\n");
+    printf("=====================\n");
+
+    test_size_classes();
+    test_reuse();
+    test_multithreaded();
+
+    printf("\n=====================\n");
+    printf("Results: %d passed, %d failed\n", g_pass, g_fail);
+    return g_fail > 0 ? 1 : 0;
+}
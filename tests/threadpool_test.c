@@ -8,6 +8,7 @@
 #include <stdarg.h>
 #include <stdatomic.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -258,6 +259,76 @@ int test_queue_overflow_behavior() {
     return 1;
 }
 
+/*
+ * test_many_producers_full_queue
+ *
+ * Many external threads submit one task at a time, far more than the global
+ * queue holds, to a small pool.  Producers that find the queue full must
+ * sleep and be woken as workers drain it; every task must run exactly once.
+ */
+#define PRODUCERS          8
+#define TASKS_PER_PRODUCER 10000
+
+static void* single_submit_thread(void* arg) {
+    Threadpool* pool = (Threadpool*)arg;
+    for (int i = 0; i < TASKS_PER_PRODUCER; i++) {
+        if (!threadpool_submit(pool, counter_task, NULL)) atomic_fetch_add(&error_count, 1);
+    }
+    return NULL;
+}
+
+int test_many_producers_full_queue() {
+    Threadpool* pool = threadpool_create(2);
+    TEST_ASSERT(pool != NULL, "Many producers: pool creation");
+
+    atomic_store(&test_counter, 0);
+    atomic_store(&completed_tasks, 0);
+    int errors_before = atomic_load(&error_count);
+
+    pthread_t tids[PRODUCERS];
+    for (int i = 0; i < PRODUCERS; i++) thread_create(&tids[i], single_submit_thread, pool);
+    for (int i = 0; i < PRODUCERS; i++) thread_join(tids[i], NULL);
+    TEST_ASSERT(atomic_load(&error_count) == errors_before, "Many producers: every submit succeeded");
+
+    threadpool_wait(pool);
+    TEST_ASSERT(atomic_load(&test_counter) == PRODUCERS * TASKS_PER_PRODUCER,
+                "Many producers: every task ran exactly once");
+
+    threadpool_destroy(pool, -1);
+    return 1;
+}
+
+/*
+ * test_park_wake_cycles
+ *
+ * Lets every worker park, then submits a single task, over and over.  Each
+ * task must be picked up by a woken worker; a lost wakeup leaves it queued
+ * with everyone asleep, which the bounded poll reports instead of hanging.
+ */
+#define PARK_CYCLES       200
+#define PARK_WAKE_TIMEOUT 2000 /* ms per cycle */
+
+int test_park_wake_cycles() {
+    Threadpool* pool = threadpool_create(4);
+    TEST_ASSERT(pool != NULL, "Park/wake: pool creation");
+
+    atomic_store(&test_counter, 0);
+    for (int i = 0; i < PARK_CYCLES; i++) {
+        usleep(1000); /* long enough for idle workers to pass YIELD_THRESHOLD and park */
+        TEST_ASSERT(threadpool_submit(pool, counter_task, NULL), "Park/wake: submit");
+
+        int waited = 0;
+        while (atomic_load(&test_counter) == i && waited < PARK_WAKE_TIMEOUT * 10) {
+            usleep(100);
+            waited++;
+        }
+        TEST_ASSERT(atomic_load(&test_counter) == i + 1, "Park/wake: a parked worker woke for the task");
+    }
+
+    threadpool_destroy(pool, -1);
+    return 1;
+}
+
 int test_rapid_create_destroy() {
     for (int i = 0; i < 50; i++) {
         Threadpool* pool = threadpool_create(4);
@@ -664,6 +735,459 @@ int test_batch_concurrent_submitters() {
     return 1;
 }
 
+// =============================================================================
+// TaskGroup (fork-join) Tests
+// =============================================================================
+
+typedef struct {
+    Threadpool* pool;
+    int n;
+    long result;
+} fib_arg;
+
+static long fib_serial(int n) {
+    return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+/*
+ * fib_task — textbook recursive fork-join: spawn one child, compute the
+ * other inline, then join.  Every level above the cutoff calls tg_wait()
+ * from inside a running task.
+ */
+static void fib_task(void* varg) {
+    fib_arg* a = (fib_arg*)varg;
+    if (a->n < 12) {
+        a->result = fib_serial(a->n);
+        return;
+    }
+    fib_arg left = {a->pool, a->n - 1, 0};
+    fib_arg right = {a->pool, a->n - 2, 0};
+
+    TaskGroup tg;
+    tg_init(&tg, a->pool);
+    tg_spawn(&tg, fib_task, &left);
+    fib_task(&right);
+    tg_wait(&tg);
+    a->result = left.result + right.result;
+}
+
+int test_tg_invalid_parameters() {
+    Threadpool* pool = threadpool_create(2);
+    TEST_ASSERT(pool != NULL, "TaskGroup invalid: pool creation");
+
+    TaskGroup tg;
+    tg_init(&tg, pool);
+    TEST_ASSERT(!tg_spawn(NULL, counter_task, NULL), "tg_spawn(NULL group) should fail");
+    TEST_ASSERT(!tg_spawn(&tg, NULL, NULL), "tg_spawn(NULL function) should fail");
+    tg_wait(NULL);
+    tg_wait(&tg); /* empty group returns immediately */
+
+    threadpool_destroy(pool, -1);
+    return 1;
+}
+
+/*
+ * test_tg_external_spawn
+ *
+ * Tasks spawned from a non-worker thread go through the global queue, and
+ * tg_wait() must not return before every one of them has run — without any
+ * help from threadpool_wait().
+ */
+int test_tg_external_spawn() {
+    Threadpool* pool = threadpool_create(4);
+    TEST_ASSERT(pool != NULL, "TaskGroup external: pool creation");
+
+    atomic_store(&test_counter, 0);
+    atomic_store(&completed_tasks, 0);
+
+    TaskGroup tg;
+    tg_init(&tg, pool);
+    const int N = 5000;
+    for (int i = 0; i < N; i++) {
+        TEST_ASSERT(tg_spawn(&tg, counter_task, NULL), "TaskGroup external: spawn should succeed");
+    }
+    tg_wait(&tg);
+    TEST_ASSERT(atomic_load(&test_counter) == N, "TaskGroup external: all tasks done when tg_wait returns");
+
+    /* The group is reusable once waited on. */
+    for (int i = 0; i < N; i++) tg_spawn(&tg, counter_task, NULL);
+    tg_wait(&tg);
+    TEST_ASSERT(atomic_load(&test_counter) == 2 * N, "TaskGroup external: reused group waits again");
+
+    threadpool_destroy(pool, -1);
+    return 1;
+}
+
+/*
+ * test_tg_recursive
+ *
+ * Recursive fork-join from worker threads.  With a single worker, progress
+ * depends entirely on tg_wait() executing the children it is waiting for.
+ */
+int test_tg_recursive() {
+    const int n = 24;
+    long expected = fib_serial(n);
+
+    size_t sizes[] = {1, 4};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        Threadpool* pool = threadpool_create(sizes[s]);
+        TEST_ASSERT(pool != NULL, "TaskGroup recursive: pool creation");
+
+        fib_arg root = {pool, n, 0};
+        TaskGroup tg;
+        tg_init(&tg, pool);
+        TEST_ASSERT(tg_spawn(&tg, fib_task, &root), "TaskGroup recursive: root spawn");
+        tg_wait(&tg);
+        TEST_ASSERT(root.result == expected, "TaskGroup recursive: fib result correct");
+
+        /* threadpool_wait sees no stragglers from the nested groups. */
+        threadpool_wait(pool);
+        threadpool_destroy(pool, -1);
+    }
+    return 1;
+}
+
+/*
+ * test_tg_concurrent_groups
+ *
+ * Independent groups waited on from several external threads at once must
+ * each see only their own completion.
+ */
+typedef struct {
+    Threadpool* pool;
+    atomic_int counter;
+    int ok;
+} group_waiter_arg;
+
+static void group_counter_task(void* arg) {
+    atomic_fetch_add(&((group_waiter_arg*)arg)->counter, 1);
+}
+
+static void* group_waiter_thread(void* varg) {
+    group_waiter_arg* a = (group_waiter_arg*)varg;
+    TaskGroup tg;
+    tg_init(&tg, a->pool);
+    for (int i = 0; i < 1000; i++) tg_spawn(&tg, group_counter_task, a);
+    tg_wait(&tg);
+    a->ok = atomic_load(&a->counter) == 1000;
+    return NULL;
+}
+
+int test_tg_concurrent_groups() {
+    Threadpool* pool = threadpool_create(4);
+    TEST_ASSERT(pool != NULL, "TaskGroup concurrent: pool creation");
+
+    enum { WAITERS = 4 };
+    group_waiter_arg args[WAITERS];
+    pthread_t tids[WAITERS];
+    for (int i = 0; i < WAITERS; i++) {
+        args[i].pool = pool;
+        atomic_init(&args[i].counter, 0);
+        args[i].ok = 0;
+        thread_create(&tids[i], group_waiter_thread, &args[i]);
+    }
+    for (int i = 0; i < WAITERS; i++) thread_join(tids[i], NULL);
+    for (int i = 0; i < WAITERS; i++) {
+        TEST_ASSERT(args[i].ok, "TaskGroup concurrent: each group complete when its wait returns");
+    }
+
+    threadpool_destroy(pool, -1);
+    return 1;
+}
+
+// =============================================================================
+// Parallel Loop Tests
+// =============================================================================
+
+#define PF_N 100000
+
+static atomic_int pf_hits[PF_N];
+
+static void pf_mark(size_t begin, size_t end, void* ctx) {
+    (void)ctx;
+    for (size_t i = begin; i < end; i++) atomic_fetch_add(&pf_hits[i], 1);
+}
+
+static int pf_all_hit_once(size_t begin, size_t end) {
+    for (size_t i = 0; i < PF_N; i++) {
+        int expected = i >= begin && i < end;
+        if (atomic_load(&pf_hits[i]) != expected) return 0;
+    }
+    return 1;
+}
+
+static void pf_clear(void) {
+    for (size_t i = 0; i < PF_N; i++) atomic_store(&pf_hits[i], 0);
+}
+
+static void pf_sum(size_t begin, size_t end, void* acc, void* ctx) {
+    const uint32_t* v = (const uint32_t*)ctx;
+    uint64_t s = 0;
+    for (size_t i = begin; i < end; i++) s += v[i];
+    *(uint64_t*)acc += s;
+}
+
+static void pf_add(void* acc, const void* other, void* ctx) {
+    (void)ctx;
+    *(uint64_t*)acc += *(const uint64_t*)other;
+}
+
+/*
+ * test_parallel_for_coverage
+ *
+ * Every index in the range is visited exactly once and nothing outside it,
+ * for automatic, tiny and oversized grains.
+ */
+int test_parallel_for_coverage() {
+    Threadpool* pool = threadpool_create(4);
+    TEST_ASSERT(pool != NULL, "parallel_for: pool creation");
+
+    size_t grains[] = {0, 1, 7, 1000, PF_N * 2};
+    for (size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); g++) {
+        pf_clear();
+        TEST_ASSERT(threadpool_parallel_for(pool, 0, PF_N, grains[g], pf_mark, NULL), "parallel_for: returns true");
+        TEST_ASSERT(pf_all_hit_once(0, PF_N), "parallel_for: each index visited exactly once");
+    }
+
+    pf_clear();
+    threadpool_parallel_for(pool, 123, 45678, 0, pf_mark, NULL);
+    TEST_ASSERT(pf_all_hit_once(123, 45678), "parallel_for: offset range covered exactly");
+
+    pf_clear();
+    TEST_ASSERT(threadpool_parallel_for(pool, 10, 10, 0, pf_mark, NULL), "parallel_for: empty range succeeds");
+    TEST_ASSERT(pf_all_hit_once(0, 0), "parallel_for: empty range runs nothing");
+
+    TEST_ASSERT(!threadpool_parallel_for(NULL, 0, 10, 0, pf_mark, NULL), "parallel_for: NULL pool fails");
+    TEST_ASSERT(!threadpool_parallel_for(pool, 0, 10, 0, NULL, NULL), "parallel_for: NULL fn fails");
+
+    threadpool_destroy(pool, -1);
+    return 1;
+}
+
+/*
+ * test_parallel_for_nested
+ *
+ * A parallel_for issued from inside a running task joins by helping, so it
+ * completes even on a single-worker pool.
+ */
+static void pf_nested_task(void* arg) {
+    Threadpool* pool = (Threadpool*)arg;
+    threadpool_parallel_for(pool, 0, PF_N, 64, pf_mark, NULL);
+    atomic_fetch_add(&completed_tasks, 1);
+}
+
+int test_parallel_for_nested() {
+    Threadpool* pool = threadpool_create(1);
+    TEST_ASSERT(pool != NULL, "parallel_for nested: pool creation");
+
+    pf_clear();
+    atomic_store(&completed_tasks, 0);
+    TaskGroup tg;
+    tg_init(&tg, pool);
+    tg_spawn(&tg, pf_nested_task, pool);
+    tg_wait(&tg);
+    TEST_ASSERT(atomic_load(&completed_tasks) == 1, "parallel_for nested: task finished");
+    TEST_ASSERT(pf_all_hit_once(0, PF_N), "parallel_for nested: each index visited exactly once");
+
+    threadpool_destroy(pool, -1);
+    return 1;
+}
+
+/*
+ * test_parallel_reduce_sum
+ *
+ * The reduction matches a serial sum regardless of grain, and the result is
+ * the identity for an empty range.
+ */
+int test_parallel_reduce_sum() {
+    Threadpool* pool = threadpool_create(4);
+    TEST_ASSERT(pool != NULL, "parallel_reduce: pool creation");
+
+    uint32_t* v = (uint32_t*)malloc(PF_N * sizeof(uint32_t));
+    TEST_ASSERT(v != NULL, "parallel_reduce: allocation");
+    uint64_t expected = 0;
+    for (size_t i = 0; i < PF_N; i++) {
+        v[i] = (uint32_t)(i * 2654435761u);
+        expected += v[i];
+    }
+
+    const uint64_t zero = 0;
+    size_t grains[] = {0, 1, 333, PF_N};
+    for (size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); g++) {
+        uint64_t total = 1;
+        TEST_ASSERT(threadpool_parallel_reduce(pool, 0, PF_N, grains[g], pf_sum, pf_add, &zero, &total,
+                                               sizeof(total), v),
+                    "parallel_reduce: returns true");
+        TEST_ASSERT(total == expected, "parallel_reduce: sum matches serial");
+    }
+
+    uint64_t total = 42;
+    threadpool_parallel_reduce(pool, 5, 5, 0, pf_sum, pf_add, &zero, &total, sizeof(total), v);
+    TEST_ASSERT(total == 0, "parallel_reduce: empty range yields the identity");
+
+    total = 42;
+    TEST_ASSERT(!threadpool_parallel_reduce(pool, 0, 10, 0, pf_sum, NULL, &zero, &total, sizeof(total), v),
+                "parallel_reduce: NULL combine fails");
+    TEST_ASSERT(total == 42, "parallel_reduce: result untouched on failure");
+
+    free(v);
+    threadpool_destroy(pool, -1);
+    return 1;
+}
+
+// =============================================================================
+// Future Tests
+// =============================================================================
+
+static void* square_task(void* arg) {
+    intptr_t x = (intptr_t)arg;
+    return (void*)(x * x);
+}
+
+static void* add_then(void* arg, void* result) {
+    return (void*)((intptr_t)result + (intptr_t)arg);
+}
+
+int test_future_basic() {
+    TEST_ASSERT(threadpool_submit_future(NULL, square_task, NULL) == NULL, "Future: NULL pool rejected");
+    TEST_ASSERT(future_wait(NULL) == NULL, "Future: waiting on NULL returns NULL");
+    TEST_ASSERT(!future_try_get(NULL, NULL), "Future: try_get on NULL fails");
+
+    Threadpool* pool = threadpool_create(4);
+    TEST_ASSERT(pool != NULL, "Future: pool creation");
+    TEST_ASSERT(threadpool_submit_future(pool, NULL, NULL) == NULL, "Future: NULL function rejected");
+    TEST_ASSERT(future_then(NULL, add_then, NULL) == NULL, "Future: then on NULL rejected");
+
+    Future* futures[256];
+    for (intptr_t i = 0; i < 256; i++) {
+        futures[i] = threadpool_submit_future(pool, square_task, (void*)i);
+        TEST_ASSERT(futures[i] != NULL, "Future: submit");
+    }
+    for (intptr_t i = 0; i < 256; i++) {
+        TEST_ASSERT((intptr_t)future_wait(futures[i]) == i * i, "Future: wait returns the task's result");
+        void* r = NULL;
+        TEST_ASSERT(future_try_get(futures[i], &r) && (intptr_t)r == i * i, "Future: try_get after completion");
+        future_release(futures[i]);
+    }
+
+    /* Released futures are recycled, so long runs reuse the same objects. */
+    for (int i = 0; i < 20000; i++) {
+        Future* f = threadpool_submit_future(pool, square_task, (void*)(intptr_t)3);
+        TEST_ASSERT(f && (intptr_t)future_wait(f) == 9, "Future: submit/wait/release cycle");
+        future_release(f);
+    }
+
+    threadpool_destroy(pool, -1);
+    return 1;
+}
+
+/*
+ * test_future_then_chain
+ *
+ * A chain of continuations, each adding one, whose head is released at once,
+ * plus continuations attached after their parent has already completed.
+ */
+#define THEN_CHAIN 1000
+
+int test_future_then_chain() {
+    Threadpool* pool = threadpool_create(4);
+    TEST_ASSERT(pool != NULL, "Future then: pool creation");
+
+    Future* f = threadpool_submit_future(pool, square_task, (void*)(intptr_t)10);
+    TEST_ASSERT(f != NULL, "Future then: submit");
+    for (int i = 0; i < THEN_CHAIN; i++) {
+        Future* next = future_then(f, add_then, (void*)(intptr_t)1);
+        TEST_ASSERT(next != NULL, "Future then: chain");
+        future_release(f);
+        f = next;
+    }
+    TEST_ASSERT((intptr_t)future_wait(f) == 100 + THEN_CHAIN, "Future then: chain result");
+
+    Future* late = future_then(f, add_then, (void*)(intptr_t)5);
+    TEST_ASSERT(late != NULL, "Future then: continuation on a completed future");
+    TEST_ASSERT((intptr_t)future_wait(late) == 105 + THEN_CHAIN, "Future then: late continuation result");
+    future_release(late);
+    future_release(f);
+
+    threadpool_destroy(pool, -1);
+    return 1;
+}
+
+int test_future_when_all() {
+    Threadpool* pool = threadpool_create(4);
+    TEST_ASSERT(pool != NULL, "Future when_all: pool creation");
+    TEST_ASSERT(future_when_all(NULL, NULL, 0) == NULL, "Future when_all: NULL pool rejected");
+
+    Future* none = future_when_all(pool, NULL, 0);
+    TEST_ASSERT(none != NULL && future_try_get(none, NULL), "Future when_all: empty set is complete");
+    future_release(none);
+
+    enum { N = 500 };
+    Future* futures[N];
+    for (intptr_t i = 0; i < N; i++) {
+        futures[i] = threadpool_submit_future(pool, square_task, (void*)i);
+        TEST_ASSERT(futures[i] != NULL, "Future when_all: submit");
+    }
+    Future* all = future_when_all(pool, futures, N);
+    TEST_ASSERT(all != NULL, "Future when_all: create");
+    future_wait(all);
+
+    long long sum = 0;
+    for (int i = 0; i < N; i++) {
+        void* r = NULL;
+        TEST_ASSERT(future_try_get(futures[i], &r), "Future when_all: every input completed");
+        sum += (intptr_t)r;
+        future_release(futures[i]);
+    }
+    TEST_ASSERT(sum == (long long)(N - 1) * N * (2 * N - 1) / 6, "Future when_all: results");
+    future_release(all);
+
+    threadpool_destroy(pool, -1);
+    return 1;
+}
+
+/*
+ * test_future_wait_in_task
+ *
+ * Recursive fib where each level waits on a future for one half.  With a
+ * single worker the waiting task must run the pending child itself.
+ */
+typedef struct {
+    Threadpool* pool;
+    intptr_t n;
+} future_fib_arg;
+
+static void* future_fib(void* varg) {
+    future_fib_arg* a = (future_fib_arg*)varg;
+    if (a->n < 12) return (void*)(intptr_t)fib_serial((int)a->n);
+
+    future_fib_arg lo = {a->pool, a->n - 1};
+    future_fib_arg hi = {a->pool, a->n - 2};
+    Future* f = threadpool_submit_future(a->pool, future_fib, &lo);
+    if (!f) return (void*)(intptr_t)-1;
+    intptr_t b = (intptr_t)future_fib(&hi);
+    intptr_t r = (intptr_t)future_wait(f);
+    future_release(f);
+    return (void*)(r + b);
+}
+
+int test_future_wait_in_task() {
+    size_t sizes[] = {1, 4};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        Threadpool* pool = threadpool_create(sizes[s]);
+        TEST_ASSERT(pool != NULL, "Future fib: pool creation");
+
+        future_fib_arg root = {pool, 24};
+        Future* f = threadpool_submit_future(pool, future_fib, &root);
+        TEST_ASSERT(f != NULL, "Future fib: submit");
+        TEST_ASSERT((intptr_t)future_wait(f) == fib_serial(24), "Future fib: result");
+        future_release(f);
+
+        threadpool_destroy(pool, -1);
+    }
+    return 1;
+}
+
 // =============================================================================
 // Main Test Runner
 // =============================================================================
@@ -703,6 +1227,8 @@ int main(void) {
 
     // Stress and edge cases
     RUN_TEST(test_queue_overflow_behavior);
+    RUN_TEST(test_many_producers_full_queue);
+    RUN_TEST(test_park_wake_cycles);
     RUN_TEST(test_rapid_create_destroy);
     RUN_TEST(test_stress_test);
 
@@ -729,6 +1255,26 @@ int main(void) {
     RUN_TEST(test_batch_multiple_batches);
     RUN_TEST(test_batch_concurrent_submitters);
 
+    safe_printf("\n--- TaskGroup ---\n\n");
+
+    RUN_TEST(test_tg_invalid_parameters);
+    RUN_TEST(test_tg_external_spawn);
+    RUN_TEST(test_tg_recursive);
+    RUN_TEST(test_tg_concurrent_groups);
+
+    safe_printf("\n--- Parallel loops ---\n\n");
+
+    RUN_TEST(test_parallel_for_coverage);
+    RUN_TEST(test_parallel_for_nested);
+    RUN_TEST(test_parallel_reduce_sum);
+
+    safe_printf("\n--- Futures ---\n\n");
+
+    RUN_TEST(test_future_basic);
+    RUN_TEST(test_future_then_chain);
+    RUN_TEST(test_future_when_all);
+    RUN_TEST(test_future_wait_in_task);
+
     print_test_summary(result);
     return (result.failed > 0 || atomic_load(&error_count) > 0) ? 1 : 0;
 }